@@ -1,33 +1,175 @@
-Texture2D albedo;
+// texture_atlas.h, one array per texture format
+Texture2DArray albedo0 : register(t0);
+Texture2DArray albedo1 : register(t4);
+Texture2DArray albedo2 : register(t5);
+Texture2DArray albedo3 : register(t6);
 SamplerState sampler0;
 
+// shader_constants.h SubmeshTexture
+struct SubmeshTexture
+{
+    int array;
+    float layer;
+    float maxLod;
+    float padding;
+    float4 uvRect;
+};
+
+StructuredBuffer<SubmeshTexture> submeshTextures : register(t7);
+StructuredBuffer<uint> submeshTriangles : register(t8); // first triangle of every submesh of every level of every mesh this frame
+
+// shadow_cache.h, depth of the main light's cube faces compared with less equal
+TextureCube<float> shadowCube : register(t9);
+SamplerComparisonState shadowSampler : register(s1);
+
+// light_culling.h
+struct PointLight
+{
+    float3 position;
+    float radius;
+    float3 color;
+    float intensity;
+};
+
+StructuredBuffer<PointLight> pointLights : register(t1);
+StructuredBuffer<uint2> clusters : register(t2); // offset and count into clusterLightIndices
+StructuredBuffer<uint> clusterLightIndices : register(t3);
+
 struct VertexOutput
 {
     float4 pos : SV_Position;
     float4 worldPos : WORLD_POS;
     float3 normal : NORMAL;
     float2 texCoords : TEX_COORDS;
+    float viewDepth : VIEW_DEPTH;
 };
 
 cbuffer LightSettings : register(b0)
 {
-    float4 camPos0;
     float4 lightPos0;
     float4 ambientColor0;
     float4 lightColor0;
     float ambientStrength0;
     float specularStrength0;
     float specularPow0;
-    float dummyPadding0;
+    uint shadowsEnabled0;
+    float shadowNear0;
+    float shadowRange0;
+    float shadowBias0;
+    float shadowFilterRadius0;
+};
+
+// shader_constants.h ViewConstants
+cbuffer view : register(b1)
+{
+    float4x4 viewProj;
+    float4 viewDepthColumn;
+    float4 camPos0;
+    
+    uint4 clusterCounts;  // x, y, z, point light count
+    float4 clusterParams; // tile width, tile height, slice scale, slice bias
+};
+
+// shader_constants.h ObjectConstants
+cbuffer object : register(b2)
+{
+    float4 positionScale;
+    float4 positionOffset;
+    uint firstTriangle;
+    uint submeshCount;
+    uint submeshTriangleOffset;
 };
 
-float4 main(VertexOutput v) : SV_Target0
+// gradients are taken before any branch, the submesh and so the array differ between pixels of a quad
+float3 SampleAlbedo(Texture2DArray albedo, SubmeshTexture submesh, float2 uv, float2 uvDx, float2 uvDy)
+{
+    if (submesh.uvRect.x == 1.0f && submesh.uvRect.y == 1.0f)
+        return albedo.SampleGrad(sampler0, float3(uv, submesh.layer), uvDx, uvDy).rgb;
+
+    // an atlas rect wraps by hand and stops at the last level its gutter still covers
+    float width, height, layers, levels;
+    albedo.GetDimensions(0, width, height, layers, levels);
+    float2 size = float2(width, height) * submesh.uvRect.xy;
+    float2 dx = uvDx * size;
+    float2 dy = uvDy * size;
+    float lod = 0.5f * log2(max(dot(dx, dx), dot(dy, dy)));
+
+    float3 location = float3(frac(uv) * submesh.uvRect.xy + submesh.uvRect.zw, submesh.layer);
+    return albedo.SampleLevel(sampler0, location, clamp(lod, 0.0f, submesh.maxLod)).rgb;
+}
+
+// GetLightAttenuation in light_culling.cpp
+float GetLightAttenuation(float distance, float radius)
+{
+    float ratio = distance / radius;
+    float ratio2 = ratio * ratio;
+    float window = max(1.0f - ratio2 * ratio2, 0.0f);
+    return window * window / (distance * distance + 1.0f);
+}
+
+// GetClusterIndex in light_culling.cpp
+uint GetClusterIndex(float2 pixel, float viewDepth)
+{
+    uint x = min(uint(pixel.x / clusterParams.x), clusterCounts.x - 1);
+    uint y = min(uint(pixel.y / clusterParams.y), clusterCounts.y - 1);
+    float slice = floor(log(viewDepth) * clusterParams.z + clusterParams.w);
+    uint z = uint(clamp(slice, 0.0f, float(clusterCounts.z - 1)));
+    return x + y * clusterCounts.x + z * clusterCounts.x * clusterCounts.y;
+}
+
+// 1 lit to 0 shadowed. the face a direction picks is the one of its major axis, so the distance along that axis is the
+// view depth the face stored, projected like Mat4PerspectiveFovLH does it
+float GetMainLightShadow(float3 toSurface)
+{
+    float3 a = abs(toSurface);
+    float axisDistance = max(a.x, max(a.y, a.z)) - shadowBias0;
+    if (shadowsEnabled0 == 0 || axisDistance >= shadowRange0)
+        return 1.0f;
+
+    float depth = shadowRange0 / (shadowRange0 - shadowNear0) * (1.0f - shadowNear0 / max(axisDistance, shadowNear0));
+
+    // a face covers 2 * axisDistance over its width, every tap is filtered 2x2 by the comparison sampler on top
+    float faceSize, faceHeight, levels;
+    shadowCube.GetDimensions(0, faceSize, faceHeight, levels);
+    float spread = 2.0f * axisDistance / faceSize * shadowFilterRadius0;
+
+    static const float3 taps[8] =
+    {
+        float3(-1, -1, -1), float3(1, -1, -1), float3(-1, 1, -1), float3(1, 1, -1),
+        float3(-1, -1, 1), float3(1, -1, 1), float3(-1, 1, 1), float3(1, 1, 1),
+    };
+
+    float lit = 0.0f;
+    for (uint i = 0; i < 8; i++)
+        lit += shadowCube.SampleCmpLevelZero(shadowSampler, toSurface + taps[i] * spread, depth);
+    return lit / 8.0f;
+}
+
+float4 main(VertexOutput v, uint primitiveId : SV_PrimitiveID) : SV_Target0
 {   
     float3 camPos = float3(camPos0.xyz);
     float3 lightPos = float3(lightPos0.xyz);
     float3 ambientColor = float3(ambientColor0.xyz);
     
-    float3 textureSample = albedo.Sample(sampler0, v.texCoords);
+    // submesh of this triangle, meshes have a handful so a linear walk is enough
+    uint meshTriangle = firstTriangle + primitiveId;
+    uint submeshIndex = 0;
+    while (submeshIndex + 1 < submeshCount && submeshTriangles[submeshTriangleOffset + submeshIndex + 1] <= meshTriangle)
+        submeshIndex++;
+    
+    SubmeshTexture submesh = submeshTextures[submeshIndex];
+    float2 uvDx = ddx(v.texCoords);
+    float2 uvDy = ddy(v.texCoords);
+    
+    float3 textureSample = float3(1.0f, 1.0f, 1.0f);
+    if (submesh.array == 0)
+        textureSample = SampleAlbedo(albedo0, submesh, v.texCoords, uvDx, uvDy);
+    else if (submesh.array == 1)
+        textureSample = SampleAlbedo(albedo1, submesh, v.texCoords, uvDx, uvDy);
+    else if (submesh.array == 2)
+        textureSample = SampleAlbedo(albedo2, submesh, v.texCoords, uvDx, uvDy);
+    else if (submesh.array == 3)
+        textureSample = SampleAlbedo(albedo3, submesh, v.texCoords, uvDx, uvDy);
     float3 ambientLight = ambientColor * ambientStrength0;
     
     float3 lightDirection = normalize(v.worldPos - float4(lightPos, 1.0f));
@@ -40,5 +182,26 @@ float4 main(VertexOutput v) : SV_Target0
     float spec = pow(max(dot(viewDir, reflectDir) * -1.0f, 0.0f), specularPow0);
     float3 specular = specularStrength0 * spec * lightColor0.xyz;
     
+    float shadow = GetMainLightShadow(v.worldPos.xyz - lightPos);
+    diffuse *= shadow;
+    specular *= shadow;
+    
+    // point lights of this pixel's cluster, same model as the main light plus attenuation
+    uint2 cluster = clusters[GetClusterIndex(v.pos.xy, v.viewDepth)];
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        PointLight light = pointLights[clusterLightIndices[cluster.x + i]];
+        
+        float3 toSurface = v.worldPos.xyz - light.position;
+        float distance = length(toSurface);
+        float3 pointDirection = toSurface / distance;
+        float3 radiance = light.color * light.intensity * GetLightAttenuation(distance, light.radius);
+        
+        diffuse += max(dot(pointDirection, v.normal) * -1.0f, 0.0f) * radiance;
+        
+        float pointSpec = pow(max(dot(viewDir, reflect(pointDirection, v.normal)) * -1.0f, 0.0f), specularPow0);
+        specular += specularStrength0 * pointSpec * radiance;
+    }
+    
     return float4(textureSample * (diffuse + ambientLight + specular), 1.0f);
 }
\ No newline at end of file
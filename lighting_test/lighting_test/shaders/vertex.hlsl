@@ -1,10 +1,28 @@
-cbuffer mvp : register(b0)
+// shader_constants.h ViewConstants, the cluster constants after it are only read by pixel.hlsl
+cbuffer view : register(b0)
 {
-    float4x4 model;
-    float4x4 view;
-    float4x4 proj;
+    float4x4 viewProj;
+    float4 viewDepthColumn;
+};
+
+// shader_constants.h ObjectConstants, the submesh run after it is only read by pixel.hlsl
+cbuffer object : register(b1)
+{
+    float4 positionScale;
+    float4 positionOffset;
+};
+
+// per instance stream, rows of the model matrix and of transpose(inverse(model))
+struct InstanceInput
+{
+    float4 model0 : MODEL0;
+    float4 model1 : MODEL1;
+    float4 model2 : MODEL2;
+    float4 model3 : MODEL3;
     
-    float4x4 inverseModel;
+    float4 normalMatrix0 : NORMAL_MATRIX0;
+    float4 normalMatrix1 : NORMAL_MATRIX1;
+    float4 normalMatrix2 : NORMAL_MATRIX2;
 };
 
 struct VertexOutput
@@ -13,21 +31,62 @@ struct VertexOutput
     float4 worldPos : WORLD_POS;
     float3 normal : NORMAL;
     float2 texCoords : TEX_COORDS;
+    float viewDepth : VIEW_DEPTH;
 };
 
-VertexOutput main(float3 pos : POS, float3 normal : NORMAL, float2 texCoords : TEX_COORDS)
+#ifdef PACKED_VERTEX
+
+struct VertexInput
 {
-    VertexOutput o;
+    float4 pos : POS;           // unorm16, relative to the mesh bounds
+    float2 normal : NORMAL;     // snorm16 octahedral
+    float2 texCoords : TEX_COORDS;
+};
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+float3 GetPosition(VertexInput v) { return v.pos.xyz * positionScale.xyz + positionOffset.xyz; }
+float3 GetNormal(VertexInput v) { return OctahedralDecode(v.normal); }
+
+#else
+
+struct VertexInput
+{
+    float3 pos : POS;
+    float3 normal : NORMAL;
+    float2 texCoords : TEX_COORDS;
+};
+
+float3 GetPosition(VertexInput v) { return v.pos; }
+float3 GetNormal(VertexInput v) { return v.normal; }
+
+#endif
+
+VertexOutput main(VertexInput v, InstanceInput i)
+{
+    float3 pos = GetPosition(v);
+    float3 normal = GetNormal(v);
     
-    float4x4 finalMVP = mul(mul(model, view), proj);
+    float4x4 model = float4x4(i.model0, i.model1, i.model2, i.model3);
+    float3x3 normalMatrix = float3x3(i.normalMatrix0.xyz, i.normalMatrix1.xyz, i.normalMatrix2.xyz);
     
-    o.pos = mul(float4(pos.xyz, 1.0f), finalMVP);
+    VertexOutput o;
     
     o.worldPos = mul(float4(pos.xyz, 1.0f), model);
     
-    o.texCoords = texCoords;
+    o.pos = mul(o.worldPos, viewProj);
+    
+    o.viewDepth = dot(o.worldPos, viewDepthColumn);
+    
+    o.texCoords = v.texCoords;
     
-    o.normal = normalize(mul(normal, float3x3(inverseModel[0].xyz, inverseModel[1].xyz, inverseModel[2].xyz)));
+    o.normal = normalize(mul(normal, normalMatrix));
     
     return o;
 }
\ No newline at end of file
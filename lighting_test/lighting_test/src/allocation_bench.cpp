@@ -0,0 +1,170 @@
+#include "allocation_bench.h"
+#include "culling.h"
+#include "light_culling.h"
+#include "mesh_cache.h"
+#include "meshlet.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <random>
+
+using BenchClock = std::chrono::high_resolution_clock;
+
+static double MillisecondsSince(BenchClock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+void RunAllocationBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, const HeapAllocationCounter& countHeapAllocations,
+    AllocationBenchmarkResult& result)
+{
+    constexpr uint32_t LOAD_RUNS = 5;
+    constexpr uint32_t GRID_SIZE = 32;
+    constexpr uint32_t LIGHT_COUNT = 256;
+    constexpr uint32_t FRAMES = 120;
+    constexpr uint32_t WARMUP_FRAMES = 2; // the frame arena merges its blocks on the first resets
+
+    result = {};
+
+    std::vector<MeshData> meshes;
+    for (const std::string& path : meshPaths)
+    {
+        AllocationBenchmarkMesh bench = {};
+        bench.path = path;
+        bench.tinyobjMs = bench.coldMs = bench.warmMs = 1e30;
+
+        MeshData data;
+        bool ok = true;
+        for (uint32_t run = 0; run < LOAD_RUNS && ok; run++)
+        {
+            uint64_t before = countHeapAllocations();
+            auto start = BenchClock::now();
+            {
+                MeshData tinyobj;
+                ok &= LoadMeshDataTinyObj(path, tinyobj);
+            }
+            bench.tinyobjMs = std::min(bench.tinyobjMs, MillisecondsSince(start));
+            bench.tinyobjHeapAllocations = countHeapAllocations() - before;
+
+            Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+
+            data = {};
+            before = countHeapAllocations();
+            start = BenchClock::now();
+            ok &= LoadMeshData(jobs, path, scratch, data);
+            bench.coldMs = std::min(bench.coldMs, MillisecondsSince(start));
+            bench.coldHeapAllocations = countHeapAllocations() - before;
+
+            scratch.Reset();
+
+            data = {};
+            before = countHeapAllocations();
+            start = BenchClock::now();
+            ok &= LoadMeshData(jobs, path, scratch, data);
+            bench.warmMs = std::min(bench.warmMs, MillisecondsSince(start));
+            bench.warmHeapAllocations = countHeapAllocations() - before;
+            bench.scratch = scratch.GetStats();
+        }
+
+        if (!ok)
+            continue;
+
+        result.meshes.push_back(bench);
+        meshes.push_back(std::move(data));
+    }
+
+    if (meshes.empty())
+        return;
+
+    uint32_t meshCount = (uint32_t)meshes.size();
+    std::vector<MeshBounds> bounds(meshCount);
+    std::vector<MeshletData> meshlets(meshCount);
+    float spacing = 0.0f;
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        MeshView view = MakeMeshView(meshes[i]);
+        MakeMeshBounds(view, bounds[i]);
+        BuildMeshlets(view, meshlets[i]);
+        spacing = std::max(spacing, bounds[i].bounds.radius * 2.5f);
+    }
+
+    Scene scene;
+    for (uint32_t i = 0; i < GRID_SIZE * GRID_SIZE; i++)
+    {
+        Vec3 location = { (i % GRID_SIZE) * spacing, 0.0f, (i / GRID_SIZE) * spacing };
+        AddInstance(scene, i % meshCount, { location, { 0.0f, (float)(i * 37 % 360), 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<InstanceRange> ranges;
+    SortInstancesByMesh(scene, meshCount, order, ranges);
+
+    uint32_t instanceCount = GetInstanceCount(scene);
+    std::vector<InstanceData> instances(instanceCount);
+    ComputeInstanceData(jobs, scene, order.data(), instanceCount, instances.data());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> spread(0.0f, GRID_SIZE * spacing);
+    std::vector<PointLight> lights(LIGHT_COUNT);
+    for (PointLight& light : lights)
+    {
+        light.position = { spread(rng), spacing, spread(rng) };
+        light.radius = spacing * 2.0f;
+        light.color = { 1.0f, 1.0f, 1.0f };
+        light.intensity = 1.0f;
+    }
+
+    Mat4 proj = Mat4PerspectiveFovLH(60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f);
+    ClusterProjection projection = { 60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f, 1600, 900 };
+
+    VisibleSet visible;
+    MeshletVisibleSet meshletVisible;
+    LightClusters clusters;
+    Arena frameArena;
+
+    uint64_t heapAllocations = 0;
+    uint64_t arenaAllocations = 0;
+    double ms = 0.0;
+
+    for (uint32_t frame = 0; frame < WARMUP_FRAMES + FRAMES; frame++)
+    {
+        // across the grid diagonally, looking ahead and a little to the side
+        float t = (float)frame / (WARMUP_FRAMES + FRAMES);
+        Vec3 eye = { t * GRID_SIZE * spacing, spacing, t * GRID_SIZE * spacing * 0.5f };
+        Vec3 direction = { cosf(t * 3.0f), -0.2f, 1.0f };
+
+        Mat4 view = Mat4LookToLH(eye, direction, { 0.0f, 1.0f, 0.0f });
+        Frustum frustum = MakeFrustum(Mat4Multiply(view, proj));
+
+        uint64_t before = countHeapAllocations();
+        auto start = BenchClock::now();
+
+        frameArena.Reset();
+        CullScene(jobs, frustum, bounds.data(), meshCount, instances.data(), ranges.data(), frameArena, visible);
+        CullMeshlets(jobs, frustum, eye, meshlets.data(), meshCount, visible, frameArena, meshletVisible);
+        BuildLightClusters(jobs, lights.data(), LIGHT_COUNT, view, projection, frameArena, clusters);
+
+        double frameMs = MillisecondsSince(start);
+        uint64_t frameHeapAllocations = countHeapAllocations() - before;
+
+        if (frame < WARMUP_FRAMES)
+            continue;
+
+        ArenaStats stats = frameArena.GetStats();
+        ms += frameMs;
+        heapAllocations += frameHeapAllocations;
+        arenaAllocations += stats.allocations;
+        result.framePeakBytes = std::max(result.framePeakBytes, stats.peakBytes);
+    }
+
+    result.frames = FRAMES;
+    result.instanceCount = instanceCount;
+    result.lightCount = LIGHT_COUNT;
+    result.workerCount = jobs.GetWorkerCount();
+    result.frameMs = ms / FRAMES;
+    result.frameHeapAllocations = (double)heapAllocations / FRAMES;
+    result.frameArenaAllocations = (double)arenaAllocations / FRAMES;
+    result.frameArenaBlocks = frameArena.GetStats().heapAllocations;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "arena.h"
+#include "jobs.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// heap allocations against arena allocations on the load path and over a few frames of culling and light clusters.
+// counting the heap needs operator new replaced, which only a program can do, so the count comes from the caller
+
+// heap allocations made so far by every thread
+using HeapAllocationCounter = std::function<uint64_t()>;
+
+struct AllocationBenchmarkMesh
+{
+    std::string path;
+    double tinyobjMs;               // LoadMeshDataTinyObj, what loading used to be
+    uint64_t tinyobjHeapAllocations;
+    double coldMs;                  // LoadMeshData on a new arena
+    uint64_t coldHeapAllocations;
+    double warmMs;                  // LoadMeshData again on the same arena after a Reset
+    uint64_t warmHeapAllocations;
+    ArenaStats scratch;             // of the warm load
+};
+
+struct AllocationBenchmarkResult
+{
+    std::vector<AllocationBenchmarkMesh> meshes;
+
+    uint32_t frames;
+    uint32_t instanceCount;
+    uint32_t lightCount;
+    uint32_t workerCount;
+    double frameMs;                 // CullScene, CullMeshlets and BuildLightClusters
+    double frameHeapAllocations;    // per frame once the frame arena has its block
+    double frameArenaAllocations;   // per frame, what used to be std::vectors of their own
+    uint64_t framePeakBytes;
+    uint32_t frameArenaBlocks;      // heap allocations of the frame arena over every frame
+};
+
+// every mesh is loaded a few times each way, best time and the allocations of the last run. the frames cull a grid of
+// the meshes against a camera moving through it
+void RunAllocationBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, const HeapAllocationCounter& countHeapAllocations,
+    AllocationBenchmarkResult& result);
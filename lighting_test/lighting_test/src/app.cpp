@@ -0,0 +1,965 @@
+#include "app.h"
+#include "asset_loader.h"
+#include "math_bench.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "obj_parser.h"
+#include "platform.h"
+#include "png_writer.h"
+#include "profiler.h"
+#include "scene.h"
+#include "shadow_cache.h"
+#include "software_raster.h"
+#include "texture_streaming.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "../vendor/imgui/imgui.h"
+
+JobSystem* gJobs = nullptr;
+
+static Transform sModelTransform
+{
+    { -0.330f, -0.540f, 2.070f },   // location
+    { 0.0f, 150.0f, 0.0f },   // rotation
+    { 1.0f, 1.0f, 1.0f }    // scale
+};
+
+struct Camera
+{
+    Vec3 location = { -1.38f, 1.44f, -2.0f };
+    Vec3 rotation = { 0.0f, 0.0f, 0.0f };
+    Vec3 direction = { 0.0f, 0.0f, 1.0f };
+    float FOV = 60.0f;
+    float speed = 0.03f;
+};
+
+static Camera sCamera;
+static LightSettings sLightSettings;
+
+// cpu side of a mesh, the gpu side is the renderer's mesh with the same index
+struct Mesh
+{
+    std::string debugName;
+    VertexFormat vertexFormat;
+    MeshStats stats;
+    float decodeMs;
+    bool loadedFromCache;
+};
+
+static std::vector<Mesh> sMeshes;
+static std::vector<MeshBounds> sMeshBounds; // one per mesh, for CullScene
+static std::vector<MeshletData> sMeshlets;  // one per mesh, for CullMeshlets
+static std::vector<MeshLods> sMeshLods;     // one per mesh, for SelectMeshLods
+static uint32_t sMeshIndex = 0;
+
+static float sAssetDecodeWallTimeMs = 0.0f;
+struct AssetTiming
+{
+    std::string path;
+    float decodeMs;
+    float mipsMs;
+    float encodeMs;
+    float psnr;
+    const char* format;
+    bool loadedFromCache;
+    ArenaStats scratch; // of a mesh parsed from source
+};
+
+static std::vector<AssetTiming> sAssetTimings;
+
+static std::vector<ObjParseBenchmarkCase> sObjParseBenchmark;
+
+static const char* const sMeshPaths[] =
+{
+    "meshes/dbd.obj",
+    "meshes/cube.obj",
+    "meshes/lamp.obj",
+    "meshes/negan.obj",
+};
+
+struct TextureSlot
+{
+    const char* path;
+    uint32_t meshIndex;
+    uint32_t submeshIndex;
+};
+
+static const TextureSlot sTextureSlots[] =
+{
+    { "textures/dbd/0.png", 0, 0 },
+    { "textures/dbd/1.png", 0, 1 },
+    { "textures/dbd/2.png", 0, 2 },
+    { "textures/dbd/3.png", 0, 3 },
+    { "textures/dbd/4.png", 0, 4 },
+    { "textures/dbd/5.png", 0, 5 },
+    { "textures/dbd/6.png", 0, 6 },
+    { "textures/dbd/7.png", 0, 7 },
+    { "textures/lamp/0.jpg", 2, 0 },
+    { "textures/negan/0.png", 3, 0 },
+};
+
+// what actually loaded, indices into sMeshes, the software reference loads the same set again
+static std::vector<std::string> sLoadedMeshPaths;
+static std::vector<TextureSlot> sLoadedTextureSlots;
+
+static const float sClearColor[] = { 0.1f, 0.1f, 0.1f, 1.0f };
+
+static uint32_t sViewWidth = 0;
+static uint32_t sViewHeight = 0;
+
+// instance 0 is the model edited in the settings panel, the rest is a grid of copies around it
+static Scene sScene;
+static std::vector<uint32_t> sInstanceOrder;
+static std::vector<InstanceRange> sInstanceRanges;
+static std::vector<InstanceData> sInstanceData;
+static bool sSceneDirty = true;
+static int sInstanceGridSize = 0;
+static float sInstanceSpacing = 3.0f;
+static float sInstancePrepareMs = 0.0f;
+
+// temporaries of culling, light clusters and streaming, all given back at the start of the next update
+constexpr size_t FRAME_ARENA_BLOCK_SIZE = 1024 * 1024;
+static Arena sFrameArena(FRAME_ARENA_BLOCK_SIZE);
+
+// what survives frustum culling, this is what gets uploaded and drawn
+static VisibleSet sVisibleSet;
+static bool sFrustumCulling = true;
+
+// triangles of the meshes with few visible instances that survive meshlet culling, drawn instead of whole meshes
+static MeshletVisibleSet sMeshletVisibleSet;
+static bool sMeshletCulling = true;
+
+// visible instances sorted by the level of detail they are drawn at, meshlet culling only applies to full detail
+static LodSelection sLodSelection;
+static bool sLodSelectionEnabled = true;
+static float sLodPixelError = 1.0f;
+
+// the main light's shadow cube, kept between frames and only drawn again where something moved
+static ShadowCubeCache sShadowCache;
+static ShadowCasterSet sShadowCasters;
+static bool sShadowsEnabled = true;
+
+// textures start with their small levels only, the bigger ones are read in once a mesh is close enough to show them and
+// given back under the budget. the decoded textures stay around since their cooked dds are what streaming reads from
+static std::deque<DecodedTexture> sDecodedTextures;
+static std::vector<std::vector<const TextureView*>> sSubmeshTextures; // per mesh, every level, null stays white
+static TextureStreamer sTextureStreamer;
+static StreamingIo* sStreamingIo = nullptr; // like gJobs never stopped, it runs until the process exits
+static std::vector<float> sStreamingScreenSizes;
+static std::vector<StreamingRequest> sStreamingRequests;
+static std::vector<uint32_t> sStreamingEvicted;
+static uint64_t sStreamingReadSum = 0; // keeps the prefetch from being optimized away, only the io thread writes it
+static int sStreamingBudgetMb = 128;
+
+static ShadowBenchmarkResult sShadowBenchmark;
+static bool sShadowBenchmarkRan = false;
+
+static CullingBenchmarkResult sCullingBenchmark;
+static bool sCullingBenchmarkRan = false;
+
+// extra point lights scattered over the scene, culled into clusters every frame
+static std::vector<PointLight> sPointLights;
+static std::vector<Vec3> sPointLightOrigins;
+static int sPointLightCount = 0;
+static float sPointLightRadius = 2.0f;
+static float sPointLightIntensity = 1.0f;
+static bool sAnimatePointLights = true;
+static float sPointLightTime = 0.0f;
+static bool sFlythroughPoseSet = false; // the next AppUpdate takes the pose instead of the keyboard
+static LightClusters sLightClusters;
+static float sLightCullingMs = 0.0f;
+
+static LightCullingBenchmarkResult sLightCullingBenchmark;
+static bool sLightCullingBenchmarkRan = false;
+
+static SceneBenchmarkResult sSceneBenchmark;
+static bool sSceneBenchmarkRan = false;
+
+static ViewConstants sViewConstants;
+
+static SoftwareReference sSoftwareReference;
+static bool sSoftwareRan = false;
+
+static MathBenchmarkResult sMathBenchmark;
+static bool sMathBenchmarkRan = false;
+
+static bool sTraceCaptureRequested = false;
+static uint64_t sTraceWriteFrame = 0;
+static bool sTraceWritten = false;
+static bool sTraceRan = false;
+
+static void SetMesh(uint32_t meshIndex)
+{
+    sMeshIndex = meshIndex;
+    sScene.meshIndices[0] = meshIndex;
+    sSceneDirty = true;
+}
+
+static void RebuildScene()
+{
+    ClearScene(sScene);
+    AddInstance(sScene, sMeshIndex, sModelTransform);
+
+    // square grid centered on the model, cycling through the meshes
+    uint32_t gridSize = (uint32_t)sInstanceGridSize;
+    float half = ((float)gridSize - 1.0f) * 0.5f;
+    for (uint32_t z = 0; z < gridSize; z++)
+    {
+        for (uint32_t x = 0; x < gridSize; x++)
+        {
+            Transform transform = sModelTransform;
+            transform.location.x += (x - half) * sInstanceSpacing;
+            transform.location.z += (z + 1) * sInstanceSpacing;
+            transform.rotation.y += (x * 37 + z * 11) % 360;
+
+            AddInstance(sScene, (x + z) % (uint32_t)sMeshes.size(), transform);
+        }
+    }
+
+    sSceneDirty = true;
+}
+
+static void GeneratePointLights()
+{
+    // same lights for the same count, scattered over the model and the instance grid
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    float extent = 2.0f + sInstanceGridSize * sInstanceSpacing * 0.5f;
+
+    sPointLights.resize(sPointLightCount);
+    sPointLightOrigins.resize(sPointLightCount);
+    for (uint32_t i = 0; i < (uint32_t)sPointLightCount; i++)
+    {
+        sPointLightOrigins[i] =
+        {
+            sModelTransform.location.x + (unit(rng) * 2.0f - 1.0f) * extent,
+            sModelTransform.location.y + unit(rng) * 2.5f,
+            sModelTransform.location.z + unit(rng) * extent * 2.0f - 1.0f,
+        };
+
+        PointLight& light = sPointLights[i];
+        light.position = sPointLightOrigins[i];
+        light.color = { 0.2f + unit(rng) * 0.8f, 0.2f + unit(rng) * 0.8f, 0.2f + unit(rng) * 0.8f };
+    }
+}
+
+JobSystem& GetAppJobs()
+{
+    if (!gJobs)
+        gJobs = new JobSystem();
+
+    return *gJobs;
+}
+
+// the renderer gets the levels the mesh has resident, the same drop for every texture keeps them packing the same way
+static void SetStreamedMeshTextures(uint32_t mesh)
+{
+    const std::vector<const TextureView*>& full = sSubmeshTextures[mesh];
+    uint32_t drop = sTextureStreamer.meshes[mesh].residentDrop;
+
+    std::vector<TextureView> trimmed(full.size());
+    std::vector<const TextureView*> views(full.size(), nullptr);
+    for (uint32_t i = 0; i < full.size(); i++)
+    {
+        if (!full[i])
+            continue;
+
+        trimmed[i] = TrimTextureView(*full[i], drop);
+        views[i] = &trimmed[i];
+    }
+
+    RendererSetMeshTextures(mesh, views.data());
+}
+
+bool AppInit(const AppSettings& settings)
+{
+    // decode every asset on the job system, gpu resources are created here on the main thread
+    GetAppJobs();
+
+    // a partial checkout still runs, the meshes that are not there are left out with their textures
+    uint32_t meshIndices[std::size(sMeshPaths)];
+
+    AssetBatch assets;
+    for (uint32_t i = 0; i < std::size(sMeshPaths); i++)
+    {
+        uint64_t size;
+        int64_t timestamp;
+        if (!GetFileStamp(sMeshPaths[i], size, timestamp))
+        {
+            fprintf(stderr, "missing %s, skipped\n", sMeshPaths[i]);
+            meshIndices[i] = UINT32_MAX;
+            continue;
+        }
+
+        meshIndices[i] = (uint32_t)sLoadedMeshPaths.size();
+        sLoadedMeshPaths.push_back(sMeshPaths[i]);
+        AddMesh(assets, sMeshPaths[i]);
+    }
+
+    for (const TextureSlot& slot : sTextureSlots)
+    {
+        if (meshIndices[slot.meshIndex] == UINT32_MAX)
+            continue;
+
+        sLoadedTextureSlots.push_back({ slot.path, meshIndices[slot.meshIndex], slot.submeshIndex });
+        AddTexture(assets, slot.path);
+    }
+
+    DecodeAssets(*gJobs, assets);
+
+    sAssetDecodeWallTimeMs = assets.decodeWallTimeMs;
+
+    for (const DecodedMesh& mesh : assets.meshes)
+    {
+        check(mesh.ok);
+
+        // the gpu gets the indices in meshlet order so compacted and whole draws find the same submesh ranges,
+        // a cooked mesh has them in that order already
+        MeshletData& meshlets = sMeshlets.emplace_back();
+        LoadMeshlets(mesh.view, meshlets);
+
+        MeshView view = mesh.view;
+        view.indices = meshlets.indices.data();
+
+        uint32_t meshIndex = RendererCreateMesh(view, mesh.path);
+        check(meshIndex == sMeshes.size());
+
+        Mesh& appMesh = sMeshes.emplace_back();
+        appMesh.debugName = mesh.path;
+        appMesh.vertexFormat = mesh.view.vertexFormat;
+        appMesh.stats = mesh.view.stats;
+        appMesh.decodeMs = mesh.decodeMs;
+        appMesh.loadedFromCache = mesh.loadedFromCache;
+
+        MakeMeshBounds(mesh.view, sMeshBounds.emplace_back());
+        sMeshLods.push_back(MakeMeshLods(mesh.view));
+        sAssetTimings.push_back({ mesh.path, mesh.decodeMs, 0.0f, 0.0f, 0.0f, nullptr, mesh.loadedFromCache, mesh.scratch });
+    }
+
+    // a texture that failed to load keeps the white default
+    std::vector<std::vector<const TextureView*>> submeshTextures(assets.meshes.size());
+    for (uint32_t i = 0; i < assets.meshes.size(); i++)
+        submeshTextures[i].resize(assets.meshes[i].view.submeshCount, nullptr);
+
+    for (uint32_t i = 0; i < assets.textures.size(); i++)
+    {
+        const DecodedTexture& texture = assets.textures[i];
+        if (!texture.ok)
+        {
+            fprintf(stderr, "failed to load %s, left white\n", texture.path.c_str());
+            continue;
+        }
+
+        submeshTextures[sLoadedTextureSlots[i].meshIndex][sLoadedTextureSlots[i].submeshIndex] = &texture.view;
+        sAssetTimings.push_back({ texture.path, texture.decodeMs, texture.mipsMs, texture.encodeMs, texture.psnr, GetTextureFormatName(texture.view.format), texture.loadedFromCache, {} });
+    }
+
+    // the views point into the decoded textures, swapping the deques keeps every element where it is
+    std::swap(sDecodedTextures, assets.textures);
+    sSubmeshTextures = std::move(submeshTextures);
+
+    sTextureStreamer.meshes.resize(sSubmeshTextures.size());
+    for (uint32_t i = 0; i < sSubmeshTextures.size(); i++)
+    {
+        InitStreamingMesh(sSubmeshTextures[i].data(), (uint32_t)sSubmeshTextures[i].size(), sTextureStreamer.meshes[i]);
+        SetStreamedMeshTextures(i);
+    }
+
+    if (sMeshes.empty())
+        return false;
+
+    sStreamingIo = new StreamingIo();
+    StartStreamingIo(*sStreamingIo, [](const StreamingRequest& request)
+    {
+        for (const TextureView* view : sSubmeshTextures[request.mesh])
+        {
+            if (view)
+                sStreamingReadSum += PrefetchTextureLevels(*view, request.drop, request.fromDrop);
+        }
+    });
+
+    // set default mesh
+    sMeshIndex = 0;
+    sInstanceGridSize = std::clamp(settings.instanceGridSize, 0, APP_MAX_INSTANCE_GRID_SIZE);
+    RebuildScene();
+
+    sPointLightCount = std::clamp(settings.pointLightCount, 0, APP_MAX_POINT_LIGHTS);
+    GeneratePointLights();
+
+    sShadowsEnabled = settings.shadows;
+
+    return true;
+}
+
+// after culling: finished reads go to the renderer, then the policy runs on this frame's screen sizes
+static void UpdateStreamedTextures()
+{
+    PROFILE_SCOPE("UpdateStreamedTextures");
+
+    uint32_t meshCount = (uint32_t)sTextureStreamer.meshes.size();
+    float pixelsPerUnit = sViewHeight / (2.0f * tanf(sCamera.FOV * TO_RADIANS * 0.5f));
+
+    sStreamingScreenSizes.resize(meshCount);
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        const InstanceRange& range = sVisibleSet.ranges[i];
+        sStreamingScreenSizes[i] = GetStreamingScreenSize(sCamera.location, pixelsPerUnit, sMeshBounds[i].bounds,
+            sVisibleSet.instances.data() + range.first, range.count);
+    }
+
+    CollectStreamingRequests(*sStreamingIo, sStreamingRequests);
+    for (const StreamingRequest& request : sStreamingRequests)
+    {
+        CompleteStreamingRequest(sTextureStreamer, request);
+        SetStreamedMeshTextures(request.mesh);
+    }
+
+    sTextureStreamer.settings.budgetBytes = (uint64_t)sStreamingBudgetMb << 20;
+    UpdateTextureStreaming(sTextureStreamer, sStreamingScreenSizes.data(), sFrameArena, sStreamingRequests, sStreamingEvicted);
+
+    for (uint32_t mesh : sStreamingEvicted)
+        SetStreamedMeshTextures(mesh);
+
+    SubmitStreamingRequests(*sStreamingIo, sStreamingRequests);
+}
+
+TextureStreamingStats GetAppTextureStreamingStats()
+{
+    return sTextureStreamer.stats;
+}
+
+ArenaStats GetAppFrameArenaStats()
+{
+    return sFrameArena.GetStats();
+}
+
+void AppSetFlythroughPose(const FlythroughPose& pose)
+{
+    sCamera.location = pose.camera;
+    sCamera.direction = pose.direction;
+    sModelTransform.location = pose.modelLocation;
+    sModelTransform.rotation = pose.modelRotation;
+    sLightSettings.pos = { pose.light.x, pose.light.y, pose.light.z, 0.0f };
+    sPointLightTime = pose.time;
+    sFlythroughPoseSet = true;
+}
+
+void AppUpdate()
+{
+    PROFILE_SCOPE("Update");
+
+    sFrameArena.Reset();
+
+    GetPlatformWindowSize(sViewWidth, sViewHeight);
+
+    // move camera, a flythrough pose moves everything itself and keeps the time
+    bool scripted = sFlythroughPoseSet;
+    sFlythroughPoseSet = false;
+
+    if (!scripted)
+    {
+        if (IsPlatformKeyDown(KEY_W))
+            sCamera.location.z += sCamera.speed;
+
+        if (IsPlatformKeyDown(KEY_S))
+            sCamera.location.z -= sCamera.speed;
+
+        if (IsPlatformKeyDown(KEY_D))
+            sCamera.location.x += sCamera.speed;
+
+        if (IsPlatformKeyDown(KEY_A))
+            sCamera.location.x -= sCamera.speed;
+
+        if (IsPlatformKeyDown(KEY_E))
+            sCamera.location.y += sCamera.speed;
+
+        if (IsPlatformKeyDown(KEY_Q))
+            sCamera.location.y -= sCamera.speed;
+    }
+
+    // instances
+    SetInstanceTransform(sScene, 0, sModelTransform);
+
+    if (sSceneDirty)
+    {
+        SortInstancesByMesh(sScene, (uint32_t)sMeshes.size(), sInstanceOrder, sInstanceRanges);
+        sSceneDirty = false;
+    }
+
+    uint32_t instanceCount = GetInstanceCount(sScene);
+    sInstanceData.resize(instanceCount);
+
+    auto prepareStart = std::chrono::high_resolution_clock::now();
+    ComputeInstanceData(*gJobs, sScene, sInstanceOrder.data(), instanceCount, sInstanceData.data());
+    sInstancePrepareMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - prepareStart).count();
+
+    Mat4 view = Mat4LookToLH(sCamera.location, sCamera.direction, { 0.0f, 1.0f, 0.0f });
+
+    Mat4 proj = Mat4PerspectiveFovLH(sCamera.FOV * TO_RADIANS, (float)sViewWidth / (float)sViewHeight, 0.01f, 1000.0f);
+
+    // multiplied once here instead of per vertex, shaders use column major, lets transpose
+    Mat4 viewProj = Mat4Multiply(view, proj);
+    sViewConstants.viewProj = Mat4Transpose(viewProj);
+    sViewConstants.viewDepth = { view.m[0][2], view.m[1][2], view.m[2][2], view.m[3][2] };
+    sViewConstants.camPos = { sCamera.location.x, sCamera.location.y, sCamera.location.z, 0.0f };
+
+    Frustum frustum = sFrustumCulling ? MakeFrustum(viewProj) : MakeInfiniteFrustum();
+    CullScene(*gJobs, frustum, sMeshBounds.data(), (uint32_t)sMeshBounds.size(), sInstanceData.data(), sInstanceRanges.data(), sFrameArena, sVisibleSet);
+
+    if (sLodSelectionEnabled)
+    {
+        LodProjection lodProjection = { sCamera.FOV * TO_RADIANS, sViewHeight, 0.01f, sLodPixelError };
+        SelectMeshLods(*gJobs, sCamera.location, lodProjection, sMeshBounds.data(), sMeshLods.data(), (uint32_t)sMeshLods.size(), sVisibleSet, sLodSelection);
+    }
+
+    if (sMeshletCulling)
+        CullMeshlets(*gJobs, frustum, sCamera.location, sMeshlets.data(), (uint32_t)sMeshlets.size(), sVisibleSet, sFrameArena, sMeshletVisibleSet);
+
+    UpdateStreamedTextures();
+
+    if (sShadowsEnabled)
+    {
+        const Vec4& light = sLightSettings.pos;
+        ShadowCubeProjection shadowProjection = { { light.x, light.y, light.z }, sLightSettings.shadowNear, sLightSettings.shadowRange };
+        uint32_t faceMask = UpdateShadowCube(*gJobs, shadowProjection, sMeshBounds.data(), (uint32_t)sMeshBounds.size(), sInstanceData.data(),
+            sInstanceRanges.data(), sShadowCache);
+        GatherShadowCasters(*gJobs, sShadowCache, faceMask, sInstanceData.data(), sInstanceRanges.data(), (uint32_t)sMeshBounds.size(), sShadowCasters);
+    }
+    sLightSettings.shadowsEnabled = sShadowsEnabled;
+
+    // point lights, circling around where they were placed
+    if (!scripted)
+        sPointLightTime += 1.0f / 60.0f;
+    for (uint32_t i = 0; i < sPointLights.size(); i++)
+    {
+        PointLight& light = sPointLights[i];
+        float phase = sAnimatePointLights ? sPointLightTime + i * 0.37f : i * 0.37f;
+        light.position = sPointLightOrigins[i];
+        light.position.x += cosf(phase) * 0.5f;
+        light.position.z += sinf(phase) * 0.5f;
+        light.radius = sPointLightRadius;
+        light.intensity = sPointLightIntensity;
+    }
+
+    ClusterProjection projection = { sCamera.FOV * TO_RADIANS, (float)sViewWidth / (float)sViewHeight, 0.01f, 1000.0f, sViewWidth, sViewHeight };
+
+    auto cullingStart = std::chrono::high_resolution_clock::now();
+    BuildLightClusters(*gJobs, sPointLights.data(), (uint32_t)sPointLights.size(), view, projection, sFrameArena, sLightClusters);
+    sLightCullingMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullingStart).count();
+
+    sViewConstants.clusters = sLightClusters.constants;
+}
+
+RenderFrame GetAppRenderFrame()
+{
+    RenderFrame frame;
+    frame.view = &sViewConstants;
+    frame.light = &sLightSettings;
+    frame.visible = &sVisibleSet;
+    frame.meshletVisible = sMeshletCulling ? &sMeshletVisibleSet : nullptr;
+    frame.lods = sLodSelectionEnabled ? &sLodSelection : nullptr;
+    frame.shadowCasters = sShadowsEnabled ? &sShadowCasters : nullptr;
+    frame.pointLights = sPointLights.data();
+    frame.pointLightCount = (uint32_t)sPointLights.size();
+    frame.clusters = &sLightClusters;
+    frame.clearColor = sClearColor;
+    frame.jobs = gJobs;
+    return frame;
+}
+
+// assets are mapped again from their caches since the gpu path does not keep cpu copies around
+SoftwareReference AppRenderSoftwareReference(const char* path, const char* goldenPath)
+{
+    AssetBatch assets;
+    for (const std::string& meshPath : sLoadedMeshPaths)
+        AddMesh(assets, meshPath);
+
+    for (const TextureSlot& slot : sLoadedTextureSlots)
+        AddTexture(assets, slot.path);
+
+    DecodeAssets(*gJobs, assets);
+
+    std::vector<RasterMesh> meshes(assets.meshes.size());
+    for (uint32_t i = 0; i < meshes.size(); i++)
+    {
+        check(assets.meshes[i].ok);
+        MakeRasterMesh(assets.meshes[i].view, meshes[i]);
+    }
+
+    std::vector<RasterTexture> textures(assets.textures.size());
+    for (uint32_t i = 0; i < textures.size(); i++)
+    {
+        if (!assets.textures[i].ok)
+            continue;
+
+        MakeRasterTexture(assets.textures[i].view, textures[i]);
+        meshes[sLoadedTextureSlots[i].meshIndex].textures[sLoadedTextureSlots[i].submeshIndex] = &textures[i];
+    }
+
+    RasterTarget target;
+    ResizeRasterTarget(target, sViewWidth, sViewHeight);
+    ClearRasterTarget(target, sClearColor, 1.0f);
+
+    SoftwareReference reference;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const InstanceRange& range = sInstanceRanges[meshIndex];
+        RasterDraw(*gJobs, target, meshes[meshIndex], sInstanceData.data() + range.first, range.count, sViewConstants, sLightSettings,
+            sPointLights.data(), &sLightClusters, reference.stats);
+    }
+    reference.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    reference.written = WritePng(path, (const uint8_t*)target.color.data(), target.width, target.height);
+
+    if (goldenPath)
+    {
+        reference.compared = true;
+        reference.compare = CompareRasterTarget(target, goldenPath, RASTER_GOLDEN_CHANNEL_TOLERANCE, RASTER_GOLDEN_MAX_PIXELS_OVER);
+    }
+
+    sSoftwareReference = reference;
+    sSoftwareRan = true;
+
+    return reference;
+}
+
+void AppImgui()
+{
+    PROFILE_SCOPE("AppImgui");
+
+    ImGui::Begin("Settings");
+
+    ImGui::PushID("model");
+    ImGui::Text("Model");
+    
+    if (ImGui::BeginCombo("Mesh", sMeshes[sMeshIndex].debugName.c_str()))
+    {
+        for (uint32_t i = 0; i < sMeshes.size(); i++)
+            if (ImGui::Selectable(sMeshes[i].debugName.c_str(), i == sMeshIndex))
+                SetMesh(i);
+
+        ImGui::EndCombo();
+    }
+
+    const MeshStats& stats = sMeshes[sMeshIndex].stats;
+    ImGui::Text("Vertices: %u (unwelded %u)", stats.vertexCount, stats.unweldedVertexCount);
+    ImGui::Text("Indices: %u", stats.indexCount);
+    ImGui::Text("Vertex memory saved: %.1f KB", MeshBytesSaved(stats, sMeshes[sMeshIndex].vertexFormat) / 1024.0f);
+    ImGui::Text("ACMR: %.3f -> %.3f -> %.3f", stats.acmrBefore, stats.acmrOptimized, stats.acmrAfter);
+    ImGui::Text("ATVR: %.3f -> %.3f -> %.3f", stats.atvrBefore, stats.atvrOptimized, stats.atvrAfter);
+
+    const MeshletStats& meshletStats = sMeshlets[sMeshIndex].stats;
+    ImGui::Text("Meshlets: %u (%.1f vertices, %.1f triangles), %u without cone, %s in %.2f ms", meshletStats.meshletCount,
+        meshletStats.averageVertices, meshletStats.averageTriangles, meshletStats.conesDisabled,
+        sMeshes[sMeshIndex].loadedFromCache ? "loaded" : "built", meshletStats.ms);
+
+    const MeshLods& lods = sMeshLods[sMeshIndex];
+    for (uint32_t level = 1; level < lods.levelCount; level++)
+        ImGui::Text("LOD %u: %u triangles, error %.5f", level, lods.triangles[level], lods.errors[level]);
+
+    if (sMeshes[sMeshIndex].vertexFormat == VertexFormat::Packed)
+        ImGui::Text("Packed vertices (16 B), max error: pos %.5f, normal %.3f deg, uv %.5f", stats.packingError.position, stats.packingError.normalDegrees, stats.packingError.textureCoords);
+    else
+        ImGui::Text("Full vertices (32 B)");
+    ImGui::Text("Loaded from %s in %.2f ms", sMeshes[sMeshIndex].loadedFromCache ? "cache" : "obj", sMeshes[sMeshIndex].decodeMs);
+    
+    ImGui::DragFloat3("Location", &sModelTransform.location.x, 0.03f);
+    ImGui::DragFloat3("Rotation", &sModelTransform.rotation.x, 0.5f);
+    ImGui::DragFloat3("Scale", &sModelTransform.scale.x, 0.05f);
+    ImGui::PopID();
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::PushID("camera");
+    ImGui::Text("Camera");
+    ImGui::DragFloat3("Location", &sCamera.location.x, 0.03f);
+    ImGui::DragFloat3("Direction", &sCamera.direction.x, 0.01f);
+    ImGui::DragFloat("FOV", &sCamera.FOV, 0.05f);
+    ImGui::PopID();
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    ImGui::PushID("light");
+    ImGui::Text("Light settings");
+    ImGui::DragFloat3("Position", &sLightSettings.pos.x, 0.03f);
+    ImGui::ColorEdit3("Ambient color", &sLightSettings.ambientColor.x);
+    ImGui::ColorEdit3("Light color", &sLightSettings.lightColor.x);
+    ImGui::DragFloat("Ambient intensity", &sLightSettings.ambientStrength);
+    ImGui::DragFloat("Specular intensity", &sLightSettings.specularStrength);
+    ImGui::DragFloat("Specular power", &sLightSettings.specularPow);
+
+    ImGui::Checkbox("Shadows", &sShadowsEnabled);
+    if (sShadowsEnabled)
+    {
+        ImGui::DragFloat("Shadow range", &sLightSettings.shadowRange, 0.1f, 1.0f, 200.0f);
+        ImGui::DragFloat("Shadow bias", &sLightSettings.shadowBias, 0.001f, 0.0f, 1.0f);
+        ImGui::DragFloat("Shadow filter", &sLightSettings.shadowFilterRadius, 0.05f, 0.0f, 8.0f);
+
+        const ShadowCacheStats& shadowStats = sShadowCache.stats;
+        ImGui::Text("Cube faces: %u redrawn, %u kept, %u instances changed in %.3f ms", shadowStats.facesRedrawn, shadowStats.facesKept,
+            shadowStats.instancesChanged, shadowStats.ms);
+        ImGui::Text("Casters drawn: %u", (uint32_t)sShadowCasters.instances.size());
+    }
+
+    if (ImGui::Button("Run shadow benchmark (4096 instances)"))
+    {
+        RunShadowBenchmark(*gJobs, 4096, sShadowBenchmark);
+        sShadowBenchmarkRan = true;
+    }
+
+    if (sShadowBenchmarkRan)
+    {
+        for (const ShadowBenchmarkScene& scene : sShadowBenchmark.scenes)
+        {
+            uint32_t faces = scene.frames * SHADOW_CUBE_FACES;
+            ImGui::Text("%-22s %5.1f%% faces avoided, %u missed, %.3f ms", scene.name, (faces - scene.facesRedrawn) * 100.0f / faces, scene.facesMissed, scene.ms);
+        }
+    }
+    ImGui::PopID();
+
+    if (ImGui::TreeNode("Point lights"))
+    {
+        if (ImGui::SliderInt("Count", &sPointLightCount, 0, APP_MAX_POINT_LIGHTS))
+            GeneratePointLights();
+
+        ImGui::DragFloat("Radius", &sPointLightRadius, 0.05f, 0.1f, 50.0f);
+        ImGui::DragFloat("Intensity", &sPointLightIntensity, 0.05f, 0.0f, 100.0f);
+        ImGui::Checkbox("Animate", &sAnimatePointLights);
+
+        ImGui::Text("Clusters %ux%ux%u, culled in %.3f ms", CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z, sLightCullingMs);
+        ImGui::Text("Light indices: %u, max per cluster: %u", (uint32_t)sLightClusters.lightIndices.size(), sLightClusters.maxLightsPerCluster);
+
+        if (ImGui::Button("Run benchmark (1024 lights)"))
+        {
+            RunLightCullingBenchmark(*gJobs, 1024, sLightCullingBenchmark);
+            sLightCullingBenchmarkRan = true;
+        }
+
+        if (sLightCullingBenchmarkRan)
+            ImGui::Text("%.3f ms, %u indices, max %u per cluster (%u workers)", sLightCullingBenchmark.ms, sLightCullingBenchmark.totalIndices, sLightCullingBenchmark.maxLightsPerCluster, sLightCullingBenchmark.workerCount);
+
+        ImGui::TreePop();
+    }
+
+    ImGui::Spacing();
+    ImGui::Separator();
+    ImGui::Spacing();
+
+    if (ImGui::TreeNode("Scene"))
+    {
+        bool changed = ImGui::SliderInt("Grid size", &sInstanceGridSize, 0, APP_MAX_INSTANCE_GRID_SIZE);
+        changed |= ImGui::DragFloat("Spacing", &sInstanceSpacing, 0.05f, 0.5f, 20.0f);
+        if (changed)
+            RebuildScene();
+
+        ImGui::Text("Instances: %u, world matrices in %.3f ms", GetInstanceCount(sScene), sInstancePrepareMs);
+
+        const CullingStats& culling = sVisibleSet.stats;
+        ImGui::Checkbox("Frustum culling", &sFrustumCulling);
+        ImGui::Text("Instances: %u drawn, %u culled in %.3f ms", culling.instancesTested - culling.instancesCulled, culling.instancesCulled, culling.ms);
+        ImGui::Text("Submesh draws: %u issued, %u culled", culling.submeshesDrawn, culling.submeshesCulled);
+
+        const MeshletCullingStats& meshletCulling = sMeshletVisibleSet.stats;
+        ImGui::Checkbox("Meshlet culling", &sMeshletCulling);
+        if (sMeshletCulling)
+        {
+            ImGui::Text("Meshlets: %u tested, %u outside, %u facing away in %.3f ms", meshletCulling.meshletsTested,
+                meshletCulling.meshletsFrustumCulled, meshletCulling.meshletsBackfaceCulled, meshletCulling.ms);
+            ImGui::Text("Triangles: %u tested, %u outside, %u facing away", meshletCulling.trianglesTested,
+                meshletCulling.trianglesFrustumCulled, meshletCulling.trianglesBackfaceCulled);
+            ImGui::Text("Meshes: %u compacted, %u drawn whole (over %u instances)", meshletCulling.meshesCompacted, meshletCulling.meshesWhole, MESHLET_CULLING_MAX_INSTANCES);
+        }
+
+        const LodStats& lodStats = sLodSelection.stats;
+        ImGui::Checkbox("Levels of detail", &sLodSelectionEnabled);
+        if (sLodSelectionEnabled)
+        {
+            ImGui::SliderFloat("Pixel error", &sLodPixelError, 0.1f, 8.0f);
+            ImGui::Text("Instances per level: %u, %u, %u, %u, %u in %.3f ms", lodStats.instances[0], lodStats.instances[1], lodStats.instances[2],
+                lodStats.instances[3], lodStats.instances[4], lodStats.ms);
+        }
+
+        if (ImGui::Button("Run culling benchmark (1M instances)"))
+        {
+            RunCullingBenchmark(*gJobs, 1000000, sCullingBenchmark);
+            sCullingBenchmarkRan = true;
+        }
+
+        if (sCullingBenchmarkRan)
+            ImGui::Text("%.2f ms (scalar %.2f ms), %u visible, %u submesh draws, %u mismatches (%u workers)", sCullingBenchmark.ms, sCullingBenchmark.scalarMs, sCullingBenchmark.visibleInstances, sCullingBenchmark.submeshesDrawn, sCullingBenchmark.mismatches, sCullingBenchmark.workerCount);
+
+        if (ImGui::Button("Run benchmark (100k instances)"))
+        {
+            RunSceneBenchmark(*gJobs, 100000, sSceneBenchmark);
+            sSceneBenchmarkRan = true;
+        }
+
+        if (sSceneBenchmarkRan)
+            ImGui::Text("%.2f ms, %.0f instances/ms (%u workers)", sSceneBenchmark.ms, sSceneBenchmark.instancesPerMs, sSceneBenchmark.workerCount);
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Software reference"))
+    {
+        // the reference has no shadow term, the frame next to it is drawn without shadows too
+        if (ImGui::Button("Render reference.png"))
+        {
+            sShadowsEnabled = false;
+            AppRenderSoftwareReference("reference.png", nullptr);
+        }
+
+        if (sSoftwareRan)
+        {
+            const RasterStats& stats = sSoftwareReference.stats;
+            ImGui::Text("%.2f ms, %.1f fps (vertex %.2f, bin %.2f, raster %.2f)%s", sSoftwareReference.ms, 1000.0f / sSoftwareReference.ms,
+                stats.vertexMs, stats.binMs, stats.rasterMs, sSoftwareReference.written ? "" : ", writing the png failed");
+            ImGui::Text("Triangles: %u in, %u culled, %u clipped", stats.trianglesIn, stats.trianglesCulled, stats.trianglesClipped);
+            ImGui::Text("Pixels shaded: %llu", (unsigned long long)stats.pixelsShaded);
+            ImGui::Text("Shadows turned off, the reference is unshadowed");
+        }
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Texture streaming"))
+    {
+        const TextureStreamingStats& streaming = sTextureStreamer.stats;
+        ImGui::SliderInt("Budget (MB)", &sStreamingBudgetMb, 8, 1024);
+        ImGui::SliderFloat("Mip bias", &sTextureStreamer.settings.mipBias, -2.0f, 4.0f);
+        ImGui::Text("Resident: %.1f MB, %.1f MB with reads in flight, %.1f MB wanted", streaming.residentBytes / (1024.0 * 1024.0),
+            streaming.reservedBytes / (1024.0 * 1024.0), streaming.wantedBytes / (1024.0 * 1024.0));
+        ImGui::Text("Reads: %u requested, %u in flight, %u meshes evicted, %u blurry, %.3f ms", streaming.requests, streaming.inFlight,
+            streaming.evictions, streaming.blurryMeshes, streaming.ms);
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Asset loading"))
+    {
+        ImGui::Text("Decode wall time: %.2f ms (%u workers)", sAssetDecodeWallTimeMs, gJobs->GetWorkerCount());
+        for (const AssetTiming& timing : sAssetTimings)
+        {
+            if (timing.loadedFromCache)
+                ImGui::Text("%6.2f ms  %s (cache)", timing.decodeMs, timing.path.c_str());
+            else if (!timing.format)
+                ImGui::Text("%6.2f ms  %s (source, %.1f MB scratch in %llu allocations, %u from the heap)", timing.decodeMs, timing.path.c_str(),
+                    timing.scratch.peakBytes / (1024.0 * 1024.0), (unsigned long long)timing.scratch.allocations, timing.scratch.heapAllocations);
+            else
+                ImGui::Text("%6.2f ms (+%.2f ms mips, +%.2f ms %s, %.1f dB)  %s", timing.decodeMs, timing.mipsMs, timing.encodeMs, timing.format, timing.psnr, timing.path.c_str());
+        }
+
+        if (ImGui::Button("Run obj parse benchmark"))
+            RunObjParseBenchmark(*gJobs, sLoadedMeshPaths, sObjParseBenchmark);
+
+        for (const ObjParseBenchmarkCase& bench : sObjParseBenchmark)
+            ImGui::Text("%-18s tinyobj %6.1f MB/s, parser %6.1f MB/s (%.2fx)%s", bench.path.c_str(), bench.tinyobjMBs, bench.parserMBs, bench.tinyobjMs / bench.parserMs, bench.identical ? "" : ", output differs");
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Math"))
+    {
+        ImGui::Text("Matrix code path: %s", GetSimdMathPath());
+        if (ImGui::Button("Run benchmark (100k matrices)"))
+        {
+            RunMathBenchmark(100000, sMathBenchmark);
+            sMathBenchmarkRan = true;
+        }
+
+        if (sMathBenchmarkRan)
+        {
+            for (uint32_t i = 0; i < sMathBenchmark.caseCount; i++)
+            {
+                const MathBenchmarkCase& bench = sMathBenchmark.cases[i];
+                ImGui::Text("%-10s scalar %7.3f ms, simd %7.3f ms (%.2fx), max error %g", bench.name, bench.scalarMs, bench.simdMs, bench.scalarMs / bench.simdMs, bench.maxError);
+            }
+        }
+
+        ImGui::TreePop();
+    }
+
+    if (ImGui::TreeNode("Profiler"))
+    {
+        ProfileFrameTimes history[PROFILER_HISTORY];
+        GetProfilerHistory(history);
+
+        float frameMs[PROFILER_HISTORY], cpuMs[PROFILER_HISTORY], gpuMs[PROFILER_HISTORY];
+        for (uint32_t i = 0; i < PROFILER_HISTORY; i++)
+        {
+            frameMs[i] = history[i].frameMs;
+            cpuMs[i] = history[i].cpuMs;
+            gpuMs[i] = history[i].gpuMs;
+        }
+
+        // the gpu times of the last few frames are still in flight, show the newest one that arrived
+        float lastGpuMs = 0.0f;
+        for (uint32_t i = PROFILER_HISTORY; i-- > 0 && lastGpuMs == 0.0f;)
+            lastGpuMs = gpuMs[i];
+
+        char overlay[32];
+        snprintf(overlay, sizeof(overlay), "%.2f ms", frameMs[PROFILER_HISTORY - 1]);
+        ImGui::PlotLines("Frame", frameMs, PROFILER_HISTORY, 0, overlay, 0.0f, 33.3f, ImVec2(0.0f, 60.0f));
+        snprintf(overlay, sizeof(overlay), "%.2f ms", cpuMs[PROFILER_HISTORY - 1]);
+        ImGui::PlotLines("CPU", cpuMs, PROFILER_HISTORY, 0, overlay, 0.0f, 33.3f, ImVec2(0.0f, 60.0f));
+        snprintf(overlay, sizeof(overlay), "%.2f ms", lastGpuMs);
+        ImGui::PlotLines("GPU", gpuMs, PROFILER_HISTORY, 0, overlay, 0.0f, 33.3f, ImVec2(0.0f, 60.0f));
+
+        ProfilerStats profilerStats = GetProfilerStats();
+        ImGui::Text("Frame %llu, %u threads, %llu events dropped", (unsigned long long)profilerStats.frameIndex, profilerStats.threadCount, (unsigned long long)profilerStats.droppedEvents);
+        RendererStats rendererStats = GetRendererStats();
+        ImGui::Text("%s: %u draws, %u instances, %u triangles", GetRendererName(), rendererStats.drawCalls, rendererStats.instancesDrawn, rendererStats.trianglesDrawn);
+        ImGui::Text("Shadow cube: %u faces, %u draws, %u triangles", rendererStats.shadowFacesDrawn, rendererStats.shadowDrawCalls, rendererStats.shadowTrianglesDrawn);
+        ImGui::Text("Commands: %u in %u buffers, record %.2f ms, sort %.2f ms, %u command lists", rendererStats.commands.commands,
+            rendererStats.commands.buffers, rendererStats.commands.recordMs, rendererStats.commands.sortMs, rendererStats.commandLists);
+        ImGui::Text("State changes: %u bound, %u already bound", rendererStats.commands.stateChanges, rendererStats.commands.stateChangesSkipped);
+        ImGui::Text("Shaders: %u from cache, %u compiled, %u stale removed, %.1f ms at startup", rendererStats.shaders.fromCache,
+            rendererStats.shaders.compiled, rendererStats.shaders.staleRemoved, rendererStats.shaders.wallTimeMs);
+        ImGui::Text("Textures: %u arrays, %u layers, %.1f%% occupied", rendererStats.textureArrays, rendererStats.textureLayers, rendererStats.textureOccupancy * 100.0f);
+        ImGui::Text("Constant buffers: %u uploaded, %u unchanged", rendererStats.constantUploads, rendererStats.constantUploadsSkipped);
+        ArenaStats frameArena = sFrameArena.GetStats();
+        ImGui::Text("Frame arena: %llu allocations, %.1f KB of %.1f KB, %u blocks from the heap so far", (unsigned long long)frameArena.allocations,
+            frameArena.peakBytes / 1024.0, frameArena.reservedBytes / 1024.0, frameArena.heapAllocations);
+        ImGui::Text("Object constants: %u uploaded, %u unchanged, ring %u / %u KB", rendererStats.objectUploads, rendererStats.objectUploadsSkipped,
+            rendererStats.objectRingUsed / 1024, rendererStats.objectRingSize / 1024);
+
+        // main thread scopes of the last frame, the workers only show up in the trace
+        for (const ProfileEvent& event : GetProfilerLastFrame())
+            if (event.thread == profilerStats.mainThread)
+                ImGui::Text("%*s%-*s %7.3f ms", event.depth * 2, "", 24 - event.depth * 2, event.name, (event.endNs - event.startNs) / 1e6);
+
+        if (!sTraceCaptureRequested && ImGui::Button("Capture 60 frames"))
+        {
+            ProfilerStartCapture(60);
+            sTraceWriteFrame = profilerStats.frameIndex + 60 + PROFILER_GPU_LATENCY;
+            sTraceCaptureRequested = true;
+        }
+
+        // written once the gpu timings of the last captured frames had time to arrive
+        if (sTraceCaptureRequested && !IsProfilerCapturing() && profilerStats.frameIndex >= sTraceWriteFrame)
+        {
+            sTraceWritten = WriteChromeTrace("trace.json");
+            sTraceCaptureRequested = false;
+            sTraceRan = true;
+        }
+
+        if (sTraceCaptureRequested)
+            ImGui::Text("Capturing...");
+        else if (sTraceRan)
+            ImGui::Text(sTraceWritten ? "Written to trace.json, open it in chrome://tracing" : "Failed to write trace.json");
+
+        ImGui::TreePop();
+    }
+
+    ImGui::End();
+}
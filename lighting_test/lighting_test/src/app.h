@@ -0,0 +1,56 @@
+#pragma once
+
+#include "flythrough.h"
+#include "renderer.h"
+#include "software_raster.h"
+#include "texture_streaming.h"
+
+// the demo itself, platform independent: loads the assets, keeps the scene, camera and lights, culls
+// and builds the RenderFrame the renderer draws. the frame loop that drives it lives with the platform
+
+// the most the settings panel goes to, AppInit clamps to them as well
+constexpr int APP_MAX_INSTANCE_GRID_SIZE = 100;
+constexpr int APP_MAX_POINT_LIGHTS = 4096;
+
+struct AppSettings
+{
+    int instanceGridSize = 0; // copies of the model around it, gridSize * gridSize
+    int pointLightCount = 0;
+    bool shadows = true; // the main light's cube shadow, the software reference has none
+};
+
+// the job system everything runs on, made on first use so the renderer can load its shaders before AppInit
+JobSystem& GetAppJobs();
+
+// decodes the assets on the job system and creates them on the renderer, false when nothing could be loaded
+bool AppInit(const AppSettings& settings);
+
+// camera, model and main light of the next AppUpdate, which then leaves the keyboard alone and animates the point
+// lights at the pose's time instead of its own
+void AppSetFlythroughPose(const FlythroughPose& pose);
+
+// moves the camera, prepares and culls the instances, animates and clusters the lights
+void AppUpdate();
+
+// the ImGui settings panel, call between ImGui::NewFrame and RendererDrawFrame
+void AppImgui();
+
+// valid until the next AppUpdate
+RenderFrame GetAppRenderFrame();
+
+// of the last AppUpdate
+TextureStreamingStats GetAppTextureStreamingStats();
+ArenaStats GetAppFrameArenaStats();
+
+struct SoftwareReference
+{
+    bool written = false; // false when writing the png failed
+    float ms = 0.0f;
+    RasterStats stats;
+    bool compared = false; // a golden image was given
+    RasterCompareResult compare;
+};
+
+// draws the current frame with the cpu rasterizer into a png and compares it against goldenPath when there is one.
+// it has no shadow term, the gpu frame only matches it with shadows turned off
+SoftwareReference AppRenderSoftwareReference(const char* path, const char* goldenPath);
@@ -0,0 +1,78 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <new>
+
+void* Arena::Allocate(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto alignedOffset = [&](const Block* block)
+    {
+        uintptr_t data = (uintptr_t)(block + 1);
+        return ((data + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - data;
+    };
+
+    size_t offset = blocks ? alignedOffset(blocks) : 0;
+    if (!blocks || offset + size > blocks->size)
+    {
+        // the rest of the current block is left unused, a new one holds at least this allocation
+        size_t newSize = std::max({ blockSize, mergedSize, size + alignment });
+        Block* block = (Block*)::operator new(sizeof(Block) + newSize);
+        block->next = blocks;
+        block->size = newSize;
+        block->used = 0;
+
+        blocks = block;
+        mergedSize = 0;
+        stats.reservedBytes += newSize;
+        stats.heapAllocations++;
+        offset = alignedOffset(block);
+    }
+
+    void* result = (uint8_t*)(blocks + 1) + offset;
+    stats.bytes += offset + size - blocks->used;
+    stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+    stats.allocations++;
+    blocks->used = offset + size;
+
+    return result;
+}
+
+void Arena::Reset()
+{
+    // a round that needed several blocks gets them as one the next time
+    if (blocks && blocks->next)
+    {
+        size_t total = (size_t)stats.reservedBytes;
+        Release();
+        mergedSize = total;
+    }
+    else if (blocks)
+    {
+        blocks->used = 0;
+    }
+
+    stats.allocations = 0;
+    stats.bytes = 0;
+    stats.resets++;
+}
+
+void Arena::Release()
+{
+    while (blocks)
+    {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+
+    stats.reservedBytes = 0;
+    mergedSize = 0;
+}
+
+ArenaStats Arena::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core.h"
+
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+// linear allocator for temporaries: allocating bumps a pointer through blocks taken from the heap, nothing is freed
+// on its own and Reset gives everything back at once. Reset keeps the memory, merged into a single block as big as
+// everything the round before needed, so an arena reset every frame or kept from one load to the next stops touching
+// the heap once it has seen its peak. allocating is locked so the jobs of one pass can share an arena, resetting is
+// not and must wait until they are done
+
+constexpr size_t ARENA_DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+struct ArenaStats
+{
+    uint64_t allocations = 0;     // since the last Reset
+    uint64_t bytes = 0;           // handed out since the last Reset, alignment padding included
+    uint64_t peakBytes = 0;       // most bytes handed out between two Resets
+    uint64_t reservedBytes = 0;   // blocks held right now
+    uint32_t heapAllocations = 0; // blocks taken from the heap over the arena's life
+    uint32_t resets = 0;
+};
+
+struct Arena
+{
+    explicit Arena(size_t blockSize = ARENA_DEFAULT_BLOCK_SIZE) : blockSize(blockSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() { Release(); }
+
+    // uninitialized, valid until the next Reset
+    void* Allocate(size_t size, size_t alignment);
+
+    // only for types that need no destructor, the arena never runs one
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "arena memory is given back without destructors");
+        return (T*)Allocate(count * sizeof(T), alignof(T));
+    }
+
+    void Reset();
+
+    // gives the blocks back to the heap
+    void Release();
+
+    ArenaStats GetStats();
+
+    struct Block
+    {
+        Block* next;
+        size_t size; // usable bytes after the header
+        size_t used;
+    };
+
+    size_t blockSize;
+    size_t mergedSize = 0;   // left by a Reset that gave back several blocks, the size of the next one
+    Block* blocks = nullptr; // the one allocated from first, the full ones after it
+    ArenaStats stats;
+    std::mutex mutex;
+};
+
+// lets std containers allocate from an arena, deallocate does nothing. growing one in small steps wastes every buffer
+// it grew out of until the Reset, reserve what is known up front
+template <typename T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return (T*)arena->Allocate(count * sizeof(T), alignof(T)); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
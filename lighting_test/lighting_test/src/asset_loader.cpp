@@ -0,0 +1,164 @@
+#include "asset_loader.h"
+#include "profiler.h"
+
+#include "../vendor/stb/stb_image.h"
+
+#include <chrono>
+
+using AssetClock = std::chrono::high_resolution_clock;
+
+static float MillisecondsSince(AssetClock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(AssetClock::now() - start).count();
+}
+
+bool DecodeMesh(JobSystem& jobs, DecodedMesh& mesh)
+{
+    PROFILE_SCOPE("DecodeMesh");
+
+    auto start = AssetClock::now();
+
+    // the cooked cache is mapped and used as is, the obj is only parsed when the cache is missing or stale
+    mesh.loadedFromCache = MapMeshCache(mesh.path, mesh.cacheFile, mesh.view);
+    if (!mesh.loadedFromCache)
+    {
+        Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+        mesh.ok = CookMeshData(jobs, mesh.path, scratch, mesh.data);
+        mesh.view = MakeMeshView(mesh.data);
+        mesh.scratch = scratch.GetStats();
+    }
+    else
+    {
+        mesh.ok = true;
+    }
+
+    mesh.decodeMs = MillisecondsSince(start);
+
+    // cook for the next launch, not counted in the decode time
+    if (mesh.ok && !mesh.loadedFromCache)
+        WriteMeshCache(mesh.path, mesh.data);
+
+    return mesh.ok;
+}
+
+// textures are authored in srgb, kaiser keeps distant mips sharp without aliasing
+static constexpr MipFilter TEXTURE_MIP_FILTER = MipFilter::Kaiser;
+static constexpr BcQuality TEXTURE_BC_QUALITY = BcQuality::High;
+
+static void CompressTexture(JobSystem& jobs, const MipChain& mips, DecodedTexture& texture)
+{
+    const MipLevel& top = mips.levels[0];
+
+    // d3d wants the top level of a block compressed texture to be a whole number of blocks
+    if (top.width % 4 != 0 || top.height % 4 != 0)
+        return;
+
+    bool hasAlpha = false;
+    const uint8_t* topPixels = mips.GetLevelPixels(0);
+    for (size_t i = 3; i < (size_t)top.width * top.height * 4 && !hasAlpha; i += 4)
+        hasAlpha = topPixels[i] != 0xff;
+
+    TextureData& data = texture.data;
+    data.format = ChooseBcFormat(hasAlpha, TEXTURE_BC_QUALITY);
+    data.levels = mips.levels;
+
+    size_t totalBytes = 0;
+    for (MipLevel& level : data.levels)
+    {
+        level.offset = totalBytes;
+        totalBytes += GetLevelSize(data.format, level.width, level.height);
+    }
+
+    data.data.resize(totalBytes);
+
+    for (uint32_t i = 0; i < data.levels.size(); i++)
+    {
+        const MipLevel& level = data.levels[i];
+        EncodeBcImage(jobs, data.format, TEXTURE_BC_QUALITY, mips.GetLevelPixels(i), level.width, level.height, data.data.data() + level.offset);
+    }
+
+    std::vector<uint8_t> decoded((size_t)top.width * top.height * 4);
+    DecodeBcImage(data.format, data.data.data(), top.width, top.height, decoded.data());
+    texture.psnr = ComputePsnr(topPixels, decoded.data(), (size_t)top.width * top.height);
+}
+
+bool DecodeTexture(JobSystem& jobs, DecodedTexture& texture)
+{
+    PROFILE_SCOPE("DecodeTexture");
+
+    auto start = AssetClock::now();
+
+    texture.loadedFromCache = MapTextureCache(texture.path, texture.cacheFile, texture.view);
+    if (texture.loadedFromCache)
+    {
+        texture.ok = true;
+        texture.decodeMs = MillisecondsSince(start);
+        return true;
+    }
+
+    int x, y, channels;
+    uint8_t* pixels = stbi_load(texture.path.c_str(), &x, &y, &channels, 4);
+    texture.ok = pixels != nullptr;
+
+    texture.decodeMs = MillisecondsSince(start);
+
+    if (!texture.ok)
+        return false;
+
+    auto mipsStart = AssetClock::now();
+
+    MipChain mips;
+    GenerateMipChain(jobs, pixels, (uint32_t)x, (uint32_t)y, TEXTURE_MIP_FILTER, true, mips);
+    stbi_image_free(pixels);
+
+    texture.mipsMs = MillisecondsSince(mipsStart);
+
+    auto encodeStart = AssetClock::now();
+
+    CompressTexture(jobs, mips, texture);
+
+    if (!IsBlockCompressed(texture.data.format))
+    {
+        texture.data.data = std::move(mips.pixels);
+        texture.data.levels = std::move(mips.levels);
+    }
+
+    texture.encodeMs = MillisecondsSince(encodeStart);
+
+    texture.view = MakeTextureView(texture.data);
+
+    WriteTextureCache(texture.path, texture.data);
+
+    return true;
+}
+
+uint32_t AddMesh(AssetBatch& batch, const std::string& path)
+{
+    batch.meshes.emplace_back().path = path;
+    return (uint32_t)batch.meshes.size() - 1;
+}
+
+uint32_t AddTexture(AssetBatch& batch, const std::string& path)
+{
+    batch.textures.emplace_back().path = path;
+    return (uint32_t)batch.textures.size() - 1;
+}
+
+void DecodeAssets(JobSystem& jobs, AssetBatch& batch)
+{
+    PROFILE_SCOPE("DecodeAssets");
+
+    auto start = AssetClock::now();
+
+    JobCounter counter;
+
+    for (DecodedMesh& mesh : batch.meshes)
+        jobs.Submit([&jobs, &mesh] { DecodeMesh(jobs, mesh); }, counter);
+
+    for (DecodedTexture& texture : batch.textures)
+        jobs.Submit([&jobs, &texture] { DecodeTexture(jobs, texture); }, counter);
+
+    jobs.Wait(counter);
+
+    batch.decodeWallTimeMs = MillisecondsSince(start);
+}
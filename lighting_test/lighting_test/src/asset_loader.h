@@ -0,0 +1,55 @@
+#pragma once
+
+#include "mesh_cache.h"
+#include "jobs.h"
+#include "texture_cache.h"
+
+#include <deque>
+
+struct DecodedMesh
+{
+    std::string path;
+    MappedFile cacheFile; // backs view when loadedFromCache
+    MeshData data;        // backs view otherwise
+    MeshView view;
+    ArenaStats scratch;   // of the parse, untouched when loadedFromCache
+    bool loadedFromCache = false;
+    bool ok = false;
+    float decodeMs = 0.0f;
+};
+
+struct DecodedTexture
+{
+    std::string path;
+    MappedFile cacheFile; // backs view when loadedFromCache
+    TextureData data;     // backs view otherwise
+    TextureView view;
+    bool loadedFromCache = false;
+    bool ok = false;
+    float decodeMs = 0.0f;
+    float mipsMs = 0.0f;
+    float encodeMs = 0.0f;
+    float psnr = 0.0f; // of the top level after block compression, 0 when not compressed
+};
+
+// everything the app wants loaded at once, decoded in parallel and then handed back to the
+// caller which creates the gpu resources on its own thread
+// deques so the returned references stay valid while adding more assets
+struct AssetBatch
+{
+    std::deque<DecodedMesh> meshes;
+    std::deque<DecodedTexture> textures;
+    float decodeWallTimeMs = 0.0f;
+};
+
+// maps the cooked cache when up to date, otherwise parses the obj with its chunks split across jobs
+bool DecodeMesh(JobSystem& jobs, DecodedMesh& mesh);
+// maps the cooked dds when up to date, otherwise decodes the image, builds its srgb correct mip chain,
+// block compresses it and cooks the dds for the next launch, mip and block rows are split across jobs
+bool DecodeTexture(JobSystem& jobs, DecodedTexture& texture);
+
+uint32_t AddMesh(AssetBatch& batch, const std::string& path);
+uint32_t AddTexture(AssetBatch& batch, const std::string& path);
+
+// one job per asset, blocks until all of them are decoded
+void DecodeAssets(JobSystem& jobs, AssetBatch& batch);
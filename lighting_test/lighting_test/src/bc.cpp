@@ -0,0 +1,907 @@
+#include "bc.h"
+
+#include "../vendor/stb/stb_image.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define BC_SSE 1
+    #include <emmintrin.h>
+#else
+    #define BC_SSE 0
+#endif
+
+static constexpr uint32_t MAX_PALETTE_SIZE = 16;
+
+// 4x4 texels in structure of arrays form, values in [0, 255]
+struct BlockPixels
+{
+    float channels[4][16];
+};
+
+// palette in structure of arrays form, padded to a multiple of 4 entries for the sse loop
+struct Palette
+{
+    float channels[4][MAX_PALETTE_SIZE];
+    uint32_t size;
+};
+
+static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+static const uint32_t BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+const char* GetTextureFormatName(TextureFormat format)
+{
+    switch (format)
+    {
+        case TextureFormat::BC1: return "BC1";
+        case TextureFormat::BC3: return "BC3";
+        case TextureFormat::BC7: return "BC7";
+        default: return "RGBA8";
+    }
+}
+
+bool IsBlockCompressed(TextureFormat format)
+{
+    return format != TextureFormat::RGBA8;
+}
+
+uint32_t GetBlockBytes(TextureFormat format)
+{
+    switch (format)
+    {
+        case TextureFormat::BC1: return 8;
+        case TextureFormat::BC3: return 16;
+        case TextureFormat::BC7: return 16;
+        default: return 4;
+    }
+}
+
+uint32_t GetRowPitch(TextureFormat format, uint32_t width)
+{
+    if (!IsBlockCompressed(format))
+        return width * 4;
+
+    return ((width + 3) / 4) * GetBlockBytes(format);
+}
+
+size_t GetLevelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+    uint32_t rows = IsBlockCompressed(format) ? (height + 3) / 4 : height;
+    return (size_t)GetRowPitch(format, width) * rows;
+}
+
+TextureFormat ChooseBcFormat(bool hasAlpha, BcQuality quality)
+{
+    if (quality == BcQuality::High)
+        return TextureFormat::BC7;
+
+    return hasAlpha ? TextureFormat::BC3 : TextureFormat::BC1;
+}
+
+static float Clamp(float x, float low, float high)
+{
+    return x < low ? low : (x > high ? high : x);
+}
+
+// edge blocks repeat the last row/column
+static void LoadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockPixels& outBlock)
+{
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        uint32_t srcY = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            uint32_t srcX = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+            const uint8_t* texel = rgba + ((size_t)srcY * width + srcX) * 4;
+            for (uint32_t c = 0; c < 4; c++)
+                outBlock.channels[c][y * 4 + x] = texel[c];
+        }
+    }
+}
+
+// nearest palette entry per texel, returns the total squared error
+static float AssignIndices(const BlockPixels& block, uint32_t channelCount, const Palette& palette, uint8_t outIndices[16])
+{
+    float totalError = 0.0f;
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+#if BC_SSE
+        __m128 best = _mm_set1_ps(1e30f);
+        __m128i bestIndex = _mm_setzero_si128();
+        __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i four = _mm_set1_epi32(4);
+
+        for (uint32_t p = 0; p < palette.size; p += 4)
+        {
+            __m128 error = _mm_setzero_ps();
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(&palette.channels[c][p]), _mm_set1_ps(block.channels[c][i]));
+                error = _mm_add_ps(error, _mm_mul_ps(d, d));
+            }
+
+            __m128 better = _mm_cmplt_ps(error, best);
+            best = _mm_min_ps(error, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(better), index), _mm_andnot_si128(_mm_castps_si128(better), bestIndex));
+            index = _mm_add_epi32(index, four);
+        }
+
+        float lanes[4];
+        int32_t laneIndices[4];
+        _mm_storeu_ps(lanes, best);
+        _mm_storeu_si128((__m128i*)laneIndices, bestIndex);
+
+        uint32_t winner = 0;
+        for (uint32_t lane = 1; lane < 4; lane++)
+            if (lanes[lane] < lanes[winner] || (lanes[lane] == lanes[winner] && laneIndices[lane] < laneIndices[winner]))
+                winner = lane;
+
+        outIndices[i] = (uint8_t)laneIndices[winner];
+        totalError += lanes[winner];
+#else
+        float best = 1e30f;
+        uint8_t bestIndex = 0;
+
+        for (uint32_t p = 0; p < palette.size; p++)
+        {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++)
+            {
+                float d = palette.channels[c][p] - block.channels[c][i];
+                error += d * d;
+            }
+
+            if (error < best)
+            {
+                best = error;
+                bestIndex = (uint8_t)p;
+            }
+        }
+
+        outIndices[i] = bestIndex;
+        totalError += best;
+#endif
+    }
+
+    return totalError;
+}
+
+// initial endpoints from the texels furthest apart along the chosen axis
+static void FitEndpoints(const BlockPixels& block, uint32_t channelCount, BcQuality quality, float outE0[4], float outE1[4])
+{
+    float mean[4] = {};
+    for (uint32_t c = 0; c < channelCount; c++)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+            mean[c] += block.channels[c][i];
+        mean[c] /= 16.0f;
+    }
+
+    float axis[4] = {};
+
+    if (quality == BcQuality::Fast)
+    {
+        // luminance-ish axis, alpha weighted like a color channel
+        axis[0] = 0.299f;
+        axis[1] = 0.587f;
+        axis[2] = 0.114f;
+        axis[3] = channelCount > 3 ? 0.5f : 0.0f;
+    }
+    else
+    {
+        float covariance[4][4] = {};
+        for (uint32_t i = 0; i < 16; i++)
+            for (uint32_t a = 0; a < channelCount; a++)
+                for (uint32_t b = 0; b < channelCount; b++)
+                    covariance[a][b] += (block.channels[a][i] - mean[a]) * (block.channels[b][i] - mean[b]);
+
+        // power iteration, starts from the diagonal so a flat block keeps a sane axis
+        for (uint32_t c = 0; c < channelCount; c++)
+            axis[c] = covariance[c][c] + 1.0f;
+
+        for (uint32_t iteration = 0; iteration < 8; iteration++)
+        {
+            float next[4] = {};
+            float length = 0.0f;
+            for (uint32_t a = 0; a < channelCount; a++)
+            {
+                for (uint32_t b = 0; b < channelCount; b++)
+                    next[a] += covariance[a][b] * axis[b];
+                length += next[a] * next[a];
+            }
+
+            if (length < 1e-12f)
+                break;
+
+            length = 1.0f / sqrtf(length);
+            for (uint32_t c = 0; c < channelCount; c++)
+                axis[c] = next[c] * length;
+        }
+    }
+
+    float minProjection = 1e30f;
+    float maxProjection = -1e30f;
+    uint32_t minTexel = 0;
+    uint32_t maxTexel = 0;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float projection = 0.0f;
+        for (uint32_t c = 0; c < channelCount; c++)
+            projection += (block.channels[c][i] - mean[c]) * axis[c];
+
+        if (projection < minProjection)
+        {
+            minProjection = projection;
+            minTexel = i;
+        }
+
+        if (projection > maxProjection)
+        {
+            maxProjection = projection;
+            maxTexel = i;
+        }
+    }
+
+    // fast takes the extreme texels as they are, high puts the endpoints on the principal axis
+    float axisLengthSq = 0.0f;
+    for (uint32_t c = 0; c < channelCount; c++)
+        axisLengthSq += axis[c] * axis[c];
+    axisLengthSq = axisLengthSq > 1e-12f ? axisLengthSq : 1.0f;
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        if (c >= channelCount)
+        {
+            outE0[c] = 255.0f;
+            outE1[c] = 255.0f;
+        }
+        else if (quality == BcQuality::Fast)
+        {
+            outE0[c] = block.channels[c][minTexel];
+            outE1[c] = block.channels[c][maxTexel];
+        }
+        else
+        {
+            outE0[c] = Clamp(mean[c] + axis[c] * minProjection / axisLengthSq, 0.0f, 255.0f);
+            outE1[c] = Clamp(mean[c] + axis[c] * maxProjection / axisLengthSq, 0.0f, 255.0f);
+        }
+    }
+}
+
+// least squares endpoints for fixed palette weights per texel
+static bool RefineEndpoints(const BlockPixels& block, uint32_t channelCount, const float weights[16], float outE0[4], float outE1[4])
+{
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float rhs0[4] = {}, rhs1[4] = {};
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        float w1 = weights[i];
+        float w0 = 1.0f - w1;
+        a += w0 * w0;
+        b += w0 * w1;
+        c += w1 * w1;
+
+        for (uint32_t ch = 0; ch < channelCount; ch++)
+        {
+            rhs0[ch] += w0 * block.channels[ch][i];
+            rhs1[ch] += w1 * block.channels[ch][i];
+        }
+    }
+
+    float determinant = a * c - b * b;
+    if (fabsf(determinant) < 1e-6f)
+        return false;
+
+    float inverse = 1.0f / determinant;
+    for (uint32_t ch = 0; ch < channelCount; ch++)
+    {
+        outE0[ch] = Clamp((c * rhs0[ch] - b * rhs1[ch]) * inverse, 0.0f, 255.0f);
+        outE1[ch] = Clamp((a * rhs1[ch] - b * rhs0[ch]) * inverse, 0.0f, 255.0f);
+    }
+
+    return true;
+}
+
+// ---- BC1 color block ----
+
+static uint16_t PackRgb565(const float color[4])
+{
+    uint32_t r = (uint32_t)(color[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = (uint32_t)(color[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = (uint32_t)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRgb565(uint16_t packed, float outColor[4])
+{
+    uint32_t r = (packed >> 11) & 31;
+    uint32_t g = (packed >> 5) & 63;
+    uint32_t b = packed & 31;
+    outColor[0] = (float)((r << 3) | (r >> 2));
+    outColor[1] = (float)((g << 2) | (g >> 4));
+    outColor[2] = (float)((b << 3) | (b >> 2));
+    outColor[3] = 255.0f;
+}
+
+static void BuildBc1Palette(uint16_t c0, uint16_t c1, Palette& outPalette)
+{
+    float e0[4], e1[4];
+    UnpackRgb565(c0, e0);
+    UnpackRgb565(c1, e1);
+
+    for (uint32_t p = 0; p < 4; p++)
+        for (uint32_t c = 0; c < 4; c++)
+            outPalette.channels[c][p] = e0[c] + (e1[c] - e0[c]) * BC1_WEIGHTS[p];
+
+    outPalette.size = 4;
+}
+
+struct Bc1Result
+{
+    uint16_t c0, c1;
+    uint8_t indices[16];
+    float error;
+};
+
+static Bc1Result EvaluateBc1(const BlockPixels& block, const float e0[4], const float e1[4])
+{
+    Bc1Result result;
+    result.c0 = PackRgb565(e0);
+    result.c1 = PackRgb565(e1);
+
+    // 4 color mode needs c0 > c1
+    if (result.c0 < result.c1)
+    {
+        uint16_t temp = result.c0;
+        result.c0 = result.c1;
+        result.c1 = temp;
+    }
+
+    // equal endpoints decode in 3 color mode where index 3 is transparent black, the palette
+    // entries are all the same color then and ties resolve to index 0 so that index is never picked
+    Palette palette;
+    BuildBc1Palette(result.c0, result.c1, palette);
+    result.error = AssignIndices(block, 3, palette, result.indices);
+    return result;
+}
+
+static void EncodeBc1Color(const BlockPixels& block, BcQuality quality, uint8_t* outBlock)
+{
+    float e0[4], e1[4];
+    FitEndpoints(block, 3, quality, e0, e1);
+
+    Bc1Result best = EvaluateBc1(block, e0, e1);
+
+    if (quality == BcQuality::High)
+    {
+        for (uint32_t iteration = 0; iteration < 2; iteration++)
+        {
+            float weights[16];
+            for (uint32_t i = 0; i < 16; i++)
+                weights[i] = BC1_WEIGHTS[best.indices[i]];
+
+            float c0[4], c1[4];
+            UnpackRgb565(best.c0, c0);
+            UnpackRgb565(best.c1, c1);
+            if (!RefineEndpoints(block, 3, weights, c0, c1))
+                break;
+
+            Bc1Result candidate = EvaluateBc1(block, c0, c1);
+            if (candidate.error >= best.error)
+                break;
+
+            best = candidate;
+        }
+    }
+
+    uint32_t indexBits = 0;
+    for (uint32_t i = 0; i < 16; i++)
+        indexBits |= (uint32_t)best.indices[i] << (i * 2);
+
+    memcpy(outBlock + 0, &best.c0, 2);
+    memcpy(outBlock + 2, &best.c1, 2);
+    memcpy(outBlock + 4, &indexBits, 4);
+}
+
+// ---- BC3 alpha block ----
+
+static void EncodeBc3Alpha(const BlockPixels& block, uint8_t* outBlock)
+{
+    float minAlpha = 255.0f, maxAlpha = 0.0f;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        minAlpha = block.channels[3][i] < minAlpha ? block.channels[3][i] : minAlpha;
+        maxAlpha = block.channels[3][i] > maxAlpha ? block.channels[3][i] : maxAlpha;
+    }
+
+    uint8_t a0 = (uint8_t)(maxAlpha + 0.5f);
+    uint8_t a1 = (uint8_t)(minAlpha + 0.5f);
+
+    uint64_t indexBits = 0;
+
+    if (a0 != a1)
+    {
+        // 8 value mode: a0, a1, then 6 interpolated steps from a0 to a1
+        float values[8] = { (float)a0, (float)a1 };
+        for (uint32_t i = 1; i < 7; i++)
+            values[i + 1] = ((7 - i) * a0 + i * a1) / 7.0f;
+
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            uint64_t bestIndex = 0;
+            float bestError = 1e30f;
+            for (uint32_t v = 0; v < 8; v++)
+            {
+                float error = fabsf(values[v] - block.channels[3][i]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = v;
+                }
+            }
+            indexBits |= bestIndex << (i * 3);
+        }
+    }
+
+    outBlock[0] = a0;
+    outBlock[1] = a1;
+    for (uint32_t i = 0; i < 6; i++)
+        outBlock[2 + i] = (uint8_t)(indexBits >> (i * 8));
+}
+
+// ---- BC7 mode 6: one subset, rgba 7 bit endpoints plus a p-bit each, 4 bit indices ----
+
+// picks the p-bit that lands closest to the ideal 8 bit endpoint
+static void QuantizeBc7Endpoint(const float endpoint[4], uint8_t outQuantized[4], uint32_t& outPBit)
+{
+    float bestError = 1e30f;
+
+    for (uint32_t p = 0; p < 2; p++)
+    {
+        uint8_t quantized[4];
+        float error = 0.0f;
+
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float q = floorf((endpoint[c] - p) / 2.0f + 0.5f);
+            q = Clamp(q, 0.0f, 127.0f);
+            quantized[c] = (uint8_t)q;
+
+            float d = (float)(((uint32_t)q << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+
+        if (error < bestError)
+        {
+            bestError = error;
+            outPBit = p;
+            memcpy(outQuantized, quantized, 4);
+        }
+    }
+}
+
+struct Bc7Result
+{
+    uint8_t e0[4], e1[4]; // 7 bit
+    uint32_t p0, p1;
+    uint8_t indices[16];
+    float error;
+};
+
+static void ExpandBc7Endpoint(const uint8_t quantized[4], uint32_t pBit, float outEndpoint[4])
+{
+    for (uint32_t c = 0; c < 4; c++)
+        outEndpoint[c] = (float)((quantized[c] << 1) | pBit);
+}
+
+static float Bc7Interpolate(float e0, float e1, uint32_t weight)
+{
+    return (float)((((uint32_t)e0 * (64 - weight) + (uint32_t)e1 * weight + 32) >> 6));
+}
+
+static Bc7Result EvaluateBc7(const BlockPixels& block, const float e0[4], const float e1[4])
+{
+    Bc7Result result;
+    QuantizeBc7Endpoint(e0, result.e0, result.p0);
+    QuantizeBc7Endpoint(e1, result.e1, result.p1);
+
+    float x0[4], x1[4];
+    ExpandBc7Endpoint(result.e0, result.p0, x0);
+    ExpandBc7Endpoint(result.e1, result.p1, x1);
+
+    Palette palette;
+    palette.size = 16;
+    for (uint32_t p = 0; p < 16; p++)
+        for (uint32_t c = 0; c < 4; c++)
+            palette.channels[c][p] = Bc7Interpolate(x0[c], x1[c], BC7_WEIGHTS[p]);
+
+    result.error = AssignIndices(block, 4, palette, result.indices);
+    return result;
+}
+
+// little endian bit writer over a 16 byte block
+struct BlockBitWriter
+{
+    uint8_t* bytes;
+    uint32_t position = 0;
+
+    void Write(uint32_t value, uint32_t bitCount)
+    {
+        for (uint32_t i = 0; i < bitCount; i++, position++)
+            if ((value >> i) & 1)
+                bytes[position >> 3] |= (uint8_t)(1 << (position & 7));
+    }
+};
+
+struct BlockBitReader
+{
+    const uint8_t* bytes;
+    uint32_t position = 0;
+
+    uint32_t Read(uint32_t bitCount)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bitCount; i++, position++)
+            value |= (uint32_t)((bytes[position >> 3] >> (position & 7)) & 1) << i;
+        return value;
+    }
+};
+
+static void WriteBc7Mode6(const Bc7Result& result, uint8_t* outBlock)
+{
+    memset(outBlock, 0, 16);
+
+    BlockBitWriter writer = { outBlock };
+    writer.Write(1 << 6, 7); // mode 6
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        writer.Write(result.e0[c], 7);
+        writer.Write(result.e1[c], 7);
+    }
+
+    writer.Write(result.p0, 1);
+    writer.Write(result.p1, 1);
+
+    writer.Write(result.indices[0], 3);
+    for (uint32_t i = 1; i < 16; i++)
+        writer.Write(result.indices[i], 4);
+}
+
+static void EncodeBc7Mode6(const BlockPixels& block, BcQuality quality, uint8_t* outBlock)
+{
+    float e0[4], e1[4];
+    FitEndpoints(block, 4, quality, e0, e1);
+
+    Bc7Result best = EvaluateBc7(block, e0, e1);
+
+    if (quality == BcQuality::High)
+    {
+        for (uint32_t iteration = 0; iteration < 2; iteration++)
+        {
+            float weights[16];
+            for (uint32_t i = 0; i < 16; i++)
+                weights[i] = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+
+            float r0[4], r1[4];
+            ExpandBc7Endpoint(best.e0, best.p0, r0);
+            ExpandBc7Endpoint(best.e1, best.p1, r1);
+            if (!RefineEndpoints(block, 4, weights, r0, r1))
+                break;
+
+            Bc7Result candidate = EvaluateBc7(block, r0, r1);
+            if (candidate.error >= best.error)
+                break;
+
+            best = candidate;
+        }
+    }
+
+    // the anchor texel only stores 3 bits, so its index has to be in the lower half
+    if (best.indices[0] >= 8)
+    {
+        uint8_t temp[4];
+        memcpy(temp, best.e0, 4);
+        memcpy(best.e0, best.e1, 4);
+        memcpy(best.e1, temp, 4);
+
+        uint32_t tempP = best.p0;
+        best.p0 = best.p1;
+        best.p1 = tempP;
+
+        for (uint32_t i = 0; i < 16; i++)
+            best.indices[i] = (uint8_t)(15 - best.indices[i]);
+    }
+
+    WriteBc7Mode6(best, outBlock);
+}
+
+void EncodeBcImage(JobSystem& jobs, TextureFormat format, BcQuality quality, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* outBlocks)
+{
+    check(IsBlockCompressed(format));
+
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint32_t blockBytes = GetBlockBytes(format);
+
+    ParallelFor(jobs, blocksY, 4, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t by = begin; by < end; by++)
+        {
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                BlockPixels block;
+                LoadBlock(rgba, width, height, bx, by, block);
+
+                uint8_t* outBlock = outBlocks + ((size_t)by * blocksX + bx) * blockBytes;
+
+                switch (format)
+                {
+                    case TextureFormat::BC1:
+                        EncodeBc1Color(block, quality, outBlock);
+                        break;
+
+                    case TextureFormat::BC3:
+                        EncodeBc3Alpha(block, outBlock);
+                        EncodeBc1Color(block, quality, outBlock + 8);
+                        break;
+
+                    case TextureFormat::BC7:
+                        EncodeBc7Mode6(block, quality, outBlock);
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+        }
+    });
+}
+
+// ---- decoders ----
+
+static void DecodeBc1Color(const uint8_t* block, bool allowThreeColor, uint8_t outTexels[16][4])
+{
+    uint16_t c0, c1;
+    uint32_t indexBits;
+    memcpy(&c0, block + 0, 2);
+    memcpy(&c1, block + 2, 2);
+    memcpy(&indexBits, block + 4, 4);
+
+    float e0[4], e1[4];
+    UnpackRgb565(c0, e0);
+    UnpackRgb565(c1, e1);
+
+    float palette[4][4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        palette[0][c] = e0[c];
+        palette[1][c] = e1[c];
+
+        if (c0 > c1 || !allowThreeColor)
+        {
+            palette[2][c] = (2.0f * e0[c] + e1[c]) / 3.0f;
+            palette[3][c] = (e0[c] + 2.0f * e1[c]) / 3.0f;
+        }
+        else
+        {
+            palette[2][c] = (e0[c] + e1[c]) / 2.0f;
+            palette[3][c] = 0.0f;
+        }
+    }
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t index = (indexBits >> (i * 2)) & 3;
+        for (uint32_t c = 0; c < 4; c++)
+            outTexels[i][c] = (uint8_t)(palette[index][c] + 0.5f);
+    }
+}
+
+static void DecodeBc3Alpha(const uint8_t* block, uint8_t outTexels[16][4])
+{
+    uint32_t a0 = block[0];
+    uint32_t a1 = block[1];
+
+    float values[8] = { (float)a0, (float)a1 };
+    if (a0 > a1)
+    {
+        for (uint32_t i = 1; i < 7; i++)
+            values[i + 1] = ((7 - i) * a0 + i * a1) / 7.0f;
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; i++)
+            values[i + 1] = ((5 - i) * a0 + i * a1) / 5.0f;
+        values[6] = 0.0f;
+        values[7] = 255.0f;
+    }
+
+    uint64_t indexBits = 0;
+    for (uint32_t i = 0; i < 6; i++)
+        indexBits |= (uint64_t)block[2 + i] << (i * 8);
+
+    for (uint32_t i = 0; i < 16; i++)
+        outTexels[i][3] = (uint8_t)(values[(indexBits >> (i * 3)) & 7] + 0.5f);
+}
+
+static void DecodeBc7(const uint8_t* block, uint8_t outTexels[16][4])
+{
+    BlockBitReader reader = { block };
+
+    // only mode 6 is produced by the encoder, anything else decodes to transparent black
+    if (reader.Read(7) != (1 << 6))
+    {
+        memset(outTexels, 0, 16 * 4);
+        return;
+    }
+
+    uint8_t e0[4], e1[4];
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        e0[c] = (uint8_t)reader.Read(7);
+        e1[c] = (uint8_t)reader.Read(7);
+    }
+
+    uint32_t p0 = reader.Read(1);
+    uint32_t p1 = reader.Read(1);
+
+    float x0[4], x1[4];
+    ExpandBc7Endpoint(e0, p0, x0);
+    ExpandBc7Endpoint(e1, p1, x1);
+
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        uint32_t index = reader.Read(i == 0 ? 3 : 4);
+        for (uint32_t c = 0; c < 4; c++)
+            outTexels[i][c] = (uint8_t)Bc7Interpolate(x0[c], x1[c], BC7_WEIGHTS[index]);
+    }
+}
+
+void DecodeBcImage(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* outRgba)
+{
+    check(IsBlockCompressed(format));
+
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint32_t blockBytes = GetBlockBytes(format);
+
+    for (uint32_t by = 0; by < blocksY; by++)
+    {
+        for (uint32_t bx = 0; bx < blocksX; bx++)
+        {
+            const uint8_t* block = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+
+            uint8_t texels[16][4];
+            switch (format)
+            {
+                case TextureFormat::BC1:
+                    DecodeBc1Color(block, true, texels);
+                    break;
+
+                case TextureFormat::BC3:
+                    DecodeBc1Color(block + 8, false, texels);
+                    DecodeBc3Alpha(block, texels);
+                    break;
+
+                default:
+                    DecodeBc7(block, texels);
+                    break;
+            }
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++)
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(outRgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+        }
+    }
+}
+
+float ComputePsnr(const uint8_t* rgbaA, const uint8_t* rgbaB, size_t pixelCount)
+{
+    double squaredError = 0.0;
+    for (size_t i = 0; i < pixelCount * 4; i++)
+    {
+        double d = (double)rgbaA[i] - (double)rgbaB[i];
+        squaredError += d * d;
+    }
+
+    double meanSquaredError = squaredError / (double)(pixelCount * 4);
+    if (meanSquaredError <= 0.0)
+        return 99.0f;
+
+    return (float)(10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
+
+uint32_t CheckBc7RoundTrip(uint32_t blockCount)
+{
+    std::mt19937 rng(7);
+    uint32_t mismatches = 0;
+
+    for (uint32_t b = 0; b < blockCount; b++)
+    {
+        Bc7Result fields = {};
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            fields.e0[c] = (uint8_t)(rng() & 127);
+            fields.e1[c] = (uint8_t)(rng() & 127);
+        }
+        fields.p0 = rng() & 1;
+        fields.p1 = rng() & 1;
+        fields.indices[0] = (uint8_t)(rng() & 7); // the anchor only has 3 bits
+        for (uint32_t i = 1; i < 16; i++)
+            fields.indices[i] = (uint8_t)(rng() & 15);
+
+        uint8_t block[16];
+        WriteBc7Mode6(fields, block);
+
+        uint8_t decoded[16 * 4];
+        DecodeBcImage(TextureFormat::BC7, block, 4, 4, decoded);
+
+        // straight from the fields with the spec's integer interpolation
+        bool same = true;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t x0 = ((uint32_t)fields.e0[c] << 1) | fields.p0;
+                uint32_t x1 = ((uint32_t)fields.e1[c] << 1) | fields.p1;
+                uint32_t weight = BC7_WEIGHTS[fields.indices[i]];
+                same &= decoded[i * 4 + c] == (uint8_t)((x0 * (64 - weight) + x1 * weight + 32) >> 6);
+            }
+        }
+
+        mismatches += same ? 0 : 1;
+    }
+
+    return mismatches;
+}
+
+void RunBcBenchmark(JobSystem& jobs, const std::vector<std::string>& texturePaths, BcBenchmarkResult& result)
+{
+    using BcClock = std::chrono::high_resolution_clock;
+
+    static const TextureFormat FORMATS[BC_BENCHMARK_FORMATS] = { TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7 };
+
+    result = {};
+    result.workerCount = jobs.GetWorkerCount();
+
+    for (const std::string& path : texturePaths)
+    {
+        int x, y, channels;
+        uint8_t* pixels = stbi_load(path.c_str(), &x, &y, &channels, 4);
+        if (!pixels)
+            continue;
+
+        BcBenchmarkCase& bench = result.cases.emplace_back();
+        bench.path = path;
+        bench.width = (uint32_t)x;
+        bench.height = (uint32_t)y;
+
+        std::vector<uint8_t> decoded((size_t)x * y * 4);
+        for (uint32_t i = 0; i < BC_BENCHMARK_FORMATS; i++)
+        {
+            BcBenchmarkFormat& format = bench.formats[i];
+            format.format = FORMATS[i];
+
+            std::vector<uint8_t> blocks(GetLevelSize(format.format, bench.width, bench.height));
+
+            auto start = BcClock::now();
+            EncodeBcImage(jobs, format.format, BcQuality::High, pixels, bench.width, bench.height, blocks.data());
+            format.ms = std::chrono::duration<double, std::milli>(BcClock::now() - start).count();
+            format.mbPerSecond = (double)x * y * 4 / (1024.0 * 1024.0) / (format.ms / 1000.0);
+
+            DecodeBcImage(format.format, blocks.data(), bench.width, bench.height, decoded.data());
+            format.psnr = ComputePsnr(pixels, decoded.data(), (size_t)x * y);
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    result.roundTripBlocks = 4096;
+    result.roundTripMismatches = CheckBc7RoundTrip(result.roundTripBlocks);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "jobs.h"
+
+#include <string>
+#include <vector>
+
+enum class TextureFormat : uint32_t
+{
+    RGBA8,
+    BC1, // rgb, 4 bits per texel
+    BC3, // rgba, 8 bits per texel
+    BC7, // rgba, 8 bits per texel, only mode 6 is encoded (and decoded)
+};
+
+enum class BcQuality
+{
+    Fast, // luminance extremes, one index pass
+    High, // principal axis fit and least squares endpoint refinement
+};
+
+const char* GetTextureFormatName(TextureFormat format);
+
+bool IsBlockCompressed(TextureFormat format);
+
+// 8 or 16, 4 for RGBA8 (bytes per texel)
+uint32_t GetBlockBytes(TextureFormat format);
+
+uint32_t GetRowPitch(TextureFormat format, uint32_t width);
+size_t GetLevelSize(TextureFormat format, uint32_t width, uint32_t height);
+
+// fast picks BC1/BC3 depending on alpha, high always goes for BC7
+TextureFormat ChooseBcFormat(bool hasAlpha, BcQuality quality);
+
+// rgba8 in, blocks out (GetLevelSize bytes), block rows are split across jobs
+void EncodeBcImage(JobSystem& jobs, TextureFormat format, BcQuality quality, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* outBlocks);
+
+// blocks in, rgba8 out, used to measure what the encoder lost
+void DecodeBcImage(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* outRgba);
+
+// peak signal to noise ratio over all four channels, in dB
+float ComputePsnr(const uint8_t* rgbaA, const uint8_t* rgbaB, size_t pixelCount);
+
+// random mode 6 blocks packed like the encoder packs them and decoded again, returns the blocks whose texels differ
+// from what the spec's interpolation gives for their fields, should be 0
+uint32_t CheckBc7RoundTrip(uint32_t blockCount);
+
+constexpr uint32_t BC_BENCHMARK_FORMATS = 3;
+
+struct BcBenchmarkFormat
+{
+    TextureFormat format;
+    double ms;
+    double mbPerSecond; // of rgba8 source
+    float psnr;         // over all four channels, bc1 keeps no alpha and scores low on textures that have some
+};
+
+struct BcBenchmarkCase
+{
+    std::string path;
+    uint32_t width;
+    uint32_t height;
+    BcBenchmarkFormat formats[BC_BENCHMARK_FORMATS]; // BC1, BC3, BC7
+};
+
+struct BcBenchmarkResult
+{
+    std::vector<BcBenchmarkCase> cases;
+    uint32_t workerCount;
+    uint32_t roundTripBlocks;
+    uint32_t roundTripMismatches;
+};
+
+// the top level of every texture encoded at high quality in each format, decoded again for the psnr
+void RunBcBenchmark(JobSystem& jobs, const std::vector<std::string>& texturePaths, BcBenchmarkResult& result);
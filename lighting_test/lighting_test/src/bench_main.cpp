@@ -0,0 +1,496 @@
+#include "allocation_bench.h"
+#include "asset_loader.h"
+#include "culling.h"
+#include "light_culling.h"
+#include "math_bench.h"
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "meshlet.h"
+#include "mips.h"
+#include "obj_parser.h"
+#include "profiler.h"
+#include "render_commands.h"
+#include "scene.h"
+#include "shader_cache.h"
+#include "shadow_cache.h"
+#include "texture_atlas.h"
+#include "texture_streaming.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// the benchmarks of the settings panel as a console program, for machines without a gpu.
+// run from the project directory (or pass --data) so the asset benchmarks find meshes/ and textures/
+
+// every heap allocation of the program is counted so the allocations benchmark can tell what the arenas saved,
+// the aligned overloads are left to the library and not counted
+static std::atomic<uint64_t> sHeapAllocations = 0;
+
+void* operator new(size_t size)
+{
+    sHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    sHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+static std::vector<std::string> FindFiles(const char* directory, std::initializer_list<const char*> extensions)
+{
+    std::vector<std::string> paths;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory, error))
+    {
+        if (!entry.is_regular_file())
+            continue;
+
+        std::string extension = entry.path().extension().string();
+        for (const char* wanted : extensions)
+        {
+            if (extension == wanted)
+                paths.push_back(entry.path().generic_string());
+        }
+    }
+
+    // same order on every run and filesystem
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static void BenchMath(JobSystem&)
+{
+    MathBenchmarkResult result;
+    RunMathBenchmark(100000, result);
+
+    printf("math (%s, %u matrices)\n", result.simdPath, result.matrixCount);
+    for (uint32_t i = 0; i < result.caseCount; i++)
+    {
+        const MathBenchmarkCase& bench = result.cases[i];
+        printf("  %-10s scalar %7.3f ms, simd %7.3f ms (%.2fx), max error %g\n", bench.name, bench.scalarMs, bench.simdMs, bench.scalarMs / bench.simdMs, bench.maxError);
+    }
+}
+
+static void BenchScene(JobSystem& jobs)
+{
+    SceneBenchmarkResult result;
+    RunSceneBenchmark(jobs, 100000, result);
+
+    printf("scene (%u instances, %u workers)\n", result.instanceCount, result.workerCount);
+    printf("  %.3f ms, %.0f instances/ms\n", result.ms, result.instancesPerMs);
+}
+
+static void BenchCulling(JobSystem& jobs)
+{
+    CullingBenchmarkResult result;
+    RunCullingBenchmark(jobs, 1000000, result);
+
+    printf("culling (%u instances, %u workers)\n", result.instanceCount, result.workerCount);
+    printf("  %.3f ms (scalar %.3f ms), %u visible, %u submesh draws, %u mismatches\n", result.ms, result.scalarMs, result.visibleInstances, result.submeshesDrawn, result.mismatches);
+}
+
+static void BenchLightCulling(JobSystem& jobs)
+{
+    LightCullingBenchmarkResult result;
+    RunLightCullingBenchmark(jobs, 1024, result);
+
+    printf("light culling (%u lights, %u workers)\n", result.lightCount, result.workerCount);
+    printf("  %.3f ms, %u indices, max %u per cluster, %u mismatches\n", result.ms, result.totalIndices, result.maxLightsPerCluster,
+        result.mismatches);
+}
+
+static void BenchObjParse(JobSystem& jobs)
+{
+    std::vector<std::string> paths = FindFiles("meshes", { ".obj" });
+
+    std::vector<ObjParseBenchmarkCase> cases;
+    RunObjParseBenchmark(jobs, paths, cases);
+
+    printf("obj parse (%u meshes)\n", (uint32_t)cases.size());
+    for (const ObjParseBenchmarkCase& bench : cases)
+        printf("  %-24s tinyobj %6.1f MB/s, parser %6.1f MB/s (%.2fx)%s\n", bench.path.c_str(), bench.tinyobjMBs, bench.parserMBs, bench.tinyobjMs / bench.parserMs, bench.identical ? "" : ", output differs");
+}
+
+// a first run on a fresh checkout decodes the sources and cooks the caches, later runs map the caches
+static void BenchAssets(JobSystem& jobs)
+{
+    AssetBatch assets;
+    for (const std::string& path : FindFiles("meshes", { ".obj" }))
+        AddMesh(assets, path);
+    for (const std::string& path : FindFiles("textures", { ".png", ".jpg" }))
+        AddTexture(assets, path);
+
+    DecodeAssets(jobs, assets);
+
+    printf("asset decode (%u meshes, %u textures)\n", (uint32_t)assets.meshes.size(), (uint32_t)assets.textures.size());
+    printf("  %.2f ms wall\n", assets.decodeWallTimeMs);
+    for (const DecodedMesh& mesh : assets.meshes)
+        printf("  %7.2f ms  %s (%s)%s\n", mesh.decodeMs, mesh.path.c_str(), mesh.loadedFromCache ? "cache" : "source", mesh.ok ? "" : ", failed");
+    for (const DecodedTexture& texture : assets.textures)
+    {
+        printf("  %7.2f ms  %s (%s)%s", texture.decodeMs, texture.path.c_str(), texture.loadedFromCache ? "cache" : "source", texture.ok ? "" : ", failed");
+        if (!texture.loadedFromCache && texture.ok)
+            printf(", mips %.2f ms", texture.mipsMs);
+        if (!texture.loadedFromCache && IsBlockCompressed(texture.data.format))
+            printf(", %s in %.2f ms, %.1f dB", GetTextureFormatName(texture.data.format), texture.encodeMs, texture.psnr);
+        printf("\n");
+    }
+}
+
+// what welding and the vertex cache pass saved per mesh, and a launch without the cache against one with it
+static void BenchMeshes(JobSystem& jobs)
+{
+    std::vector<MeshBenchmarkCase> cases;
+    RunMeshBenchmark(jobs, FindFiles("meshes", { ".obj" }), cases);
+
+    printf("meshes (%u meshes)\n", (uint32_t)cases.size());
+    for (const MeshBenchmarkCase& bench : cases)
+    {
+        const MeshStats& stats = bench.stats;
+        printf("  %-20s %u submeshes, %u indices, %u vertices welded from %u (%.2fx), %.1f KB saved\n", bench.path.c_str(), bench.submeshCount,
+            stats.indexCount, stats.vertexCount, stats.unweldedVertexCount, (float)stats.unweldedVertexCount / (stats.vertexCount ? stats.vertexCount : 1),
+            MeshBytesSaved(stats, VertexFormat::Full) / 1024.0f);
+        printf("    acmr %.3f -> %.3f -> %.3f, atvr %.3f -> %.3f -> %.3f (welded, optimized, meshlet order, fifo of %u)\n", stats.acmrBefore,
+            stats.acmrOptimized, stats.acmrAfter, stats.atvrBefore, stats.atvrOptimized, stats.atvrAfter, VERTEX_CACHE_SIZE);
+        printf("    obj parse %.2f ms, cook %.2f ms, cache map %.3f ms (%.0fx faster than the cook), %.1f KB%s\n", bench.parseMs, bench.cookMs,
+            bench.mapMs, bench.cookMs / bench.mapMs, bench.cacheBytes / 1024.0f, bench.cacheMatches ? "" : ", MISMATCH");
+
+        if (bench.vertexFormat == VertexFormat::Packed)
+        {
+            const VertexPackingError& error = stats.packingError;
+            printf("    packed error: pos %.6f (bound %.6f), normal %.4f deg (bound %.2f), uv %.6f (bound %.6f)%s\n", error.position,
+                GetMaxPackedPositionError(bench.quantization), error.normalDegrees, MAX_PACKED_NORMAL_DEGREES, error.textureCoords,
+                MAX_PACKED_UV_ERROR, IsPackingErrorWithinBounds(error, bench.quantization) ? "" : ", OUT OF BOUNDS");
+        }
+        else
+            printf("    full vertices, uvs past %.0f do not fit half floats\n", MAX_PACKED_UV);
+    }
+}
+
+// mip chain of every texture, box against kaiser
+static void BenchMips(JobSystem& jobs)
+{
+    std::vector<MipBenchmarkCase> cases;
+    RunMipBenchmark(jobs, FindFiles("textures", { ".png", ".jpg" }), cases);
+
+    printf("mips (%u textures, srgb, %u workers)\n", (uint32_t)cases.size(), jobs.GetWorkerCount());
+    for (const MipBenchmarkCase& bench : cases)
+    {
+        double mb = (double)bench.width * bench.height * 4 / (1024.0 * 1024.0);
+        printf("  %-22s %4ux%-4u %2u levels  box %8.2f ms (%6.1f MB/s)  kaiser %8.2f ms (%6.1f MB/s, %.2fx)\n", bench.path.c_str(), bench.width,
+            bench.height, bench.levelCount, bench.boxMs, mb / (bench.boxMs / 1000.0), bench.kaiserMs, mb / (bench.kaiserMs / 1000.0),
+            bench.kaiserMs / bench.boxMs);
+    }
+}
+
+// encode throughput and quality of the top level of every texture, plus the bc7 decoder against the spec
+static void BenchBc(JobSystem& jobs)
+{
+    BcBenchmarkResult result;
+    RunBcBenchmark(jobs, FindFiles("textures", { ".png", ".jpg" }), result);
+
+    printf("bc encode (%u textures, high quality, %u workers)\n", (uint32_t)result.cases.size(), result.workerCount);
+    for (const BcBenchmarkCase& bench : result.cases)
+    {
+        printf("  %-22s %4ux%-4u", bench.path.c_str(), bench.width, bench.height);
+        for (const BcBenchmarkFormat& format : bench.formats)
+            printf("  %s %7.1f MB/s %5.1f dB", GetTextureFormatName(format.format), format.mbPerSecond, format.psnr);
+        printf("\n");
+    }
+    printf("  bc7 mode 6 round trip: %u of %u blocks mismatched\n", result.roundTripMismatches, result.roundTripBlocks);
+}
+
+// every directory under textures/ packed as if it were the textures of one mesh, then a random set
+static void BenchAtlas(JobSystem& jobs)
+{
+    printf("texture atlas\n");
+
+    std::error_code error;
+    std::vector<std::string> directories;
+    for (const auto& entry : std::filesystem::directory_iterator("textures", error))
+    {
+        if (entry.is_directory())
+            directories.push_back(entry.path().generic_string());
+    }
+    std::sort(directories.begin(), directories.end());
+
+    for (const std::string& directory : directories)
+    {
+        AssetBatch assets;
+        for (const std::string& path : FindFiles(directory.c_str(), { ".png", ".jpg" }))
+            AddTexture(assets, path);
+
+        DecodeAssets(jobs, assets);
+
+        std::vector<const TextureView*> textures;
+        for (const DecodedTexture& texture : assets.textures)
+        {
+            if (texture.ok)
+                textures.push_back(&texture.view);
+        }
+
+        PackedTextures packed;
+        PackTextures(textures.data(), (uint32_t)textures.size(), packed);
+
+        printf("  %-18s %u textures, %.1f%% occupied\n", directory.c_str(), (uint32_t)textures.size(), GetTextureOccupancy(packed) * 100.0f);
+        for (const TextureArrayLayout& layout : packed.arrays)
+            printf("    %-5s %ux%u, %u layers, %u levels, gutter %u\n", GetTextureFormatName(layout.format), layout.width, layout.height, layout.layerCount, layout.levelCount, layout.gutter);
+    }
+
+    AtlasBenchmarkResult result;
+    RunAtlasBenchmark(256, result);
+
+    printf("  random: %u textures in %u arrays, %u layers (%u whole), %.1f%% occupied, %.3f ms\n", result.textureCount, result.arrayCount,
+        result.layerCount, result.wholeLayers, result.occupancy * 100.0f, result.ms);
+}
+
+// triangles the meshlet pass rejects for each camera path, against what a per triangle backface test would
+static void BenchMeshlets(JobSystem& jobs)
+{
+    std::vector<MeshletBenchmarkCase> cases;
+    RunMeshletBenchmark(jobs, FindFiles("meshes", { ".obj" }), cases);
+
+    printf("meshlets (%u meshes, %u workers)\n", (uint32_t)cases.size(), jobs.GetWorkerCount());
+    for (const MeshletBenchmarkCase& bench : cases)
+    {
+        const MeshletStats& meshlets = bench.meshlets;
+        printf("  %-20s %u triangles, %u meshlets (%.1f vertices, %.1f triangles), %u without cone, built in %.2f ms\n", bench.path.c_str(), bench.triangleCount,
+            meshlets.meshletCount, meshlets.averageVertices, meshlets.averageTriangles, meshlets.conesDisabled, meshlets.ms);
+
+        for (const MeshletBenchmarkPath& path : bench.paths)
+        {
+            float tested = path.trianglesTested ? (float)path.trianglesTested : 1.0f;
+            printf("    %-12s frustum %5.1f%%, backface %5.1f%% (per triangle %5.1f%%), %.4f ms%s\n", path.name, path.trianglesFrustumCulled * 100.0f / tested,
+                path.trianglesBackfaceCulled * 100.0f / tested, path.trianglesBackfacing * 100.0f / tested, path.ms, path.wronglyCulled ? ", front faces culled" : "");
+        }
+    }
+}
+
+// triangles and error of every level of detail, the measured error is what a sampled source vertex is off by
+static void BenchLods(JobSystem& jobs)
+{
+    std::vector<LodBenchmarkCase> cases;
+    RunLodBenchmark(jobs, FindFiles("meshes", { ".obj" }), cases);
+
+    printf("levels of detail (%u meshes)\n", (uint32_t)cases.size());
+    for (const LodBenchmarkCase& bench : cases)
+    {
+        printf("  %-20s %u levels, radius %.3f, built in %.2f ms\n", bench.path.c_str(), (uint32_t)bench.levels.size(), bench.radius, bench.ms);
+        for (uint32_t level = 0; level < bench.levels.size(); level++)
+        {
+            const LodBenchmarkLevel& result = bench.levels[level];
+            printf("    %u: %6u triangles (%5.1f%%), error %.5f, measured %.5f\n", level, result.triangles,
+                result.triangles * 100.0f / bench.levels[0].triangles, result.error, result.measuredError);
+        }
+    }
+}
+
+// cube shadow faces redrawn against the ones whose casters changed, found by brute force, over a few typical scenes
+static void BenchShadows(JobSystem& jobs)
+{
+    ShadowBenchmarkResult result;
+    RunShadowBenchmark(jobs, 4096, result);
+
+    printf("shadow cube cache (%u instances, %u workers), face test misses %u\n", result.instanceCount, result.workerCount, result.faceTestMisses);
+    for (const ShadowBenchmarkScene& scene : result.scenes)
+    {
+        uint32_t faces = scene.frames * SHADOW_CUBE_FACES;
+        printf("  %-22s %4u / %u faces redrawn (%5.1f%% avoided), %4u needed, %u missed, %5.1f casters/frame, %.3f ms\n", scene.name,
+            scene.facesRedrawn, faces, (faces - scene.facesRedrawn) * 100.0f / faces, scene.facesNeeded, scene.facesMissed,
+            (float)scene.castersDrawn / scene.frames, scene.ms);
+    }
+}
+
+// recording, sorting and replaying draws against a backend that only counts, with the state changes sorting saves
+static void BenchRenderCommands(JobSystem& jobs)
+{
+    RenderCommandBenchmarkResult result;
+    RunRenderCommandBenchmark(jobs, 65536, result);
+
+    printf("render commands (%u draws, %u workers)\n", result.commandCount, result.workerCount);
+    printf("  record %.3f ms, radix sort %.3f ms (std::stable_sort %.3f ms, %u mismatches), replay %.3f ms\n", result.recordMs,
+        result.sortMs, result.stdSortMs, result.mismatches, result.replayMs);
+    printf("  state changes: %u in recording order, %u sorted (%.1f%% fewer)\n", result.unsortedStateChanges, result.sortedStateChanges,
+        100.0f - result.sortedStateChanges * 100.0f / result.unsortedStateChanges);
+}
+
+static void BenchShaderCache(JobSystem& jobs)
+{
+    ShaderCacheBenchmarkResult result;
+    RunShaderCacheBenchmark(jobs, result);
+
+    printf("shader cache (%u permutations, stub compiler, %u workers)\n", result.shaderCount, result.workerCount);
+    printf("  compile one by one %.3f ms, cold cache %.3f ms, warm cache %.3f ms (%u misses, %u mismatches)\n", result.serialMs,
+        result.coldMs, result.warmMs, result.warmMisses, result.mismatches);
+    printf("  after editing the shared include %.3f ms (%u hits, %u stale entries left)\n", result.includeMs, result.includeHits,
+        result.staleLeft);
+}
+
+static void BenchTextureStreaming(JobSystem&)
+{
+    TextureStreamingBenchmarkResult result;
+    RunTextureStreamingBenchmark(result);
+
+    printf("texture streaming (%u meshes, %u frames, %.1f MB at full detail, %.1f MB always resident, %.1f MB wanted at most)\n",
+        result.meshCount, result.frames, result.fullMb, result.tailMb, result.peakWantedMb);
+    for (const TextureStreamingBenchmarkRun& run : result.runs)
+    {
+        if (run.budgetFraction == 0.0f)
+            printf("  no budget:   ");
+        else
+            printf("  budget %3.0f%%:", run.budgetFraction * 100.0f);
+        printf(" resident avg %7.1f MB, reserved peak %7.1f MB, %u overruns, %u blurry, %u requests, %u evictions, %.3f ms\n",
+            run.avgResidentMb, run.peakReservedMb, run.budgetOverruns, run.blurryFrames, run.requests,
+            run.evictions, run.ms);
+    }
+}
+
+// heap allocations with and without the arenas, loading every mesh and over frames of culling and light clusters
+static void BenchAllocations(JobSystem& jobs)
+{
+    AllocationBenchmarkResult result;
+    RunAllocationBenchmark(jobs, FindFiles("meshes", { ".obj" }), [] { return sHeapAllocations.load(); }, result);
+
+    printf("allocations (%u meshes, %u workers)\n", (uint32_t)result.meshes.size(), result.workerCount);
+    for (const AllocationBenchmarkMesh& bench : result.meshes)
+    {
+        printf("  %-20s tinyobj %8.2f ms %7llu allocs, arena cold %7.2f ms %5llu allocs, warm %7.2f ms %5llu allocs (%llu from the arena, %.1f MB peak)\n",
+            bench.path.c_str(), bench.tinyobjMs, (unsigned long long)bench.tinyobjHeapAllocations, bench.coldMs,
+            (unsigned long long)bench.coldHeapAllocations, bench.warmMs, (unsigned long long)bench.warmHeapAllocations,
+            (unsigned long long)bench.scratch.allocations, bench.scratch.peakBytes / (1024.0 * 1024.0));
+    }
+
+    if (result.frames)
+    {
+        printf("  %u frames, %u instances, %u lights: %.3f ms, %.1f heap allocs and %.1f arena allocs per frame, %.1f KB peak, %u arena blocks\n",
+            result.frames, result.instanceCount, result.lightCount, result.frameMs, result.frameHeapAllocations, result.frameArenaAllocations,
+            result.framePeakBytes / 1024.0, result.frameArenaBlocks);
+    }
+}
+
+struct Benchmark
+{
+    const char* name;
+    void (*run)(JobSystem& jobs);
+};
+
+static const Benchmark sBenchmarks[] =
+{
+    { "math", BenchMath },
+    { "scene", BenchScene },
+    { "culling", BenchCulling },
+    { "lights", BenchLightCulling },
+    { "obj", BenchObjParse },
+    { "meshes", BenchMeshes },
+    { "assets", BenchAssets },
+    { "mips", BenchMips },
+    { "bc", BenchBc },
+    { "atlas", BenchAtlas },
+    { "meshlets", BenchMeshlets },
+    { "lods", BenchLods },
+    { "shadows", BenchShadows },
+    { "commands", BenchRenderCommands },
+    { "shaders", BenchShaderCache },
+    { "streaming", BenchTextureStreaming },
+    { "allocations", BenchAllocations },
+};
+
+static void PrintUsage()
+{
+    printf("usage: lighting_bench [--data DIR] [benchmark...]\n"
+           "runs every benchmark when none is named, one of:");
+    for (const Benchmark& bench : sBenchmarks)
+        printf(" %s", bench.name);
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    ProfilerSetThreadName("main");
+
+    std::vector<const Benchmark*> selected;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+        {
+            PrintUsage();
+            return 0;
+        }
+
+        if (!strcmp(arg, "--data"))
+        {
+            if (i + 1 == argc)
+            {
+                fprintf(stderr, "missing value for --data\n");
+                return 1;
+            }
+
+            std::error_code error;
+            std::filesystem::current_path(argv[++i], error);
+            if (error)
+            {
+                fprintf(stderr, "cannot enter %s: %s\n", argv[i], error.message().c_str());
+                return 1;
+            }
+            continue;
+        }
+
+        const Benchmark* found = nullptr;
+        for (const Benchmark& bench : sBenchmarks)
+        {
+            if (!strcmp(arg, bench.name))
+                found = &bench;
+        }
+
+        if (!found)
+        {
+            fprintf(stderr, "unknown benchmark %s\n", arg);
+            PrintUsage();
+            return 1;
+        }
+
+        selected.push_back(found);
+    }
+
+    if (selected.empty())
+    {
+        for (const Benchmark& bench : sBenchmarks)
+            selected.push_back(&bench);
+    }
+
+    JobSystem jobs;
+    for (const Benchmark* bench : selected)
+        bench->run(jobs);
+
+    return 0;
+}
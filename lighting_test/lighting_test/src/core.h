@@ -1,6 +1,7 @@
 #pragma once
 
 #include <inttypes.h>
+#include <stdio.h>
 
 struct Vec2
 {
@@ -24,6 +25,11 @@ struct Transform
 	Vec3 scale;
 };
 
-#define check(Condition) { if(!(Condition)) __debugbreak(); }
+#ifdef _MSC_VER
+	#define DEBUG_BREAK() __debugbreak()
+#else
+	#define DEBUG_BREAK() __builtin_trap()
+#endif
 
-#define d3dcheck(Condition) check(Condition == S_OK)
\ No newline at end of file
+// printed before breaking so a headless run without a debugger still says what failed
+#define check(Condition) { if(!(Condition)) { fprintf(stderr, "check failed: %s (%s:%d)\n", #Condition, __FILE__, __LINE__); fflush(stderr); DEBUG_BREAK(); } }
\ No newline at end of file
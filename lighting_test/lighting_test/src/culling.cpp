@@ -0,0 +1,405 @@
+#include "culling.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+
+static Vec4 NormalizePlane(float x, float y, float z, float w)
+{
+    float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+    return { x * invLength, y * invLength, z * invLength, w * invLength };
+}
+
+Frustum MakeFrustum(const Mat4& viewProj)
+{
+    // row vectors, clip = (p, 1) * viewProj so clip.x is p against column 0 and so on
+    const float (*m)[4] = viewProj.m;
+
+    Frustum frustum;
+    frustum.planes[0] = NormalizePlane(m[0][3] + m[0][0], m[1][3] + m[1][0], m[2][3] + m[2][0], m[3][3] + m[3][0]); // x >= -w
+    frustum.planes[1] = NormalizePlane(m[0][3] - m[0][0], m[1][3] - m[1][0], m[2][3] - m[2][0], m[3][3] - m[3][0]); // x <= w
+    frustum.planes[2] = NormalizePlane(m[0][3] + m[0][1], m[1][3] + m[1][1], m[2][3] + m[2][1], m[3][3] + m[3][1]); // y >= -w
+    frustum.planes[3] = NormalizePlane(m[0][3] - m[0][1], m[1][3] - m[1][1], m[2][3] - m[2][1], m[3][3] - m[3][1]); // y <= w
+    frustum.planes[4] = NormalizePlane(m[0][2], m[1][2], m[2][2], m[3][2]);                                         // z >= 0
+    frustum.planes[5] = NormalizePlane(m[0][3] - m[0][2], m[1][3] - m[1][2], m[2][3] - m[2][2], m[3][3] - m[3][2]); // z <= w
+    return frustum;
+}
+
+Frustum MakeInfiniteFrustum()
+{
+    Frustum frustum;
+    for (Vec4& plane : frustum.planes)
+        plane = { 0.0f, 0.0f, 0.0f, 1.0f };
+    return frustum;
+}
+
+void MakeMeshBounds(const MeshView& view, MeshBounds& outBounds)
+{
+    outBounds.submeshes.assign(view.submeshBounds, view.submeshBounds + view.submeshCount);
+    outBounds.bounds = {};
+
+    if (view.submeshCount == 0)
+        return;
+
+    SubMeshBounds& bounds = outBounds.bounds;
+    bounds.min = view.submeshBounds[0].min;
+    bounds.max = view.submeshBounds[0].max;
+    for (const SubMeshBounds& s : outBounds.submeshes)
+    {
+        bounds.min = { fminf(bounds.min.x, s.min.x), fminf(bounds.min.y, s.min.y), fminf(bounds.min.z, s.min.z) };
+        bounds.max = { fmaxf(bounds.max.x, s.max.x), fmaxf(bounds.max.y, s.max.y), fmaxf(bounds.max.z, s.max.z) };
+    }
+
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+
+    // encloses every submesh sphere, looser than going through the vertices again but good enough
+    bounds.radius = 0.0f;
+    for (const SubMeshBounds& s : outBounds.submeshes)
+        bounds.radius = fmaxf(bounds.radius, Length(s.center - bounds.center) + s.radius);
+}
+
+bool IsSphereVisible(const Frustum& frustum, const Vec3& center, float radius)
+{
+    for (const Vec4& plane : frustum.planes)
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius)
+            return false;
+
+    return true;
+}
+
+bool IsBoxVisible(const Frustum& frustum, const Vec3& center, const Vec3& extent)
+{
+    for (const Vec4& plane : frustum.planes)
+    {
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        float radius = fabsf(plane.x) * extent.x + fabsf(plane.y) * extent.y + fabsf(plane.z) * extent.z;
+        if (distance < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+// model matrices of 4 instances with every element spread across the lanes, m[row][column].v[lane]
+struct GroupMatrix
+{
+    Float4 m[4][4];
+};
+
+static GroupMatrix LoadGroup(const InstanceData* const group[4])
+{
+    // rows of the 4 matrices are loaded as they are and transposed into place
+    GroupMatrix out;
+    for (uint32_t row = 0; row < 4; row++)
+    {
+        Float4 a = LoadFloat4(group[0]->model.m[row]);
+        Float4 b = LoadFloat4(group[1]->model.m[row]);
+        Float4 c = LoadFloat4(group[2]->model.m[row]);
+        Float4 d = LoadFloat4(group[3]->model.m[row]);
+        Transpose(a, b, c, d);
+        out.m[row][0] = a;
+        out.m[row][1] = b;
+        out.m[row][2] = c;
+        out.m[row][3] = d;
+    }
+    return out;
+}
+
+// local point c of 4 instances to world space
+static void TransformPoint(const GroupMatrix& g, const Vec3& c, Float4& outX, Float4& outY, Float4& outZ)
+{
+    Float4 cx = Splat(c.x);
+    Float4 cy = Splat(c.y);
+    Float4 cz = Splat(c.z);
+    outX = cx * g.m[0][0] + cy * g.m[1][0] + cz * g.m[2][0] + g.m[3][0];
+    outY = cx * g.m[0][1] + cy * g.m[1][1] + cz * g.m[2][1] + g.m[3][1];
+    outZ = cx * g.m[0][2] + cy * g.m[1][2] + cz * g.m[2][2] + g.m[3][2];
+}
+
+// bit i set when the sphere of instance i is outside, the radius grows with the largest axis scale
+static int GetSpheresOutside(const Frustum& frustum, const GroupMatrix& g, const SubMeshBounds& bounds)
+{
+    Float4 x, y, z;
+    TransformPoint(g, bounds.center, x, y, z);
+
+    Float4 scaleSquared = Splat(0.0f);
+    for (uint32_t row = 0; row < 3; row++)
+    {
+        Float4 ax = g.m[row][0];
+        Float4 ay = g.m[row][1];
+        Float4 az = g.m[row][2];
+        scaleSquared = Max(scaleSquared, ax * ax + ay * ay + az * az);
+    }
+
+    Float4 negRadius = Splat(0.0f) - Splat(bounds.radius) * Sqrt(scaleSquared);
+
+    int outside = 0;
+    for (const Vec4& plane : frustum.planes)
+    {
+        Float4 distance = Splat(plane.x) * x + Splat(plane.y) * y + Splat(plane.z) * z + Splat(plane.w);
+        outside |= LessMask(distance, negRadius);
+    }
+
+    return outside;
+}
+
+// bit i set when the box of instance i is outside, the box is the world space box around the transformed one
+static int GetBoxesOutside(const Frustum& frustum, const GroupMatrix& g, const SubMeshBounds& bounds)
+{
+    Float4 x, y, z;
+    TransformPoint(g, bounds.center, x, y, z);
+
+    Vec3 e = (bounds.max - bounds.min) * 0.5f;
+    Float4 ex = Splat(e.x);
+    Float4 ey = Splat(e.y);
+    Float4 ez = Splat(e.z);
+    Float4 extentX = ex * Abs(g.m[0][0]) + ey * Abs(g.m[1][0]) + ez * Abs(g.m[2][0]);
+    Float4 extentY = ex * Abs(g.m[0][1]) + ey * Abs(g.m[1][1]) + ez * Abs(g.m[2][1]);
+    Float4 extentZ = ex * Abs(g.m[0][2]) + ey * Abs(g.m[1][2]) + ez * Abs(g.m[2][2]);
+
+    int outside = 0;
+    for (const Vec4& plane : frustum.planes)
+    {
+        Float4 distance = Splat(plane.x) * x + Splat(plane.y) * y + Splat(plane.z) * z + Splat(plane.w);
+        Float4 radius = Splat(fabsf(plane.x)) * extentX + Splat(fabsf(plane.y)) * extentY + Splat(fabsf(plane.z)) * extentZ;
+        outside |= LessMask(distance, Splat(0.0f) - radius);
+    }
+
+    return outside;
+}
+
+// instances [begin, end) in groups of 4, the last group repeats its last instance
+static void MakeGroup(const InstanceData* instances, uint32_t i, uint32_t end, const InstanceData* outGroup[4])
+{
+    for (uint32_t lane = 0; lane < 4; lane++)
+        outGroup[lane] = &instances[i + lane < end ? i + lane : end - 1];
+}
+
+void CullScene(JobSystem& jobs, const Frustum& frustum, const MeshBounds* meshes, uint32_t meshCount,
+    const InstanceData* instances, const InstanceRange* ranges, Arena& scratch, VisibleSet& out)
+{
+    PROFILE_SCOPE("CullScene");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint32_t instanceCount = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        instanceCount = ranges[mesh].first + ranges[mesh].count > instanceCount ? ranges[mesh].first + ranges[mesh].count : instanceCount;
+
+    // spheres, batches can straddle meshes since the ranges are contiguous
+    uint8_t* instanceVisible = scratch.AllocateArray<uint8_t>(instanceCount);
+
+    ParallelFor(jobs, instanceCount, 1024, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        {
+            uint32_t meshBegin = ranges[mesh].first > begin ? ranges[mesh].first : begin;
+            uint32_t meshEnd = ranges[mesh].first + ranges[mesh].count < end ? ranges[mesh].first + ranges[mesh].count : end;
+
+            for (uint32_t i = meshBegin; i < meshEnd; i += 4)
+            {
+                const InstanceData* group[4];
+                MakeGroup(instances, i, meshEnd, group);
+
+                int outside = GetSpheresOutside(frustum, LoadGroup(group), meshes[mesh].bounds);
+                for (uint32_t lane = 0; lane < 4 && i + lane < meshEnd; lane++)
+                    instanceVisible[i + lane] = !(outside & (1 << lane));
+            }
+        }
+    });
+
+    out.instances.resize(instanceCount);
+    out.ranges.resize(meshCount);
+    out.submeshOffsets.resize(meshCount);
+    out.stats = CullingStats();
+    out.stats.instancesTested = instanceCount;
+
+    uint32_t visibleCount = 0;
+    uint32_t submeshCount = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        out.ranges[mesh].first = visibleCount;
+        for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+            if (instanceVisible[i])
+                out.instances[visibleCount++] = instances[i];
+        out.ranges[mesh].count = visibleCount - out.ranges[mesh].first;
+
+        out.submeshOffsets[mesh] = submeshCount;
+        submeshCount += (uint32_t)meshes[mesh].submeshes.size();
+    }
+
+    out.instances.resize(visibleCount);
+    out.stats.instancesCulled = instanceCount - visibleCount;
+
+    // boxes, a submesh stays as soon as one visible instance shows it
+    out.submeshVisible.assign(submeshCount, 0);
+
+    ParallelFor(jobs, submeshCount, 4, [&](uint32_t begin, uint32_t end)
+    {
+        uint32_t mesh = 0;
+        for (uint32_t flat = begin; flat < end; flat++)
+        {
+            while (flat >= out.submeshOffsets[mesh] + meshes[mesh].submeshes.size())
+                mesh++;
+
+            const SubMeshBounds& bounds = meshes[mesh].submeshes[flat - out.submeshOffsets[mesh]];
+            const InstanceData* meshInstances = out.instances.data() + out.ranges[mesh].first;
+            uint32_t count = out.ranges[mesh].count;
+
+            for (uint32_t i = 0; i < count; i += 4)
+            {
+                const InstanceData* group[4];
+                MakeGroup(meshInstances, i, count, group);
+
+                if (GetBoxesOutside(frustum, LoadGroup(group), bounds) != 0xf)
+                {
+                    out.submeshVisible[flat] = 1;
+                    break;
+                }
+            }
+        }
+    });
+
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        if (out.ranges[mesh].count == 0)
+            continue;
+
+        for (uint32_t s = 0; s < meshes[mesh].submeshes.size(); s++)
+        {
+            if (out.submeshVisible[out.submeshOffsets[mesh] + s])
+                out.stats.submeshesDrawn++;
+            else
+                out.stats.submeshesCulled++;
+        }
+    }
+
+    out.stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void RunCullingBenchmark(JobSystem& jobs, uint32_t instanceCount, CullingBenchmarkResult& result)
+{
+    constexpr uint32_t MESH_COUNT = 4;
+    constexpr uint32_t SUBMESH_COUNT = 8;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 0.5f);
+    std::uniform_real_distribution<float> location(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> rotation(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    // boxes scattered around the origin stand in for the submeshes
+    std::vector<SubMeshBounds> submeshBounds(MESH_COUNT * SUBMESH_COUNT);
+    for (SubMeshBounds& bounds : submeshBounds)
+    {
+        bounds.center = { unit(rng), unit(rng), unit(rng) };
+        Vec3 e = { extent(rng), extent(rng), extent(rng) };
+        bounds.min = bounds.center - e;
+        bounds.max = bounds.center + e;
+        bounds.radius = Length(e);
+    }
+
+    MeshBounds meshes[MESH_COUNT];
+    for (uint32_t mesh = 0; mesh < MESH_COUNT; mesh++)
+    {
+        MeshView view = {};
+        view.submeshBounds = submeshBounds.data() + mesh * SUBMESH_COUNT;
+        view.submeshCount = SUBMESH_COUNT;
+        MakeMeshBounds(view, meshes[mesh]);
+    }
+
+    Scene scene;
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        Transform transform;
+        transform.location = { location(rng), location(rng), location(rng) };
+        transform.rotation = { rotation(rng), rotation(rng), rotation(rng) };
+        transform.scale = { scale(rng), scale(rng), scale(rng) };
+        AddInstance(scene, i % MESH_COUNT, transform);
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<InstanceRange> ranges;
+    SortInstancesByMesh(scene, MESH_COUNT, order, ranges);
+
+    std::vector<InstanceData> instances(instanceCount);
+    ComputeInstanceData(jobs, scene, order.data(), instanceCount, instances.data());
+
+    Mat4 view = Mat4LookToLH({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f });
+    Mat4 proj = Mat4PerspectiveFovLH(60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f);
+    Frustum frustum = MakeFrustum(Mat4Multiply(view, proj));
+
+    VisibleSet visible;
+    Arena scratch;
+
+    double best = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        scratch.Reset();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        CullScene(jobs, frustum, meshes, MESH_COUNT, instances.data(), ranges.data(), scratch, visible);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = ms < best ? ms : best;
+    }
+
+    std::vector<uint8_t> scalarVisible(instanceCount);
+
+    double bestScalar = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t mesh = 0; mesh < MESH_COUNT; mesh++)
+        {
+            const SubMeshBounds& bounds = meshes[mesh].bounds;
+            for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+            {
+                const float (*m)[4] = instances[i].model.m;
+                Vec3 c = bounds.center;
+                Vec3 center =
+                {
+                    c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0],
+                    c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1],
+                    c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2],
+                };
+
+                float scaleSquared = 0.0f;
+                for (uint32_t row = 0; row < 3; row++)
+                    scaleSquared = fmaxf(scaleSquared, m[row][0] * m[row][0] + m[row][1] * m[row][1] + m[row][2] * m[row][2]);
+
+                scalarVisible[i] = IsSphereVisible(frustum, center, bounds.radius * sqrtf(scaleSquared));
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        bestScalar = ms < bestScalar ? ms : bestScalar;
+    }
+
+    // both keep the instances in order, walk them side by side
+    uint32_t mismatches = 0;
+    for (uint32_t mesh = 0; mesh < MESH_COUNT; mesh++)
+    {
+        uint32_t cursor = visible.ranges[mesh].first;
+        uint32_t cursorEnd = cursor + visible.ranges[mesh].count;
+        for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+        {
+            bool kept = cursor < cursorEnd && memcmp(&visible.instances[cursor], &instances[i], sizeof(InstanceData)) == 0;
+            if (kept)
+                cursor++;
+            if (kept != (scalarVisible[i] != 0))
+                mismatches++;
+        }
+    }
+
+    result.instanceCount = instanceCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.ms = best;
+    result.scalarMs = bestScalar;
+    result.visibleInstances = (uint32_t)visible.instances.size();
+    result.submeshesDrawn = visible.stats.submeshesDrawn;
+    result.mismatches = mismatches;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "mesh_cache.h"
+#include "scene.h"
+
+#include <vector>
+
+// view frustum culling of the instances of a scene sorted by mesh: whole instances are dropped on
+// their bounding sphere, then submeshes on their box against the instances that are left, both tests
+// run on 4 instances at a time
+
+// a point p is inside plane (x, y, z, w) when x * p.x + y * p.y + z * p.z + w >= 0
+struct Frustum
+{
+    Vec4 planes[6]; // left, right, bottom, top, near, far
+};
+
+// planes of d3d clip space (0 <= z <= w) for viewProj = view * proj, not transposed, normalized
+Frustum MakeFrustum(const Mat4& viewProj);
+
+// planes that nothing is outside of, for comparing against culling turned off
+Frustum MakeInfiniteFrustum();
+
+// object space bounds of one mesh, bounds covers every submesh
+struct MeshBounds
+{
+    SubMeshBounds bounds;
+    std::vector<SubMeshBounds> submeshes;
+};
+
+void MakeMeshBounds(const MeshView& view, MeshBounds& outBounds);
+
+bool IsSphereVisible(const Frustum& frustum, const Vec3& center, float radius);
+bool IsBoxVisible(const Frustum& frustum, const Vec3& center, const Vec3& extent);
+
+struct CullingStats
+{
+    uint32_t instancesTested = 0;
+    uint32_t instancesCulled = 0;
+    uint32_t submeshesDrawn = 0;  // instanced draws left, one per visible submesh of a mesh with visible instances
+    uint32_t submeshesCulled = 0; // submeshes of those meshes no visible instance shows
+    float ms = 0.0f;
+};
+
+struct VisibleSet
+{
+    std::vector<InstanceData> instances;  // visible instances, still sorted by mesh
+    std::vector<InstanceRange> ranges;    // per mesh, into instances
+    std::vector<uint32_t> submeshOffsets; // per mesh, into submeshVisible
+    std::vector<uint8_t> submeshVisible;  // per submesh of every mesh
+    CullingStats stats;
+};
+
+// instances and ranges as written by SortInstancesByMesh and ComputeInstanceData, meshes has one entry
+// per range, the sphere test is split across the job system. temporaries come from scratch, the frame's arena
+void CullScene(JobSystem& jobs, const Frustum& frustum, const MeshBounds* meshes, uint32_t meshCount,
+    const InstanceData* instances, const InstanceRange* ranges, Arena& scratch, VisibleSet& out);
+
+struct CullingBenchmarkResult
+{
+    uint32_t instanceCount;
+    uint32_t workerCount;
+    double ms;        // CullScene
+    double scalarMs;  // one IsSphereVisible per instance on a single thread
+    uint32_t visibleInstances;
+    uint32_t submeshesDrawn;
+    uint32_t mismatches; // instances the two disagree on, should be 0
+};
+
+// random instances of 4 meshes with 8 submeshes each scattered around a camera, best of a few runs
+void RunCullingBenchmark(JobSystem& jobs, uint32_t instanceCount, CullingBenchmarkResult& result);
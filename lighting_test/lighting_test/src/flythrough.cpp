@@ -0,0 +1,327 @@
+#include "flythrough.h"
+#include "profiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+
+bool LoadFlythrough(const std::string& path, Flythrough& outFlythrough, std::string& outError)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        outError = path + ": cannot open";
+        return false;
+    }
+
+    Flythrough flythrough;
+    flythrough.path = path;
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+            line.resize(comment);
+
+        char word[32];
+        int consumed = 0;
+        if (sscanf(line.c_str(), " %31s %n", word, &consumed) != 1)
+            continue;
+
+        const char* args = line.c_str() + consumed;
+        FlythroughPose* key = flythrough.keys.empty() ? nullptr : &flythrough.keys.back();
+
+        auto fail = [&](const char* what)
+        {
+            outError = path + ":" + std::to_string(lineNumber) + ": " + what;
+            return false;
+        };
+
+        // the three floats of a key statement, after the key they belong to
+        auto readVec3 = [&](Vec3 FlythroughPose::*field)
+        {
+            if (!key)
+                return fail("before the first key");
+
+            Vec3 value;
+            char rest;
+            if (sscanf(args, "%f %f %f %c", &value.x, &value.y, &value.z, &rest) != 3)
+                return fail("expected three numbers");
+
+            key->*field = value;
+            return true;
+        };
+
+        auto readInt = [&](int& value)
+        {
+            char rest;
+            if (sscanf(args, "%d %c", &value, &rest) != 1 || value < 0)
+                return fail("expected a count");
+            return true;
+        };
+
+        bool ok = true;
+        int count = 0;
+        if (!strcmp(word, "frames"))
+        {
+            ok = readInt(count) && (count > 0 || fail("no frames to measure"));
+            flythrough.frames = (uint32_t)count;
+        }
+        else if (!strcmp(word, "warmup"))
+        {
+            ok = readInt(count);
+            flythrough.warmupFrames = (uint32_t)count;
+        }
+        else if (!strcmp(word, "grid"))
+            ok = readInt(flythrough.instanceGridSize);
+        else if (!strcmp(word, "lights"))
+            ok = readInt(flythrough.pointLightCount);
+        else if (!strcmp(word, "timestep"))
+        {
+            char rest;
+            ok = (sscanf(args, "%f %c", &flythrough.timestep, &rest) == 1 && flythrough.timestep > 0.0f) || fail("expected seconds");
+        }
+        else if (!strcmp(word, "key"))
+        {
+            // a new key starts from the one before
+            FlythroughPose next = key ? *key : FlythroughPose();
+            char rest;
+            if (sscanf(args, "%f %c", &next.time, &rest) != 1)
+                ok = fail("expected seconds");
+            else if (key && next.time < key->time)
+                ok = fail("keys must come in order");
+            else
+                flythrough.keys.push_back(next);
+        }
+        else if (!strcmp(word, "camera"))
+            ok = readVec3(&FlythroughPose::camera);
+        else if (!strcmp(word, "direction"))
+            ok = readVec3(&FlythroughPose::direction);
+        else if (!strcmp(word, "model"))
+            ok = readVec3(&FlythroughPose::modelLocation);
+        else if (!strcmp(word, "rotation"))
+            ok = readVec3(&FlythroughPose::modelRotation);
+        else if (!strcmp(word, "light"))
+            ok = readVec3(&FlythroughPose::light);
+        else
+            ok = fail((std::string("unknown statement ") + word).c_str());
+
+        if (!ok)
+            return false;
+    }
+
+    if (flythrough.keys.empty())
+    {
+        outError = path + ": no keys";
+        return false;
+    }
+
+    outFlythrough = std::move(flythrough);
+    return true;
+}
+
+static Vec3 Lerp(const Vec3& a, const Vec3& b, float t)
+{
+    return a + (b - a) * t;
+}
+
+FlythroughPose SampleFlythrough(const Flythrough& flythrough, float time)
+{
+    const std::vector<FlythroughPose>& keys = flythrough.keys;
+
+    // first key after time
+    auto next = std::upper_bound(keys.begin(), keys.end(), time, [](float t, const FlythroughPose& key) { return t < key.time; });
+
+    FlythroughPose pose;
+    if (next == keys.begin())
+        pose = keys.front();
+    else if (next == keys.end())
+        pose = keys.back();
+    else
+    {
+        const FlythroughPose& a = *(next - 1);
+        const FlythroughPose& b = *next;
+        float t = (time - a.time) / (b.time - a.time);
+
+        pose.camera = Lerp(a.camera, b.camera, t);
+        pose.direction = Lerp(a.direction, b.direction, t);
+        pose.modelLocation = Lerp(a.modelLocation, b.modelLocation, t);
+        pose.modelRotation = Lerp(a.modelRotation, b.modelRotation, t);
+        pose.light = Lerp(a.light, b.light, t);
+    }
+
+    pose.time = time;
+    return pose;
+}
+
+uint32_t GetFlythroughFrameCount(const Flythrough& flythrough)
+{
+    return flythrough.warmupFrames + flythrough.frames + PROFILER_GPU_LATENCY;
+}
+
+FlythroughPose GetFlythroughFramePose(const Flythrough& flythrough, uint32_t frame)
+{
+    uint32_t measured = frame > flythrough.warmupFrames ? frame - flythrough.warmupFrames : 0;
+    return SampleFlythrough(flythrough, flythrough.keys.front().time + measured * flythrough.timestep);
+}
+
+void RecordFlythroughFrame(const Flythrough& flythrough, uint32_t frame, const RendererStats& stats, FlythroughRun& run)
+{
+    // ProfilerEndFrame already moved on to the next one
+    uint64_t profilerFrame = GetProfilerStats().frameIndex - 1;
+
+    if (frame >= flythrough.warmupFrames && frame < flythrough.warmupFrames + flythrough.frames)
+    {
+        FlythroughFrame& record = run.frames.emplace_back();
+        record.profilerFrame = profilerFrame;
+        record.time = GetFlythroughFramePose(flythrough, frame).time;
+        record.drawCalls = stats.drawCalls;
+        record.instancesDrawn = stats.instancesDrawn;
+        record.trianglesDrawn = stats.trianglesDrawn;
+        record.shadowDrawCalls = stats.shadowDrawCalls;
+        record.shadowTrianglesDrawn = stats.shadowTrianglesDrawn;
+    }
+
+    // the frames whose gpu timings may have arrived since the last call, older ones have theirs
+    size_t first = run.frames.size() > PROFILER_GPU_LATENCY + 1 ? run.frames.size() - (PROFILER_GPU_LATENCY + 1) : 0;
+    for (size_t i = first; i < run.frames.size(); i++)
+    {
+        FlythroughFrame& record = run.frames[i];
+
+        ProfileFrameTimes times;
+        if (GetProfilerFrameTimes(record.profilerFrame, times))
+        {
+            record.frameMs = times.frameMs;
+            record.cpuMs = times.cpuMs;
+            record.gpuMs = times.gpuMs;
+        }
+    }
+}
+
+FlythroughPercentiles ComputeFlythroughPercentiles(std::vector<float> values)
+{
+    FlythroughPercentiles result = {};
+    if (values.empty())
+        return result;
+
+    std::sort(values.begin(), values.end());
+
+    auto rank = [&](float percent)
+    {
+        size_t index = (size_t)ceilf(percent / 100.0f * values.size());
+        return values[index ? index - 1 : 0];
+    };
+
+    double sum = 0.0;
+    for (float value : values)
+        sum += value;
+
+    result.p50 = rank(50.0f);
+    result.p95 = rank(95.0f);
+    result.p99 = rank(99.0f);
+    result.min = values.front();
+    result.max = values.back();
+    result.avg = (float)(sum / values.size());
+    return result;
+}
+
+static bool HasGpuTimings(const FlythroughRun& run)
+{
+    for (const FlythroughFrame& frame : run.frames)
+    {
+        if (frame.gpuMs > 0.0f)
+            return true;
+    }
+
+    return false;
+}
+
+static std::vector<float> GatherTimes(const FlythroughRun& run, float FlythroughFrame::*field)
+{
+    std::vector<float> values;
+    values.reserve(run.frames.size());
+    for (const FlythroughFrame& frame : run.frames)
+        values.push_back(frame.*field);
+    return values;
+}
+
+// paths are the only strings, backslashes and quotes are all they need escaped
+static void WriteJsonString(FILE* file, const std::string& text)
+{
+    fputc('"', file);
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            fputc('\\', file);
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+static void WritePercentiles(FILE* file, const char* name, const FlythroughPercentiles& percentiles)
+{
+    fprintf(file, "  \"%s\": { \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"min\": %.4f, \"max\": %.4f, \"avg\": %.4f },\n", name,
+        percentiles.p50, percentiles.p95, percentiles.p99, percentiles.min, percentiles.max, percentiles.avg);
+}
+
+bool WriteFlythroughReport(const std::string& path, const Flythrough& flythrough, const FlythroughRun& run, const char* rendererName,
+    uint32_t width, uint32_t height, int instanceGridSize, int pointLightCount)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool gpu = HasGpuTimings(run);
+
+    fprintf(file, "{\n  \"script\": ");
+    WriteJsonString(file, flythrough.path);
+    fprintf(file, ",\n  \"renderer\": ");
+    WriteJsonString(file, rendererName);
+    fprintf(file, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"instanceGrid\": %d,\n  \"pointLights\": %d,\n", width, height,
+        instanceGridSize, pointLightCount);
+    fprintf(file, "  \"frames\": %u,\n  \"warmupFrames\": %u,\n  \"timestep\": %.6f,\n", (uint32_t)run.frames.size(),
+        flythrough.warmupFrames, flythrough.timestep);
+
+    WritePercentiles(file, "frameMs", ComputeFlythroughPercentiles(GatherTimes(run, &FlythroughFrame::frameMs)));
+    WritePercentiles(file, "cpuMs", ComputeFlythroughPercentiles(GatherTimes(run, &FlythroughFrame::cpuMs)));
+    if (gpu)
+        WritePercentiles(file, "gpuMs", ComputeFlythroughPercentiles(GatherTimes(run, &FlythroughFrame::gpuMs)));
+    else
+        fprintf(file, "  \"gpuMs\": null,\n");
+
+    fprintf(file, "  \"perFrame\": [\n");
+    for (size_t i = 0; i < run.frames.size(); i++)
+    {
+        const FlythroughFrame& frame = run.frames[i];
+        fprintf(file, "    { \"time\": %.4f, \"frameMs\": %.4f, \"cpuMs\": %.4f, ", frame.time, frame.frameMs, frame.cpuMs);
+        if (gpu)
+            fprintf(file, "\"gpuMs\": %.4f, ", frame.gpuMs);
+        else
+            fprintf(file, "\"gpuMs\": null, ");
+        fprintf(file, "\"drawCalls\": %u, \"instances\": %u, \"triangles\": %u, \"shadowDrawCalls\": %u, \"shadowTriangles\": %u }%s\n",
+            frame.drawCalls, frame.instancesDrawn, frame.trianglesDrawn, frame.shadowDrawCalls, frame.shadowTrianglesDrawn,
+            i + 1 < run.frames.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    bool ok = !ferror(file);
+    return fclose(file) == 0 && ok;
+}
+
+void PrintFlythroughSummary(const FlythroughRun& run)
+{
+    FlythroughPercentiles cpu = ComputeFlythroughPercentiles(GatherTimes(run, &FlythroughFrame::cpuMs));
+    printf("flythrough: %u frames, cpu p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", (uint32_t)run.frames.size(), cpu.p50,
+        cpu.p95, cpu.p99, cpu.max);
+
+    if (HasGpuTimings(run))
+    {
+        FlythroughPercentiles gpu = ComputeFlythroughPercentiles(GatherTimes(run, &FlythroughFrame::gpuMs));
+        printf("flythrough: gpu p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", gpu.p50, gpu.p95, gpu.p99, gpu.max);
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "renderer.h"
+
+#include <string>
+#include <vector>
+
+// a scripted benchmark: camera, model and main light follow keyframes read from a text file, one frame every fixed
+// timestep whatever the frame took, so two runs of the same script draw the same frames. the platforms drive it, see
+// --flythrough in platform_headless.cpp and platform_win32.cpp, and write what every frame cost as json
+//
+// script, one statement per line, # starts a comment:
+//   frames N           measured frames (default 600)
+//   warmup N           frames run at the first key before measuring, not recorded (default 10)
+//   timestep S         seconds between frames (default 1/60)
+//   grid N             instance grid size, the app's --grid (default: left to the command line)
+//   lights N           point light count, the app's --lights (default: left to the command line)
+//   key T              starts the key at T seconds, keys must come in order. what the key does not set it keeps from
+//                      the key before
+//   camera X Y Z       camera location
+//   direction X Y Z    where the camera looks
+//   model X Y Z        model location
+//   rotation X Y Z     model rotation in degrees
+//   light X Y Z        main light position
+// between keys everything is interpolated linearly, before the first and after the last key it holds
+
+struct FlythroughPose
+{
+    float time = 0.0f;
+    Vec3 camera = { -1.38f, 1.44f, -2.0f };
+    Vec3 direction = { 0.0f, 0.0f, 1.0f };
+    Vec3 modelLocation = { -0.330f, -0.540f, 2.070f };
+    Vec3 modelRotation = { 0.0f, 150.0f, 0.0f };
+    Vec3 light = { 0.9f, 0.0f, 0.6f };
+};
+
+struct Flythrough
+{
+    std::string path;
+    uint32_t frames = 600;
+    uint32_t warmupFrames = 10;
+    float timestep = 1.0f / 60.0f;
+    int instanceGridSize = -1; // -1 when the script leaves it to the command line
+    int pointLightCount = -1;
+    std::vector<FlythroughPose> keys;
+};
+
+// false with the line that could not be read in outError
+bool LoadFlythrough(const std::string& path, Flythrough& outFlythrough, std::string& outError);
+
+FlythroughPose SampleFlythrough(const Flythrough& flythrough, float time);
+
+// warmup, measured and PROFILER_GPU_LATENCY more so the gpu timings of the last measured frames arrive
+uint32_t GetFlythroughFrameCount(const Flythrough& flythrough);
+
+// pose of frame, the warmup frames hold the first key
+FlythroughPose GetFlythroughFramePose(const Flythrough& flythrough, uint32_t frame);
+
+struct FlythroughFrame
+{
+    uint64_t profilerFrame;
+    float time;
+    float frameMs;  // between two ProfilerEndFrame calls
+    float cpuMs;    // frameMs minus what the main thread waited on, present and vsync among it
+    float gpuMs;    // 0 when the renderer has no gpu timings
+    uint32_t drawCalls;
+    uint32_t instancesDrawn;
+    uint32_t trianglesDrawn;
+    uint32_t shadowDrawCalls;
+    uint32_t shadowTrianglesDrawn;
+};
+
+struct FlythroughRun
+{
+    std::vector<FlythroughFrame> frames;
+};
+
+// call after ProfilerEndFrame with the frame's number and the renderer's stats, only the measured frames are kept.
+// gpu timings trail by a few frames, every call picks up the ones that arrived since
+void RecordFlythroughFrame(const Flythrough& flythrough, uint32_t frame, const RendererStats& stats, FlythroughRun& run);
+
+struct FlythroughPercentiles
+{
+    float p50;
+    float p95;
+    float p99;
+    float min;
+    float max;
+    float avg;
+};
+
+// nearest rank, all zero when there are no values
+FlythroughPercentiles ComputeFlythroughPercentiles(std::vector<float> values);
+
+// summary and every frame, gpu entries are null when the renderer had no gpu timings
+bool WriteFlythroughReport(const std::string& path, const Flythrough& flythrough, const FlythroughRun& run, const char* rendererName,
+    uint32_t width, uint32_t height, int instanceGridSize, int pointLightCount);
+
+// cpu and gpu p50/p95/p99 on one line each
+void PrintFlythroughSummary(const FlythroughRun& run);
@@ -0,0 +1,113 @@
+#include "jobs.h"
+#include "profiler.h"
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    if (workerCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    for (uint32_t i = 0; i < workerCount; i++)
+        mWorkers.emplace_back(&JobSystem::WorkerMain, this);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mWakeWorkers.notify_all();
+
+    for (std::thread& worker : mWorkers)
+        worker.join();
+}
+
+void JobSystem::Submit(std::function<void()> job, JobCounter& counter)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back({ std::move(job), &counter });
+        counter.pending++;
+    }
+    mWakeWorkers.notify_one();
+}
+
+bool JobSystem::RunOne(std::unique_lock<std::mutex>& lock, const JobCounter* counter)
+{
+    auto next = counter ? std::find_if(mQueue.begin(), mQueue.end(), [counter](const Job& job) { return job.counter == counter; }) : mQueue.begin();
+    if (next == mQueue.end())
+        return false;
+
+    Job job = std::move(*next);
+    mQueue.erase(next);
+
+    lock.unlock();
+    {
+        PROFILE_SCOPE("Job");
+        job.fn();
+    }
+    lock.lock();
+
+    job.counter->pending--;
+    mJobDone.notify_all();
+
+    return true;
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    auto hasJob = [&] { return std::any_of(mQueue.begin(), mQueue.end(), [&](const Job& job) { return job.counter == &counter; }); };
+
+    while (counter.pending > 0)
+    {
+        if (!RunOne(lock, &counter))
+            mJobDone.wait(lock, [&] { return counter.pending == 0 || hasJob(); });
+    }
+}
+
+void JobSystem::WorkerMain()
+{
+    ProfilerSetThreadName("worker");
+
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true)
+    {
+        mWakeWorkers.wait(lock, [this] { return mShutdown || !mQueue.empty(); });
+
+        if (mShutdown && mQueue.empty())
+            return;
+
+        RunOne(lock, nullptr);
+    }
+}
+
+void ParallelFor(JobSystem& jobs, uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& fn)
+{
+    if (count == 0)
+        return;
+
+    if (batchSize == 0)
+        batchSize = 1;
+
+    // a single batch is not worth a round trip through the queue
+    if (count <= batchSize)
+    {
+        fn(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (uint32_t begin = 0; begin < count; begin += batchSize)
+    {
+        uint32_t end = count - begin > batchSize ? begin + batchSize : count;
+        jobs.Submit([&fn, begin, end] { fn(begin, end); }, counter);
+    }
+
+    jobs.Wait(counter);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core.h"
+
+#include <functional>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// tracks a group of submitted jobs, only touched under the job system lock
+struct JobCounter
+{
+    uint32_t pending = 0;
+};
+
+// small fixed size worker pool
+class JobSystem
+{
+public:
+    // 0 = one worker per hardware thread minus the caller
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void Submit(std::function<void()> job, JobCounter& counter);
+
+    // blocks until every job of counter is done, the calling thread runs queued jobs of the same counter meanwhile
+    // so it is fine to wait from inside a job. other jobs are left to the workers, a waiter that picked them up would
+    // only return once they are done and whatever it times would include them
+    void Wait(JobCounter& counter);
+
+    uint32_t GetWorkerCount() const { return (uint32_t)mWorkers.size(); }
+
+private:
+    struct Job
+    {
+        std::function<void()> fn;
+        JobCounter* counter;
+    };
+
+    // the first queued job, or the first of counter when there is one
+    bool RunOne(std::unique_lock<std::mutex>& lock, const JobCounter* counter);
+    void WorkerMain();
+
+    std::vector<std::thread> mWorkers;
+    std::deque<Job> mQueue;
+    std::mutex mMutex;
+    std::condition_variable mWakeWorkers;
+    std::condition_variable mJobDone;
+    bool mShutdown = false;
+};
+
+// splits [0, count) in batches of batchSize and runs fn(begin, end) on the pool, returns when all batches are done
+void ParallelFor(JobSystem& jobs, uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& fn);
@@ -0,0 +1,309 @@
+#include "light_culling.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+// slices are widened a little so a pixel whose depth lands on a slice border on the gpu (different log
+// precision) still finds every light of both slices
+constexpr float SLICE_PADDING = 0.01f;
+
+ClusterConstants MakeClusterConstants(const ClusterProjection& projection, uint32_t pointLightCount)
+{
+    ClusterConstants constants;
+    constants.countX = CLUSTER_COUNT_X;
+    constants.countY = CLUSTER_COUNT_Y;
+    constants.countZ = CLUSTER_COUNT_Z;
+    constants.pointLightCount = pointLightCount;
+    constants.tileWidth = (float)projection.width / CLUSTER_COUNT_X;
+    constants.tileHeight = (float)projection.height / CLUSTER_COUNT_Y;
+
+    // slice 0 starts at CLUSTER_NEAR_Z and the last one ends at the far plane
+    constants.sliceScale = CLUSTER_COUNT_Z / logf(projection.farZ / CLUSTER_NEAR_Z);
+    constants.sliceBias = -logf(CLUSTER_NEAR_Z) * constants.sliceScale;
+    return constants;
+}
+
+uint32_t GetClusterIndex(const ClusterConstants& constants, float x, float y, float viewZ)
+{
+    uint32_t clusterX = (uint32_t)(x / constants.tileWidth);
+    uint32_t clusterY = (uint32_t)(y / constants.tileHeight);
+    clusterX = clusterX < constants.countX ? clusterX : constants.countX - 1;
+    clusterY = clusterY < constants.countY ? clusterY : constants.countY - 1;
+
+    float slice = floorf(logf(viewZ) * constants.sliceScale + constants.sliceBias);
+    uint32_t clusterZ = slice < 0.0f ? 0 : (slice >= constants.countZ ? constants.countZ - 1 : (uint32_t)slice);
+
+    return clusterX + clusterY * constants.countX + clusterZ * constants.countX * constants.countY;
+}
+
+float GetLightAttenuation(float distance, float radius)
+{
+    float ratio = distance / radius;
+    float ratio2 = ratio * ratio;
+    float window = 1.0f - ratio2 * ratio2;
+    window = window < 0.0f ? 0.0f : window;
+    return window * window / (distance * distance + 1.0f);
+}
+
+static float GetSliceDepth(const ClusterConstants& constants, uint32_t slice)
+{
+    return expf((slice - constants.sliceBias) / constants.sliceScale);
+}
+
+// the lights overlapping one depth slice in view space, padded to a multiple of 4 with lights that never hit
+struct SliceLights
+{
+    SliceLights(Arena& arena, uint32_t lightCount) : x(arena), y(arena), z(arena), radiusSquared(arena), indices(arena)
+    {
+        for (ArenaVector<float>* values : { &x, &y, &z, &radiusSquared })
+            values->reserve(lightCount + 3);
+        indices.reserve(lightCount);
+    }
+
+    ArenaVector<float> x, y, z, radiusSquared;
+    ArenaVector<uint32_t> indices;
+};
+
+void BuildLightClusters(JobSystem& jobs, const PointLight* lights, uint32_t lightCount, const Mat4& view,
+    const ClusterProjection& projection, Arena& scratch, LightClusters& outClusters)
+{
+    PROFILE_SCOPE("BuildLightClusters");
+
+    ClusterConstants constants = MakeClusterConstants(projection, lightCount);
+    outClusters.constants = constants;
+
+    Vec4* viewLights = scratch.AllocateArray<Vec4>(lightCount);
+    for (uint32_t i = 0; i < lightCount; i++)
+    {
+        Vec4 center = Vec4Transform({ lights[i].position.x, lights[i].position.y, lights[i].position.z, 1.0f }, view);
+        viewLights[i] = { center.x, center.y, center.z, lights[i].radius };
+    }
+
+    // view space x and y of the frustum at depth 1 for every tile border
+    float tanHalfFov = tanf(projection.fovRadians * 0.5f);
+    float borderX[CLUSTER_COUNT_X + 1];
+    float borderY[CLUSTER_COUNT_Y + 1];
+    for (uint32_t i = 0; i <= CLUSTER_COUNT_X; i++)
+        borderX[i] = (2.0f * i / CLUSTER_COUNT_X - 1.0f) * tanHalfFov * projection.aspect;
+    for (uint32_t i = 0; i <= CLUSTER_COUNT_Y; i++)
+        borderY[i] = (1.0f - 2.0f * i / CLUSTER_COUNT_Y) * tanHalfFov;
+
+    constexpr uint32_t CLUSTERS_PER_SLICE = CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+
+    outClusters.clusters.resize(CLUSTER_COUNT * 2);
+    // grown from the jobs, the arena takes the lock
+    ArenaVector<ArenaVector<uint32_t>> sliceIndices(CLUSTER_COUNT_Z, ArenaVector<uint32_t>(scratch), scratch);
+
+    ParallelFor(jobs, CLUSTER_COUNT_Z, 1, [&](uint32_t sliceBegin, uint32_t sliceEnd)
+    {
+        SliceLights sliceLights(scratch, lightCount);
+
+        for (uint32_t slice = sliceBegin; slice < sliceEnd; slice++)
+        {
+            float nearZ = slice == 0 ? projection.nearZ : GetSliceDepth(constants, slice) * (1.0f - SLICE_PADDING);
+            float farZ = slice == CLUSTER_COUNT_Z - 1 ? projection.farZ : GetSliceDepth(constants, slice + 1) * (1.0f + SLICE_PADDING);
+
+            sliceLights.x.clear();
+            sliceLights.y.clear();
+            sliceLights.z.clear();
+            sliceLights.radiusSquared.clear();
+            sliceLights.indices.clear();
+
+            for (uint32_t i = 0; i < lightCount; i++)
+            {
+                const Vec4& light = viewLights[i];
+                if (light.z + light.w < nearZ || light.z - light.w > farZ)
+                    continue;
+
+                sliceLights.x.push_back(light.x);
+                sliceLights.y.push_back(light.y);
+                sliceLights.z.push_back(light.z);
+                sliceLights.radiusSquared.push_back(light.w * light.w);
+                sliceLights.indices.push_back(i);
+            }
+
+            uint32_t sliceLightCount = (uint32_t)sliceLights.indices.size();
+            while (sliceLights.x.size() % 4)
+            {
+                sliceLights.x.push_back(0.0f);
+                sliceLights.y.push_back(0.0f);
+                sliceLights.z.push_back(0.0f);
+                sliceLights.radiusSquared.push_back(-1.0f);
+            }
+
+            ArenaVector<uint32_t>& indices = sliceIndices[slice];
+            indices.clear();
+
+            Float4 zero = Splat(0.0f);
+            Float4 minZ = Splat(nearZ);
+            Float4 maxZ = Splat(farZ);
+
+            for (uint32_t y = 0; y < CLUSTER_COUNT_Y; y++)
+            {
+                // tile borders scale with depth, the box spans both ends of the slice
+                float top = borderY[y];
+                float bottom = borderY[y + 1];
+                Float4 minY = Splat(fminf(bottom * nearZ, bottom * farZ));
+                Float4 maxY = Splat(fmaxf(top * nearZ, top * farZ));
+
+                for (uint32_t x = 0; x < CLUSTER_COUNT_X; x++)
+                {
+                    float left = borderX[x];
+                    float right = borderX[x + 1];
+                    Float4 minX = Splat(fminf(left * nearZ, left * farZ));
+                    Float4 maxX = Splat(fmaxf(right * nearZ, right * farZ));
+
+                    uint32_t cluster = slice * CLUSTERS_PER_SLICE + y * CLUSTER_COUNT_X + x;
+                    outClusters.clusters[cluster * 2 + 0] = (uint32_t)indices.size(); // slice local until the end
+                    outClusters.clusters[cluster * 2 + 1] = 0;
+
+                    // squared distance from the sphere center to the box, 4 lights at a time
+                    for (uint32_t i = 0; i < sliceLightCount; i += 4)
+                    {
+                        Float4 cx = LoadFloat4(&sliceLights.x[i]);
+                        Float4 cy = LoadFloat4(&sliceLights.y[i]);
+                        Float4 cz = LoadFloat4(&sliceLights.z[i]);
+
+                        Float4 dx = Max(Max(minX - cx, cx - maxX), zero);
+                        Float4 dy = Max(Max(minY - cy, cy - maxY), zero);
+                        Float4 dz = Max(Max(minZ - cz, cz - maxZ), zero);
+
+                        int hits = LessEqualMask(dx * dx + dy * dy + dz * dz, LoadFloat4(&sliceLights.radiusSquared[i]));
+
+                        while (hits)
+                        {
+                            uint32_t lane = 0;
+                            while (!(hits & (1 << lane)))
+                                lane++;
+                            hits &= ~(1 << lane);
+
+                            indices.push_back(sliceLights.indices[i + lane]);
+                        }
+                    }
+
+                    outClusters.clusters[cluster * 2 + 1] = (uint32_t)indices.size() - outClusters.clusters[cluster * 2 + 0];
+                }
+            }
+        }
+    });
+
+    // slices in order, offsets become global
+    uint32_t total = 0;
+    for (uint32_t slice = 0; slice < CLUSTER_COUNT_Z; slice++)
+    {
+        for (uint32_t c = 0; c < CLUSTERS_PER_SLICE; c++)
+            outClusters.clusters[(slice * CLUSTERS_PER_SLICE + c) * 2] += total;
+        total += (uint32_t)sliceIndices[slice].size();
+    }
+
+    outClusters.lightIndices.resize(total);
+    outClusters.maxLightsPerCluster = 0;
+
+    uint32_t offset = 0;
+    for (const ArenaVector<uint32_t>& indices : sliceIndices)
+    {
+        if (!indices.empty())
+            memcpy(outClusters.lightIndices.data() + offset, indices.data(), indices.size() * sizeof(uint32_t));
+        offset += (uint32_t)indices.size();
+    }
+
+    for (uint32_t c = 0; c < CLUSTER_COUNT; c++)
+        if (outClusters.clusters[c * 2 + 1] > outClusters.maxLightsPerCluster)
+            outClusters.maxLightsPerCluster = outClusters.clusters[c * 2 + 1];
+}
+
+uint32_t CheckLightClusters(const PointLight* lights, uint32_t lightCount, const Mat4& view, const ClusterProjection& projection,
+    const LightClusters& clusters)
+{
+    ClusterConstants constants = MakeClusterConstants(projection, lightCount);
+    float tanHalfFov = tanf(projection.fovRadians * 0.5f);
+
+    uint32_t mismatches = 0;
+    std::vector<uint32_t> expected, found;
+    for (uint32_t z = 0; z < CLUSTER_COUNT_Z; z++)
+    {
+        float nearZ = z == 0 ? projection.nearZ : GetSliceDepth(constants, z) * (1.0f - SLICE_PADDING);
+        float farZ = z == CLUSTER_COUNT_Z - 1 ? projection.farZ : GetSliceDepth(constants, z + 1) * (1.0f + SLICE_PADDING);
+
+        for (uint32_t y = 0; y < CLUSTER_COUNT_Y; y++)
+        {
+            float top = (1.0f - 2.0f * y / CLUSTER_COUNT_Y) * tanHalfFov;
+            float bottom = (1.0f - 2.0f * (y + 1) / CLUSTER_COUNT_Y) * tanHalfFov;
+
+            for (uint32_t x = 0; x < CLUSTER_COUNT_X; x++)
+            {
+                float left = (2.0f * x / CLUSTER_COUNT_X - 1.0f) * tanHalfFov * projection.aspect;
+                float right = (2.0f * (x + 1) / CLUSTER_COUNT_X - 1.0f) * tanHalfFov * projection.aspect;
+
+                Vec3 boxMin = { fminf(left * nearZ, left * farZ), fminf(bottom * nearZ, bottom * farZ), nearZ };
+                Vec3 boxMax = { fmaxf(right * nearZ, right * farZ), fmaxf(top * nearZ, top * farZ), farZ };
+
+                expected.clear();
+                for (uint32_t i = 0; i < lightCount; i++)
+                {
+                    Vec4 center = Vec4Transform({ lights[i].position.x, lights[i].position.y, lights[i].position.z, 1.0f }, view);
+                    float dx = fmaxf(fmaxf(boxMin.x - center.x, center.x - boxMax.x), 0.0f);
+                    float dy = fmaxf(fmaxf(boxMin.y - center.y, center.y - boxMax.y), 0.0f);
+                    float dz = fmaxf(fmaxf(boxMin.z - center.z, center.z - boxMax.z), 0.0f);
+                    if (dx * dx + dy * dy + dz * dz <= lights[i].radius * lights[i].radius)
+                        expected.push_back(i);
+                }
+
+                uint32_t cluster = x + y * CLUSTER_COUNT_X + z * CLUSTER_COUNT_X * CLUSTER_COUNT_Y;
+                const uint32_t* indices = clusters.lightIndices.data() + clusters.clusters[cluster * 2 + 0];
+                found.assign(indices, indices + clusters.clusters[cluster * 2 + 1]);
+                std::sort(found.begin(), found.end());
+
+                mismatches += found != expected;
+            }
+        }
+    }
+
+    return mismatches;
+}
+
+void RunLightCullingBenchmark(JobSystem& jobs, uint32_t lightCount, LightCullingBenchmarkResult& result)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> depth(0.0f, 80.0f);
+    std::uniform_real_distribution<float> radius(0.5f, 6.0f);
+
+    std::vector<PointLight> lights(lightCount);
+    for (PointLight& light : lights)
+    {
+        light.position = { spread(rng), spread(rng) * 0.5f, depth(rng) };
+        light.radius = radius(rng);
+        light.color = { 1.0f, 1.0f, 1.0f };
+        light.intensity = 1.0f;
+    }
+
+    ClusterProjection projection = { 60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f, 1600, 900 };
+    Mat4 view = Mat4LookToLH({ 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f });
+
+    LightClusters clusters;
+    Arena scratch;
+
+    double best = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        scratch.Reset();
+
+        auto start = std::chrono::high_resolution_clock::now();
+        BuildLightClusters(jobs, lights.data(), lightCount, view, projection, scratch, clusters);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = ms < best ? ms : best;
+    }
+
+    result.lightCount = lightCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.ms = best;
+    result.totalIndices = (uint32_t)clusters.lightIndices.size();
+    result.maxLightsPerCluster = clusters.maxLightsPerCluster;
+    result.mismatches = CheckLightClusters(lights.data(), lightCount, view, projection, clusters);
+}
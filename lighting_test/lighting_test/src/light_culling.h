@@ -0,0 +1,92 @@
+#pragma once
+
+#include "arena.h"
+#include "simd_math.h"
+#include "jobs.h"
+
+#include <vector>
+
+// clustered shading: the view frustum is cut in CLUSTER_COUNT_X * CLUSTER_COUNT_Y screen tiles and
+// CLUSTER_COUNT_Z exponential depth slices, every cluster gets the list of point lights whose sphere
+// touches it, the pixel shader finds its cluster from the pixel position and view depth and only loops
+// over that list
+
+constexpr uint32_t CLUSTER_COUNT_X = 16;
+constexpr uint32_t CLUSTER_COUNT_Y = 9;
+constexpr uint32_t CLUSTER_COUNT_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+// the first slice ends here, everything closer shares it
+constexpr float CLUSTER_NEAR_Z = 0.1f;
+
+// matches the hlsl StructuredBuffer<PointLight>, attenuation reaches zero at radius
+struct PointLight
+{
+    Vec3 position;
+    float radius;
+    Vec3 color;
+    float intensity;
+};
+
+// what the pixel shader needs to find its cluster, lives in the ViewConstants cbuffer
+struct ClusterConstants
+{
+    uint32_t countX;
+    uint32_t countY;
+    uint32_t countZ;
+    uint32_t pointLightCount;
+    float tileWidth;  // pixels
+    float tileHeight; // pixels
+    float sliceScale; // slice = log(viewZ) * sliceScale + sliceBias
+    float sliceBias;
+};
+
+// the projection the clusters are built for, same values as the Mat4PerspectiveFovLH call
+struct ClusterProjection
+{
+    float fovRadians;
+    float aspect;
+    float nearZ;
+    float farZ;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct LightClusters
+{
+    ClusterConstants constants;
+    std::vector<uint32_t> clusters;     // offset and count into lightIndices, 2 per cluster, x fastest then y then z
+    std::vector<uint32_t> lightIndices;
+    uint32_t maxLightsPerCluster = 0;
+};
+
+ClusterConstants MakeClusterConstants(const ClusterProjection& projection, uint32_t pointLightCount);
+
+// index of the cluster covering pixel (x, y) at view depth viewZ, what the pixel shader computes
+uint32_t GetClusterIndex(const ClusterConstants& constants, float x, float y, float viewZ);
+
+// light attenuation shared by pixel.hlsl and the software rasterizer, smooth window to zero at radius
+float GetLightAttenuation(float distance, float radius);
+
+// lights go to view space, every depth slice keeps the lights overlapping its depth range and then tests
+// them 4 at a time against the bounding box of each of its froxels, slices are split across the job system.
+// the per slice lists are built in scratch and copied out in order
+void BuildLightClusters(JobSystem& jobs, const PointLight* lights, uint32_t lightCount, const Mat4& view,
+    const ClusterProjection& projection, Arena& scratch, LightClusters& outClusters);
+
+// every light against the box of every cluster one at a time, returns the clusters whose list holds other lights
+uint32_t CheckLightClusters(const PointLight* lights, uint32_t lightCount, const Mat4& view, const ClusterProjection& projection,
+    const LightClusters& clusters);
+
+struct LightCullingBenchmarkResult
+{
+    uint32_t lightCount;
+    uint32_t workerCount;
+    double ms;
+    uint32_t totalIndices;
+    uint32_t maxLightsPerCluster;
+    uint32_t mismatches; // clusters CheckLightClusters disagrees on, should be 0
+};
+
+// random lights around the camera, best of a few runs
+void RunLightCullingBenchmark(JobSystem& jobs, uint32_t lightCount, LightCullingBenchmarkResult& result);
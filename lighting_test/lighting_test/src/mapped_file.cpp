@@ -0,0 +1,131 @@
+#include "mapped_file.h"
+
+#include <filesystem>
+
+bool GetFileStamp(const std::string& path, uint64_t& outSize, int64_t& outTimestamp)
+{
+    std::error_code error;
+
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (error)
+        return false;
+
+    auto time = std::filesystem::last_write_time(path, error);
+    if (error)
+        return false;
+
+    outSize = (uint64_t)size;
+    outTimestamp = (int64_t)time.time_since_epoch().count();
+
+    return true;
+}
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+bool MappedFile::Map(const std::string& path)
+{
+    Unmap();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const uint8_t*)view;
+    size = (uint64_t)fileSize.QuadPart;
+
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (data)
+        UnmapViewOfFile(data);
+
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+
+    if (fileHandle)
+        CloseHandle(fileHandle);
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool MappedFile::Map(const std::string& path)
+{
+    Unmap();
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED)
+    {
+        close(file);
+        return false;
+    }
+
+    fd = file;
+    data = (const uint8_t*)view;
+    size = (uint64_t)fileStat.st_size;
+
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (data)
+        munmap((void*)data, (size_t)size);
+
+    if (fd >= 0)
+        close(fd);
+
+    data = nullptr;
+    size = 0;
+    fd = -1;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "core.h"
+
+#include <string>
+
+// read only memory mapped file, the view stays valid until Unmap (or destruction)
+struct MappedFile
+{
+    const uint8_t* data = nullptr;
+    uint64_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { Unmap(); }
+
+    bool Map(const std::string& path);
+    void Unmap();
+};
+
+// size and last write time, used to tell whether a cooked file is older than its source
+bool GetFileStamp(const std::string& path, uint64_t& outSize, int64_t& outTimestamp);
@@ -0,0 +1,159 @@
+#include "math_bench.h"
+
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static void ScalarMultiply(const Mat4& a, const Mat4& b, Mat4& out)
+{
+    for (uint32_t r = 0; r < 4; r++)
+        for (uint32_t c = 0; c < 4; c++)
+            out.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+}
+
+// the old path: three separate matrices multiplied together
+static void ScalarCompose(const Transform& transform, Mat4& out)
+{
+    Mat4 scaleRotation;
+    ScalarMultiply(Mat4Scaling(transform.scale), Mat4RotationRollPitchYaw(transform.rotation.x * TO_RADIANS, transform.rotation.y * TO_RADIANS, transform.rotation.z * TO_RADIANS), scaleRotation);
+    ScalarMultiply(scaleRotation, Mat4Translation(transform.location), out);
+}
+
+// general 4x4 gauss-jordan inverse, what a non affine aware library does
+static void ScalarInverse(const Mat4& m, Mat4& out)
+{
+    float a[4][8];
+    for (uint32_t r = 0; r < 4; r++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            a[r][c] = m.m[r][c];
+            a[r][c + 4] = r == c ? 1.0f : 0.0f;
+        }
+    }
+
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        uint32_t pivot = c;
+        for (uint32_t r = c + 1; r < 4; r++)
+            if (fabsf(a[r][c]) > fabsf(a[pivot][c]))
+                pivot = r;
+
+        for (uint32_t k = 0; k < 8; k++)
+        {
+            float temp = a[c][k];
+            a[c][k] = a[pivot][k];
+            a[pivot][k] = temp;
+        }
+
+        float inversePivot = a[c][c] != 0.0f ? 1.0f / a[c][c] : 0.0f;
+        for (uint32_t k = 0; k < 8; k++)
+            a[c][k] *= inversePivot;
+
+        for (uint32_t r = 0; r < 4; r++)
+        {
+            if (r == c)
+                continue;
+
+            float factor = a[r][c];
+            for (uint32_t k = 0; k < 8; k++)
+                a[r][k] -= factor * a[c][k];
+        }
+    }
+
+    for (uint32_t r = 0; r < 4; r++)
+        for (uint32_t c = 0; c < 4; c++)
+            out.m[r][c] = a[r][c + 4];
+}
+
+static float MaxError(const std::vector<Mat4>& a, const std::vector<Mat4>& b)
+{
+    float maxError = 0.0f;
+    for (size_t i = 0; i < a.size(); i++)
+        for (uint32_t r = 0; r < 4; r++)
+            for (uint32_t c = 0; c < 4; c++)
+                maxError = fmaxf(maxError, fabsf(a[i].m[r][c] - b[i].m[r][c]));
+    return maxError;
+}
+
+template<typename F>
+static double TimeMs(F fn)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// best of a few runs of each, taken in turns so whatever else the machine is doing hits both alike.
+// the first runs also warm the caches
+template<typename S, typename V>
+static void TimeCase(MathBenchmarkCase& bench, S scalar, V simd)
+{
+    bench.scalarMs = 1e30;
+    bench.simdMs = 1e30;
+    for (uint32_t run = 0; run < 20; run++)
+    {
+        bench.scalarMs = std::min(bench.scalarMs, TimeMs(scalar));
+        bench.simdMs = std::min(bench.simdMs, TimeMs(simd));
+    }
+}
+
+void RunMathBenchmark(uint32_t matrixCount, MathBenchmarkResult& result)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> location(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> rotation(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+
+    std::vector<Transform> transforms(matrixCount);
+    for (Transform& transform : transforms)
+    {
+        transform.location = { location(rng), location(rng), location(rng) };
+        transform.rotation = { rotation(rng), rotation(rng), rotation(rng) };
+        transform.scale = { scale(rng), scale(rng), scale(rng) };
+    }
+
+    std::vector<Mat4> models(matrixCount);
+    Mat4FromTransformBatch(transforms.data(), models.data(), matrixCount);
+
+    Mat4 viewProj = Mat4Multiply(
+        Mat4LookToLH({ 0.0f, 2.0f, -10.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }),
+        Mat4PerspectiveFovLH(60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f));
+
+    std::vector<Mat4> scalarOut(matrixCount);
+    std::vector<Mat4> simdOut(matrixCount);
+
+    result.simdPath = GetSimdMathPath();
+    result.matrixCount = matrixCount;
+    result.caseCount = 0;
+
+    // compose
+    {
+        MathBenchmarkCase& bench = result.cases[result.caseCount++];
+        bench.name = "compose";
+        TimeCase(bench, [&] { for (uint32_t i = 0; i < matrixCount; i++) ScalarCompose(transforms[i], scalarOut[i]); },
+            [&] { Mat4FromTransformBatch(transforms.data(), simdOut.data(), matrixCount); });
+        bench.maxError = MaxError(scalarOut, simdOut);
+    }
+
+    // model * viewProj
+    {
+        MathBenchmarkCase& bench = result.cases[result.caseCount++];
+        bench.name = "multiply";
+        TimeCase(bench, [&] { for (uint32_t i = 0; i < matrixCount; i++) ScalarMultiply(models[i], viewProj, scalarOut[i]); },
+            [&] { Mat4MultiplyBatch(models.data(), viewProj, simdOut.data(), matrixCount); });
+        bench.maxError = MaxError(scalarOut, simdOut);
+    }
+
+    // inverse
+    {
+        MathBenchmarkCase& bench = result.cases[result.caseCount++];
+        bench.name = "inverse";
+        TimeCase(bench, [&] { for (uint32_t i = 0; i < matrixCount; i++) ScalarInverse(models[i], scalarOut[i]); },
+            [&] { for (uint32_t i = 0; i < matrixCount; i++) simdOut[i] = Mat4AffineInverse(models[i]); });
+        bench.maxError = MaxError(scalarOut, simdOut);
+    }
+}
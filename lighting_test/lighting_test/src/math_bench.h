@@ -0,0 +1,23 @@
+#pragma once
+
+#include "simd_math.h"
+
+// times the simd matrix batches and the affine inverse against plain scalar reference code over the same inputs,
+// single multiplies and transposes are scalar code on both sides and not measured
+struct MathBenchmarkCase
+{
+    const char* name;
+    double scalarMs;
+    double simdMs;
+    float maxError; // largest absolute difference between both results
+};
+
+struct MathBenchmarkResult
+{
+    const char* simdPath;
+    uint32_t matrixCount;
+    MathBenchmarkCase cases[3];
+    uint32_t caseCount;
+};
+
+void RunMathBenchmark(uint32_t matrixCount, MathBenchmarkResult& result);
@@ -0,0 +1,175 @@
+#include "mesh.h"
+#include "obj_parser.h"
+
+#include "../vendor/tinyobjloader/tiny_obj_loader.h"
+
+#include <math.h>
+#include <unordered_map>
+
+struct WeldKey
+{
+    int vertexIndex;
+    int normalIndex;
+    int texcoordIndex;
+
+    bool operator==(const WeldKey& other) const
+    {
+        return vertexIndex == other.vertexIndex && normalIndex == other.normalIndex && texcoordIndex == other.texcoordIndex;
+    }
+};
+
+struct WeldKeyHash
+{
+    size_t operator()(const WeldKey& key) const
+    {
+        // fnv-1a style mix, indices are small and dense so this spreads them well enough
+        uint64_t h = 14695981039346656037ull;
+        h = (h ^ (uint32_t)key.vertexIndex) * 1099511628211ull;
+        h = (h ^ (uint32_t)key.normalIndex) * 1099511628211ull;
+        h = (h ^ (uint32_t)key.texcoordIndex) * 1099511628211ull;
+        return (size_t)h;
+    }
+};
+
+// everything but the parse itself, shared by both loaders
+static void FinishMeshData(MeshData& data)
+{
+    data.stats.vertexCount = (uint32_t)data.vertices.size();
+    data.stats.indexCount = (uint32_t)data.indices.size();
+    data.stats.acmrBefore = data.stats.acmrOptimized = data.stats.acmrAfter = 0.0f;
+    data.stats.atvrBefore = data.stats.atvrOptimized = data.stats.atvrAfter = 0.0f;
+    data.stats.packingError = {};
+
+    data.submeshBounds.resize(data.submeshes.size());
+    for (size_t i = 0; i < data.submeshes.size(); i++)
+        data.submeshBounds[i] = ComputeSubMeshBounds(data.vertices.data(), data.indices.data(), data.submeshes[i]);
+}
+
+bool LoadMeshData(JobSystem& jobs, const std::string& meshPath, Arena& scratch, MeshData& outData)
+{
+    if (!ParseObj(jobs, meshPath, scratch, outData))
+        return false;
+
+    FinishMeshData(outData);
+    return true;
+}
+
+bool LoadMeshDataTinyObj(const std::string& meshPath, MeshData& outData)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, meshPath.c_str()))
+        return false;
+
+    size_t totalIndexCount = 0;
+    for (const auto& shape : shapes)
+        totalIndexCount += shape.mesh.indices.size();
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SubMeshRange> submeshes;
+
+    // worst case is no sharing at all
+    vertices.reserve(totalIndexCount);
+    indices.reserve(totalIndexCount);
+    submeshes.reserve(shapes.size());
+
+    std::unordered_map<WeldKey, uint32_t, WeldKeyHash> weldMap;
+    weldMap.reserve(totalIndexCount);
+
+    for (const auto& shape : shapes)
+    {
+        SubMeshRange& s = submeshes.emplace_back();
+        s.indexOffset = (uint32_t)indices.size();
+        s.indexCount = (uint32_t)shape.mesh.indices.size();
+
+        for (const auto& index : shape.mesh.indices)
+        {
+            WeldKey key = { index.vertex_index, index.normal_index, index.texcoord_index };
+
+            auto [it, inserted] = weldMap.try_emplace(key, (uint32_t)vertices.size());
+            if (inserted)
+            {
+                MeshVertex& v = vertices.emplace_back();
+                v.pos.x = attrib.vertices[3 * index.vertex_index + 0];
+                v.pos.y = attrib.vertices[3 * index.vertex_index + 1];
+                v.pos.z = attrib.vertices[3 * index.vertex_index + 2];
+
+                if (index.normal_index != -1)
+                {
+                    v.normal.x = attrib.normals[3 * index.normal_index + 0];
+                    v.normal.y = attrib.normals[3 * index.normal_index + 1];
+                    v.normal.z = attrib.normals[3 * index.normal_index + 2];
+                }
+
+                if (index.texcoord_index != -1)
+                {
+                    v.textureCoords.x = attrib.texcoords[2 * index.texcoord_index + 0];
+                    v.textureCoords.y = -attrib.texcoords[2 * index.texcoord_index + 1];
+                }
+            }
+
+            indices.push_back(it->second);
+        }
+    }
+
+    vertices.shrink_to_fit();
+
+    outData.stats.unweldedVertexCount = (uint32_t)totalIndexCount;
+    outData.vertices = std::move(vertices);
+    outData.indices = std::move(indices);
+    outData.submeshes = std::move(submeshes);
+
+    FinishMeshData(outData);
+
+    return true;
+}
+
+SubMeshBounds ComputeSubMeshBounds(const MeshVertex* vertices, const uint32_t* indices, const SubMeshRange& range)
+{
+    SubMeshBounds bounds = {};
+    if (range.indexCount == 0)
+        return bounds;
+
+    bounds.min = bounds.max = vertices[indices[range.indexOffset]].pos;
+    for (uint32_t i = range.indexOffset; i < range.indexOffset + range.indexCount; i++)
+    {
+        const Vec3& p = vertices[indices[i]].pos;
+        bounds.min = { fminf(bounds.min.x, p.x), fminf(bounds.min.y, p.y), fminf(bounds.min.z, p.z) };
+        bounds.max = { fmaxf(bounds.max.x, p.x), fmaxf(bounds.max.y, p.y), fmaxf(bounds.max.z, p.z) };
+    }
+
+    bounds.center = { (bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f };
+
+    float radiusSquared = 0.0f;
+    for (uint32_t i = range.indexOffset; i < range.indexOffset + range.indexCount; i++)
+    {
+        const Vec3& p = vertices[indices[i]].pos;
+        float dx = p.x - bounds.center.x;
+        float dy = p.y - bounds.center.y;
+        float dz = p.z - bounds.center.z;
+        radiusSquared = fmaxf(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    bounds.radius = sqrtf(radiusSquared);
+
+    return bounds;
+}
+
+void PackMeshVertices(MeshData& data)
+{
+    if (data.vertexFormat == VertexFormat::Packed || !CanPackVertices(data.vertices.data(), (uint32_t)data.vertices.size()))
+        return;
+
+    data.quantization = ComputeVertexQuantization(data.vertices.data(), (uint32_t)data.vertices.size());
+    data.stats.packingError = MeasurePackingError(data.vertices.data(), (uint32_t)data.vertices.size(), data.quantization);
+
+    data.packedVertices.resize(data.vertices.size());
+    for (size_t i = 0; i < data.vertices.size(); i++)
+        data.packedVertices[i] = PackVertex(data.vertices[i], data.quantization);
+
+    data.vertexFormat = VertexFormat::Packed;
+    std::vector<MeshVertex>().swap(data.vertices);
+}
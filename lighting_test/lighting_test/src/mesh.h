@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vertex_format.h"
+
+#include <vector>
+#include <string>
+
+// the full detail level and up to 4 coarser ones, see mesh_lod.h
+constexpr uint32_t MAX_MESH_LODS = 5;
+
+// range of the shared index buffer drawn with one texture
+struct SubMeshRange
+{
+    uint32_t indexOffset;
+    uint32_t indexCount;
+};
+
+// a run of triangles of one submesh culled as a whole, see meshlet.h
+struct Meshlet
+{
+    uint32_t indexOffset;   // into the mesh's indices, every meshlet is a run of them
+    uint32_t triangleCount;
+    uint32_t vertexCount;   // distinct vertices
+    uint32_t submesh;
+};
+
+// center xyz, radius, cone xyz and cutoff of every meshlet, one array after the other
+constexpr uint32_t MESHLET_BOUNDS_ARRAYS = 8;
+
+// object space bounds of one submesh, the sphere is centered on the box and only as big as the
+// farthest vertex needs
+struct SubMeshBounds
+{
+    Vec3 min;
+    Vec3 max;
+    Vec3 center;
+    float radius;
+};
+
+struct MeshStats
+{
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t unweldedVertexCount; // one vertex per index, what we used to upload
+
+    // post transform cache efficiency of the welded mesh, after OptimizeMesh and of the order it is drawn in, which
+    // the meshlets regroup
+    float acmrBefore;
+    float atvrBefore;
+    float acmrOptimized;
+    float atvrOptimized;
+    float acmrAfter;
+    float atvrAfter;
+
+    // zero when the mesh kept the full vertex format
+    VertexPackingError packingError;
+};
+
+// cpu side mesh, no graphics api stuff in here
+struct MeshData
+{
+    // only one of the two vertex arrays is filled, depending on vertexFormat
+    VertexFormat vertexFormat = VertexFormat::Full;
+    std::vector<MeshVertex> vertices;
+    std::vector<PackedVertex> packedVertices;
+    VertexQuantization quantization = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } };
+
+    std::vector<uint32_t> indices;
+    std::vector<SubMeshRange> submeshes;
+    std::vector<SubMeshBounds> submeshBounds; // one per submesh
+    MeshStats stats;
+
+    // coarser levels from BuildMeshLods, their indices follow the full detail ones in indices
+    std::vector<SubMeshRange> lodSubmeshes; // level major, one per submesh per level
+    std::vector<float> lodErrors;           // per level, object space distance
+
+    // from CookMeshlets, the full detail indices are in meshlet order
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> submeshMeshlets;  // first meshlet of every submesh, then the meshlet count
+    std::vector<float> meshletBounds;       // MESHLET_BOUNDS_ARRAYS arrays of the meshlet count padded to 4
+};
+
+class JobSystem;
+struct Arena;
+
+// parses the obj and welds every (position, normal, texcoord) triple into a single shared vertex,
+// the parse is split across the job system and its temporaries come from scratch (see obj_parser.h)
+bool LoadMeshData(JobSystem& jobs, const std::string& meshPath, Arena& scratch, MeshData& outData);
+
+// the same through tinyobj::LoadObj, what LoadMeshData used to be, kept to check and time the parser against
+bool LoadMeshDataTinyObj(const std::string& meshPath, MeshData& outData);
+
+SubMeshBounds ComputeSubMeshBounds(const MeshVertex* vertices, const uint32_t* indices, const SubMeshRange& range);
+
+// switches the mesh to the packed vertex format when its uvs allow it, run this last
+// since everything else works on MeshVertex
+void PackMeshVertices(MeshData& data);
+
+// against one full vertex per index
+inline uint64_t MeshBytesSaved(const MeshStats& stats, VertexFormat format)
+{
+    return (uint64_t)stats.unweldedVertexCount * sizeof(MeshVertex) - (uint64_t)stats.vertexCount * GetVertexStride(format);
+}
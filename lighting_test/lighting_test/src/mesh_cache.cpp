@@ -0,0 +1,332 @@
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "meshlet.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+std::string GetMeshCachePath(const std::string& meshPath)
+{
+    return meshPath + ".lmesh";
+}
+
+MeshView MakeMeshView(const MeshData& data)
+{
+    MeshView view;
+    view.vertexFormat = data.vertexFormat;
+    view.vertices = data.vertices.data();
+    view.packedVertices = data.packedVertices.data();
+    view.quantization = data.quantization;
+    view.indices = data.indices.data();
+    view.submeshes = data.submeshes.data();
+    view.submeshBounds = data.submeshBounds.data();
+    view.lodErrors = data.lodErrors.data();
+    view.lodSubmeshes = data.lodSubmeshes.data();
+    view.meshlets = data.meshlets.data();
+    view.submeshMeshlets = data.submeshMeshlets.data();
+    view.meshletBounds = data.meshletBounds.data();
+    view.vertexCount = (uint32_t)(data.vertexFormat == VertexFormat::Packed ? data.packedVertices.size() : data.vertices.size());
+    view.indexCount = (uint32_t)data.indices.size();
+    view.submeshCount = (uint32_t)data.submeshes.size();
+    view.lodCount = (uint32_t)data.lodErrors.size();
+    view.meshletCount = (uint32_t)data.meshlets.size();
+    view.stats = data.stats;
+    return view;
+}
+
+bool WriteMeshCache(const std::string& meshPath, const MeshData& data)
+{
+    MeshCacheHeader header = {};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    MeshView view = MakeMeshView(data);
+
+    header.vertexStride = GetVertexStride(data.vertexFormat);
+    header.submeshCount = view.submeshCount;
+    header.vertexCount = view.vertexCount;
+    header.indexCount = view.indexCount;
+    header.lodCount = view.lodCount;
+    header.meshletCount = view.meshletCount;
+    header.stats = data.stats;
+    header.vertexFormat = data.vertexFormat;
+    header.quantization = data.quantization;
+
+    if (!GetFileStamp(meshPath, header.sourceSize, header.sourceTimestamp))
+        return false;
+
+    // write to a temp file first so a crash never leaves a half written cache behind
+    std::string cachePath = GetMeshCachePath(meshPath);
+    std::string tempPath = cachePath + ".tmp";
+
+    bool ok;
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)data.submeshes.data(), data.submeshes.size() * sizeof(SubMeshRange));
+        file.write((const char*)data.submeshBounds.data(), data.submeshBounds.size() * sizeof(SubMeshBounds));
+        file.write((const char*)data.lodErrors.data(), data.lodErrors.size() * sizeof(float));
+        file.write((const char*)data.lodSubmeshes.data(), data.lodSubmeshes.size() * sizeof(SubMeshRange));
+        file.write((const char*)data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet));
+        file.write((const char*)data.submeshMeshlets.data(), data.submeshMeshlets.size() * sizeof(uint32_t));
+        file.write((const char*)data.meshletBounds.data(), data.meshletBounds.size() * sizeof(float));
+        file.write((const char*)view.GetVertexData(), (size_t)view.vertexCount * header.vertexStride);
+        file.write((const char*)data.indices.data(), data.indices.size() * sizeof(uint32_t));
+        file.flush();
+        ok = file.good();
+    }
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, cachePath, error);
+
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool CookMeshData(JobSystem& jobs, const std::string& meshPath, Arena& scratch, MeshData& outData)
+{
+    if (!LoadMeshData(jobs, meshPath, scratch, outData))
+        return false;
+
+    OptimizeMesh(outData, true);
+    BuildMeshLods(outData);
+    PackMeshVertices(outData);
+    CookMeshlets(outData);
+
+    return true;
+}
+
+bool CookMesh(JobSystem& jobs, const std::string& meshPath)
+{
+    MeshData data;
+    Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+    if (!CookMeshData(jobs, meshPath, scratch, data))
+        return false;
+
+    return WriteMeshCache(meshPath, data);
+}
+
+// the submesh table and the bounds arrays after the meshlets
+static uint64_t GetMeshletTableBytes(uint32_t submeshCount, uint32_t meshletCount)
+{
+    if (!meshletCount)
+        return 0;
+
+    uint64_t paddedCount = (meshletCount + 3) & ~3u;
+    return (submeshCount + 1) * sizeof(uint32_t) + MESHLET_BOUNDS_ARRAYS * paddedCount * sizeof(float);
+}
+
+static bool IsRangeInside(const SubMeshRange& range, uint32_t indexCount)
+{
+    return range.indexCount % 3 == 0 && (uint64_t)range.indexOffset + range.indexCount <= indexCount;
+}
+
+// culling, meshlets and the software rasterizer index cpu arrays with what the cache says, a file that does not add up
+// has to fail here instead of reading past them. one pass over the indices, cheap next to the cook it saves
+static bool IsMeshViewValid(const MeshView& view)
+{
+    for (uint32_t s = 0; s < view.submeshCount; s++)
+    {
+        if (!IsRangeInside(view.submeshes[s], view.indexCount))
+            return false;
+    }
+
+    for (uint32_t i = 0; i < view.lodCount * view.submeshCount; i++)
+    {
+        if (!IsRangeInside(view.lodSubmeshes[i], view.indexCount))
+            return false;
+    }
+
+    for (uint32_t level = 0; level < view.lodCount; level++)
+    {
+        if (!(view.lodErrors[level] >= 0.0f) || (level && view.lodErrors[level] < view.lodErrors[level - 1]))
+            return false;
+    }
+
+    if (view.meshletCount)
+    {
+        if (view.submeshMeshlets[0] != 0 || view.submeshMeshlets[view.submeshCount] != view.meshletCount)
+            return false;
+
+        for (uint32_t s = 0; s < view.submeshCount; s++)
+        {
+            uint32_t first = view.submeshMeshlets[s], end = view.submeshMeshlets[s + 1];
+            if (first > end || end > view.meshletCount)
+                return false;
+
+            for (uint32_t i = first; i < end; i++)
+            {
+                const Meshlet& meshlet = view.meshlets[i];
+                if (meshlet.submesh != s || meshlet.triangleCount > view.indexCount / 3
+                    || !IsRangeInside({ meshlet.indexOffset, meshlet.triangleCount * 3 }, view.indexCount))
+                    return false;
+            }
+        }
+    }
+
+    uint32_t largest = 0;
+    for (uint32_t i = 0; i < view.indexCount; i++)
+        largest = std::max(largest, view.indices[i]);
+
+    return view.indexCount == 0 || largest < view.vertexCount;
+}
+
+bool MapMeshCache(const std::string& meshPath, MappedFile& outFile, MeshView& outView)
+{
+    uint64_t sourceSize;
+    int64_t sourceTimestamp;
+    if (!GetFileStamp(meshPath, sourceSize, sourceTimestamp))
+        return false;
+
+    if (!outFile.Map(GetMeshCachePath(meshPath)))
+        return false;
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)outFile.data;
+
+    bool valid = outFile.size >= sizeof(MeshCacheHeader)
+        && header->magic == MESH_CACHE_MAGIC
+        && header->version == MESH_CACHE_VERSION
+        && (header->vertexFormat == VertexFormat::Full || header->vertexFormat == VertexFormat::Packed)
+        && header->vertexStride == GetVertexStride(header->vertexFormat)
+        && header->sourceSize == sourceSize
+        && header->sourceTimestamp == sourceTimestamp;
+
+    uint64_t expectedSize = sizeof(MeshCacheHeader);
+    if (valid)
+    {
+        expectedSize += (uint64_t)header->submeshCount * (sizeof(SubMeshRange) + sizeof(SubMeshBounds));
+        expectedSize += (uint64_t)header->lodCount * (sizeof(float) + header->submeshCount * sizeof(SubMeshRange));
+        expectedSize += (uint64_t)header->meshletCount * sizeof(Meshlet) + GetMeshletTableBytes(header->submeshCount, header->meshletCount);
+        expectedSize += (uint64_t)header->vertexCount * header->vertexStride;
+        expectedSize += (uint64_t)header->indexCount * sizeof(uint32_t);
+        valid = outFile.size == expectedSize;
+    }
+
+    if (!valid)
+    {
+        outFile.Unmap();
+        return false;
+    }
+
+    const uint8_t* cursor = outFile.data + sizeof(MeshCacheHeader);
+
+    outView.submeshes = (const SubMeshRange*)cursor;
+    cursor += header->submeshCount * sizeof(SubMeshRange);
+
+    outView.submeshBounds = (const SubMeshBounds*)cursor;
+    cursor += header->submeshCount * sizeof(SubMeshBounds);
+
+    outView.lodErrors = (const float*)cursor;
+    cursor += header->lodCount * sizeof(float);
+
+    outView.lodSubmeshes = (const SubMeshRange*)cursor;
+    cursor += (size_t)header->lodCount * header->submeshCount * sizeof(SubMeshRange);
+
+    outView.meshlets = (const Meshlet*)cursor;
+    cursor += (size_t)header->meshletCount * sizeof(Meshlet);
+
+    outView.submeshMeshlets = header->meshletCount ? (const uint32_t*)cursor : nullptr;
+    outView.meshletBounds = header->meshletCount ? (const float*)cursor + header->submeshCount + 1 : nullptr;
+    cursor += GetMeshletTableBytes(header->submeshCount, header->meshletCount);
+
+    outView.vertexFormat = header->vertexFormat;
+    outView.vertices = header->vertexFormat == VertexFormat::Full ? (const MeshVertex*)cursor : nullptr;
+    outView.packedVertices = header->vertexFormat == VertexFormat::Packed ? (const PackedVertex*)cursor : nullptr;
+    outView.quantization = header->quantization;
+    cursor += (size_t)header->vertexCount * header->vertexStride;
+
+    outView.indices = (const uint32_t*)cursor;
+
+    outView.submeshCount = header->submeshCount;
+    outView.lodCount = header->lodCount;
+    outView.meshletCount = header->meshletCount;
+    outView.vertexCount = header->vertexCount;
+    outView.indexCount = header->indexCount;
+    outView.stats = header->stats;
+
+    if (!IsMeshViewValid(outView))
+    {
+        outFile.Unmap();
+        return false;
+    }
+
+    return true;
+}
+
+void RunMeshBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<MeshBenchmarkCase>& outCases)
+{
+    using MeshClock = std::chrono::high_resolution_clock;
+    auto millisecondsSince = [](MeshClock::time_point start) { return std::chrono::duration<double, std::milli>(MeshClock::now() - start).count(); };
+
+    constexpr uint32_t MAP_RUNS = 10;
+
+    outCases.clear();
+
+    Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+    for (const std::string& path : meshPaths)
+    {
+        scratch.Reset();
+
+        MeshData parsed;
+        auto start = MeshClock::now();
+        bool ok = LoadMeshData(jobs, path, scratch, parsed);
+        double parseMs = millisecondsSince(start);
+
+        scratch.Reset();
+
+        MeshData data;
+        start = MeshClock::now();
+        ok = ok && CookMeshData(jobs, path, scratch, data);
+        double cookMs = millisecondsSince(start);
+
+        if (!ok || !WriteMeshCache(path, data))
+            continue;
+
+        MeshBenchmarkCase& bench = outCases.emplace_back();
+        bench.path = path;
+        bench.submeshCount = (uint32_t)data.submeshes.size();
+        bench.stats = data.stats;
+        bench.vertexFormat = data.vertexFormat;
+        bench.quantization = data.quantization;
+        bench.parseMs = parseMs;
+        bench.cookMs = cookMs;
+        bench.mapMs = 1e30;
+        volatile uint8_t touched = 0;
+
+        for (uint32_t run = 0; run < MAP_RUNS; run++)
+        {
+            MappedFile file;
+            MeshView view;
+
+            // every page touched, mapping alone reads nothing yet
+            start = MeshClock::now();
+            bool mapped = MapMeshCache(path, file, view);
+            for (size_t i = 0; mapped && i < file.size; i += 4096)
+                touched += file.data[i];
+            bench.mapMs = std::min(bench.mapMs, millisecondsSince(start));
+
+            if (run > 0)
+                continue;
+
+            MeshView cooked = MakeMeshView(data);
+            uint32_t stride = GetVertexStride(cooked.vertexFormat);
+            bench.cacheBytes = file.size;
+            bench.cacheMatches = mapped && view.vertexFormat == cooked.vertexFormat && view.vertexCount == cooked.vertexCount
+                && view.indexCount == cooked.indexCount && view.submeshCount == cooked.submeshCount
+                && !memcmp(view.GetVertexData(), cooked.GetVertexData(), (size_t)cooked.vertexCount * stride)
+                && !memcmp(view.indices, cooked.indices, (size_t)cooked.indexCount * sizeof(uint32_t))
+                && view.meshletCount == cooked.meshletCount
+                && !memcmp(view.meshlets, cooked.meshlets, (size_t)cooked.meshletCount * sizeof(Meshlet))
+                && !memcmp(view.meshletBounds, cooked.meshletBounds, data.meshletBounds.size() * sizeof(float));
+        }
+    }
+}
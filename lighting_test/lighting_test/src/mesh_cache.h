@@ -0,0 +1,95 @@
+#pragma once
+
+#include "arena.h"
+#include "mesh.h"
+#include "mapped_file.h"
+
+// binary mesh cache, written next to the obj as "<mesh>.lmesh"
+//
+// layout: MeshCacheHeader | SubMeshRange[submeshCount] | SubMeshBounds[submeshCount] | float[lodCount] | SubMeshRange[lodCount * submeshCount]
+//         | Meshlet[meshletCount] | uint32_t[submeshCount + 1] when there are meshlets | float[MESHLET_BOUNDS_ARRAYS * meshletCount padded to 4]
+//         | MeshVertex or PackedVertex[vertexCount] | uint32_t[indexCount]
+// everything is 4 byte aligned so the mapped file can be handed to the gpu as is
+
+constexpr uint32_t MESH_CACHE_MAGIC = 0x48534d4c; // "LMSH"
+constexpr uint32_t MESH_CACHE_VERSION = 9;
+
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexStride;
+    uint32_t submeshCount;
+    uint32_t vertexCount;
+    uint32_t indexCount;    // every level
+    uint32_t lodCount;      // coarser levels
+    uint32_t meshletCount;
+    uint64_t sourceSize;
+    int64_t sourceTimestamp;
+    MeshStats stats;
+    VertexFormat vertexFormat;
+    VertexQuantization quantization;
+    uint32_t dummyPadding0;
+};
+
+// non owning view over mesh data, either a MeshData or a mapped cache file
+struct MeshView
+{
+    VertexFormat vertexFormat;
+    const MeshVertex* vertices;          // when vertexFormat is Full
+    const PackedVertex* packedVertices;  // when vertexFormat is Packed
+    VertexQuantization quantization;
+    const uint32_t* indices;
+    const SubMeshRange* submeshes;
+    const SubMeshBounds* submeshBounds;
+    const float* lodErrors;              // lodCount
+    const SubMeshRange* lodSubmeshes;    // lodCount * submeshCount, level major
+    const Meshlet* meshlets;             // meshletCount, none when the mesh was not cooked
+    const uint32_t* submeshMeshlets;     // submeshCount + 1
+    const float* meshletBounds;          // MESHLET_BOUNDS_ARRAYS * meshletCount padded to 4
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t submeshCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+    MeshStats stats;
+
+    const void* GetVertexData() const { return vertexFormat == VertexFormat::Packed ? (const void*)packedVertices : (const void*)vertices; }
+};
+
+std::string GetMeshCachePath(const std::string& meshPath);
+
+MeshView MakeMeshView(const MeshData& data);
+
+// writes the cache for meshPath, stamped with the current size and timestamp of the obj
+bool WriteMeshCache(const std::string& meshPath, const MeshData& data);
+
+// first block of the arena a cook parses with, grows past it for bigger meshes
+constexpr size_t MESH_LOAD_ARENA_BLOCK_SIZE = 4 * 1024 * 1024;
+
+// everything that ends up in the cache: parse, optimize, levels of detail, pack, meshlets. the parse temporaries come from scratch
+bool CookMeshData(JobSystem& jobs, const std::string& meshPath, Arena& scratch, MeshData& outData);
+
+// offline cooker entry point: CookMeshData and write the result
+bool CookMesh(JobSystem& jobs, const std::string& meshPath);
+
+// maps the cache for meshPath, fails if it is missing, corrupt, from another version or older than the obj. its ranges
+// are checked against the index count and its indices against the vertex count, a cache pointing outside itself fails
+bool MapMeshCache(const std::string& meshPath, MappedFile& outFile, MeshView& outView);
+
+struct MeshBenchmarkCase
+{
+    std::string path;
+    uint32_t submeshCount;
+    MeshStats stats;    // of the cooked mesh, vertexCount against unweldedVertexCount is what welding saved
+    double parseMs;     // LoadMeshData, the obj parsed and welded
+    double cookMs;      // CookMeshData, what a launch without a cache pays
+    double mapMs;       // MapMeshCache of what the cook wrote and a read of every page, best of a few
+    uint64_t cacheBytes;
+    bool cacheMatches;  // the mapped view has the cooked vertices, indices and meshlets
+    VertexFormat vertexFormat;
+    VertexQuantization quantization; // what stats.packingError is checked against when packed
+};
+
+// every mesh cooked from the obj, written to its cache and mapped again
+void RunMeshBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<MeshBenchmarkCase>& outCases);
@@ -0,0 +1,819 @@
+#include "mesh_lod.h"
+#include "mesh_optimize.h"
+#include "profiler.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+// sum of squared distances to a set of planes, v^T A v + 2 b.v + c
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight; // area of the faces, the error is divided by it to stay a distance
+};
+
+static void AddPlane(Quadric& q, const Vec3& normal, float d, double weight)
+{
+    double x = normal.x, y = normal.y, z = normal.z;
+
+    q.a00 += weight * x * x;
+    q.a01 += weight * x * y;
+    q.a02 += weight * x * z;
+    q.a11 += weight * y * y;
+    q.a12 += weight * y * z;
+    q.a22 += weight * z * z;
+    q.b0 += weight * x * d;
+    q.b1 += weight * y * d;
+    q.b2 += weight * z * d;
+    q.c += weight * d * d;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& other)
+{
+    q.a00 += other.a00;
+    q.a01 += other.a01;
+    q.a02 += other.a02;
+    q.a11 += other.a11;
+    q.a12 += other.a12;
+    q.a22 += other.a22;
+    q.b0 += other.b0;
+    q.b1 += other.b1;
+    q.b2 += other.b2;
+    q.c += other.c;
+    q.weight += other.weight;
+}
+
+static double EvaluateQuadric(const Quadric& q, const Vec3& p)
+{
+    double x = p.x, y = p.y, z = p.z;
+    double result = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+        2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return result > 0.0 ? result : 0.0;
+}
+
+// borders and seams weigh this much more than a face of the same size, they only move along themselves
+constexpr double LOD_BORDER_WEIGHT = 10.0;
+
+// wedges of a position closer than this count as one, uv distance plus 1 - cosine of the normals. faceted meshes
+// split every corner by a slightly different normal or uv, only what is further apart is a seam or a hard edge
+constexpr float LOD_ATTRIBUTE_TOLERANCE = 0.3f;
+
+static float GetAttributeDistance(const MeshVertex& a, const MeshVertex& b)
+{
+    return fabsf(a.textureCoords.x - b.textureCoords.x) + fabsf(a.textureCoords.y - b.textureCoords.y) + (1.0f - Dot(a.normal, b.normal));
+}
+
+// a collapse that turns a triangle's normal further than about 75 degrees folds the surface over
+constexpr float LOD_FLIP_COSINE = 0.25f;
+
+// exact positions, the wedges of a position are its vertices split by normal or uv
+struct LodPositionKey
+{
+    float x, y, z;
+    bool operator==(const LodPositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct LodPositionKeyHash
+{
+    size_t operator()(const LodPositionKey& key) const
+    {
+        uint32_t bits[3];
+        memcpy(bits, &key, sizeof(bits));
+        return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+    }
+};
+
+static float PointTriangleDistance(const Vec3& p, const Vec3& a, const Vec3& b, const Vec3& c)
+{
+    // closest point by region (Ericson, real-time collision detection 5.1.5)
+    Vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return Length(ap);
+
+    Vec3 bp = p - b;
+    float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return Length(bp);
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return Length(p - (a + ab * (d1 / (d1 - d3))));
+
+    Vec3 cp = p - c;
+    float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return Length(cp);
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return Length(p - (a + ac * (d2 / (d2 - d6))));
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        return Length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+    float denom = 1.0f / (va + vb + vc);
+    return Length(p - (a + ab * (vb * denom) + ac * (vc * denom)));
+}
+
+struct CollapseCandidate
+{
+    uint32_t from; // positions
+    uint32_t to;
+    float error;
+};
+
+uint32_t SimplifyIndices(const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+    uint32_t targetIndexCount, uint32_t* outIndices, float& outError)
+{
+    outError = 0.0f;
+
+    uint32_t triangleCount = indexCount / 3;
+    uint32_t targetTriangles = targetIndexCount / 3;
+
+    // positions of the vertices this range uses, every collapse works on positions and moves all the wedges along
+    std::unordered_map<LodPositionKey, uint32_t, LodPositionKeyHash> positionMap;
+    std::vector<uint32_t> vertexPositions(vertexCount, UINT32_MAX); // UINT32_MAX until the range uses the vertex
+    std::vector<Vec3> positions;
+    std::vector<uint32_t> triangles(indices, indices + triangleCount * 3);
+    std::vector<uint32_t> trianglePositions(triangleCount * 3);
+
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+    {
+        uint32_t vertex = triangles[i];
+        if (vertexPositions[vertex] == UINT32_MAX)
+        {
+            const Vec3& p = vertices[vertex].pos;
+            auto inserted = positionMap.insert({ { p.x, p.y, p.z }, (uint32_t)positions.size() });
+            if (inserted.second)
+                positions.push_back(p);
+            vertexPositions[vertex] = inserted.first->second;
+        }
+        trianglePositions[i] = vertexPositions[vertex];
+    }
+
+    uint32_t positionCount = (uint32_t)positions.size();
+
+    std::vector<std::vector<uint32_t>> positionTriangles(positionCount);
+    std::vector<uint8_t> dead(triangleCount, 0);
+    uint32_t liveTriangles = triangleCount;
+
+    // the face planes and, added below, the border and seam planes, what orders the collapses
+    std::vector<Quadric> quadrics(positionCount, Quadric {});
+
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        const uint32_t* p = trianglePositions.data() + t * 3;
+        if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2])
+        {
+            dead[t] = 1;
+            liveTriangles--;
+            continue;
+        }
+
+        for (uint32_t k = 0; k < 3; k++)
+            positionTriangles[p[k]].push_back(t);
+
+        // every face pulls its corners towards its plane, bigger faces more
+        Vec3 normal = Cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+        float length = Length(normal);
+        if (length == 0.0f)
+            continue;
+
+        normal = normal * (1.0f / length);
+        float d = -Dot(normal, positions[p[0]]);
+        double area = 0.5 * length;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            AddPlane(quadrics[p[k]], normal, d, area);
+            quadrics[p[k]].weight += area;
+        }
+    }
+
+    // edges with one face are borders, edges whose two faces disagree on the attributes at either end are uv seams
+    // or hard edges. both get a plane through the edge standing on the face so their vertices stay on the line
+    std::vector<uint8_t> border(positionCount, 0);
+    std::vector<uint8_t> seam(positionCount, 0);
+
+    auto addEdgePlane = [&](uint32_t a, uint32_t b, uint32_t triangle)
+    {
+        const uint32_t* p = trianglePositions.data() + triangle * 3;
+        Vec3 faceNormal = Cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+        Vec3 edge = positions[b] - positions[a];
+        Vec3 normal = Cross(edge, faceNormal);
+        float length = Length(normal);
+        if (length == 0.0f)
+            return;
+
+        normal = normal * (1.0f / length);
+        float d = -Dot(normal, positions[a]);
+        double weight = LOD_BORDER_WEIGHT * Dot(edge, edge);
+        AddPlane(quadrics[a], normal, d, weight);
+        AddPlane(quadrics[b], normal, d, weight);
+    };
+
+    auto sameAttributes = [&](uint32_t a, uint32_t b)
+    {
+        return a == b || GetAttributeDistance(vertices[a], vertices[b]) <= LOD_ATTRIBUTE_TOLERANCE;
+    };
+
+    {
+        struct EdgeUse
+        {
+            uint32_t triangle;
+            uint32_t corner; // the edge runs from this corner to the next
+            uint32_t count;
+        };
+
+        std::unordered_map<uint64_t, EdgeUse> edges;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (dead[t])
+                continue;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = trianglePositions[t * 3 + k], b = trianglePositions[t * 3 + (k + 1) % 3];
+                uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+                auto inserted = edges.insert({ key, { t, k, 0 } });
+                EdgeUse& use = inserted.first->second;
+                use.count++;
+
+                if (inserted.second)
+                    continue;
+
+                // the second face winds the edge the other way, its wedges are compared end by end
+                uint32_t va = triangles[t * 3 + k], vb = triangles[t * 3 + (k + 1) % 3];
+                uint32_t ua = triangles[use.triangle * 3 + use.corner], ub = triangles[use.triangle * 3 + (use.corner + 1) % 3];
+                bool reversed = trianglePositions[use.triangle * 3 + use.corner] == b;
+                if (reversed ? sameAttributes(va, ub) && sameAttributes(vb, ua) : sameAttributes(va, ua) && sameAttributes(vb, ub))
+                    continue;
+
+                seam[a] = 1;
+                seam[b] = 1;
+                addEdgePlane(a, b, t);
+                addEdgePlane(a, b, use.triangle);
+            }
+        }
+
+        for (const auto& entry : edges)
+        {
+            const EdgeUse& use = entry.second;
+            if (use.count != 1)
+                continue;
+
+            uint32_t a = trianglePositions[use.triangle * 3 + use.corner], b = trianglePositions[use.triangle * 3 + (use.corner + 1) % 3];
+            border[a] = 1;
+            border[b] = 1;
+            addEdgePlane(a, b, use.triangle);
+        }
+    }
+
+    // area weighted rms distance to the planes of both, only good for ordering the collapses. what the level reports
+    // is measured on the result below
+    auto collapseError = [&](uint32_t from, uint32_t to)
+    {
+        Quadric q = quadrics[from];
+        AddQuadric(q, quadrics[to]);
+        double error = EvaluateQuadric(q, positions[to]);
+        return q.weight > 0.0 ? (float)sqrt(error / q.weight) : 0.0f;
+    };
+
+    std::vector<uint32_t> stamp(positionCount, UINT32_MAX);
+    std::vector<uint32_t> locked(positionCount, UINT32_MAX);
+    std::vector<uint32_t> collapsedTo(positionCount); // a position itself until it is collapsed
+    for (uint32_t i = 0; i < positionCount; i++)
+        collapsedTo[i] = i;
+    std::vector<uint32_t> wedgeFrom, wedgeTo; // the wedge of to that each wedge of from met across the edge
+    std::vector<uint32_t> shared;
+    std::vector<uint32_t> faceWedges;         // the new wedge of from's corner in every face it keeps
+    uint32_t stampId = 0;
+
+    // checks a collapse and does it when nothing breaks: a border position only moves along the border and, unless
+    // relaxed, a seam position only along the seam. the neighbourhood has to stay a disc and no face may flip.
+    // a wedge of from becomes the wedge of to it meets across the edge, or one with the same attributes, relaxed
+    // collapses fall back to the closest attributes when there is none
+    auto tryCollapse = [&](uint32_t from, uint32_t to, uint32_t pass, bool relaxed)
+    {
+        std::vector<uint32_t>& fromTriangles = positionTriangles[from];
+
+        uint32_t edgeTriangles = 0;
+        bool seamEdge = false;
+        wedgeFrom.clear();
+        wedgeTo.clear();
+        shared.clear();
+
+        for (uint32_t t : fromTriangles)
+        {
+            if (dead[t])
+                continue;
+
+            const uint32_t* p = trianglePositions.data() + t * 3;
+            uint32_t corner = p[0] == from ? 0 : p[1] == from ? 1 : 2;
+            uint32_t other = p[0] == to ? 0 : p[1] == to ? 1 : p[2] == to ? 2 : 3;
+            if (other == 3)
+                continue;
+
+            edgeTriangles++;
+            shared.push_back(p[3 - corner - other]);
+
+            uint32_t wedge = triangles[t * 3 + corner];
+            uint32_t target = triangles[t * 3 + other];
+            if (!wedgeFrom.empty())
+                seamEdge |= !sameAttributes(wedgeFrom[0], wedge) || !sameAttributes(wedgeTo[0], target);
+
+            wedgeFrom.push_back(wedge);
+            wedgeTo.push_back(target);
+        }
+
+        if (edgeTriangles == 0 || (border[from] && (edgeTriangles != 1 || !border[to])))
+            return false;
+
+        if (!relaxed && seam[from] && !border[from] && (!seamEdge || !seam[to]))
+            return false;
+
+        // every position around both that is not across one of the edge's faces would end up with a doubled edge
+        stampId++;
+        for (uint32_t t : positionTriangles[to])
+        {
+            if (dead[t])
+                continue;
+            for (uint32_t k = 0; k < 3; k++)
+                stamp[trianglePositions[t * 3 + k]] = stampId;
+        }
+
+        faceWedges.clear();
+        for (uint32_t t : fromTriangles)
+        {
+            if (dead[t])
+                continue;
+
+            const uint32_t* p = trianglePositions.data() + t * 3;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t q = p[k];
+                if (q == from || q == to || stamp[q] != stampId)
+                    continue;
+                if (std::find(shared.begin(), shared.end(), q) == shared.end())
+                    return false;
+            }
+
+            if (p[0] == to || p[1] == to || p[2] == to)
+                continue;
+
+            uint32_t corner = p[0] == from ? 0 : p[1] == from ? 1 : 2;
+            uint32_t wedge = triangles[t * 3 + corner];
+
+            uint32_t best = UINT32_MAX;
+            float bestDistance = FLT_MAX;
+            for (uint32_t w = 0; w < wedgeFrom.size(); w++)
+            {
+                float distance = wedgeFrom[w] == wedge ? -1.0f : GetAttributeDistance(vertices[wedge], vertices[wedgeTo[w]]);
+                if (distance < bestDistance)
+                {
+                    best = w;
+                    bestDistance = distance;
+                }
+            }
+
+            if (!relaxed && bestDistance > LOD_ATTRIBUTE_TOLERANCE)
+                return false;
+
+            faceWedges.push_back(wedgeTo[best]);
+
+            Vec3 a = positions[p[0]], b = positions[p[1]], c = positions[p[2]];
+            Vec3 before = Cross(b - a, c - a);
+            (corner == 0 ? a : corner == 1 ? b : c) = positions[to];
+            Vec3 after = Cross(b - a, c - a);
+            if (Dot(before, after) <= LOD_FLIP_COSINE * Length(before) * Length(after))
+                return false;
+        }
+
+        // faces on the edge go away, the rest move their corner over to
+        std::vector<uint32_t>& toTriangles = positionTriangles[to];
+        uint32_t kept = 0;
+        for (uint32_t t : fromTriangles)
+        {
+            if (dead[t])
+                continue;
+
+            uint32_t* p = trianglePositions.data() + t * 3;
+            if (p[0] == to || p[1] == to || p[2] == to)
+            {
+                dead[t] = 1;
+                liveTriangles--;
+                continue;
+            }
+
+            uint32_t corner = p[0] == from ? 0 : p[1] == from ? 1 : 2;
+            p[corner] = to;
+            triangles[t * 3 + corner] = faceWedges[kept++];
+            toTriangles.push_back(t);
+
+            for (uint32_t k = 0; k < 3; k++)
+                locked[p[k]] = pass;
+        }
+
+        fromTriangles.clear();
+        AddQuadric(quadrics[to], quadrics[from]);
+        collapsedTo[from] = to;
+        seam[to] |= seam[from];
+        locked[from] = pass;
+        locked[to] = pass;
+        return true;
+    };
+
+    // seams hold until nothing else can go, then they move too with their wedges matched by attributes
+    std::vector<CollapseCandidate> candidates;
+    uint32_t pass = 0;
+    bool relaxed = false;
+    while (liveTriangles > targetTriangles)
+    {
+        // every edge both ways, cheapest first. a collapse changes the faces around it so its neighbours wait for
+        // the next pass, where their errors are taken again
+        candidates.clear();
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            if (dead[t])
+                continue;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = trianglePositions[t * 3 + k], b = trianglePositions[t * 3 + (k + 1) % 3];
+                if (a > b)
+                    continue; // the face across the edge lists it the other way round, borders are looked at below
+
+                candidates.push_back({ a, b, collapseError(a, b) });
+                candidates.push_back({ b, a, collapseError(b, a) });
+            }
+
+            // border edges have no face across them
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = trianglePositions[t * 3 + k], b = trianglePositions[t * 3 + (k + 1) % 3];
+                if (a < b || !border[a] || !border[b])
+                    continue;
+
+                candidates.push_back({ a, b, collapseError(a, b) });
+                candidates.push_back({ b, a, collapseError(b, a) });
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const CollapseCandidate& a, const CollapseCandidate& b)
+        {
+            return a.error < b.error || (a.error == b.error && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        // a collapse takes about two faces, only take as many as are needed so the pass does not overshoot
+        uint32_t collapsesLeft = (liveTriangles - targetTriangles + 1) / 2;
+        uint32_t collapses = 0;
+        for (const CollapseCandidate& candidate : candidates)
+        {
+            if (collapses == collapsesLeft || liveTriangles <= targetTriangles)
+                break;
+
+            if (locked[candidate.from] == pass || locked[candidate.to] == pass)
+                continue;
+
+            if (!tryCollapse(candidate.from, candidate.to, pass, relaxed))
+                continue;
+
+            collapses++;
+        }
+
+        pass++;
+        if (collapses == 0 && relaxed)
+            break;
+
+        relaxed |= collapses == 0;
+    }
+
+    struct KeptTriangle
+    {
+        Vec3 center;
+        float radius; // of the sphere around the corners, nothing in the face is closer to a point than this allows
+        uint32_t triangle;
+    };
+
+    uint32_t outCount = 0;
+    std::vector<KeptTriangle> kept;
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        if (dead[t])
+            continue;
+
+        outIndices[outCount++] = triangles[t * 3 + 0];
+        outIndices[outCount++] = triangles[t * 3 + 1];
+        outIndices[outCount++] = triangles[t * 3 + 2];
+
+        const uint32_t* p = trianglePositions.data() + t * 3;
+        Vec3 center = (positions[p[0]] + positions[p[1]] + positions[p[2]]) * (1.0f / 3.0f);
+        float radius = fmaxf(Length(positions[p[0]] - center), fmaxf(Length(positions[p[1]] - center), Length(positions[p[2]] - center)));
+        kept.push_back({ center, radius, t });
+    }
+
+    // the error is the distance from every source position to the closest kept face, measured rather than summed
+    // over the collapses. the faces around where the position went give a first guess, the spheres skip most others
+    for (uint32_t position = 0; position < positionCount && !kept.empty(); position++)
+    {
+        const Vec3& point = positions[position];
+        auto faceDistance = [&](uint32_t t)
+        {
+            const uint32_t* p = trianglePositions.data() + t * 3;
+            return PointTriangleDistance(point, positions[p[0]], positions[p[1]], positions[p[2]]);
+        };
+
+        uint32_t moved = position;
+        while (collapsedTo[moved] != moved)
+            moved = collapsedTo[moved];
+
+        float distance = FLT_MAX;
+        for (uint32_t t : positionTriangles[moved])
+        {
+            if (!dead[t])
+                distance = fminf(distance, faceDistance(t));
+        }
+
+        for (const KeptTriangle& triangle : kept)
+        {
+            if (Length(point - triangle.center) - triangle.radius < distance)
+                distance = fminf(distance, faceDistance(triangle.triangle));
+        }
+
+        outError = fmaxf(outError, distance);
+    }
+
+    return outCount;
+}
+
+// a level that keeps more than this much of the one before is not worth its indices
+constexpr float LOD_MIN_REDUCTION = 0.75f;
+
+void BuildMeshLods(MeshData& data)
+{
+    PROFILE_SCOPE("BuildMeshLods");
+
+    data.lodSubmeshes.clear();
+    data.lodErrors.clear();
+
+    uint32_t submeshCount = (uint32_t)data.submeshes.size();
+    uint32_t vertexCount = (uint32_t)data.vertices.size();
+
+    uint32_t previousTriangles = 0;
+    for (const SubMeshRange& range : data.submeshes)
+        previousTriangles += range.indexCount / 3;
+
+    float previousError = 0.0f;
+    std::vector<uint32_t> levelIndices;
+    std::vector<SubMeshRange> levelSubmeshes(submeshCount);
+
+    for (uint32_t level = 1; level < MAX_MESH_LODS; level++)
+    {
+        // from the full detail indices every time, errors do not pile up through the levels
+        levelIndices.clear();
+        float levelError = previousError;
+        for (uint32_t s = 0; s < submeshCount; s++)
+        {
+            const SubMeshRange& range = data.submeshes[s];
+            uint32_t target = (range.indexCount / 3 >> level) * 3;
+
+            uint32_t offset = (uint32_t)levelIndices.size();
+            levelIndices.resize(offset + range.indexCount);
+
+            float error;
+            uint32_t count = SimplifyIndices(data.vertices.data(), vertexCount, data.indices.data() + range.indexOffset, range.indexCount,
+                target, levelIndices.data() + offset, error);
+            levelIndices.resize(offset + count);
+
+            levelSubmeshes[s] = { offset, count };
+            levelError = fmaxf(levelError, error);
+        }
+
+        uint32_t levelTriangles = (uint32_t)levelIndices.size() / 3;
+        if (levelTriangles == 0 || levelTriangles > previousTriangles * LOD_MIN_REDUCTION)
+            break;
+
+        uint32_t base = (uint32_t)data.indices.size();
+        data.indices.insert(data.indices.end(), levelIndices.begin(), levelIndices.end());
+
+        for (SubMeshRange range : levelSubmeshes)
+        {
+            range.indexOffset += base;
+            OptimizeVertexCache(data.indices.data() + range.indexOffset, range.indexCount, vertexCount);
+            data.lodSubmeshes.push_back(range);
+        }
+
+        // never less than a finer level, the selection walks them in order
+        data.lodErrors.push_back(levelError);
+        previousTriangles = levelTriangles;
+        previousError = levelError;
+    }
+}
+
+MeshLods MakeMeshLods(const MeshView& view)
+{
+    MeshLods lods = {};
+    lods.levelCount = 1 + view.lodCount;
+
+    for (uint32_t level = 0; level < lods.levelCount; level++)
+    {
+        lods.errors[level] = level ? view.lodErrors[level - 1] : 0.0f;
+        for (uint32_t s = 0; s < view.submeshCount; s++)
+            lods.triangles[level] += GetLodSubmesh(view, level, s).indexCount / 3;
+    }
+
+    return lods;
+}
+
+SubMeshRange GetLodSubmesh(const MeshView& view, uint32_t level, uint32_t submesh)
+{
+    if (level == 0)
+        return view.submeshes[submesh];
+
+    return view.lodSubmeshes[(level - 1) * view.submeshCount + submesh];
+}
+
+void SelectMeshLods(JobSystem& jobs, const Vec3& camera, const LodProjection& projection, const MeshBounds* bounds, const MeshLods* lods,
+    uint32_t meshCount, VisibleSet& visible, LodSelection& out)
+{
+    PROFILE_SCOPE("SelectMeshLods");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    out.ranges.assign(meshCount * MAX_MESH_LODS, { 0, 0 });
+    out.stats = {};
+
+    uint32_t instanceCount = (uint32_t)visible.instances.size();
+    out.levels.resize(instanceCount);
+
+    // an error of e at distance d covers e * pixelsPerUnit / d pixels
+    float pixelsPerUnit = projection.viewHeight / (2.0f * tanf(projection.fovY * 0.5f));
+
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        const InstanceRange& range = visible.ranges[mesh];
+        const MeshLods& meshLods = lods[mesh];
+        if (range.count == 0)
+            continue;
+
+        if (meshLods.levelCount == 1)
+        {
+            memset(out.levels.data() + range.first, 0, range.count);
+            continue;
+        }
+
+        const Vec3& c = bounds[mesh].bounds.center;
+        float radius = bounds[mesh].bounds.radius;
+
+        ParallelFor(jobs, range.count, 256, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = range.first + begin; i < range.first + end; i++)
+            {
+                const float (*m)[4] = visible.instances[i].model.m;
+
+                Vec3 center =
+                {
+                    c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0],
+                    c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1],
+                    c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2],
+                };
+
+                float scale = 0.0f;
+                for (uint32_t row = 0; row < 3; row++)
+                    scale = fmaxf(scale, m[row][0] * m[row][0] + m[row][1] * m[row][1] + m[row][2] * m[row][2]);
+                scale = sqrtf(scale);
+
+                float distance = fmaxf(Length(center - camera) - radius * scale, projection.nearZ);
+                float allowed = projection.pixelError * distance / (pixelsPerUnit * scale);
+
+                uint32_t level = 0;
+                while (level + 1 < meshLods.levelCount && meshLods.errors[level + 1] <= allowed)
+                    level++;
+
+                out.levels[i] = (uint8_t)level;
+            }
+        });
+    }
+
+    // stable counting sort of every mesh's instances by level, they stay grouped by mesh
+    out.sorted.resize(instanceCount);
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        const InstanceRange& range = visible.ranges[mesh];
+        InstanceRange* levelRanges = out.ranges.data() + mesh * MAX_MESH_LODS;
+        if (range.count == 0)
+            continue;
+
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+            levelRanges[out.levels[i]].count++;
+
+        uint32_t first = range.first;
+        for (uint32_t level = 0; level < MAX_MESH_LODS; level++)
+        {
+            levelRanges[level].first = first;
+            first += levelRanges[level].count;
+            out.stats.instances[level] += levelRanges[level].count;
+        }
+
+        if (levelRanges[0].count == range.count)
+            continue;
+
+        uint32_t cursors[MAX_MESH_LODS];
+        for (uint32_t level = 0; level < MAX_MESH_LODS; level++)
+            cursors[level] = levelRanges[level].first;
+
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+            out.sorted[cursors[out.levels[i]]++] = visible.instances[i];
+
+        memcpy(visible.instances.data() + range.first, out.sorted.data() + range.first, sizeof(InstanceData) * range.count);
+    }
+
+    out.stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void RunLodBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<LodBenchmarkCase>& outCases)
+{
+    // source vertices checked against every level, brute force against every triangle of it
+    constexpr uint32_t SAMPLE_COUNT = 2000;
+
+    outCases.clear();
+
+    for (const std::string& meshPath : meshPaths)
+    {
+        MeshData mesh;
+        Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+        if (!LoadMeshData(jobs, meshPath, scratch, mesh))
+            continue;
+
+        OptimizeMesh(mesh, true);
+
+        LodBenchmarkCase& bench = outCases.emplace_back();
+        bench.path = meshPath;
+
+        double best = 1e30;
+        MeshData built;
+        for (uint32_t run = 0; run < 5; run++)
+        {
+            built = mesh;
+
+            auto start = std::chrono::high_resolution_clock::now();
+            BuildMeshLods(built);
+            auto end = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            best = ms < best ? ms : best;
+        }
+        bench.ms = best;
+
+        MeshView view = MakeMeshView(built);
+        MeshLods lods = MakeMeshLods(view);
+
+        MeshBounds bounds;
+        MakeMeshBounds(view, bounds);
+        bench.radius = bounds.bounds.radius;
+
+        for (uint32_t level = 0; level < lods.levelCount; level++)
+        {
+            LodBenchmarkLevel& result = bench.levels.emplace_back();
+            result.triangles = lods.triangles[level];
+            result.error = lods.errors[level];
+            result.measuredError = 0.0f;
+
+            if (level == 0)
+                continue;
+
+            // a submesh's vertices against the same submesh's level, they are simplified on their own
+            for (uint32_t s = 0; s < view.submeshCount; s++)
+            {
+                SubMeshRange source = view.submeshes[s];
+                SubMeshRange simplified = GetLodSubmesh(view, level, s);
+                if (simplified.indexCount == 0)
+                    continue;
+
+                const uint32_t* levelIndices = view.indices + simplified.indexOffset;
+                uint32_t step = source.indexCount / SAMPLE_COUNT + 1;
+                for (uint32_t i = 0; i < source.indexCount; i += step)
+                {
+                    const Vec3& p = view.vertices[view.indices[source.indexOffset + i]].pos;
+
+                    float distance = 1e30f;
+                    for (uint32_t t = 0; t < simplified.indexCount; t += 3)
+                    {
+                        const Vec3& a = view.vertices[levelIndices[t + 0]].pos;
+                        const Vec3& b = view.vertices[levelIndices[t + 1]].pos;
+                        const Vec3& c = view.vertices[levelIndices[t + 2]].pos;
+                        distance = fminf(distance, PointTriangleDistance(p, a, b, c));
+                    }
+
+                    result.measuredError = fmaxf(result.measuredError, distance);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "culling.h"
+
+#include <string>
+#include <vector>
+
+// levels of detail: at cook time every submesh is simplified by quadric error edge collapses (Garland, Heckbert 1997)
+// into a few coarser index ranges over the same vertices, each with the error it was allowed. per frame every visible
+// instance picks the coarsest level whose error, projected to the screen, stays under a pixel budget
+
+// simplifies the triangles of one index range down to targetIndexCount or fewer, every collapse moves a vertex onto a
+// neighbour so the vertices are shared with the source. borders only collapse along themselves, uv seams and hard edges
+// too until nothing else is left to collapse. writes the indices kept, returns their count, outError is the largest
+// distance from a source vertex to the kept faces, measured on the result. the selection takes it as a bound
+uint32_t SimplifyIndices(const MeshVertex* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+    uint32_t targetIndexCount, uint32_t* outIndices, float& outError);
+
+// appends up to MAX_MESH_LODS - 1 levels to data, each aiming for half the triangles of the one before and simplified
+// from the full detail submeshes. run on full vertices before PackMeshVertices
+void BuildMeshLods(MeshData& data);
+
+// what the per frame selection needs of a mesh
+struct MeshLods
+{
+    uint32_t levelCount;                // with the full detail level
+    float errors[MAX_MESH_LODS];        // object space, 0 at level 0
+    uint32_t triangles[MAX_MESH_LODS];  // of every submesh together
+};
+
+MeshLods MakeMeshLods(const MeshView& view);
+
+// index range of one submesh at one level, level 0 is view.submeshes
+SubMeshRange GetLodSubmesh(const MeshView& view, uint32_t level, uint32_t submesh);
+
+struct LodProjection
+{
+    float fovY;          // radians
+    uint32_t viewHeight; // pixels
+    float nearZ;
+    float pixelError;    // largest error a level may show on screen
+};
+
+struct LodStats
+{
+    uint32_t instances[MAX_MESH_LODS] = {}; // visible instances drawn at each level
+    float ms = 0.0f;
+};
+
+struct LodSelection
+{
+    std::vector<InstanceRange> ranges; // per mesh and level, mesh * MAX_MESH_LODS + level, into VisibleSet::instances
+    LodStats stats;
+
+    // scratch kept between frames
+    std::vector<uint8_t> levels;       // per visible instance
+    std::vector<InstanceData> sorted;
+};
+
+// sorts the visible instances of every mesh by level, after CullScene. the distance is taken to the nearest point of
+// the instance's bounding sphere and the error scaled by its largest axis scale, split across the job system
+void SelectMeshLods(JobSystem& jobs, const Vec3& camera, const LodProjection& projection, const MeshBounds* bounds, const MeshLods* lods,
+    uint32_t meshCount, VisibleSet& visible, LodSelection& out);
+
+struct LodBenchmarkLevel
+{
+    uint32_t triangles;
+    float error;         // what the simplifier reports
+    float measuredError; // farthest sampled source vertex from the level's surface, never above error
+};
+
+struct LodBenchmarkCase
+{
+    std::string path;
+    float radius; // of the bounds, for scale
+    double ms;    // BuildMeshLods
+    std::vector<LodBenchmarkLevel> levels;
+};
+
+void RunLodBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<LodBenchmarkCase>& outCases);
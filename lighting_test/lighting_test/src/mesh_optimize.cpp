@@ -0,0 +1,303 @@
+#include "mesh_optimize.h"
+
+#include <math.h>
+#include <algorithm>
+
+VertexCacheStats ComputeVertexCacheStats(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats = {};
+    if (indexCount == 0 || vertexCount == 0)
+        return stats;
+
+    // a vertex is in the fifo while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t misses = 0;
+
+    for (uint32_t i = 0; i < indexCount; i++)
+    {
+        uint32_t v = indices[i];
+        if (timestamp - cacheTime[v] > cacheSize)
+        {
+            cacheTime[v] = timestamp++;
+            misses++;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)vertexCount;
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+{
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // vertex -> triangles adjacency in compressed rows
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t i = 0; i < indexCount; i++)
+        liveTriangles[indices[i]]++;
+
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; t++)
+        for (uint32_t k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+
+    uint32_t timestamp = cacheSize + 1;
+    uint32_t cursor = 0;
+
+    // start from the first vertex that is actually used in this range
+    int64_t fanning = indices[0];
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+
+        for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+        {
+            uint32_t t = adjacency[a];
+            if (emitted[t])
+                continue;
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+
+                if (timestamp - cacheTime[v] > cacheSize)
+                    cacheTime[v] = timestamp++;
+            }
+
+            emitted[t] = true;
+        }
+
+        // next fanning vertex: the candidate that stays in cache for all its remaining triangles and is oldest
+        int64_t best = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+
+            int64_t priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                priority = timestamp - cacheTime[v];
+
+            if (priority > bestPriority)
+            {
+                best = v;
+                bestPriority = priority;
+            }
+        }
+
+        if (best == -1)
+        {
+            // dead end, go back through recently used vertices, then scan for anything left
+            while (!deadEnd.empty() && best == -1)
+            {
+                uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0)
+                    best = v;
+            }
+
+            while (best == -1 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                    best = cursor;
+                cursor++;
+            }
+        }
+
+        fanning = best;
+    }
+
+    // tipsify is a heuristic, an input already in a good order can come out worse and then stays as it was
+    float before = ComputeVertexCacheStats(indices, indexCount, vertexCount, cacheSize).acmr;
+    float after = ComputeVertexCacheStats(output.data(), indexCount, vertexCount, cacheSize).acmr;
+    if (after <= before)
+        std::copy(output.begin(), output.end(), indices);
+}
+
+void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const MeshVertex* vertices, uint32_t vertexCount, uint32_t cacheSize)
+{
+    uint32_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    // a triangle missing the cache on all three vertices starts a new cluster, reordering
+    // whole clusters keeps the acmr of the tipsify pass almost untouched
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+
+    for (uint32_t t = 0; t < triangleCount; t++)
+    {
+        uint32_t misses = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[t * 3 + k];
+            if (timestamp - cacheTime[v] > cacheSize)
+            {
+                cacheTime[v] = timestamp++;
+                misses++;
+            }
+        }
+
+        if (t == 0 || misses == 3)
+            clusterStarts.push_back(t);
+    }
+
+    uint32_t clusterCount = (uint32_t)clusterStarts.size();
+    clusterStarts.push_back(triangleCount);
+
+    if (clusterCount < 2)
+        return;
+
+    // area weighted centroids and normals
+    Vec3 meshCentroid = {};
+    float meshArea = 0.0f;
+
+    std::vector<Vec3> clusterCentroids(clusterCount);
+    std::vector<Vec3> clusterNormals(clusterCount);
+
+    for (uint32_t c = 0; c < clusterCount; c++)
+    {
+        Vec3 centroid = {};
+        Vec3 normal = {};
+        float area = 0.0f;
+
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const Vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const Vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const Vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            Vec3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+            Vec3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+            Vec3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+
+            float triangleArea = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z) * 0.5f;
+
+            centroid.x += (p0.x + p1.x + p2.x) / 3.0f * triangleArea;
+            centroid.y += (p0.y + p1.y + p2.y) / 3.0f * triangleArea;
+            centroid.z += (p0.z + p1.z + p2.z) / 3.0f * triangleArea;
+
+            normal.x += n.x;
+            normal.y += n.y;
+            normal.z += n.z;
+
+            area += triangleArea;
+        }
+
+        meshCentroid.x += centroid.x;
+        meshCentroid.y += centroid.y;
+        meshCentroid.z += centroid.z;
+        meshArea += area;
+
+        float inverseArea = area > 0.0f ? 1.0f / area : 0.0f;
+        clusterCentroids[c] = { centroid.x * inverseArea, centroid.y * inverseArea, centroid.z * inverseArea };
+
+        float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        float inverseLength = length > 0.0f ? 1.0f / length : 0.0f;
+        clusterNormals[c] = { normal.x * inverseLength, normal.y * inverseLength, normal.z * inverseLength };
+    }
+
+    if (meshArea > 0.0f)
+    {
+        meshCentroid.x /= meshArea;
+        meshCentroid.y /= meshArea;
+        meshCentroid.z /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clusterCount);
+    std::vector<uint32_t> order(clusterCount);
+    for (uint32_t c = 0; c < clusterCount; c++)
+    {
+        const Vec3& centroid = clusterCentroids[c];
+        const Vec3& normal = clusterNormals[c];
+        sortKeys[c] = (centroid.x - meshCentroid.x) * normal.x + (centroid.y - meshCentroid.y) * normal.y + (centroid.z - meshCentroid.z) * normal.z;
+        order[c] = c;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(indexCount);
+    for (uint32_t c : order)
+        sorted.insert(sorted.end(), indices + clusterStarts[c] * 3, indices + clusterStarts[c + 1] * 3);
+
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t UNUSED = ~0u;
+
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    std::vector<MeshVertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (uint32_t& index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+}
+
+void OptimizeMesh(MeshData& data, bool sortForOverdraw)
+{
+    uint32_t vertexCount = (uint32_t)data.vertices.size();
+
+    VertexCacheStats before = ComputeVertexCacheStats(data.indices.data(), (uint32_t)data.indices.size(), vertexCount);
+
+    std::vector<uint32_t> input;
+    for (const SubMeshRange& range : data.submeshes)
+    {
+        uint32_t* indices = data.indices.data() + range.indexOffset;
+        input.assign(indices, indices + range.indexCount);
+
+        OptimizeVertexCache(indices, range.indexCount, vertexCount);
+
+        if (sortForOverdraw)
+            OptimizeOverdraw(indices, range.indexCount, data.vertices.data(), vertexCount);
+
+        // the overdraw sort gives a little back, when that loses to the input order the submesh keeps it
+        if (ComputeVertexCacheStats(indices, range.indexCount, vertexCount).acmr > ComputeVertexCacheStats(input.data(), range.indexCount, vertexCount).acmr)
+            std::copy(input.begin(), input.end(), indices);
+    }
+
+    OptimizeVertexFetch(data.vertices, data.indices);
+
+    VertexCacheStats after = ComputeVertexCacheStats(data.indices.data(), (uint32_t)data.indices.size(), (uint32_t)data.vertices.size());
+
+    data.stats.vertexCount = (uint32_t)data.vertices.size();
+    data.stats.acmrBefore = before.acmr;
+    data.stats.atvrBefore = before.atvr;
+    data.stats.acmrOptimized = data.stats.acmrAfter = after.acmr;
+    data.stats.atvrOptimized = data.stats.atvrAfter = after.atvr;
+}
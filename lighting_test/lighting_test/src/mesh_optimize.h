@@ -0,0 +1,29 @@
+#pragma once
+
+#include "mesh.h"
+
+// fifo post transform cache size used to optimize for and to measure with
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats
+{
+    float acmr; // average cache miss ratio, transformed vertices per triangle
+    float atvr; // average transform to vertex ratio, 1.0 is optimal
+};
+
+VertexCacheStats ComputeVertexCacheStats(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// tipsify (Sander, Nehab, Barczak 2007), reorders the triangles of one index range in place. keeps the input order
+// when that has the lower acmr
+void OptimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// splits an already cache optimized range into clusters at cache flush boundaries and sorts them
+// so outward facing clusters far from the center are drawn first, cheap view independent early z
+void OptimizeOverdraw(uint32_t* indices, uint32_t indexCount, const MeshVertex* vertices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// reorders the vertex buffer in first use order and remaps the indices, drops unused vertices
+void OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices);
+
+// all of the above per submesh, a submesh whose acmr would go up keeps its input order. fills the acmr/atvr fields of
+// data.stats
+void OptimizeMesh(MeshData& data, bool sortForOverdraw);
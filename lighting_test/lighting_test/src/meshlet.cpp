@@ -0,0 +1,822 @@
+#include "meshlet.h"
+#include "mesh_optimize.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+static Vec3 GetVertexPosition(const MeshView& view, uint32_t index)
+{
+    if (view.vertexFormat == VertexFormat::Packed)
+        return UnpackVertex(view.packedVertices[index], view.quantization).pos;
+
+    return view.vertices[index].pos;
+}
+
+// sphere and normal cone of one meshlet, written to slot i of the arrays
+static bool ComputeMeshletBounds(const Vec3* positions, const uint32_t* indices, const Meshlet& meshlet, MeshletData& data, uint32_t i)
+{
+    const uint32_t* meshletIndices = indices + meshlet.indexOffset;
+    uint32_t indexCount = meshlet.triangleCount * 3;
+
+    Vec3 min = positions[meshletIndices[0]];
+    Vec3 max = min;
+    for (uint32_t j = 1; j < indexCount; j++)
+    {
+        const Vec3& p = positions[meshletIndices[j]];
+        min = { fminf(min.x, p.x), fminf(min.y, p.y), fminf(min.z, p.z) };
+        max = { fmaxf(max.x, p.x), fmaxf(max.y, p.y), fmaxf(max.z, p.z) };
+    }
+
+    Vec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t j = 0; j < indexCount; j++)
+        radius = fmaxf(radius, Length(positions[meshletIndices[j]] - center));
+
+    data.centerX[i] = center.x;
+    data.centerY[i] = center.y;
+    data.centerZ[i] = center.z;
+    data.radius[i] = radius;
+
+    // front faces wind clockwise on screen, so their cross(b - a, c - a) points at the camera. degenerate
+    // triangles are never rasterized and do not widen the cone
+    Vec3 normals[MESHLET_MAX_TRIANGLES];
+    uint32_t normalCount = 0;
+    Vec3 sum = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+    {
+        const Vec3& a = positions[meshletIndices[t * 3 + 0]];
+        const Vec3& b = positions[meshletIndices[t * 3 + 1]];
+        const Vec3& c = positions[meshletIndices[t * 3 + 2]];
+
+        Vec3 normal = Cross(b - a, c - a);
+        float length = Length(normal);
+        if (length == 0.0f)
+            continue;
+
+        normals[normalCount] = normal * (1.0f / length);
+        sum = sum + normals[normalCount];
+        normalCount++;
+    }
+
+    data.coneX[i] = 0.0f;
+    data.coneY[i] = 0.0f;
+    data.coneZ[i] = 0.0f;
+    data.coneCutoff[i] = 1.0f;
+
+    float sumLength = Length(sum);
+    if (normalCount == 0 || sumLength < 1e-6f)
+        return false;
+
+    Vec3 axis = sum * (1.0f / sumLength);
+    float minDot = 1.0f;
+    for (uint32_t t = 0; t < normalCount; t++)
+        minDot = fminf(minDot, Dot(normals[t], axis));
+
+    // a cone this wide could only cull from right behind the meshlet
+    if (minDot <= 0.1f)
+        return false;
+
+    data.coneX[i] = axis.x;
+    data.coneY[i] = axis.y;
+    data.coneZ[i] = axis.z;
+    data.coneCutoff[i] = sqrtf(1.0f - minDot * minDot); // sine of the cone's half angle
+    return true;
+}
+
+// weight of a candidate's normal against its distance when growing a meshlet, normals count more because a
+// meshlet that wraps around the mesh never faces away as a whole
+constexpr float MESHLET_NORMAL_WEIGHT = 8.0f;
+
+// exact positions, vertices split only by normal or uv still count as neighbours
+struct PositionKey
+{
+    float x, y, z;
+    bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct PositionKeyHash
+{
+    size_t operator()(const PositionKey& key) const
+    {
+        uint32_t bits[3];
+        memcpy(bits, &key, sizeof(bits));
+        return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+    }
+};
+
+// triangles of one submesh grown into meshlets: each one starts from the first triangle left in index order and
+// takes the neighbour that adds the fewest vertices, then the one closest to its center and its average normal.
+// inside a meshlet the triangles keep their index order, so what OptimizeMesh did for the vertex cache mostly stays
+static void BuildSubmeshMeshlets(const Vec3* positions, const uint32_t* positionIds, const uint32_t* adjacencyOffsets, const uint32_t* adjacency,
+    const uint32_t* indices, const SubMeshRange& range, uint32_t submesh, std::vector<uint32_t>& vertexMeshlet, std::vector<uint32_t>& triangleStamp,
+    MeshletData& outData)
+{
+    uint32_t firstTriangle = range.indexOffset / 3;
+    uint32_t triangleCount = range.indexCount / 3;
+
+    std::vector<uint8_t> used(triangleCount, 0);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> meshletTriangles;
+
+    auto getCentroid = [&](uint32_t t)
+    {
+        const uint32_t* triangle = indices + t * 3;
+        return (positions[triangle[0]] + positions[triangle[1]] + positions[triangle[2]]) * (1.0f / 3.0f);
+    };
+
+    auto getNormal = [&](uint32_t t)
+    {
+        const uint32_t* triangle = indices + t * 3;
+        Vec3 normal = Cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+        float length = Length(normal);
+        return length > 0.0f ? normal * (1.0f / length) : normal;
+    };
+
+    uint32_t cursor = 0;
+    uint32_t emitted = 0;
+    while (emitted < triangleCount)
+    {
+        while (used[cursor])
+            cursor++;
+
+        uint32_t meshletId = (uint32_t)outData.meshlets.size();
+        Meshlet meshlet = { range.indexOffset + emitted * 3, 0, 0, submesh };
+        Vec3 centroidSum = { 0.0f, 0.0f, 0.0f };
+        Vec3 normalSum = { 0.0f, 0.0f, 0.0f };
+
+        candidates.clear();
+        meshletTriangles.clear();
+
+        auto countNewVertices = [&](uint32_t t)
+        {
+            const uint32_t* triangle = indices + t * 3;
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                bool seen = vertexMeshlet[triangle[k]] == meshletId;
+                for (uint32_t j = 0; j < k; j++)
+                    seen |= triangle[j] == triangle[k];
+                count += seen ? 0 : 1;
+            }
+            return count;
+        };
+
+        uint32_t next = firstTriangle + cursor;
+        while (next != UINT32_MAX)
+        {
+            meshlet.vertexCount += countNewVertices(next);
+            meshlet.triangleCount++;
+
+            used[next - firstTriangle] = 1;
+            meshletTriangles.push_back(next);
+            centroidSum = centroidSum + getCentroid(next);
+            normalSum = normalSum + getNormal(next);
+
+            // everything sharing a position with the new triangle becomes a candidate, once per meshlet
+            const uint32_t* triangle = indices + next * 3;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                vertexMeshlet[triangle[k]] = meshletId;
+
+                uint32_t id = positionIds[triangle[k]];
+                for (uint32_t a = adjacencyOffsets[id]; a < adjacencyOffsets[id + 1]; a++)
+                {
+                    uint32_t neighbour = adjacency[a];
+                    if (neighbour < firstTriangle || neighbour >= firstTriangle + triangleCount || used[neighbour - firstTriangle] || triangleStamp[neighbour] == meshletId)
+                        continue;
+
+                    triangleStamp[neighbour] = meshletId;
+                    candidates.push_back(neighbour);
+                }
+            }
+
+            if (meshlet.triangleCount == MESHLET_MAX_TRIANGLES)
+                break;
+
+            Vec3 center = centroidSum * (1.0f / meshlet.triangleCount);
+            float normalLength = Length(normalSum);
+            Vec3 axis = normalLength > 0.0f ? normalSum * (1.0f / normalLength) : normalSum;
+
+            // the meshlet's spread so far puts distances on the same scale as the normal term
+            float spread = 0.0f;
+            for (uint32_t t : meshletTriangles)
+                spread = fmaxf(spread, Length(getCentroid(t) - center));
+            float invSpread = spread > 0.0f ? 1.0f / spread : 1.0f;
+
+            next = UINT32_MAX;
+            uint32_t bestNew = UINT32_MAX;
+            float bestScore = 0.0f;
+            for (uint32_t i = 0; i < candidates.size();)
+            {
+                uint32_t candidate = candidates[i];
+                if (used[candidate - firstTriangle])
+                {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                i++;
+
+                uint32_t newVertices = countNewVertices(candidate);
+                if (meshlet.vertexCount + newVertices > MESHLET_MAX_VERTICES || newVertices > bestNew)
+                    continue;
+
+                float score = Length(getCentroid(candidate) - center) * invSpread + MESHLET_NORMAL_WEIGHT * (1.0f - Dot(getNormal(candidate), axis));
+                if (newVertices < bestNew || score < bestScore)
+                {
+                    next = candidate;
+                    bestNew = newVertices;
+                    bestScore = score;
+                }
+            }
+
+            // nothing connected is left, carry on with the next triangle in index order if it fits
+            if (next == UINT32_MAX)
+            {
+                while (cursor < triangleCount && used[cursor])
+                    cursor++;
+
+                if (cursor < triangleCount && meshlet.vertexCount + countNewVertices(firstTriangle + cursor) <= MESHLET_MAX_VERTICES)
+                    next = firstTriangle + cursor;
+            }
+        }
+
+        std::sort(meshletTriangles.begin(), meshletTriangles.end());
+        for (uint32_t i = 0; i < meshletTriangles.size(); i++)
+            memcpy(outData.indices.data() + meshlet.indexOffset + i * 3, indices + meshletTriangles[i] * 3, sizeof(uint32_t) * 3);
+
+        outData.meshlets.push_back(meshlet);
+        emitted += meshlet.triangleCount;
+    }
+}
+
+void BuildMeshlets(const MeshView& view, MeshletData& outData)
+{
+    PROFILE_SCOPE("BuildMeshlets");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<Vec3> positions(view.vertexCount);
+    std::vector<uint32_t> positionIds(view.vertexCount);
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> positionMap;
+    for (uint32_t i = 0; i < view.vertexCount; i++)
+    {
+        positions[i] = GetVertexPosition(view, i);
+        auto inserted = positionMap.insert({ { positions[i].x, positions[i].y, positions[i].z }, (uint32_t)positionMap.size() });
+        positionIds[i] = inserted.first->second;
+    }
+
+    // triangles around every position, counted then filled. only the full detail level is cut into meshlets, coarser
+    // levels of detail follow it in the index buffer
+    uint32_t triangleCount = 0;
+    for (uint32_t s = 0; s < view.submeshCount; s++)
+        triangleCount = std::max(triangleCount, (view.submeshes[s].indexOffset + view.submeshes[s].indexCount) / 3);
+
+    std::vector<uint32_t> adjacencyOffsets(positionMap.size() + 1, 0);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+        adjacencyOffsets[positionIds[view.indices[i]] + 1]++;
+    for (uint32_t i = 1; i < adjacencyOffsets.size(); i++)
+        adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t i = 0; i < triangleCount * 3; i++)
+        adjacency[fill[positionIds[view.indices[i]]]++] = i / 3;
+
+    outData.meshlets.clear();
+    outData.submeshMeshlets.clear();
+    outData.indices.assign(view.indices, view.indices + view.indexCount);
+
+    // meshlet that last took each vertex and last listed each triangle, nothing needs clearing between meshlets
+    std::vector<uint32_t> vertexMeshlet(view.vertexCount, UINT32_MAX);
+    std::vector<uint32_t> triangleStamp(triangleCount, UINT32_MAX);
+
+    for (uint32_t s = 0; s < view.submeshCount; s++)
+    {
+        outData.submeshMeshlets.push_back((uint32_t)outData.meshlets.size());
+        BuildSubmeshMeshlets(positions.data(), positionIds.data(), adjacencyOffsets.data(), adjacency.data(), view.indices, view.submeshes[s], s,
+            vertexMeshlet, triangleStamp, outData);
+    }
+
+    uint32_t meshletCount = (uint32_t)outData.meshlets.size();
+    outData.submeshMeshlets.push_back(meshletCount);
+
+    // padding lanes are tested like the others and ignored afterwards
+    uint32_t paddedCount = (meshletCount + 3) & ~3u;
+    for (std::vector<float>* array : { &outData.centerX, &outData.centerY, &outData.centerZ, &outData.radius, &outData.coneX, &outData.coneY, &outData.coneZ })
+        array->assign(paddedCount, 0.0f);
+    outData.coneCutoff.assign(paddedCount, 1.0f);
+
+    MeshletStats& stats = outData.stats;
+    stats = {};
+    stats.meshletCount = meshletCount;
+
+    uint64_t vertexSum = 0, triangleSum = 0;
+    for (uint32_t i = 0; i < meshletCount; i++)
+    {
+        const Meshlet& meshlet = outData.meshlets[i];
+        if (!ComputeMeshletBounds(positions.data(), outData.indices.data(), meshlet, outData, i))
+            stats.conesDisabled++;
+
+        vertexSum += meshlet.vertexCount;
+        triangleSum += meshlet.triangleCount;
+    }
+
+    stats.averageVertices = meshletCount ? (float)vertexSum / meshletCount : 0.0f;
+    stats.averageTriangles = meshletCount ? (float)triangleSum / meshletCount : 0.0f;
+    stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static std::vector<float>* GetBoundsArrays(MeshletData& data, uint32_t array)
+{
+    std::vector<float>* arrays[MESHLET_BOUNDS_ARRAYS] = { &data.centerX, &data.centerY, &data.centerZ, &data.radius, &data.coneX, &data.coneY,
+        &data.coneZ, &data.coneCutoff };
+    return arrays[array];
+}
+
+void CookMeshlets(MeshData& data)
+{
+    PROFILE_SCOPE("CookMeshlets");
+
+    MeshletData meshlets;
+    BuildMeshlets(MakeMeshView(data), meshlets);
+
+    // only the full detail ranges were regrouped, the levels of detail after them are as they were
+    data.indices = std::move(meshlets.indices);
+    data.meshlets = std::move(meshlets.meshlets);
+    data.submeshMeshlets = std::move(meshlets.submeshMeshlets);
+
+    uint32_t paddedCount = (uint32_t)meshlets.centerX.size();
+    data.meshletBounds.resize((size_t)MESHLET_BOUNDS_ARRAYS * paddedCount);
+    for (uint32_t array = 0; array < MESHLET_BOUNDS_ARRAYS; array++)
+    {
+        const std::vector<float>& values = *GetBoundsArrays(meshlets, array);
+        memcpy(data.meshletBounds.data() + (size_t)array * paddedCount, values.data(), paddedCount * sizeof(float));
+    }
+
+    // the cache stats shown for the mesh are the ones of the order it is drawn in
+    uint32_t fullDetailCount = 0;
+    for (const SubMeshRange& range : data.submeshes)
+        fullDetailCount = std::max(fullDetailCount, range.indexOffset + range.indexCount);
+
+    uint32_t vertexCount = (uint32_t)(data.vertexFormat == VertexFormat::Packed ? data.packedVertices.size() : data.vertices.size());
+    VertexCacheStats after = ComputeVertexCacheStats(data.indices.data(), fullDetailCount, vertexCount);
+    data.stats.acmrAfter = after.acmr;
+    data.stats.atvrAfter = after.atvr;
+}
+
+void LoadMeshlets(const MeshView& view, MeshletData& outData)
+{
+    if (!view.meshletCount)
+    {
+        BuildMeshlets(view, outData);
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    outData.meshlets.assign(view.meshlets, view.meshlets + view.meshletCount);
+    outData.submeshMeshlets.assign(view.submeshMeshlets, view.submeshMeshlets + view.submeshCount + 1);
+    outData.indices.assign(view.indices, view.indices + view.indexCount);
+
+    uint32_t paddedCount = (view.meshletCount + 3) & ~3u;
+    for (uint32_t array = 0; array < MESHLET_BOUNDS_ARRAYS; array++)
+    {
+        const float* values = view.meshletBounds + (size_t)array * paddedCount;
+        GetBoundsArrays(outData, array)->assign(values, values + paddedCount);
+    }
+
+    MeshletStats& stats = outData.stats;
+    stats = {};
+    stats.meshletCount = view.meshletCount;
+
+    uint64_t vertexSum = 0, triangleSum = 0;
+    for (uint32_t i = 0; i < view.meshletCount; i++)
+    {
+        vertexSum += view.meshlets[i].vertexCount;
+        triangleSum += view.meshlets[i].triangleCount;
+        stats.conesDisabled += outData.coneCutoff[i] >= 1.0f ? 1 : 0;
+    }
+
+    stats.averageVertices = (float)vertexSum / view.meshletCount;
+    stats.averageTriangles = (float)triangleSum / view.meshletCount;
+    stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// one visible instance with the frustum and the camera taken into its object space, where the meshlet bounds are
+struct InstanceCullData
+{
+    Vec4 planes[6];
+    Vec3 camera;
+    bool backfaceCulling; // mirrored instances flip the winding, their cones would cull the front
+};
+
+static void MakeInstanceCullData(const Frustum& frustum, const Vec3& camera, const Mat4& model, InstanceCullData& out)
+{
+    const float (*m)[4] = model.m;
+
+    // world = object * model, so a world plane dotted with it is a plane in object space. normalized again, the
+    // object space sphere is then tested exactly against where the scaled instance puts it
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        const Vec4& p = frustum.planes[i];
+        float x = p.x * m[0][0] + p.y * m[0][1] + p.z * m[0][2];
+        float y = p.x * m[1][0] + p.y * m[1][1] + p.z * m[1][2];
+        float z = p.x * m[2][0] + p.y * m[2][1] + p.z * m[2][2];
+        float w = p.x * m[3][0] + p.y * m[3][1] + p.z * m[3][2] + p.w;
+
+        // the planes of MakeInfiniteFrustum have no normal
+        float length = sqrtf(x * x + y * y + z * z);
+        float invLength = length > 0.0f ? 1.0f / length : 1.0f;
+        out.planes[i] = { x * invLength, y * invLength, z * invLength, w * invLength };
+    }
+
+    Vec3 row0 = { m[0][0], m[0][1], m[0][2] };
+    Vec3 row1 = { m[1][0], m[1][1], m[1][2] };
+    Vec3 row2 = { m[2][0], m[2][1], m[2][2] };
+    out.backfaceCulling = Dot(row0, Cross(row1, row2)) > 0.0f;
+
+    Vec4 objectCamera = Vec4Transform({ camera.x, camera.y, camera.z, 1.0f }, Mat4AffineInverse(model));
+    out.camera = { objectCamera.x, objectCamera.y, objectCamera.z };
+}
+
+// meshlets [first, first + 4) against every instance: bit i of outInFrustum is set when some instance has meshlet i
+// in its frustum, of outKept when some instance also sees its front
+static void TestMeshlets(const MeshletData& data, uint32_t first, const InstanceCullData* instances, uint32_t instanceCount, int& outInFrustum, int& outKept)
+{
+    Float4 cx = LoadFloat4(&data.centerX[first]);
+    Float4 cy = LoadFloat4(&data.centerY[first]);
+    Float4 cz = LoadFloat4(&data.centerZ[first]);
+    Float4 radius = LoadFloat4(&data.radius[first]);
+    Float4 negRadius = Splat(0.0f) - radius;
+
+    Float4 ax = LoadFloat4(&data.coneX[first]);
+    Float4 ay = LoadFloat4(&data.coneY[first]);
+    Float4 az = LoadFloat4(&data.coneZ[first]);
+    Float4 cutoff = LoadFloat4(&data.coneCutoff[first]);
+
+    // widened so every point of the sphere, not only the center, sees the back of the whole cone
+    Float4 coneRadius = radius * (Splat(1.0f) + cutoff);
+
+    int inFrustum = 0, kept = 0;
+    for (uint32_t i = 0; i < instanceCount && kept != 0xf; i++)
+    {
+        const InstanceCullData& instance = instances[i];
+
+        int outside = 0;
+        for (const Vec4& plane : instance.planes)
+        {
+            Float4 distance = Splat(plane.x) * cx + Splat(plane.y) * cy + Splat(plane.z) * cz + Splat(plane.w);
+            outside |= LessMask(distance, negRadius);
+        }
+
+        int inside = ~outside & 0xf;
+        inFrustum |= inside;
+
+        int back = 0;
+        if (instance.backfaceCulling)
+        {
+            Float4 vx = cx - Splat(instance.camera.x);
+            Float4 vy = cy - Splat(instance.camera.y);
+            Float4 vz = cz - Splat(instance.camera.z);
+            Float4 distance = Sqrt(vx * vx + vy * vy + vz * vz);
+            back = GreaterEqualMask(vx * ax + vy * ay + vz * az, cutoff * distance + coneRadius);
+        }
+
+        kept |= inside & ~back;
+    }
+
+    outInFrustum = inFrustum;
+    outKept = kept;
+}
+
+enum MeshletResult : uint8_t
+{
+    MESHLET_KEPT,
+    MESHLET_OUTSIDE,
+    MESHLET_BACKFACING,
+};
+
+void CullMeshlets(JobSystem& jobs, const Frustum& frustum, const Vec3& camera, const MeshletData* meshes, uint32_t meshCount,
+    const VisibleSet& visible, Arena& scratch, MeshletVisibleSet& out)
+{
+    PROFILE_SCOPE("CullMeshlets");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    out.draws.assign(meshCount, { 0, 0, false });
+    out.submeshTriangles.assign(visible.submeshVisible.size(), 0);
+    out.stats = MeshletCullingStats();
+
+    // every mesh that gets compacted puts its instances and its padded meshlets after the previous one's
+    ArenaVector<InstanceCullData> instances(scratch);
+    instances.reserve(visible.instances.size());
+    uint32_t* instanceOffsets = scratch.AllocateArray<uint32_t>(meshCount + 1);
+    uint32_t* meshletOffsets = scratch.AllocateArray<uint32_t>(meshCount + 1);
+
+    uint32_t meshletTotal = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        instanceOffsets[mesh] = (uint32_t)instances.size();
+        meshletOffsets[mesh] = meshletTotal;
+
+        const InstanceRange& range = visible.ranges[mesh];
+        if (range.count == 0)
+            continue;
+
+        if (range.count > MESHLET_CULLING_MAX_INSTANCES)
+        {
+            out.stats.meshesWhole++;
+            continue;
+        }
+
+        out.draws[mesh].compacted = true;
+        for (uint32_t i = range.first; i < range.first + range.count; i++)
+            MakeInstanceCullData(frustum, camera, visible.instances[i].model, instances.emplace_back());
+
+        meshletTotal += (uint32_t)meshes[mesh].radius.size();
+    }
+
+    instanceOffsets[meshCount] = (uint32_t)instances.size();
+    meshletOffsets[meshCount] = meshletTotal;
+
+    // lanes past the end of a mesh's meshlets are never written nor read
+    uint8_t* results = scratch.AllocateArray<uint8_t>(meshletTotal);
+
+    ParallelFor(jobs, meshletTotal / 4, 16, [&](uint32_t begin, uint32_t end)
+    {
+        uint32_t mesh = 0;
+        for (uint32_t group = begin; group < end; group++)
+        {
+            uint32_t flat = group * 4;
+            while (flat >= meshletOffsets[mesh + 1])
+                mesh++;
+
+            const MeshletData& data = meshes[mesh];
+            uint32_t first = flat - meshletOffsets[mesh];
+            uint32_t instanceCount = instanceOffsets[mesh + 1] - instanceOffsets[mesh];
+
+            int inFrustum, kept;
+            TestMeshlets(data, first, instances.data() + instanceOffsets[mesh], instanceCount, inFrustum, kept);
+
+            const uint8_t* submeshVisible = visible.submeshVisible.data() + visible.submeshOffsets[mesh];
+            for (uint32_t lane = 0; lane < 4 && first + lane < data.meshlets.size(); lane++)
+            {
+                uint8_t result = MESHLET_KEPT;
+                if (!submeshVisible[data.meshlets[first + lane].submesh] || !(inFrustum & (1 << lane)))
+                    result = MESHLET_OUTSIDE;
+                else if (!(kept & (1 << lane)))
+                    result = MESHLET_BACKFACING;
+
+                results[flat + lane] = result;
+            }
+        }
+    });
+
+    // where every kept meshlet goes, submeshes stay in order so the pixel shader still finds them by triangle
+    uint32_t* meshletFirstIndex = scratch.AllocateArray<uint32_t>(meshletTotal);
+
+    uint32_t indexCount = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+    {
+        MeshletDraw& draw = out.draws[mesh];
+        if (!draw.compacted)
+            continue;
+
+        const MeshletData& data = meshes[mesh];
+        uint32_t* submeshTriangles = out.submeshTriangles.data() + visible.submeshOffsets[mesh];
+        const uint8_t* meshResults = results + meshletOffsets[mesh];
+
+        draw.firstIndex = indexCount;
+        for (uint32_t s = 0; s + 1 < data.submeshMeshlets.size(); s++)
+        {
+            submeshTriangles[s] = (indexCount - draw.firstIndex) / 3;
+
+            for (uint32_t i = data.submeshMeshlets[s]; i < data.submeshMeshlets[s + 1]; i++)
+            {
+                uint32_t triangleCount = data.meshlets[i].triangleCount;
+                out.stats.meshletsTested++;
+                out.stats.trianglesTested += triangleCount;
+
+                if (meshResults[i] == MESHLET_KEPT)
+                {
+                    meshletFirstIndex[meshletOffsets[mesh] + i] = indexCount;
+                    indexCount += triangleCount * 3;
+                }
+                else if (meshResults[i] == MESHLET_OUTSIDE)
+                {
+                    out.stats.meshletsFrustumCulled++;
+                    out.stats.trianglesFrustumCulled += triangleCount;
+                }
+                else
+                {
+                    out.stats.meshletsBackfaceCulled++;
+                    out.stats.trianglesBackfaceCulled += triangleCount;
+                }
+            }
+        }
+        draw.indexCount = indexCount - draw.firstIndex;
+
+        out.stats.meshesCompacted++;
+    }
+
+    out.indices.resize(indexCount);
+
+    ParallelFor(jobs, meshletTotal, 64, [&](uint32_t begin, uint32_t end)
+    {
+        uint32_t mesh = 0;
+        for (uint32_t flat = begin; flat < end; flat++)
+        {
+            while (flat >= meshletOffsets[mesh + 1])
+                mesh++;
+
+            const MeshletData& data = meshes[mesh];
+            uint32_t i = flat - meshletOffsets[mesh];
+            if (i >= data.meshlets.size() || results[flat] != MESHLET_KEPT)
+                continue;
+
+            const Meshlet& meshlet = data.meshlets[i];
+            memcpy(out.indices.data() + meshletFirstIndex[flat], data.indices.data() + meshlet.indexOffset, sizeof(uint32_t) * 3 * meshlet.triangleCount);
+        }
+    });
+
+    out.stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// no meshlet anywhere else in the code knows about paths, the app has a free camera and nothing to replay
+static void GetBenchmarkCamera(uint32_t path, uint32_t frame, uint32_t frameCount, const Vec3& center, float radius, Vec3& outEye, Vec3& outDirection)
+{
+    float t = (float)frame / (float)frameCount;
+    float angle = t * 2.0f * 3.14159265f;
+
+    switch (path)
+    {
+    case 0: // orbit, the whole mesh in view
+        outEye = center + Vec3{ sinf(angle) * 3.0f * radius, 0.5f * radius, -cosf(angle) * 3.0f * radius };
+        outDirection = Normalize(center - outEye);
+        break;
+
+    case 1: // close orbit, most of the mesh outside the frustum
+        outEye = center + Vec3{ sinf(angle) * 1.2f * radius, 0.0f, -cosf(angle) * 1.2f * radius };
+        outDirection = Normalize(center - outEye);
+        break;
+
+    default: // flyby, straight past the mesh and away from it
+        outEye = center + Vec3{ 0.6f * radius, 0.2f * radius, (t * 8.0f - 4.0f) * radius };
+        outDirection = { 0.0f, 0.0f, 1.0f };
+        break;
+    }
+}
+
+static const char* const sBenchmarkPathNames[] = { "orbit", "close orbit", "flyby" };
+
+void RunMeshletBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<MeshletBenchmarkCase>& outCases)
+{
+    constexpr uint32_t FRAME_COUNT = 64;
+
+    outCases.clear();
+
+    for (const std::string& meshPath : meshPaths)
+    {
+        MeshData mesh;
+        Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+        if (!CookMeshData(jobs, meshPath, scratch, mesh))
+            continue;
+
+        MeshView view = MakeMeshView(mesh);
+
+        MeshletBenchmarkCase& bench = outCases.emplace_back();
+        bench.path = meshPath;
+        bench.triangleCount = 0;
+        for (uint32_t s = 0; s < view.submeshCount; s++)
+            bench.triangleCount += view.submeshes[s].indexCount / 3;
+
+        MeshletData meshlets;
+        BuildMeshlets(view, meshlets);
+        bench.meshlets = meshlets.stats;
+
+        MeshBounds bounds;
+        MakeMeshBounds(view, bounds);
+
+        // one instance, rotated and stretched so the object space tests have something to undo
+        Scene scene;
+        AddInstance(scene, 0, { { 0.5f, -0.5f, 2.0f }, { 10.0f, 150.0f, 0.0f }, { 1.0f, 1.5f, 1.0f } });
+
+        std::vector<uint32_t> order;
+        std::vector<InstanceRange> ranges;
+        SortInstancesByMesh(scene, 1, order, ranges);
+
+        InstanceData instance;
+        ComputeInstanceData(jobs, scene, order.data(), 1, &instance);
+
+        const float (*m)[4] = instance.model.m;
+        std::vector<Vec3> positions(view.vertexCount);
+        for (uint32_t i = 0; i < view.vertexCount; i++)
+        {
+            Vec3 p = GetVertexPosition(view, i);
+            positions[i] =
+            {
+                p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+                p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+                p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+            };
+        }
+
+        Vec3 c = bounds.bounds.center;
+        Vec3 center = { c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0], c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1], c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2] };
+        float radius = bounds.bounds.radius * 1.5f;
+
+        Mat4 proj = Mat4PerspectiveFovLH(60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f);
+
+        for (uint32_t path = 0; path < std::size(sBenchmarkPathNames); path++)
+        {
+            MeshletBenchmarkPath& result = bench.paths.emplace_back();
+            result = {};
+            result.name = sBenchmarkPathNames[path];
+            result.frames = FRAME_COUNT;
+
+            VisibleSet visible;
+            MeshletVisibleSet meshletVisible;
+            Arena scratch;
+
+            double best = 1e30;
+            for (uint32_t run = 0; run < 5; run++)
+            {
+                bool validate = run == 0;
+                double ms = 0.0;
+
+                for (uint32_t frame = 0; frame < FRAME_COUNT; frame++)
+                {
+                    Vec3 eye, direction;
+                    GetBenchmarkCamera(path, frame, FRAME_COUNT, center, radius, eye, direction);
+
+                    Mat4 cameraView = Mat4LookToLH(eye, direction, { 0.0f, 1.0f, 0.0f });
+                    Frustum frustum = MakeFrustum(Mat4Multiply(cameraView, proj));
+
+                    scratch.Reset();
+                    CullScene(jobs, frustum, &bounds, 1, &instance, ranges.data(), scratch, visible);
+
+                    auto start = std::chrono::high_resolution_clock::now();
+                    CullMeshlets(jobs, frustum, eye, &meshlets, 1, visible, scratch, meshletVisible);
+                    auto end = std::chrono::high_resolution_clock::now();
+                    ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+                    if (!validate)
+                        continue;
+
+                    const MeshletCullingStats& stats = meshletVisible.stats;
+                    result.trianglesTested += stats.trianglesTested;
+                    result.trianglesFrustumCulled += stats.trianglesFrustumCulled;
+                    result.trianglesBackfaceCulled += stats.trianglesBackfaceCulled;
+
+                    // the kept meshlets are in order, walk them side by side with the compacted indices
+                    const MeshletDraw& draw = meshletVisible.draws[0];
+                    uint32_t cursor = draw.firstIndex;
+                    for (const Meshlet& meshlet : meshlets.meshlets)
+                    {
+                        const uint32_t* meshletIndices = meshlets.indices.data() + meshlet.indexOffset;
+                        uint32_t indexCount = meshlet.triangleCount * 3;
+                        bool kept = draw.compacted && cursor + indexCount <= draw.firstIndex + draw.indexCount &&
+                            memcmp(meshletVisible.indices.data() + cursor, meshletIndices, sizeof(uint32_t) * indexCount) == 0;
+                        if (kept)
+                            cursor += indexCount;
+
+                        for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+                        {
+                            const Vec3& a = positions[meshletIndices[t * 3 + 0]];
+                            const Vec3& b = positions[meshletIndices[t * 3 + 1]];
+                            const Vec3& c = positions[meshletIndices[t * 3 + 2]];
+
+                            bool outside = false;
+                            for (const Vec4& plane : frustum.planes)
+                            {
+                                auto distance = [&](const Vec3& p) { return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w; };
+                                outside |= distance(a) < 0.0f && distance(b) < 0.0f && distance(c) < 0.0f;
+                            }
+
+                            if (outside)
+                                continue;
+
+                            // with a little slack for triangles seen edge on
+                            Vec3 normal = Cross(b - a, c - a);
+                            Vec3 toTriangle = a - eye;
+                            float facing = Dot(normal, toTriangle);
+                            if (facing >= 0.0f)
+                                result.trianglesBackfacing++;
+                            else if (!kept && facing < -1e-4f * Length(normal) * Length(toTriangle))
+                                result.wronglyCulled++;
+                        }
+                    }
+                }
+
+                best = ms < best ? ms : best;
+            }
+
+            result.ms = best / FRAME_COUNT;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "culling.h"
+
+#include <string>
+#include <vector>
+
+// every submesh cut into meshlets, small clusters of triangles with a bounding sphere and a cone around their
+// normals. per frame the meshlets outside the frustum or facing away from the camera for every visible instance
+// are dropped and the triangles that are left written into one index buffer, so big meshes only rasterize
+// what can show up. building reorders the triangles inside each submesh, which the cook does once so the mesh
+// is uploaded and cached with the meshlet's indices and both agree
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// a meshlet is tested against each visible instance of its mesh, meshes with more than this many are drawn whole
+constexpr uint32_t MESHLET_CULLING_MAX_INSTANCES = 16;
+
+struct MeshletStats
+{
+    uint32_t meshletCount;
+    float averageVertices;
+    float averageTriangles;
+    uint32_t conesDisabled; // normals spread too far for the cone to ever cull
+    float ms;               // BuildMeshlets, or LoadMeshlets when they were cooked
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> submeshMeshlets; // first meshlet of every submesh, then the meshlet count
+    std::vector<uint32_t> indices;         // the mesh's, triangles of every submesh regrouped by meshlet
+
+    // object space bounds, structures of arrays padded to a multiple of 4 meshlets. a meshlet faces away from
+    // a camera at p when dot(center - p, cone) >= coneCutoff * |center - p| + radius * (1 + coneCutoff)
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> coneX, coneY, coneZ, coneCutoff; // cutoff 1 never culls
+
+    MeshletStats stats;
+};
+
+void BuildMeshlets(const MeshView& view, MeshletData& outData);
+
+// BuildMeshlets at cook time, after PackMeshVertices: the full detail indices are put in meshlet order and their vertex
+// cache stats taken again, that order is what the gpu draws. the meshlets and their bounds are kept for the cache
+void CookMeshlets(MeshData& data);
+
+// what CookMeshlets kept, copied out of the view. a view without meshlets has them built
+void LoadMeshlets(const MeshView& view, MeshletData& outData);
+
+struct MeshletCullingStats
+{
+    uint32_t meshesCompacted = 0;        // drawn from MeshletVisibleSet::indices
+    uint32_t meshesWhole = 0;            // visible instances over MESHLET_CULLING_MAX_INSTANCES
+    uint32_t meshletsTested = 0;
+    uint32_t meshletsFrustumCulled = 0;  // outside the frustum for every instance
+    uint32_t meshletsBackfaceCulled = 0;
+    uint32_t trianglesTested = 0;
+    uint32_t trianglesFrustumCulled = 0;
+    uint32_t trianglesBackfaceCulled = 0;
+    float ms = 0.0f;
+};
+
+struct MeshletDraw
+{
+    uint32_t firstIndex; // into MeshletVisibleSet::indices
+    uint32_t indexCount;
+    bool compacted;      // false draws the mesh's own index buffer as if there were no meshlets
+};
+
+struct MeshletVisibleSet
+{
+    std::vector<uint32_t> indices;          // kept triangles of every compacted mesh, mesh after mesh
+    std::vector<MeshletDraw> draws;         // per mesh
+    std::vector<uint32_t> submeshTriangles; // per submesh like VisibleSet::submeshVisible, first triangle in the
+                                            // buffer the mesh draws from
+    MeshletCullingStats stats;
+};
+
+// after CullScene: only meshes and submeshes visible has left are tested, camera is the world space eye.
+// meshlets of 4 at a time against one instance, split across the job system. temporaries come from scratch
+void CullMeshlets(JobSystem& jobs, const Frustum& frustum, const Vec3& camera, const MeshletData* meshes, uint32_t meshCount,
+    const VisibleSet& visible, Arena& scratch, MeshletVisibleSet& out);
+
+struct MeshletBenchmarkPath
+{
+    const char* name;
+    uint32_t frames;
+    uint32_t trianglesTested;         // summed over the frames
+    uint32_t trianglesFrustumCulled;
+    uint32_t trianglesBackfaceCulled;
+    uint32_t trianglesBackfacing;     // what a per triangle test would find among the ones in the frustum
+    uint32_t wronglyCulled;           // culled triangles that face the camera inside the frustum, should be 0
+    double ms;                        // CullMeshlets per frame
+};
+
+struct MeshletBenchmarkCase
+{
+    std::string path;
+    uint32_t triangleCount;
+    MeshletStats meshlets;
+    std::vector<MeshletBenchmarkPath> paths;
+};
+
+// one instance of every mesh seen along a few camera paths around it: an orbit, a close orbit that leaves
+// most of the mesh outside the frustum, and a straight flyby
+void RunMeshletBenchmark(JobSystem& jobs, const std::vector<std::string>& meshPaths, std::vector<MeshletBenchmarkCase>& outCases);
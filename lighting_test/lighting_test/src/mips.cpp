@@ -0,0 +1,340 @@
+#include "mips.h"
+
+#include "../vendor/stb/stb_image.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define MIPS_SSE 1
+    #include <emmintrin.h>
+#else
+    #define MIPS_SSE 0
+#endif
+
+// one rgba pixel in linear float, a single sse register when available
+struct Pixel4
+{
+#if MIPS_SSE
+    __m128 v;
+
+    static Pixel4 Zero() { return { _mm_setzero_ps() }; }
+    static Pixel4 Load(const float* p) { return { _mm_loadu_ps(p) }; }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+    void MulAdd(Pixel4 p, float w) { v = _mm_add_ps(v, _mm_mul_ps(p.v, _mm_set1_ps(w))); }
+#else
+    float v[4];
+
+    static Pixel4 Zero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+    static Pixel4 Load(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+    void Store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+    void MulAdd(Pixel4 p, float w) { for (int i = 0; i < 4; i++) v[i] += p.v[i] * w; }
+#endif
+};
+
+static constexpr uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 4096;
+
+struct SrgbTables
+{
+    float toLinear[256];
+    uint8_t toSrgb[LINEAR_TO_SRGB_TABLE_SIZE];
+
+    SrgbTables()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        for (uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++)
+        {
+            float l = i / (float)(LINEAR_TO_SRGB_TABLE_SIZE - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+            toSrgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const SrgbTables& GetSrgbTables()
+{
+    static SrgbTables tables;
+    return tables;
+}
+
+static float Clamp01(float x)
+{
+    return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+}
+
+static float Sinc(float x)
+{
+    constexpr float PI = 3.14159265358979f;
+
+    if (fabsf(x) < 1e-5f)
+        return 1.0f;
+
+    return sinf(PI * x) / (PI * x);
+}
+
+// zeroth order modified bessel function of the first kind, series expansion
+static float BesselI0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    float halfX = x * 0.5f;
+
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-7f)
+            break;
+    }
+
+    return sum;
+}
+
+// filter shapes are in destination pixel units
+static constexpr float KAISER_RADIUS = 2.0f;
+static constexpr float KAISER_ALPHA = 4.0f;
+
+static float FilterRadius(MipFilter filter)
+{
+    return filter == MipFilter::Box ? 0.5f : KAISER_RADIUS;
+}
+
+static float EvaluateFilter(MipFilter filter, float t)
+{
+    if (filter == MipFilter::Box)
+        return fabsf(t) <= 0.5f ? 1.0f : 0.0f;
+
+    float r = t / KAISER_RADIUS;
+    if (r * r >= 1.0f)
+        return 0.0f;
+
+    float window = BesselI0(KAISER_ALPHA * sqrtf(1.0f - r * r)) / BesselI0(KAISER_ALPHA);
+    return Sinc(t) * window;
+}
+
+// polyphase weights for one axis, taps wrap around the edges like the sampler does
+struct FilterTaps
+{
+    uint32_t tapCount;
+    std::vector<uint32_t> indices; // dstSize * tapCount
+    std::vector<float> weights;    // dstSize * tapCount
+};
+
+static void BuildFilterTaps(MipFilter filter, uint32_t srcSize, uint32_t dstSize, FilterTaps& outTaps)
+{
+    float scale = (float)srcSize / (float)dstSize;
+    float radius = FilterRadius(filter) * scale;
+
+    outTaps.tapCount = (uint32_t)ceilf(radius * 2.0f) + 1;
+    outTaps.indices.assign((size_t)dstSize * outTaps.tapCount, 0);
+    outTaps.weights.assign((size_t)dstSize * outTaps.tapCount, 0.0f);
+
+    for (uint32_t x = 0; x < dstSize; x++)
+    {
+        float center = (x + 0.5f) * scale;
+        int first = (int)floorf(center - radius);
+
+        uint32_t* indices = &outTaps.indices[(size_t)x * outTaps.tapCount];
+        float* weights = &outTaps.weights[(size_t)x * outTaps.tapCount];
+
+        float total = 0.0f;
+        for (uint32_t i = 0; i < outTaps.tapCount; i++)
+        {
+            int src = first + (int)i;
+            float t = ((src + 0.5f) - center) / scale;
+
+            int wrapped = src % (int)srcSize;
+            if (wrapped < 0)
+                wrapped += srcSize;
+
+            indices[i] = (uint32_t)wrapped;
+            weights[i] = EvaluateFilter(filter, t);
+            total += weights[i];
+        }
+
+        for (uint32_t i = 0; i < outTaps.tapCount; i++)
+            weights[i] /= total;
+    }
+}
+
+static constexpr uint32_t ROWS_PER_JOB = 32;
+
+static void DownsampleLevel(JobSystem& jobs, MipFilter filter, const float* src, uint32_t srcWidth, uint32_t srcHeight, float* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+    FilterTaps horizontal, vertical;
+    BuildFilterTaps(filter, srcWidth, dstWidth, horizontal);
+    BuildFilterTaps(filter, srcHeight, dstHeight, vertical);
+
+    // horizontal pass into a temp image with the source height
+    std::vector<float> temp((size_t)dstWidth * srcHeight * 4);
+
+    ParallelFor(jobs, srcHeight, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            const float* srcRow = src + (size_t)y * srcWidth * 4;
+            float* tempRow = temp.data() + (size_t)y * dstWidth * 4;
+
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                const uint32_t* indices = &horizontal.indices[(size_t)x * horizontal.tapCount];
+                const float* weights = &horizontal.weights[(size_t)x * horizontal.tapCount];
+
+                Pixel4 sum = Pixel4::Zero();
+                for (uint32_t i = 0; i < horizontal.tapCount; i++)
+                    sum.MulAdd(Pixel4::Load(srcRow + indices[i] * 4), weights[i]);
+
+                sum.Store(tempRow + x * 4);
+            }
+        }
+    });
+
+    // vertical pass, whole rows at a time so the inner loop walks memory linearly
+    ParallelFor(jobs, dstHeight, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t y = begin; y < end; y++)
+        {
+            const uint32_t* indices = &vertical.indices[(size_t)y * vertical.tapCount];
+            const float* weights = &vertical.weights[(size_t)y * vertical.tapCount];
+            float* dstRow = dst + (size_t)y * dstWidth * 4;
+
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                Pixel4 sum = Pixel4::Zero();
+                for (uint32_t i = 0; i < vertical.tapCount; i++)
+                    sum.MulAdd(Pixel4::Load(temp.data() + ((size_t)indices[i] * dstWidth + x) * 4), weights[i]);
+
+                sum.Store(dstRow + x * 4);
+            }
+        }
+    });
+}
+
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t count = 1;
+    while (width > 1 || height > 1)
+    {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+    return count;
+}
+
+void GenerateMipChain(JobSystem& jobs, const uint8_t* rgba, uint32_t width, uint32_t height, MipFilter filter, bool srgb, MipChain& outChain)
+{
+    const SrgbTables& tables = GetSrgbTables();
+
+    uint32_t levelCount = GetMipLevelCount(width, height);
+
+    outChain.levels.resize(levelCount);
+
+    size_t totalBytes = 0;
+    for (uint32_t i = 0; i < levelCount; i++)
+    {
+        MipLevel& level = outChain.levels[i];
+        level.width = i == 0 ? width : (outChain.levels[i - 1].width > 1 ? outChain.levels[i - 1].width / 2 : 1);
+        level.height = i == 0 ? height : (outChain.levels[i - 1].height > 1 ? outChain.levels[i - 1].height / 2 : 1);
+        level.offset = totalBytes;
+        totalBytes += (size_t)level.width * level.height * 4;
+    }
+
+    outChain.pixels.resize(totalBytes);
+    memcpy(outChain.pixels.data(), rgba, (size_t)width * height * 4);
+
+    if (levelCount == 1)
+        return;
+
+    // linear float copy of every level except the source, which is decoded once up front
+    std::vector<std::vector<float>> linearLevels(levelCount);
+    linearLevels[0].resize((size_t)width * height * 4);
+
+    ParallelFor(jobs, height, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+    {
+        for (size_t i = (size_t)begin * width * 4; i < (size_t)end * width * 4; i++)
+        {
+            bool isAlpha = (i & 3) == 3;
+            linearLevels[0][i] = (srgb && !isAlpha) ? tables.toLinear[rgba[i]] : rgba[i] / 255.0f;
+        }
+    });
+
+    for (uint32_t i = 1; i < levelCount; i++)
+    {
+        const MipLevel& src = outChain.levels[i - 1];
+        const MipLevel& dst = outChain.levels[i];
+
+        linearLevels[i].resize((size_t)dst.width * dst.height * 4);
+        DownsampleLevel(jobs, filter, linearLevels[i - 1].data(), src.width, src.height, linearLevels[i].data(), dst.width, dst.height);
+
+        // the full resolution float copy is by far the biggest, drop it as soon as possible
+        if (i == 1)
+            std::vector<float>().swap(linearLevels[0]);
+    }
+
+    // encode back to 8 bit, one job per level and each level split again by rows
+    ParallelFor(jobs, levelCount - 1, 1, [&](uint32_t levelBegin, uint32_t levelEnd)
+    {
+        for (uint32_t level = levelBegin + 1; level < levelEnd + 1; level++)
+        {
+            const MipLevel& mip = outChain.levels[level];
+            const float* linear = linearLevels[level].data();
+            uint8_t* dst = outChain.pixels.data() + mip.offset;
+
+            ParallelFor(jobs, mip.height, ROWS_PER_JOB, [&](uint32_t begin, uint32_t end)
+            {
+                for (size_t i = (size_t)begin * mip.width * 4; i < (size_t)end * mip.width * 4; i++)
+                {
+                    float value = Clamp01(linear[i]);
+                    bool isAlpha = (i & 3) == 3;
+                    dst[i] = (srgb && !isAlpha) ? tables.toSrgb[(uint32_t)(value * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)] : (uint8_t)(value * 255.0f + 0.5f);
+                }
+            });
+        }
+    });
+}
+
+void RunMipBenchmark(JobSystem& jobs, const std::vector<std::string>& texturePaths, std::vector<MipBenchmarkCase>& outCases)
+{
+    using MipClock = std::chrono::high_resolution_clock;
+    constexpr uint32_t RUNS = 3;
+
+    outCases.clear();
+
+    for (const std::string& path : texturePaths)
+    {
+        int x, y, channels;
+        uint8_t* pixels = stbi_load(path.c_str(), &x, &y, &channels, 4);
+        if (!pixels)
+            continue;
+
+        MipBenchmarkCase& bench = outCases.emplace_back();
+        bench.path = path;
+        bench.width = (uint32_t)x;
+        bench.height = (uint32_t)y;
+        bench.levelCount = GetMipLevelCount(bench.width, bench.height);
+        bench.boxMs = bench.kaiserMs = 1e30;
+
+        for (uint32_t run = 0; run < RUNS; run++)
+        {
+            MipChain chain;
+
+            auto start = MipClock::now();
+            GenerateMipChain(jobs, pixels, bench.width, bench.height, MipFilter::Box, true, chain);
+            bench.boxMs = std::min(bench.boxMs, std::chrono::duration<double, std::milli>(MipClock::now() - start).count());
+
+            start = MipClock::now();
+            GenerateMipChain(jobs, pixels, bench.width, bench.height, MipFilter::Kaiser, true, chain);
+            bench.kaiserMs = std::min(bench.kaiserMs, std::chrono::duration<double, std::milli>(MipClock::now() - start).count());
+        }
+
+        stbi_image_free(pixels);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "jobs.h"
+
+#include <string>
+#include <vector>
+
+enum class MipFilter
+{
+    Box,
+    Kaiser,
+};
+
+struct MipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    size_t offset; // into MipChain::pixels
+};
+
+// rgba8 mip chain, level 0 is the source image
+struct MipChain
+{
+    std::vector<uint8_t> pixels;
+    std::vector<MipLevel> levels;
+
+    const uint8_t* GetLevelPixels(uint32_t level) const { return pixels.data() + levels[level].offset; }
+};
+
+// number of levels down to 1x1
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+// filters in linear space, srgb = true decodes the rgb channels from srgb first and encodes them back after
+// rows of every level run on jobs, the 8 bit encode of all levels runs in parallel at the end
+void GenerateMipChain(JobSystem& jobs, const uint8_t* rgba, uint32_t width, uint32_t height, MipFilter filter, bool srgb, MipChain& outChain);
+
+struct MipBenchmarkCase
+{
+    std::string path;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    double boxMs;    // best of a few runs, srgb like the loader
+    double kaiserMs;
+};
+
+// the full chain of every texture with both filters
+void RunMipBenchmark(JobSystem& jobs, const std::vector<std::string>& texturePaths, std::vector<MipBenchmarkCase>& outCases);
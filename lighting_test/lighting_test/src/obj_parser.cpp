@@ -0,0 +1,810 @@
+#include "obj_parser.h"
+#include "mapped_file.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+// small enough to keep every worker busy on the repo's meshes, big enough that the per chunk setup does not show
+constexpr uint64_t OBJ_CHUNK_SIZE = 64 * 1024;
+
+struct ObjCorner
+{
+    int32_t position; // 0 based, -1 when missing
+    int32_t texcoord;
+    int32_t normal;
+};
+
+struct ObjChunk
+{
+    const char* begin;
+    const char* end;
+
+    // filled by the counting pass, bases are the prefix sums over the chunks before
+    uint32_t positionCount = 0;
+    uint32_t texcoordCount = 0;
+    uint32_t normalCount = 0;
+    uint32_t cornerCount = 0;
+    uint32_t faceCount = 0;
+    uint32_t groupCount = 0;
+    uint32_t positionBase = 0;
+    uint32_t texcoordBase = 0;
+    uint32_t normalBase = 0;
+
+    // the chunk's part of the shared arrays, sized by the counting pass
+    ObjCorner* corners = nullptr;
+    uint32_t* faceSizes = nullptr;
+    uint32_t* groupStarts = nullptr; // faces of this chunk right after an o or g line
+    bool ok = true;
+};
+
+enum class ObjLine
+{
+    Position,
+    Texcoord,
+    Normal,
+    Face,
+    Group,
+    Other,
+};
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool IsDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+        p++;
+    return p;
+}
+
+// p is past the leading spaces, on return it points past the keyword
+static ObjLine ClassifyLine(const char*& p, const char* end)
+{
+    if (end - p < 2)
+        return ObjLine::Other;
+
+    if (p[0] == 'v')
+    {
+        if (IsSpace(p[1]))
+        {
+            p += 2;
+            return ObjLine::Position;
+        }
+
+        if (end - p >= 3 && IsSpace(p[2]))
+        {
+            if (p[1] == 't')
+            {
+                p += 3;
+                return ObjLine::Texcoord;
+            }
+            if (p[1] == 'n')
+            {
+                p += 3;
+                return ObjLine::Normal;
+            }
+        }
+
+        return ObjLine::Other;
+    }
+
+    if (IsSpace(p[1]))
+    {
+        if (p[0] == 'f')
+        {
+            p += 2;
+            return ObjLine::Face;
+        }
+        if (p[0] == 'o' || p[0] == 'g')
+        {
+            p += 2;
+            return ObjLine::Group;
+        }
+    }
+
+    return ObjLine::Other;
+}
+
+static double Pow10(int exponent)
+{
+    // exact in a double up to 1e22
+    static const double table[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    return exponent <= 22 ? table[exponent] : pow(10.0, exponent);
+}
+
+// decimal with optional sign, fraction and exponent, up to 19 significant digits are kept in an integer
+// and scaled once so the result is within a rounding step of strtod, returns null when there is no number
+static const char* ParseFloat(const char* p, const char* end, float& out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool any = false;
+
+    for (; p < end && IsDigit(*p); p++)
+    {
+        any = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        p++;
+        for (; p < end && IsDigit(*p); p++)
+        {
+            any = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+
+    if (!any)
+        return nullptr;
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* e = p + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            negativeExponent = *e == '-';
+            e++;
+        }
+
+        if (e < end && IsDigit(*e))
+        {
+            int value = 0;
+            for (; e < end && IsDigit(*e); e++)
+                value = value < 10000 ? value * 10 + (*e - '0') : value;
+
+            exponent += negativeExponent ? -value : value;
+            p = e;
+        }
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0)
+        value /= Pow10(-exponent);
+    else if (exponent > 0)
+        value *= Pow10(exponent);
+
+    out = (float)(negative ? -value : value);
+    return p;
+}
+
+static const char* ParseInt(const char* p, const char* end, int32_t& out)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    if (p >= end || !IsDigit(*p))
+        return nullptr;
+
+    int64_t value = 0;
+    for (; p < end && IsDigit(*p); p++)
+        value = value < INT32_MAX ? value * 10 + (*p - '0') : value;
+
+    out = (int32_t)(negative ? -value : value);
+    return p;
+}
+
+// obj indices are 1 based or negative relative to the count so far, 0 is not allowed
+static bool ResolveIndex(int32_t index, uint32_t countSoFar, int32_t& out)
+{
+    if (index > 0)
+        out = index - 1;
+    else if (index < 0)
+        out = (int32_t)countSoFar + index;
+    else
+        return false;
+
+    return out >= 0;
+}
+
+static void CountChunk(ObjChunk& chunk)
+{
+    const char* p = chunk.begin;
+    while (p < chunk.end)
+    {
+        const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+        lineEnd = lineEnd ? lineEnd : chunk.end;
+
+        const char* token = SkipSpaces(p, lineEnd);
+        switch (ClassifyLine(token, lineEnd))
+        {
+            case ObjLine::Position: chunk.positionCount++; break;
+            case ObjLine::Texcoord: chunk.texcoordCount++; break;
+            case ObjLine::Normal: chunk.normalCount++; break;
+            case ObjLine::Group: chunk.groupCount++; break;
+
+            // a corner per word, the parse fails on anything that is not one
+            case ObjLine::Face:
+                for (token = SkipSpaces(token, lineEnd); token < lineEnd; token = SkipSpaces(token, lineEnd))
+                {
+                    while (token < lineEnd && !IsSpace(*token))
+                        token++;
+                    chunk.cornerCount++;
+                }
+                chunk.faceCount++;
+                break;
+
+            default: break;
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// the values past required default to 0 when missing, like a 1d "vt u"
+static bool ParseFloats(const char* p, const char* end, float* out, uint32_t count, uint32_t required)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const char* next = ParseFloat(SkipSpaces(p, end), end, out[i]);
+        if (!next)
+        {
+            if (i < required)
+                return false;
+            out[i] = 0.0f;
+            continue;
+        }
+        p = next;
+    }
+
+    return true;
+}
+
+static bool ParseChunk(ObjChunk& chunk, float* positions, float* texcoords, float* normals)
+{
+    uint32_t positionCount = chunk.positionBase;
+    uint32_t texcoordCount = chunk.texcoordBase;
+    uint32_t normalCount = chunk.normalBase;
+    uint32_t cornerCount = 0;
+    uint32_t faceCount = 0;
+    uint32_t groupCount = 0;
+
+    const char* p = chunk.begin;
+    while (p < chunk.end)
+    {
+        const char* lineEnd = (const char*)memchr(p, '\n', chunk.end - p);
+        lineEnd = lineEnd ? lineEnd : chunk.end;
+
+        const char* token = SkipSpaces(p, lineEnd);
+        switch (ClassifyLine(token, lineEnd))
+        {
+            case ObjLine::Position:
+                if (!ParseFloats(token, lineEnd, positions + 3 * (size_t)positionCount++, 3, 3))
+                    return false;
+                break;
+
+            case ObjLine::Texcoord:
+                if (!ParseFloats(token, lineEnd, texcoords + 2 * (size_t)texcoordCount++, 2, 1))
+                    return false;
+                break;
+
+            case ObjLine::Normal:
+                if (!ParseFloats(token, lineEnd, normals + 3 * (size_t)normalCount++, 3, 3))
+                    return false;
+                break;
+
+            case ObjLine::Face:
+            {
+                uint32_t size = 0;
+                for (token = SkipSpaces(token, lineEnd); token < lineEnd; token = SkipSpaces(token, lineEnd))
+                {
+                    // v, v/vt, v//vn or v/vt/vn
+                    int32_t position, texcoord = 0, normal = 0;
+                    token = ParseInt(token, lineEnd, position);
+                    if (!token)
+                        return false;
+
+                    if (token < lineEnd && *token == '/')
+                    {
+                        token++;
+                        if (token < lineEnd && *token != '/')
+                        {
+                            token = ParseInt(token, lineEnd, texcoord);
+                            if (!token)
+                                return false;
+                        }
+
+                        if (token < lineEnd && *token == '/')
+                        {
+                            token = ParseInt(token + 1, lineEnd, normal);
+                            if (!token)
+                                return false;
+                        }
+                    }
+
+                    if (cornerCount == chunk.cornerCount)
+                        return false;
+
+                    ObjCorner& corner = chunk.corners[cornerCount++];
+                    corner.texcoord = -1;
+                    corner.normal = -1;
+
+                    if (!ResolveIndex(position, positionCount, corner.position))
+                        return false;
+                    if (texcoord && !ResolveIndex(texcoord, texcoordCount, corner.texcoord))
+                        return false;
+                    if (normal && !ResolveIndex(normal, normalCount, corner.normal))
+                        return false;
+
+                    size++;
+                }
+
+                chunk.faceSizes[faceCount++] = size;
+                break;
+            }
+
+            case ObjLine::Group:
+                chunk.groupStarts[groupCount++] = faceCount;
+                break;
+
+            case ObjLine::Other:
+                break;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return cornerCount == chunk.cornerCount;
+}
+
+// (position, normal, texcoord) -> welded vertex, open addressing with linear probing, key and value
+// share a 16 byte slot so a probe touches one cache line
+class WeldTable
+{
+public:
+    WeldTable(uint32_t maxKeys, Arena& arena)
+    {
+        uint32_t capacity = 16;
+        while (capacity < maxKeys * 2)
+            capacity *= 2;
+
+        mMask = capacity - 1;
+        mSlots = arena.AllocateArray<Slot>(capacity);
+        std::fill(mSlots, mSlots + capacity, Slot { { 0, 0, 0 }, UINT32_MAX });
+    }
+
+    // returns the vertex of key, inserting nextVertex when the key is new
+    uint32_t FindOrInsert(const ObjCorner& key, uint32_t nextVertex, bool& outInserted)
+    {
+        uint64_t h = 14695981039346656037ull;
+        h = (h ^ (uint32_t)key.position) * 1099511628211ull;
+        h = (h ^ (uint32_t)key.normal) * 1099511628211ull;
+        h = (h ^ (uint32_t)key.texcoord) * 1099511628211ull;
+
+        for (uint32_t slot = (uint32_t)(h ^ (h >> 32)) & mMask;; slot = (slot + 1) & mMask)
+        {
+            Slot& s = mSlots[slot];
+            if (s.vertex == UINT32_MAX)
+            {
+                s.key = key;
+                s.vertex = nextVertex;
+                outInserted = true;
+                return nextVertex;
+            }
+
+            if (s.key.position == key.position && s.key.normal == key.normal && s.key.texcoord == key.texcoord)
+            {
+                outInserted = false;
+                return s.vertex;
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        ObjCorner key;
+        uint32_t vertex;
+    };
+
+    uint32_t mMask;
+    Slot* mSlots;
+};
+
+// tinyobj's pnpoly, even-odd test of a point against a polygon
+static bool IsInsideTriangle(const float* x, const float* y, float testX, float testY)
+{
+    bool inside = false;
+    for (int i = 0, j = 2; i < 3; j = i++)
+        if (((y[i] > testY) != (y[j] > testY)) && (testX < (x[j] - x[i]) * (testY - y[i]) / (y[j] - y[i]) + x[i]))
+            inside = !inside;
+
+    return inside;
+}
+
+// same triangles in the same order as tinyobj: quads are split along their shorter diagonal and bigger
+// polygons are ear clipped in the plane the first non degenerate corner picks, remaining is scratch for that
+static void TriangulateFace(const ObjCorner* face, uint32_t size, const float* positions, ArenaVector<ObjCorner>& remaining,
+    ArenaVector<ObjCorner>& outTriangles)
+{
+    if (size == 3)
+    {
+        outTriangles.insert(outTriangles.end(), face, face + 3);
+        return;
+    }
+
+    auto position = [&](const ObjCorner& corner) { return positions + 3 * (size_t)corner.position; };
+
+    if (size == 4)
+    {
+        const float* p0 = position(face[0]);
+        const float* p1 = position(face[1]);
+        const float* p2 = position(face[2]);
+        const float* p3 = position(face[3]);
+
+        float e02[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float e13[3] = { p3[0] - p1[0], p3[1] - p1[1], p3[2] - p1[2] };
+        float squared02 = e02[0] * e02[0] + e02[1] * e02[1] + e02[2] * e02[2];
+        float squared13 = e13[0] * e13[0] + e13[1] * e13[1] + e13[2] * e13[2];
+
+        const uint32_t split02[] = { 0, 1, 2, 0, 2, 3 };
+        const uint32_t split13[] = { 0, 1, 3, 1, 2, 3 };
+        const uint32_t* order = squared02 < squared13 ? split02 : split13;
+        for (uint32_t i = 0; i < 6; i++)
+            outTriangles.push_back(face[order[i]]);
+        return;
+    }
+
+    uint32_t axes[2] = { 1, 2 };
+    for (uint32_t k = 0; k < size; k++)
+    {
+        const float* v0 = position(face[k]);
+        const float* v1 = position(face[(k + 1) % size]);
+        const float* v2 = position(face[(k + 2) % size]);
+        float e0[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+        float e1[3] = { v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2] };
+        float cx = fabsf(e0[1] * e1[2] - e0[2] * e1[1]);
+        float cy = fabsf(e0[2] * e1[0] - e0[0] * e1[2]);
+        float cz = fabsf(e0[0] * e1[1] - e0[1] * e1[0]);
+
+        const float epsilon = 1.1920929e-7f;
+        if (cx > epsilon || cy > epsilon || cz > epsilon)
+        {
+            if (!(cx > cy && cx > cz))
+            {
+                axes[0] = 0;
+                if (cz > cx && cz > cy)
+                    axes[1] = 1;
+            }
+            break;
+        }
+    }
+
+    remaining.assign(face, face + size);
+    uint32_t guess = 0;
+    uint32_t remainingIterations = size;
+    uint32_t previousRemaining = size;
+
+    while (remaining.size() > 3 && remainingIterations > 0)
+    {
+        uint32_t count = (uint32_t)remaining.size();
+        if (guess >= count)
+            guess -= count;
+
+        if (previousRemaining != count)
+        {
+            previousRemaining = count;
+            remainingIterations = count;
+        }
+        else
+        {
+            remainingIterations--;
+        }
+
+        ObjCorner corners[3];
+        float x[3], y[3];
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            corners[k] = remaining[(guess + k) % count];
+            x[k] = position(corners[k])[axes[0]];
+            y[k] = position(corners[k])[axes[1]];
+        }
+
+        // skip reflex corners
+        float cross = (x[1] - x[0]) * (y[2] - y[1]) - (y[1] - y[0]) * (x[2] - x[1]);
+        float area = (x[0] * y[1] - y[0] * x[1]) * 0.5f;
+        if (cross * area < 0.0f)
+        {
+            guess++;
+            continue;
+        }
+
+        bool overlap = false;
+        for (uint32_t other = 3; other < count && !overlap; other++)
+        {
+            const float* p = position(remaining[(guess + other) % count]);
+            overlap = IsInsideTriangle(x, y, p[axes[0]], p[axes[1]]);
+        }
+
+        if (overlap)
+        {
+            guess++;
+            continue;
+        }
+
+        outTriangles.insert(outTriangles.end(), corners, corners + 3);
+        remaining.erase(remaining.begin() + (guess + 1) % count);
+    }
+
+    if (remaining.size() == 3)
+        outTriangles.insert(outTriangles.end(), remaining.begin(), remaining.end());
+}
+
+bool ParseObj(JobSystem& jobs, const std::string& path, Arena& scratch, MeshData& outData)
+{
+    PROFILE_SCOPE("ParseObj");
+
+    MappedFile file;
+    if (!file.Map(path))
+        return false;
+
+    const char* data = (const char*)file.data;
+    const char* dataEnd = data + file.size;
+
+    // chunk borders moved forward to the next line, so never more chunks than whole OBJ_CHUNK_SIZEs
+    ArenaVector<ObjChunk> chunks(scratch);
+    chunks.reserve(file.size / OBJ_CHUNK_SIZE + 1);
+    for (const char* begin = data; begin < dataEnd;)
+    {
+        const char* end = (uint64_t)(dataEnd - begin) > OBJ_CHUNK_SIZE ? begin + OBJ_CHUNK_SIZE : dataEnd;
+        const char* newline = end < dataEnd ? (const char*)memchr(end, '\n', dataEnd - end) : nullptr;
+        end = newline ? newline + 1 : dataEnd;
+
+        ObjChunk& chunk = chunks.emplace_back();
+        chunk.begin = begin;
+        chunk.end = end;
+        begin = end;
+    }
+
+    uint32_t chunkCount = (uint32_t)chunks.size();
+
+    ParallelFor(jobs, chunkCount, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+            CountChunk(chunks[i]);
+    });
+
+    uint32_t positionCount = 0, texcoordCount = 0, normalCount = 0;
+    size_t cornerCount = 0, faceCount = 0, groupCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.positionBase = positionCount;
+        chunk.texcoordBase = texcoordCount;
+        chunk.normalBase = normalCount;
+        positionCount += chunk.positionCount;
+        texcoordCount += chunk.texcoordCount;
+        normalCount += chunk.normalCount;
+        cornerCount += chunk.cornerCount;
+        faceCount += chunk.faceCount;
+        groupCount += chunk.groupCount;
+    }
+
+    // every line writes its values, nothing needs clearing
+    float* positions = scratch.AllocateArray<float>((size_t)positionCount * 3);
+    float* texcoords = scratch.AllocateArray<float>((size_t)texcoordCount * 2);
+    float* normals = scratch.AllocateArray<float>((size_t)normalCount * 3);
+    ObjCorner* corners = scratch.AllocateArray<ObjCorner>(cornerCount);
+    uint32_t* faceSizes = scratch.AllocateArray<uint32_t>(faceCount);
+    uint32_t* groupStarts = scratch.AllocateArray<uint32_t>(groupCount);
+
+    for (ObjChunk& chunk : chunks)
+    {
+        chunk.corners = corners;
+        chunk.faceSizes = faceSizes;
+        chunk.groupStarts = groupStarts;
+        corners += chunk.cornerCount;
+        faceSizes += chunk.faceCount;
+        groupStarts += chunk.groupCount;
+    }
+
+    ParallelFor(jobs, chunkCount, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+            chunks[i].ok = ParseChunk(chunks[i], positions, texcoords, normals);
+    });
+
+    // a face of n corners becomes n - 2 triangles, so the indices can outgrow the corners from seven corners on
+    size_t triangulatedIndexCount = 0;
+    for (const ObjChunk& chunk : chunks)
+    {
+        if (!chunk.ok)
+            return false;
+
+        for (uint32_t f = 0; f < chunk.faceCount; f++)
+            triangulatedIndexCount += chunk.faceSizes[f] >= 3 ? 3 * (chunk.faceSizes[f] - 2) : 0;
+
+        // forward references are fine in obj, so the range check waits until every count is known
+        for (uint32_t i = 0; i < chunk.cornerCount; i++)
+        {
+            const ObjCorner& corner = chunk.corners[i];
+            if ((uint32_t)corner.position >= positionCount || (corner.texcoord >= 0 && (uint32_t)corner.texcoord >= texcoordCount)
+                || (corner.normal >= 0 && (uint32_t)corner.normal >= normalCount))
+                return false;
+        }
+    }
+
+    // built in the arena at their worst case size, every corner a new vertex and every face triangulated, and copied
+    // out at the size they ended up with
+    ArenaVector<MeshVertex> vertices(scratch);
+    ArenaVector<uint32_t> indices(scratch);
+    ArenaVector<SubMeshRange> submeshes(scratch);
+    ArenaVector<ObjCorner> triangles(scratch);
+    ArenaVector<ObjCorner> remaining(scratch);
+
+    vertices.reserve(cornerCount);
+    indices.reserve(triangulatedIndexCount);
+    submeshes.reserve(groupCount + 1);
+
+    WeldTable weldTable((uint32_t)cornerCount, scratch);
+
+    uint32_t submeshStart = 0;
+    auto closeSubmesh = [&]()
+    {
+        if ((uint32_t)indices.size() > submeshStart)
+            submeshes.push_back({ submeshStart, (uint32_t)indices.size() - submeshStart });
+        submeshStart = (uint32_t)indices.size();
+    };
+
+    for (const ObjChunk& chunk : chunks)
+    {
+        const ObjCorner* face = chunk.corners;
+        uint32_t groupStart = 0;
+
+        for (uint32_t f = 0; f < chunk.faceCount; f++)
+        {
+            for (; groupStart < chunk.groupCount && chunk.groupStarts[groupStart] == f; groupStart++)
+                closeSubmesh();
+
+            uint32_t size = chunk.faceSizes[f];
+            triangles.clear();
+            if (size >= 3)
+                TriangulateFace(face, size, positions, remaining, triangles);
+            face += size;
+
+            for (const ObjCorner& corner : triangles)
+            {
+                bool inserted;
+                uint32_t vertex = weldTable.FindOrInsert(corner, (uint32_t)vertices.size(), inserted);
+                if (inserted)
+                {
+                    MeshVertex& v = vertices.emplace_back();
+                    const float* p = positions + 3 * (size_t)corner.position;
+                    v.pos = { p[0], p[1], p[2] };
+
+                    if (corner.normal != -1)
+                    {
+                        const float* n = normals + 3 * (size_t)corner.normal;
+                        v.normal = { n[0], n[1], n[2] };
+                    }
+
+                    if (corner.texcoord != -1)
+                    {
+                        const float* t = texcoords + 2 * (size_t)corner.texcoord;
+                        v.textureCoords = { t[0], -t[1] };
+                    }
+                }
+
+                indices.push_back(vertex);
+            }
+        }
+
+        // o/g lines after the last face of the chunk
+        for (; groupStart < chunk.groupCount; groupStart++)
+            closeSubmesh();
+    }
+
+    closeSubmesh();
+
+    outData.stats.unweldedVertexCount = (uint32_t)indices.size();
+    outData.vertices.assign(vertices.begin(), vertices.end());
+    outData.indices.assign(indices.begin(), indices.end());
+    outData.submeshes.assign(submeshes.begin(), submeshes.end());
+
+    return true;
+}
+
+static bool CompareMeshData(const MeshData& a, const MeshData& b, float& outMaxError)
+{
+    outMaxError = 0.0f;
+
+    if (a.indices != b.indices || a.vertices.size() != b.vertices.size() || a.submeshes.size() != b.submeshes.size())
+        return false;
+
+    for (size_t i = 0; i < a.submeshes.size(); i++)
+        if (a.submeshes[i].indexOffset != b.submeshes[i].indexOffset || a.submeshes[i].indexCount != b.submeshes[i].indexCount)
+            return false;
+
+    for (size_t i = 0; i < a.vertices.size(); i++)
+    {
+        const float* va = &a.vertices[i].pos.x;
+        const float* vb = &b.vertices[i].pos.x;
+        for (uint32_t k = 0; k < sizeof(MeshVertex) / sizeof(float); k++)
+            outMaxError = fmaxf(outMaxError, fabsf(va[k] - vb[k]));
+    }
+
+    return true;
+}
+
+void RunObjParseBenchmark(JobSystem& jobs, const std::vector<std::string>& paths, std::vector<ObjParseBenchmarkCase>& outCases)
+{
+    outCases.clear();
+
+    for (const std::string& path : paths)
+    {
+        ObjParseBenchmarkCase& bench = outCases.emplace_back();
+        bench.path = path;
+
+        int64_t timestamp;
+        if (!GetFileStamp(path, bench.bytes, timestamp))
+            bench.bytes = 0;
+
+        MeshData tinyobj, parsed;
+        Arena scratch;
+        bool tinyobjOk = true, parsedOk = true;
+
+        double bestTinyobj = 1e30, bestParser = 1e30;
+        for (uint32_t run = 0; run < 5; run++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            tinyobjOk &= LoadMeshDataTinyObj(path, tinyobj);
+            auto mid = std::chrono::high_resolution_clock::now();
+            scratch.Reset();
+            parsedOk &= LoadMeshData(jobs, path, scratch, parsed);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double tinyobjMs = std::chrono::duration<double, std::milli>(mid - start).count();
+            double parserMs = std::chrono::duration<double, std::milli>(end - mid).count();
+            bestTinyobj = tinyobjMs < bestTinyobj ? tinyobjMs : bestTinyobj;
+            bestParser = parserMs < bestParser ? parserMs : bestParser;
+        }
+
+        double megabytes = bench.bytes / (1024.0 * 1024.0);
+        bench.tinyobjMs = bestTinyobj;
+        bench.parserMs = bestParser;
+        bench.tinyobjMBs = bestTinyobj > 0.0 ? megabytes / (bestTinyobj / 1000.0) : 0.0;
+        bench.parserMBs = bestParser > 0.0 ? megabytes / (bestParser / 1000.0) : 0.0;
+        bench.identical = tinyobjOk && parsedOk && CompareMeshData(tinyobj, parsed, bench.maxError);
+    }
+}
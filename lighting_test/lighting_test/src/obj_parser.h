@@ -0,0 +1,31 @@
+#pragma once
+
+#include "arena.h"
+#include "mesh.h"
+#include "jobs.h"
+
+// obj reader of the load path: the file is mapped and cut into chunks at line boundaries, a first pass
+// counts the attributes of every chunk so the second one can parse them in parallel straight into the
+// shared position/normal/uv arrays, faces are then triangulated and welded into MeshData in file order
+//
+// understands v, vt, vn, f, o and g and skips everything else, triangulation and the submesh split on
+// o/g follow tinyobj so meshes come out the same as through tinyobj::LoadObj
+
+// fills vertices, indices, submeshes and stats.unweldedVertexCount of outData. every temporary comes from scratch,
+// the heap only sees the mapped file and the arrays of outData
+bool ParseObj(JobSystem& jobs, const std::string& path, Arena& scratch, MeshData& outData);
+
+struct ObjParseBenchmarkCase
+{
+    std::string path;
+    uint64_t bytes;
+    double tinyobjMs;  // LoadMeshDataTinyObj, the old load path
+    double parserMs;   // LoadMeshData
+    double tinyobjMBs;
+    double parserMBs;
+    bool identical;    // same indices and submeshes, vertices within maxError
+    float maxError;
+};
+
+// both paths on every mesh, best of a few runs
+void RunObjParseBenchmark(JobSystem& jobs, const std::vector<std::string>& paths, std::vector<ObjParseBenchmarkCase>& outCases);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "core.h"
+
+// the window and its input, platform_win32.cpp opens a real window, platform_headless.cpp has none and
+// runs the app from a console. both also hold the entry point and the frame loop of their build
+
+// virtual key codes, same values as windows
+constexpr uint8_t KEY_A = 0x41;
+constexpr uint8_t KEY_D = 0x44;
+constexpr uint8_t KEY_E = 0x45;
+constexpr uint8_t KEY_Q = 0x51;
+constexpr uint8_t KEY_S = 0x53;
+constexpr uint8_t KEY_W = 0x57;
+
+bool PlatformInit(const char* title, uint32_t width, uint32_t height);
+
+// handles pending window messages, false once the window was closed
+bool PlatformPumpEvents();
+
+// client area, changes when the user resizes the window
+void GetPlatformWindowSize(uint32_t& outWidth, uint32_t& outHeight);
+
+bool IsPlatformKeyDown(uint8_t key);
+
+// HWND on windows, null when headless
+void* GetPlatformWindowHandle();
@@ -0,0 +1,336 @@
+#include "platform.h"
+#include "app.h"
+#include "profiler.h"
+
+#include <limits.h>
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <string.h>
+#include <stdlib.h>
+
+// no window, no input: the app runs a fixed number of frames against whatever renderer was linked in
+// (the null one in the cmake build) and prints where the time went
+
+uint32_t gHeadlessWidth = 1600;
+uint32_t gHeadlessHeight = 900;
+
+bool PlatformInit(const char*, uint32_t width, uint32_t height)
+{
+    gHeadlessWidth = width;
+    gHeadlessHeight = height;
+    return true;
+}
+
+bool PlatformPumpEvents()
+{
+    return true;
+}
+
+void GetPlatformWindowSize(uint32_t& outWidth, uint32_t& outHeight)
+{
+    outWidth = gHeadlessWidth;
+    outHeight = gHeadlessHeight;
+}
+
+bool IsPlatformKeyDown(uint8_t)
+{
+    return false;
+}
+
+void* GetPlatformWindowHandle()
+{
+    return nullptr;
+}
+
+// a whole number in [0, max], larger ones are clamped to max
+static bool ParseCount(const char* value, int max, int& outCount)
+{
+    char* end;
+    long count = strtol(value, &end, 10);
+    if (end == value || *end || count < 0)
+        return false;
+
+    outCount = count < max ? (int)count : max;
+    return true;
+}
+
+static void PrintUsage()
+{
+    printf("usage: lighting_headless [options]\n"
+           "  --frames N        frames to run (default 300)\n"
+           "  --grid N          instance grid size, N * N copies of the model (default 0, at most 100)\n"
+           "  --lights N        point light count (default 0, at most 4096)\n"
+           "  --size WxH        view size (default 1600x900)\n"
+           "  --data DIR        directory with meshes/, textures/ and shaders/ (default current)\n"
+           "  --reference PATH  draw the last frame with the cpu rasterizer into a png, turns shadows off since it has none\n"
+           "  --golden PATH     compare the reference against this png, fails when it differs past the tolerance\n"
+           "  --trace PATH      write a chrome trace of the last 60 frames\n"
+           "  --flythrough PATH replay a camera script instead, see flythrough.h, its frames replace --frames\n"
+           "  --report PATH     write the flythrough's frame times and percentiles as json\n");
+}
+
+int main(int argc, char** argv)
+{
+    ProfilerSetThreadName("main");
+
+    AppSettings settings;
+    uint32_t frameCount = 300;
+    uint32_t width = 1600, height = 900;
+    const char* referencePath = nullptr;
+    const char* goldenPath = nullptr;
+    const char* tracePath = nullptr;
+    const char* flythroughPath = nullptr;
+    const char* reportPath = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+        {
+            PrintUsage();
+            return 0;
+        }
+
+        if (!value)
+        {
+            fprintf(stderr, "missing value for %s\n", arg);
+            PrintUsage();
+            return 1;
+        }
+        i++;
+
+        int count = 0;
+        if (!strcmp(arg, "--frames") || !strcmp(arg, "--grid") || !strcmp(arg, "--lights"))
+        {
+            int max = !strcmp(arg, "--grid") ? APP_MAX_INSTANCE_GRID_SIZE : !strcmp(arg, "--lights") ? APP_MAX_POINT_LIGHTS : INT_MAX;
+            if (!ParseCount(value, max, count))
+            {
+                fprintf(stderr, "bad count %s for %s\n", value, arg);
+                return 1;
+            }
+        }
+
+        if (!strcmp(arg, "--frames"))
+            frameCount = (uint32_t)count;
+        else if (!strcmp(arg, "--grid"))
+            settings.instanceGridSize = count;
+        else if (!strcmp(arg, "--lights"))
+            settings.pointLightCount = count;
+        else if (!strcmp(arg, "--size"))
+        {
+            if (sscanf(value, "%ux%u", &width, &height) != 2 || !width || !height)
+            {
+                fprintf(stderr, "bad size %s\n", value);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--data"))
+        {
+            std::error_code error;
+            std::filesystem::current_path(value, error);
+            if (error)
+            {
+                fprintf(stderr, "cannot enter %s: %s\n", value, error.message().c_str());
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--reference"))
+            referencePath = value;
+        else if (!strcmp(arg, "--golden"))
+            goldenPath = value;
+        else if (!strcmp(arg, "--trace"))
+            tracePath = value;
+        else if (!strcmp(arg, "--flythrough"))
+            flythroughPath = value;
+        else if (!strcmp(arg, "--report"))
+            reportPath = value;
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", arg);
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    Flythrough flythrough;
+    if (flythroughPath)
+    {
+        std::string error;
+        if (!LoadFlythrough(flythroughPath, flythrough, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        frameCount = GetFlythroughFrameCount(flythrough);
+        if (flythrough.instanceGridSize >= 0)
+            settings.instanceGridSize = std::min(flythrough.instanceGridSize, APP_MAX_INSTANCE_GRID_SIZE);
+        if (flythrough.pointLightCount >= 0)
+            settings.pointLightCount = std::min(flythrough.pointLightCount, APP_MAX_POINT_LIGHTS);
+    }
+    else if (reportPath)
+    {
+        fprintf(stderr, "--report needs --flythrough\n");
+        return 1;
+    }
+
+    if (goldenPath && !referencePath)
+    {
+        fprintf(stderr, "--golden needs --reference\n");
+        return 1;
+    }
+
+    // the reference has no shadow term, the frames it is drawn from must not have one either
+    if (referencePath)
+        settings.shadows = false;
+
+    check(PlatformInit("lighting test", width, height));
+    check(RendererInit(GetPlatformWindowHandle(), width, height, GetAppJobs()));
+
+    if (!AppInit(settings))
+    {
+        fprintf(stderr, "no mesh could be loaded, run from the project directory or pass --data\n");
+        return 1;
+    }
+
+    printf("renderer %s, %ux%u, grid %d, %d point lights, %u frames%s\n", GetRendererName(), width, height,
+        settings.instanceGridSize, settings.pointLightCount, frameCount, settings.shadows ? "" : ", shadows off to match the reference");
+
+    // the first frames still warm caches and grow buffers, they are not counted
+    constexpr uint32_t WARMUP_FRAMES = 10;
+    uint32_t traceFrames = frameCount < 60 ? frameCount : 60;
+
+    double totalMs = 0.0;
+    double minMs = 1e30;
+    double maxMs = 0.0;
+    uint32_t measuredFrames = 0;
+    uint32_t shadowFaces = 0; // drawn over the measured frames, the cube keeps the rest
+    std::map<std::string, double> scopeTotals; // main thread, top level, measured frames only
+    FlythroughRun flythroughRun;
+
+    for (uint32_t frame = 0; frame < frameCount && PlatformPumpEvents(); frame++)
+    {
+        if (tracePath && frame == frameCount - traceFrames)
+            ProfilerStartCapture(traceFrames);
+
+        uint64_t start = ProfilerNow();
+
+        if (flythroughPath)
+            AppSetFlythroughPose(GetFlythroughFramePose(flythrough, frame));
+
+        AppUpdate();
+        RendererBeginFrame(width, height);
+        RendererDrawFrame(GetAppRenderFrame());
+
+        double ms = (double)(ProfilerNow() - start) / 1e6;
+
+        ProfilerEndFrame();
+
+        if (flythroughPath)
+            RecordFlythroughFrame(flythrough, frame, GetRendererStats(), flythroughRun);
+
+        if (frame < WARMUP_FRAMES && frameCount > WARMUP_FRAMES)
+            continue;
+
+        totalMs += ms;
+        minMs = ms < minMs ? ms : minMs;
+        maxMs = ms > maxMs ? ms : maxMs;
+        measuredFrames++;
+        shadowFaces += GetRendererStats().shadowFacesDrawn;
+
+        uint16_t mainThread = GetProfilerStats().mainThread;
+        for (const ProfileEvent& event : GetProfilerLastFrame())
+        {
+            if (event.thread == mainThread && event.depth == 0)
+                scopeTotals[event.name] += (double)(event.endNs - event.startNs) / 1e6;
+        }
+    }
+
+    if (measuredFrames)
+    {
+        RendererStats stats = GetRendererStats();
+        double avgMs = totalMs / measuredFrames;
+        printf("frame avg %.3f ms (%.1f fps), min %.3f ms, max %.3f ms over %u frames\n", avgMs, 1000.0 / avgMs, minMs, maxMs,
+            measuredFrames);
+        printf("last frame: %u draws, %u instances, %u triangles\n", stats.drawCalls, stats.instancesDrawn, stats.trianglesDrawn);
+        printf("shadow cube: %u of %u faces drawn\n", shadowFaces, measuredFrames * SHADOW_CUBE_FACES);
+        printf("render commands: %u, %u state changes, %u already bound\n", stats.commands.commands, stats.commands.stateChanges,
+            stats.commands.stateChangesSkipped);
+        TextureStreamingStats streaming = GetAppTextureStreamingStats();
+        printf("texture streaming: %.1f MB resident, %.1f MB wanted, %u in flight, %u blurry meshes\n", streaming.residentBytes / (1024.0 * 1024.0),
+            streaming.wantedBytes / (1024.0 * 1024.0), streaming.inFlight, streaming.blurryMeshes);
+        ArenaStats frameArena = GetAppFrameArenaStats();
+        printf("frame arena: %llu allocations, %.1f KB peak, %.1f KB reserved, %u blocks from the heap over the run\n",
+            (unsigned long long)frameArena.allocations, frameArena.peakBytes / 1024.0, frameArena.reservedBytes / 1024.0, frameArena.heapAllocations);
+        for (const auto& [name, ms] : scopeTotals)
+            printf("  %-24s %8.3f ms\n", name.c_str(), ms / measuredFrames);
+    }
+
+    int result = 0;
+
+    if (flythroughPath)
+    {
+        PrintFlythroughSummary(flythroughRun);
+
+        if (reportPath)
+        {
+            if (WriteFlythroughReport(reportPath, flythrough, flythroughRun, GetRendererName(), width, height, settings.instanceGridSize,
+                settings.pointLightCount))
+                printf("report written to %s\n", reportPath);
+            else
+            {
+                fprintf(stderr, "failed to write %s\n", reportPath);
+                result = 1;
+            }
+        }
+    }
+
+    if (tracePath)
+    {
+        if (WriteChromeTrace(tracePath))
+            printf("trace written to %s\n", tracePath);
+        else
+        {
+            fprintf(stderr, "failed to write %s\n", tracePath);
+            result = 1;
+        }
+    }
+
+    if (referencePath)
+    {
+        SoftwareReference reference = AppRenderSoftwareReference(referencePath, goldenPath);
+        printf("reference drawn in %.2f ms (%.1f fps), vertex %.2f ms, bin %.2f ms, raster %.2f ms, %llu pixels shaded\n", reference.ms,
+            1000.0f / reference.ms, reference.stats.vertexMs, reference.stats.binMs, reference.stats.rasterMs,
+            (unsigned long long)reference.stats.pixelsShaded);
+
+        if (reference.written)
+            printf("reference written to %s\n", referencePath);
+        else
+        {
+            fprintf(stderr, "failed to write %s\n", referencePath);
+            result = 1;
+        }
+
+        if (reference.compared)
+        {
+            const RasterCompareResult& compare = reference.compare;
+            if (!compare.loaded)
+            {
+                fprintf(stderr, "cannot read %s at %ux%u\n", goldenPath, width, height);
+                result = 1;
+            }
+            else
+            {
+                printf("golden %s: %u of %u pixels off by more than %u, at most %u, %s\n", goldenPath, compare.pixelsOver, width * height,
+                    RASTER_GOLDEN_CHANNEL_TOLERANCE, compare.maxDifference, compare.passed ? "passed" : "FAILED");
+                if (!compare.passed)
+                    result = 1;
+            }
+        }
+    }
+
+    return result;
+}
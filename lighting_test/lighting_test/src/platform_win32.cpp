@@ -0,0 +1,188 @@
+#include "platform.h"
+#include "app.h"
+#include "profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <windows.h>
+
+#include "../vendor/imgui/imgui.h"
+#include "../vendor/imgui/backends/imgui_impl_win32.h"
+
+bool gAppShouldRun = true;
+
+uint32_t gWindowWidth = 1600;
+uint32_t gWindowHeight = 900;
+HWND gWindow = nullptr;
+
+bool gKeyboard[256] = {};
+
+LRESULT WndProc(HWND hWnd, UINT Msg, WPARAM wParam, LPARAM lParam)
+{
+    extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+    ImGui_ImplWin32_WndProcHandler(hWnd, Msg, wParam, lParam);
+
+    switch (Msg)
+    {
+        case WM_KEYDOWN:
+            gKeyboard[(uint8_t)wParam] = true;
+            break;
+
+        case WM_KEYUP:
+            gKeyboard[(uint8_t)wParam] = false;
+            break;
+
+        // the renderer picks the new size up at the start of the next frame
+        case WM_SIZE:
+            gWindowWidth = LOWORD(lParam);
+            gWindowHeight = HIWORD(lParam);
+            break;
+
+        case WM_CLOSE:
+            gAppShouldRun = false;
+            break;
+    }
+
+    return DefWindowProcA(hWnd, Msg, wParam, lParam);
+}
+
+bool PlatformInit(const char* title, uint32_t width, uint32_t height)
+{
+    gWindowWidth = width;
+    gWindowHeight = height;
+
+    HINSTANCE hInst = GetModuleHandleA(nullptr);
+
+    WNDCLASSEXA wndClass = {};
+    wndClass.cbSize = sizeof(WNDCLASSEXA);
+    wndClass.hInstance = hInst;
+    wndClass.lpfnWndProc = WndProc;
+    wndClass.lpszClassName = "boh";
+
+    if (!RegisterClassExA(&wndClass))
+        return false;
+
+    gWindow = CreateWindowExA(0, "boh", title, WS_CAPTION | WS_MAXIMIZEBOX | WS_MINIMIZEBOX | WS_SIZEBOX | WS_SYSMENU,
+                100, 100, gWindowWidth, gWindowHeight, nullptr, nullptr, hInst, nullptr);
+
+    if (!gWindow)
+        return false;
+
+    ShowWindow(gWindow, SW_SHOW);
+
+    return true;
+}
+
+bool PlatformPumpEvents()
+{
+    MSG msg;
+    while (PeekMessageA(&msg, gWindow, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessageA(&msg);
+    }
+
+    return gAppShouldRun;
+}
+
+void GetPlatformWindowSize(uint32_t& outWidth, uint32_t& outHeight)
+{
+    outWidth = gWindowWidth;
+    outHeight = gWindowHeight;
+}
+
+bool IsPlatformKeyDown(uint8_t key)
+{
+    return gKeyboard[key];
+}
+
+void* GetPlatformWindowHandle()
+{
+    return gWindow;
+}
+
+// lighting_test.exe --flythrough PATH [--report PATH] replays the script with vsync off and exits when it is done,
+// see flythrough.h. the report defaults to flythrough.json in the working directory
+int APIENTRY WinMain(HINSTANCE hInst, HINSTANCE hInstPrev, PSTR cmdline, int cmdshow)
+{
+    ProfilerSetThreadName("main");
+
+    const char* flythroughPath = nullptr;
+    const char* reportPath = "flythrough.json";
+    for (int i = 1; i + 1 < __argc; i += 2)
+    {
+        if (!strcmp(__argv[i], "--flythrough"))
+            flythroughPath = __argv[i + 1];
+        else if (!strcmp(__argv[i], "--report"))
+            reportPath = __argv[i + 1];
+    }
+
+    AppSettings settings;
+    Flythrough flythrough;
+    if (flythroughPath)
+    {
+        std::string error;
+        if (!LoadFlythrough(flythroughPath, flythrough, error))
+        {
+            MessageBoxA(nullptr, error.c_str(), "lighting test", MB_OK | MB_ICONERROR);
+            return 1;
+        }
+
+        if (flythrough.instanceGridSize >= 0)
+            settings.instanceGridSize = (std::min)(flythrough.instanceGridSize, APP_MAX_INSTANCE_GRID_SIZE);
+        if (flythrough.pointLightCount >= 0)
+            settings.pointLightCount = (std::min)(flythrough.pointLightCount, APP_MAX_POINT_LIGHTS);
+    }
+
+    check(PlatformInit("lighting test", 1600, 900));
+
+    ImGui::CreateContext();
+    ImGui_ImplWin32_Init(gWindow);
+
+    check(RendererInit(gWindow, gWindowWidth, gWindowHeight, GetAppJobs()));
+    RendererSetVsync(!flythroughPath);
+
+    check(AppInit(settings));
+
+    FlythroughRun flythroughRun;
+    uint32_t flythroughFrames = flythroughPath ? GetFlythroughFrameCount(flythrough) : 0;
+
+    for (uint32_t frame = 0; PlatformPumpEvents(); frame++)
+    {
+        if (flythroughPath)
+        {
+            if (frame == flythroughFrames)
+                break;
+
+            AppSetFlythroughPose(GetFlythroughFramePose(flythrough, frame));
+        }
+
+        AppUpdate();
+
+        ImGui_ImplWin32_NewFrame();
+        RendererBeginFrame(gWindowWidth, gWindowHeight);
+        ImGui::NewFrame();
+
+        AppImgui();
+
+        RendererDrawFrame(GetAppRenderFrame());
+        ProfilerEndFrame();
+
+        if (flythroughPath)
+            RecordFlythroughFrame(flythrough, frame, GetRendererStats(), flythroughRun);
+    }
+
+    if (flythroughPath && flythroughRun.frames.size() == flythrough.frames)
+    {
+        if (!WriteFlythroughReport(reportPath, flythrough, flythroughRun, GetRendererName(), gWindowWidth, gWindowHeight,
+            settings.instanceGridSize, settings.pointLightCount))
+        {
+            MessageBoxA(nullptr, reportPath, "lighting test: failed to write", MB_OK | MB_ICONERROR);
+            return 1;
+        }
+    }
+
+    return 0;
+}
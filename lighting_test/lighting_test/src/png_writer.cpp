@@ -0,0 +1,115 @@
+#include "png_writer.h"
+
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+struct CrcTable
+{
+    uint32_t values[256];
+
+    CrcTable()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (uint32_t k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            values[i] = c;
+        }
+    }
+};
+
+static uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    static CrcTable table;
+
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; i++)
+        crc = table.values[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void PutU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void PutChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+    PutU32(out, (uint32_t)data.size());
+
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+
+    PutU32(out, Crc32(out.data() + typeOffset, out.size() - typeOffset));
+}
+
+bool WritePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    // filter byte 0 (none) in front of every row
+    size_t rowSize = (size_t)width * 4 + 1;
+    std::vector<uint8_t> raw(rowSize * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        raw[y * rowSize] = 0;
+        memcpy(&raw[y * rowSize + 1], rgba + (size_t)y * width * 4, (size_t)width * 4);
+    }
+
+    // zlib header, stored blocks of at most 65535 bytes, adler32
+    std::vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+
+    size_t offset = 0;
+    do
+    {
+        size_t blockSize = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+        bool last = offset + blockSize == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back((uint8_t)blockSize);
+        zlib.push_back((uint8_t)(blockSize >> 8));
+        zlib.push_back((uint8_t)~blockSize);
+        zlib.push_back((uint8_t)(~blockSize >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    PutU32(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    PutU32(header, width);
+    PutU32(header, height);
+    header.push_back(8); // bit depth
+    header.push_back(6); // rgba
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+
+    static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+    std::vector<uint8_t> png(signature, signature + sizeof(signature));
+    PutChunk(png, "IHDR", header);
+    PutChunk(png, "IDAT", zlib);
+    PutChunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    file.write((const char*)png.data(), png.size());
+    return (bool)file;
+}
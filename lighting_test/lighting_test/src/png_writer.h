@@ -0,0 +1,9 @@
+#pragma once
+
+#include "core.h"
+
+#include <string>
+
+// rgba8 in, png out, the zlib stream uses stored deflate blocks so no compressor is needed,
+// meant for reference images and debugging, not for shipping assets
+bool WritePng(const std::string& path, const uint8_t* rgba, uint32_t width, uint32_t height);
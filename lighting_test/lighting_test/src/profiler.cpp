@@ -0,0 +1,290 @@
+#include "profiler.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+// single producer (the owning thread), single consumer (ProfilerEndFrame)
+struct ThreadRing
+{
+    ProfileEvent events[PROFILER_RING_SIZE];
+    std::atomic<uint64_t> writeIndex = { 0 };
+    uint64_t readIndex = 0;  // consumer only
+    uint8_t depth = 0;       // producer only
+    uint16_t thread = 0;
+    std::string name;        // under sMutex
+};
+
+static std::mutex sMutex;
+static std::vector<std::unique_ptr<ThreadRing>> sRings;
+static thread_local ThreadRing* tRing = nullptr;
+
+// main thread only from here on
+static uint64_t sFrameIndex = 0;
+static uint64_t sFrameStart = 0;
+static uint64_t sDroppedEvents = 0;
+static uint16_t sMainThread = 0;
+static std::vector<ProfileEvent> sLastFrame;
+static ProfileFrameTimes sHistory[PROFILER_HISTORY];
+static uint64_t sHistoryFrameStarts[PROFILER_HISTORY];
+
+static std::vector<ProfileEvent> sCapture;
+static uint64_t sCaptureFirstFrame = 0;
+static uint64_t sCaptureEndFrame = 0;
+
+uint64_t ProfilerNow()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static ThreadRing* GetThreadRing()
+{
+    if (!tRing)
+    {
+        // once per thread, rings live until exit so drained pointers never dangle
+        std::lock_guard<std::mutex> lock(sMutex);
+        sRings.push_back(std::make_unique<ThreadRing>());
+        tRing = sRings.back().get();
+        tRing->thread = (uint16_t)(sRings.size() - 1);
+        tRing->name = "thread " + std::to_string(tRing->thread);
+    }
+
+    return tRing;
+}
+
+void ProfilerSetThreadName(const char* name)
+{
+    ThreadRing* ring = GetThreadRing();
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    ring->name = name;
+}
+
+ProfileScope::ProfileScope(const char* name, bool wait)
+    : mName(name), mWait(wait)
+{
+    GetThreadRing()->depth++;
+    mStart = ProfilerNow();
+}
+
+ProfileScope::~ProfileScope()
+{
+    uint64_t end = ProfilerNow();
+
+    ThreadRing* ring = tRing;
+    ring->depth--;
+
+    uint64_t index = ring->writeIndex.load(std::memory_order_relaxed);
+    ProfileEvent& event = ring->events[index & (PROFILER_RING_SIZE - 1)];
+    event.name = mName;
+    event.startNs = mStart;
+    event.endNs = end;
+    event.thread = ring->thread;
+    event.depth = ring->depth;
+    event.wait = mWait;
+
+    ring->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+// copies what the ring got since the last drain, events the producer lapped during the copy are dropped
+static void DrainRing(ThreadRing& ring, std::vector<ProfileEvent>& out)
+{
+    uint64_t write = ring.writeIndex.load(std::memory_order_acquire);
+    uint64_t read = ring.readIndex;
+
+    if (write - read > PROFILER_RING_SIZE)
+    {
+        sDroppedEvents += write - read - PROFILER_RING_SIZE;
+        read = write - PROFILER_RING_SIZE;
+    }
+
+    size_t first = out.size();
+    for (uint64_t i = read; i < write; i++)
+        out.push_back(ring.events[i & (PROFILER_RING_SIZE - 1)]);
+
+    uint64_t writeAfter = ring.writeIndex.load(std::memory_order_acquire);
+    if (writeAfter - read > PROFILER_RING_SIZE)
+    {
+        uint64_t overwritten = std::min<uint64_t>(writeAfter - read - PROFILER_RING_SIZE, write - read);
+        out.erase(out.begin() + first, out.begin() + first + (size_t)overwritten);
+        sDroppedEvents += overwritten;
+    }
+
+    ring.readIndex = write;
+}
+
+void ProfilerEndFrame()
+{
+    uint64_t now = ProfilerNow();
+    if (sFrameStart == 0)
+        sFrameStart = now;
+
+    sMainThread = GetThreadRing()->thread;
+
+    sLastFrame.clear();
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        for (const std::unique_ptr<ThreadRing>& ring : sRings)
+            DrainRing(*ring, sLastFrame);
+    }
+
+    std::sort(sLastFrame.begin(), sLastFrame.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+    {
+        return a.thread != b.thread ? a.thread < b.thread : a.startNs < b.startNs;
+    });
+
+    uint64_t waitNs = 0;
+    for (const ProfileEvent& event : sLastFrame)
+        if (event.wait && event.thread == sMainThread)
+            waitNs += event.endNs - event.startNs;
+
+    uint64_t frameNs = now - sFrameStart;
+    uint32_t slot = (uint32_t)(sFrameIndex % PROFILER_HISTORY);
+    sHistory[slot].frameMs = frameNs / 1e6f;
+    sHistory[slot].cpuMs = (frameNs - std::min(waitNs, frameNs)) / 1e6f;
+    sHistory[slot].gpuMs = 0.0f;
+    sHistoryFrameStarts[slot] = sFrameStart;
+
+    if (sFrameIndex >= sCaptureFirstFrame && sFrameIndex < sCaptureEndFrame)
+        sCapture.insert(sCapture.end(), sLastFrame.begin(), sLastFrame.end());
+
+    sFrameStart = now;
+    sFrameIndex++;
+}
+
+void ProfilerAddGpuFrame(uint64_t frameIndex, const ProfileGpuTiming* timings, uint32_t count, float frameMs)
+{
+    if (frameIndex >= sFrameIndex || sFrameIndex - frameIndex > PROFILER_HISTORY)
+        return;
+
+    uint32_t slot = (uint32_t)(frameIndex % PROFILER_HISTORY);
+    sHistory[slot].gpuMs = frameMs;
+
+    // still added after the capture ended, gpu results trail the cpu by a few frames
+    if (frameIndex >= sCaptureFirstFrame && frameIndex < sCaptureEndFrame)
+    {
+        uint64_t base = sHistoryFrameStarts[slot];
+        for (uint32_t i = 0; i < count; i++)
+        {
+            ProfileEvent& event = sCapture.emplace_back();
+            event.name = timings[i].name;
+            event.startNs = base + (uint64_t)(timings[i].startMs * 1e6f);
+            event.endNs = base + (uint64_t)(timings[i].endMs * 1e6f);
+            event.thread = PROFILER_GPU_THREAD;
+            event.depth = 0;
+            event.wait = false;
+        }
+    }
+}
+
+const std::vector<ProfileEvent>& GetProfilerLastFrame()
+{
+    return sLastFrame;
+}
+
+void GetProfilerHistory(ProfileFrameTimes* outTimes)
+{
+    for (uint32_t i = 0; i < PROFILER_HISTORY; i++)
+    {
+        // frame sFrameIndex - PROFILER_HISTORY + i
+        if (sFrameIndex + i < PROFILER_HISTORY)
+            outTimes[i] = {};
+        else
+            outTimes[i] = sHistory[(sFrameIndex + i) % PROFILER_HISTORY];
+    }
+}
+
+bool GetProfilerFrameTimes(uint64_t frameIndex, ProfileFrameTimes& outTimes)
+{
+    if (frameIndex >= sFrameIndex || sFrameIndex - frameIndex > PROFILER_HISTORY)
+        return false;
+
+    outTimes = sHistory[frameIndex % PROFILER_HISTORY];
+    return true;
+}
+
+ProfilerStats GetProfilerStats()
+{
+    ProfilerStats stats;
+    stats.frameIndex = sFrameIndex;
+    stats.droppedEvents = sDroppedEvents;
+    stats.mainThread = sMainThread;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    stats.threadCount = (uint32_t)sRings.size();
+    return stats;
+}
+
+void ProfilerStartCapture(uint32_t frameCount)
+{
+    sCapture.clear();
+    sCaptureFirstFrame = sFrameIndex;
+    sCaptureEndFrame = sFrameIndex + frameCount;
+}
+
+bool IsProfilerCapturing()
+{
+    return sFrameIndex < sCaptureEndFrame;
+}
+
+static void WriteJsonString(std::ofstream& file, const char* text)
+{
+    file << '"';
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            file << '\\' << *c;
+        else if ((unsigned char)*c >= 0x20)
+            file << *c;
+    }
+    file << '"';
+}
+
+bool WriteChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+        return false;
+
+    uint64_t origin = UINT64_MAX;
+    for (const ProfileEvent& event : sCapture)
+        origin = std::min(origin, event.startNs);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto writeThreadName = [&](uint32_t thread, const char* name)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":";
+        WriteJsonString(file, name);
+        file << "}}";
+        first = false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        for (const std::unique_ptr<ThreadRing>& ring : sRings)
+            writeThreadName(ring->thread, ring->name.c_str());
+    }
+    writeThreadName(PROFILER_GPU_THREAD, "gpu");
+
+    // chrome wants microseconds
+    char number[64];
+    for (const ProfileEvent& event : sCapture)
+    {
+        file << ",\n{\"name\":";
+        WriteJsonString(file, event.name);
+        snprintf(number, sizeof(number), "%.3f", (event.startNs - origin) / 1000.0);
+        file << ",\"cat\":\"" << (event.thread == PROFILER_GPU_THREAD ? "gpu" : event.wait ? "wait" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << number;
+        snprintf(number, sizeof(number), "%.3f", (event.endNs - event.startNs) / 1000.0);
+        file << ",\"dur\":" << number << ",\"pid\":1,\"tid\":" << event.thread << "}";
+    }
+
+    file << "\n]}\n";
+    file.flush();
+    return file.good();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "core.h"
+
+#include <string>
+#include <vector>
+
+// cpu scopes go to a ring buffer owned by the thread that records them, the only shared state on the
+// hot path is the release store of the ring's write index. ProfilerEndFrame drains every ring on the
+// main thread, keeps the last frame for the ui and a rolling history of frame times, and feeds the
+// chrome trace capture. gpu timings are measured by the renderer and handed in once they are ready
+
+constexpr uint32_t PROFILER_RING_SIZE = 1 << 14; // events per thread, power of two
+constexpr uint32_t PROFILER_HISTORY = 240;       // frames kept for the graph
+constexpr uint32_t PROFILER_GPU_THREAD = 0xffff; // thread index of gpu events
+constexpr uint32_t PROFILER_GPU_LATENCY = 4;     // frames a renderer may take to hand in its gpu timings
+
+struct ProfileEvent
+{
+    const char* name; // must outlive the profiler, string literals or names of long lived objects
+    uint64_t startNs;
+    uint64_t endNs;
+    uint16_t thread;
+    uint8_t depth;
+    bool wait; // time the thread spent blocked, not counted as cpu work
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(const char* name, bool wait);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* mName;
+    uint64_t mStart;
+    bool mWait;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_WAIT_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+
+// nanoseconds on a monotonic clock, the time base of every event
+uint64_t ProfilerNow();
+
+// shown in the chrome trace, call once from the thread itself
+void ProfilerSetThreadName(const char* name);
+
+struct ProfileGpuTiming
+{
+    const char* name;
+    float startMs; // relative to the first timestamp of the frame
+    float endMs;
+};
+
+struct ProfileFrameTimes
+{
+    float frameMs; // between two ProfilerEndFrame calls
+    float cpuMs;   // frameMs minus the main thread's wait scopes
+    float gpuMs;   // 0 until the gpu timings of the frame arrive
+};
+
+struct ProfilerStats
+{
+    uint64_t frameIndex;    // frame being recorded
+    uint32_t threadCount;
+    uint16_t mainThread;    // thread index of the caller of ProfilerEndFrame
+    uint64_t droppedEvents; // overwritten before they were drained
+};
+
+// closes the current frame, call once per frame from the main thread
+void ProfilerEndFrame();
+
+// timings of an earlier frame, placed on the trace at the start of that frame's cpu time
+void ProfilerAddGpuFrame(uint64_t frameIndex, const ProfileGpuTiming* timings, uint32_t count, float frameMs);
+
+// every event of the last finished frame, sorted by thread and then start time
+const std::vector<ProfileEvent>& GetProfilerLastFrame();
+
+// oldest first, outTimes holds PROFILER_HISTORY entries and the ones not recorded yet are zero
+void GetProfilerHistory(ProfileFrameTimes* outTimes);
+
+// times of one finished frame, false once it fell out of the history
+bool GetProfilerFrameTimes(uint64_t frameIndex, ProfileFrameTimes& outTimes);
+
+ProfilerStats GetProfilerStats();
+
+// records the next frameCount frames, WriteChromeTrace writes them once the capture is over
+void ProfilerStartCapture(uint32_t frameCount);
+bool IsProfilerCapturing();
+bool WriteChromeTrace(const std::string& path);
@@ -0,0 +1,314 @@
+#include "render_commands.h"
+#include "profiler.h"
+
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+uint64_t MakeRenderKey(uint32_t pass, uint32_t shader, uint32_t material, float depth, uint32_t sequence)
+{
+    check(pass < RENDER_KEY_PASS_COUNT && shader < RENDER_KEY_SHADER_COUNT && material < RENDER_KEY_MATERIAL_COUNT);
+
+    // bits of a positive float sort like the float does, anything behind the eye is as near as it gets
+    uint32_t depthBits = 0;
+    if (depth > 0.0f)
+        memcpy(&depthBits, &depth, sizeof(float));
+
+    return (uint64_t)pass << 60 | (uint64_t)shader << 56 | (uint64_t)material << 40 | (uint64_t)(depthBits >> 8) << 16 | (sequence & 0xffff);
+}
+
+uint32_t GetRenderKeyPass(uint64_t key)
+{
+    return (uint32_t)(key >> 60);
+}
+
+uint32_t GetRenderKeyShader(uint64_t key)
+{
+    return (uint32_t)(key >> 56) & (RENDER_KEY_SHADER_COUNT - 1);
+}
+
+uint32_t GetRenderKeyMaterial(uint64_t key)
+{
+    return (uint32_t)(key >> 40) & (RENDER_KEY_MATERIAL_COUNT - 1);
+}
+
+float GetNearestInstanceDepth(const InstanceData* instances, uint32_t count, const Vec4& viewDepth)
+{
+    float nearest = FLT_MAX;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float* origin = instances[i].model.m[3];
+        float depth = origin[0] * viewDepth.x + origin[1] * viewDepth.y + origin[2] * viewDepth.z + viewDepth.w;
+        nearest = depth < nearest ? depth : nearest;
+    }
+
+    return nearest;
+}
+
+void ResetRenderCommands(RenderCommandQueue& queue)
+{
+    queue.bufferCount = 0;
+    queue.stats = {};
+}
+
+void RecordRenderCommands(JobSystem& jobs, RenderCommandQueue& queue, uint32_t count, uint32_t batchSize,
+    const std::function<void(uint32_t, uint32_t, RenderCommandBuffer&)>& record)
+{
+    PROFILE_SCOPE("RecordRenderCommands");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    batchSize = batchSize ? batchSize : 1;
+    uint32_t batchCount = (count + batchSize - 1) / batchSize;
+    uint32_t firstBuffer = queue.bufferCount;
+
+    if (queue.buffers.size() < firstBuffer + batchCount)
+        queue.buffers.resize(firstBuffer + batchCount);
+
+    for (uint32_t i = firstBuffer; i < firstBuffer + batchCount; i++)
+    {
+        queue.buffers[i].keys.clear();
+        queue.buffers[i].commands.clear();
+    }
+
+    ParallelFor(jobs, count, batchSize, [&](uint32_t begin, uint32_t end)
+    {
+        record(begin, end, queue.buffers[firstBuffer + begin / batchSize]);
+    });
+
+    queue.bufferCount += batchCount;
+    queue.stats.buffers = queue.bufferCount;
+    queue.stats.recordMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// a pass binds its own targets and buffers, everything after it starts over
+static uint32_t GetStateChanges(uint64_t key, const RenderCommand& command, uint64_t previousKey, const RenderCommand& previous)
+{
+    if (GetRenderKeyPass(key) != GetRenderKeyPass(previousKey))
+        return RENDER_STATE_ALL;
+
+    uint32_t changes = 0;
+    changes |= GetRenderKeyShader(key) != GetRenderKeyShader(previousKey) ? RENDER_STATE_SHADER : 0;
+    changes |= GetRenderKeyMaterial(key) != GetRenderKeyMaterial(previousKey) ? RENDER_STATE_MATERIAL : 0;
+    changes |= command.mesh != previous.mesh ? RENDER_STATE_VERTEX_BUFFER : 0;
+    changes |= command.indexBuffer != previous.indexBuffer ? RENDER_STATE_INDEX_BUFFER : 0;
+    changes |= command.constants != previous.constants ? RENDER_STATE_CONSTANTS : 0;
+    return changes;
+}
+
+static uint32_t CountBits(uint32_t bits)
+{
+    uint32_t count = 0;
+    for (; bits; bits &= bits - 1)
+        count++;
+    return count;
+}
+
+void SortRenderCommands(RenderCommandQueue& queue)
+{
+    PROFILE_SCOPE("SortRenderCommands");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < queue.bufferCount; i++)
+        count += (uint32_t)queue.buffers[i].keys.size();
+
+    queue.commands.resize(count);
+    queue.keys.resize(count);
+    queue.order.resize(count);
+    queue.scratchKeys.resize(count);
+    queue.scratchOrder.resize(count);
+
+    uint32_t cursor = 0;
+    for (uint32_t i = 0; i < queue.bufferCount; i++)
+    {
+        const RenderCommandBuffer& buffer = queue.buffers[i];
+        uint32_t size = (uint32_t)buffer.keys.size();
+        if (size == 0)
+            continue;
+
+        memcpy(queue.keys.data() + cursor, buffer.keys.data(), sizeof(uint64_t) * size);
+        memcpy(queue.commands.data() + cursor, buffer.commands.data(), sizeof(RenderCommand) * size);
+        cursor += size;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+        queue.order[i] = i;
+
+    // every byte's histogram in one go over the keys
+    uint32_t histograms[8][256] = {};
+    for (uint64_t key : queue.keys)
+    {
+        for (uint32_t byte = 0; byte < 8; byte++)
+            histograms[byte][(key >> (byte * 8)) & 0xff]++;
+    }
+
+    uint64_t* keys = queue.keys.data();
+    uint32_t* order = queue.order.data();
+    uint64_t* scratchKeys = queue.scratchKeys.data();
+    uint32_t* scratchOrder = queue.scratchOrder.data();
+
+    for (uint32_t byte = 0; byte < 8 && count; byte++)
+    {
+        uint32_t* histogram = histograms[byte];
+        if (histogram[(keys[0] >> (byte * 8)) & 0xff] == count)
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++)
+        {
+            offsets[bucket] = sum;
+            sum += histogram[bucket];
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t slot = offsets[(keys[i] >> (byte * 8)) & 0xff]++;
+            scratchKeys[slot] = keys[i];
+            scratchOrder[slot] = order[i];
+        }
+
+        std::swap(keys, scratchKeys);
+        std::swap(order, scratchOrder);
+    }
+
+    // an odd number of passes leaves the result in the scratch arrays
+    if (keys != queue.keys.data())
+    {
+        queue.keys.swap(queue.scratchKeys);
+        queue.order.swap(queue.scratchOrder);
+    }
+
+    queue.changes.resize(count);
+    queue.stats.commands = count;
+    queue.stats.stateChanges = 0;
+    queue.stats.stateChangesSkipped = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t changes = i == 0 ? RENDER_STATE_ALL :
+            GetStateChanges(queue.keys[i], queue.commands[queue.order[i]], queue.keys[i - 1], queue.commands[queue.order[i - 1]]);
+
+        queue.changes[i] = changes;
+        queue.stats.stateChanges += CountBits(changes);
+        queue.stats.stateChangesSkipped += RENDER_STATE_COUNT - CountBits(changes);
+    }
+
+    queue.stats.sortMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ReplayRenderCommands(const RenderCommandQueue& queue, uint32_t begin, uint32_t end,
+    const std::function<void(const RenderCommand&, uint64_t, uint32_t)>& draw)
+{
+    for (uint32_t i = begin; i < end; i++)
+        draw(queue.commands[queue.order[i]], queue.keys[i], i == begin ? RENDER_STATE_ALL : queue.changes[i]);
+}
+
+void RunRenderCommandBenchmark(JobSystem& jobs, uint32_t commandCount, RenderCommandBenchmarkResult& result)
+{
+    constexpr uint32_t PASS_COUNT = 7; // six shadow faces and the main pass, like the renderer
+    constexpr uint32_t SHADER_COUNT = 2;
+    constexpr uint32_t MATERIAL_COUNT = 256;
+    constexpr uint32_t MESH_COUNT = 1024;
+    constexpr uint32_t BATCH_SIZE = 1024;
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> pass(0, PASS_COUNT - 1);
+    std::uniform_int_distribution<uint32_t> mesh(0, MESH_COUNT - 1);
+    std::uniform_real_distribution<float> depth(0.1f, 500.0f);
+
+    // what each draw would be, recording only copies it into a command so the timing is the buffers' and not the rng's
+    struct Draw
+    {
+        uint32_t pass;
+        uint32_t mesh;
+        float depth;
+    };
+
+    std::vector<Draw> draws(commandCount);
+    for (Draw& draw : draws)
+        draw = { pass(rng), mesh(rng), depth(rng) };
+
+    // a mesh always has the same shader and material, like in the renderer
+    auto record = [&](uint32_t begin, uint32_t end, RenderCommandBuffer& buffer)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const Draw& draw = draws[i];
+            RenderCommand command = { draw.mesh, draw.mesh, i, 0, 36, i, 1, 0 };
+            PushRenderCommand(buffer, MakeRenderKey(draw.pass, draw.mesh % SHADER_COUNT, draw.mesh % MATERIAL_COUNT, draw.depth, 0), command);
+        }
+    };
+
+    RenderCommandQueue queue;
+
+    double bestRecord = 1e30, bestSort = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        ResetRenderCommands(queue);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        RecordRenderCommands(jobs, queue, commandCount, BATCH_SIZE, record);
+        auto recorded = std::chrono::high_resolution_clock::now();
+        SortRenderCommands(queue);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        bestRecord = std::min(bestRecord, std::chrono::duration<double, std::milli>(recorded - start).count());
+        bestSort = std::min(bestSort, std::chrono::duration<double, std::milli>(end - recorded).count());
+    }
+
+    // key of the i-th recorded command, every batch filled its own buffer
+    auto recordedKey = [&](uint32_t i) { return queue.buffers[i / BATCH_SIZE].keys[i % BATCH_SIZE]; };
+
+    // the same keys through the standard library, stable like the radix sort so both orders have to agree
+    std::vector<uint32_t> reference(commandCount);
+    double bestStdSort = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        for (uint32_t i = 0; i < commandCount; i++)
+            reference[i] = i;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::stable_sort(reference.begin(), reference.end(), [&](uint32_t a, uint32_t b) { return recordedKey(a) < recordedKey(b); });
+        auto end = std::chrono::high_resolution_clock::now();
+        bestStdSort = std::min(bestStdSort, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < commandCount; i++)
+        mismatches += queue.order[i] != reference[i];
+
+    // replaying with a backend that does nothing is the cost of walking the queue
+    uint32_t drawn = 0;
+    double bestReplay = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        drawn = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        ReplayRenderCommands(queue, 0, commandCount, [&](const RenderCommand& command, uint64_t, uint32_t)
+        {
+            drawn += command.instanceCount;
+        });
+        auto end = std::chrono::high_resolution_clock::now();
+        bestReplay = std::min(bestReplay, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    check(drawn == commandCount);
+
+    // recording order binds what a draw straight to the context would
+    uint32_t unsortedChanges = 0;
+    for (uint32_t i = 0; i < commandCount; i++)
+        unsortedChanges += i == 0 ? RENDER_STATE_COUNT : CountBits(GetStateChanges(recordedKey(i), queue.commands[i], recordedKey(i - 1), queue.commands[i - 1]));
+
+    result.commandCount = commandCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.recordMs = bestRecord;
+    result.sortMs = bestSort;
+    result.stdSortMs = bestStdSort;
+    result.replayMs = bestReplay;
+    result.unsortedStateChanges = unsortedChanges;
+    result.sortedStateChanges = queue.stats.stateChanges;
+    result.mismatches = mismatches;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "core.h"
+#include "jobs.h"
+#include "scene.h"
+
+#include <functional>
+#include <vector>
+
+// draws are recorded as small commands with a 64 bit sort key instead of going to the gpu right away. jobs record into
+// their own linear buffers, the keys of every buffer are radix sorted together and the replay walks them in order,
+// binding only the state that differs from the draw before. most significant first the key is
+//
+//   pass 4 | shader 4 | material 16 | depth 24 | sequence 16
+//
+// so draws of a pass stay together, then the ones sharing a shader and a material, then near to far
+
+constexpr uint32_t RENDER_KEY_PASS_COUNT = 16;
+constexpr uint32_t RENDER_KEY_SHADER_COUNT = 16;
+constexpr uint32_t RENDER_KEY_MATERIAL_COUNT = 1 << 16;
+
+// depth is view space, only its upper 24 bits are kept, sequence orders draws the other fields leave tied
+uint64_t MakeRenderKey(uint32_t pass, uint32_t shader, uint32_t material, float depth, uint32_t sequence);
+
+uint32_t GetRenderKeyPass(uint64_t key);
+uint32_t GetRenderKeyShader(uint64_t key);
+uint32_t GetRenderKeyMaterial(uint64_t key);
+
+// view space depth of the nearest instance origin, what an instanced draw sorts by. viewDepth is the third column of
+// the view matrix like ViewConstants holds it
+float GetNearestInstanceDepth(const InstanceData* instances, uint32_t count, const Vec4& viewDepth);
+
+// what the backend needs to issue one instanced draw, the handles mean whatever the backend made them mean
+struct RenderCommand
+{
+    uint32_t mesh;          // vertex buffer
+    uint32_t indexBuffer;   // of the mesh or a shared one
+    uint32_t constants;     // per draw constants, e.g. an offset into a ring
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t padding;
+};
+
+// bits of what a command has to bind before drawing, the first command of a replay binds everything
+constexpr uint32_t RENDER_STATE_PASS = 1 << 0;          // targets, viewport and whatever else is per pass
+constexpr uint32_t RENDER_STATE_SHADER = 1 << 1;
+constexpr uint32_t RENDER_STATE_MATERIAL = 1 << 2;
+constexpr uint32_t RENDER_STATE_VERTEX_BUFFER = 1 << 3;
+constexpr uint32_t RENDER_STATE_INDEX_BUFFER = 1 << 4;
+constexpr uint32_t RENDER_STATE_CONSTANTS = 1 << 5;
+constexpr uint32_t RENDER_STATE_COUNT = 6;
+constexpr uint32_t RENDER_STATE_ALL = (1 << RENDER_STATE_COUNT) - 1;
+
+// one job's commands, appended without any locking
+struct RenderCommandBuffer
+{
+    std::vector<uint64_t> keys;
+    std::vector<RenderCommand> commands;
+};
+
+inline void PushRenderCommand(RenderCommandBuffer& buffer, uint64_t key, const RenderCommand& command)
+{
+    buffer.keys.push_back(key);
+    buffer.commands.push_back(command);
+}
+
+struct RenderCommandStats
+{
+    uint32_t commands = 0;
+    uint32_t buffers = 0;             // recorded into this frame
+    uint32_t stateChanges = 0;        // bits a replay of the whole queue binds
+    uint32_t stateChangesSkipped = 0; // bits already bound by the command before
+    float recordMs = 0.0f;
+    float sortMs = 0.0f;
+};
+
+struct RenderCommandQueue
+{
+    std::vector<RenderCommandBuffer> buffers; // per recording batch, only cleared between frames so they keep their memory
+    uint32_t bufferCount = 0;
+
+    // after SortRenderCommands
+    std::vector<RenderCommand> commands;  // every buffer's commands one after the other
+    std::vector<uint64_t> keys;           // sorted
+    std::vector<uint32_t> order;          // command of every sorted key
+    std::vector<uint32_t> changes;        // RENDER_STATE_ bits of every sorted command
+
+    // radix sort scratch
+    std::vector<uint64_t> scratchKeys;
+    std::vector<uint32_t> scratchOrder;
+
+    RenderCommandStats stats;
+};
+
+void ResetRenderCommands(RenderCommandQueue& queue);
+
+// runs record(begin, end, buffer) over [0, count) in batches of batchSize on the job system, each batch into a buffer
+// of its own. buffers are numbered by batch so the order of equal keys does not depend on which worker ran what.
+// may be called several times a frame, every call adds its buffers after the ones already there
+void RecordRenderCommands(JobSystem& jobs, RenderCommandQueue& queue, uint32_t count, uint32_t batchSize,
+    const std::function<void(uint32_t, uint32_t, RenderCommandBuffer&)>& record);
+
+// gathers the buffers and sorts them by key, 8 bits per pass least significant first and stable, the passes where every
+// key has the same byte are skipped. then finds what every command has to bind over the one before it
+void SortRenderCommands(RenderCommandQueue& queue);
+
+// calls draw for the sorted commands [begin, end) in order with the state each one changes, the first of the range
+// binds everything so ranges can be replayed on different contexts
+void ReplayRenderCommands(const RenderCommandQueue& queue, uint32_t begin, uint32_t end,
+    const std::function<void(const RenderCommand&, uint64_t, uint32_t)>& draw);
+
+struct RenderCommandBenchmarkResult
+{
+    uint32_t commandCount;
+    uint32_t workerCount;
+    double recordMs;         // RecordRenderCommands
+    double sortMs;           // SortRenderCommands
+    double stdSortMs;        // std::stable_sort of the same keys, for scale
+    double replayMs;         // ReplayRenderCommands with a draw that only counts
+    uint32_t unsortedStateChanges; // in recording order
+    uint32_t sortedStateChanges;
+    uint32_t mismatches;     // commands the radix sort put somewhere else than std::stable_sort, should be 0
+};
+
+// random draws over a few passes, shaders and materials recorded by every worker, best of a few runs
+void RunRenderCommandBenchmark(JobSystem& jobs, uint32_t commandCount, RenderCommandBenchmarkResult& result);
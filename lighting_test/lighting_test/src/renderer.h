@@ -0,0 +1,85 @@
+#pragma once
+
+#include "culling.h"
+#include "mesh_cache.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "render_commands.h"
+#include "shader_cache.h"
+#include "shader_constants.h"
+#include "shadow_cache.h"
+#include "texture_atlas.h"
+
+#include <string>
+
+// what the app needs from a gpu, renderer_d3d11.cpp draws with d3d11, renderer_null.cpp only keeps the
+// counters so the whole frame runs headless. meshes are addressed by the index RendererCreateMesh returns,
+// the same index the app uses for its instance ranges
+
+// both backends record their draws with render_commands.h: the faces of the shadow cube are passes 0 to 5 and the main
+// pass comes after them, a mesh is its own material since it owns its texture arrays
+constexpr uint32_t RENDER_PASS_MAIN = SHADOW_CUBE_FACES;
+constexpr uint32_t RENDER_MESHLET_INDEX_BUFFER = UINT32_MAX; // index buffer handle of what meshlet culling kept
+
+// everything one frame draws, pointers stay owned by the app and only have to live until RendererDrawFrame returns
+struct RenderFrame
+{
+    const ViewConstants* view;
+    const LightSettings* light;
+    const VisibleSet* visible; // instances grouped by mesh and the visibility of every submesh
+    const MeshletVisibleSet* meshletVisible; // null draws every mesh from its own index buffer
+    const LodSelection* lods;                // null draws every instance at full detail, else one draw per level
+    const ShadowCasterSet* shadowCasters;    // faces of the main light's shadow cube to draw again, null keeps all of them
+    const PointLight* pointLights;
+    uint32_t pointLightCount;
+    const LightClusters* clusters;
+    const float* clearColor;
+    JobSystem* jobs;                         // records the draws
+};
+
+struct RendererStats
+{
+    uint32_t drawCalls;
+    uint32_t instancesDrawn;
+    uint32_t trianglesDrawn;        // of every instance
+    uint32_t constantUploads;       // view and light buffers
+    uint32_t constantUploadsSkipped; // unchanged since the last upload
+    uint32_t objectUploads;         // per draw constants written to the ring
+    uint32_t objectUploadsSkipped;
+    uint32_t objectRingUsed;        // bytes
+    uint32_t objectRingSize;
+    uint32_t textureArrays;         // of every mesh, see texture_atlas.h
+    uint32_t textureLayers;
+    float textureOccupancy;
+    uint32_t shadowFacesDrawn;      // of the main light's cube, the others kept what they had
+    uint32_t shadowDrawCalls;
+    uint32_t shadowTrianglesDrawn;
+    RenderCommandStats commands;    // of every pass
+    uint32_t commandLists;          // deferred contexts the draws were split across, 0 when replayed on the immediate one
+    ShaderLoadStats shaders;        // at init
+};
+
+// shaders are loaded on the job system, see shader_cache.h
+bool RendererInit(void* windowHandle, uint32_t width, uint32_t height, JobSystem& jobs);
+const char* GetRendererName();
+
+// every submesh starts out with a white texture, the name labels the mesh in gpu timings. meshes drawn with meshlet
+// culling are created with the indices of their MeshletData, levels of detail come along with the view
+uint32_t RendererCreateMesh(const MeshView& view, const std::string& debugName);
+
+// one texture per submesh, null keeps it white. packed into texture arrays so the mesh draws in one call, can be called
+// again whenever streaming changes the levels the textures have
+void RendererSetMeshTextures(uint32_t mesh, const TextureView* const* submeshTextures);
+
+// on by default, benchmarks turn it off to present as soon as a frame is done
+void RendererSetVsync(bool enabled);
+
+// resizes the back buffers when the window size changed and starts the frame's gpu timings,
+// the ui of the frame is built between this and RendererDrawFrame
+void RendererBeginFrame(uint32_t width, uint32_t height);
+
+// uploads the frame, draws it and the ui, then presents
+void RendererDrawFrame(const RenderFrame& frame);
+
+// of the last drawn frame
+RendererStats GetRendererStats();
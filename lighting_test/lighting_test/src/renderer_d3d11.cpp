@@ -0,0 +1,1362 @@
+#include "renderer.h"
+#include "profiler.h"
+#include "vertex_format.h"
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include <d3dcompiler.h>
+
+#include <algorithm>
+
+#include "../vendor/imgui/imgui.h"
+#include "../vendor/imgui/backends/imgui_impl_dx11.h"
+
+#define d3dcheck(Condition) check(Condition == S_OK)
+
+IDXGISwapChain* gSwapChain = nullptr;
+ID3D11Device* gDevice = nullptr;
+ID3D11DeviceContext* gContext = nullptr;
+
+ID3D11RenderTargetView* gBackBufferView = nullptr;
+
+ID3D11DepthStencilView* gDepthBufferView = nullptr;
+
+ID3D11DeviceContext1* gContext1 = nullptr; // for constant buffer offsets
+
+// dynamic constant buffer that remembers what it holds, uploads of unchanged data are skipped
+struct CachedConstantBuffer
+{
+    ID3D11Buffer* buffer = nullptr;
+    std::vector<uint8_t> contents;
+};
+
+// vertex.hlsl b0 and pixel.hlsl b1, pixel.hlsl b0
+CachedConstantBuffer gViewBuffer;
+CachedConstantBuffer gLightBuffer;
+
+// every draw's ObjectConstants, appended with no overwrite maps and discarded when full
+constexpr uint32_t OBJECT_CONSTANT_RING_SIZE = 64 * 1024;
+
+struct ConstantRing
+{
+    ID3D11Buffer* buffer = nullptr;
+    uint32_t cursor = OBJECT_CONSTANT_RING_SIZE; // full so the first allocation discards
+    uint32_t generation = 0;                     // bumped on discard, older offsets are gone
+};
+
+ConstantRing gObjectConstantRing;
+
+RendererStats gStats = {}; // of the last frame
+
+// shader visible buffer rewritten every frame, grows when the data does not fit anymore
+struct DynamicStructuredBuffer
+{
+    ID3D11Buffer* buffer = nullptr;
+    ID3D11ShaderResourceView* view = nullptr;
+    uint32_t capacity = 0;
+};
+
+// pixel.hlsl t1, t2, t3
+DynamicStructuredBuffer gPointLightBuffer;
+DynamicStructuredBuffer gClusterBuffer;
+DynamicStructuredBuffer gClusterLightIndexBuffer;
+
+// pixel.hlsl t8, first triangle of every submesh of every level of every mesh in the buffer it draws from this frame
+DynamicStructuredBuffer gSubmeshTriangleBuffer;
+std::vector<uint32_t> gSubmeshTriangles;
+
+// indices of the triangles meshlet culling kept, shared by every compacted mesh like the instance buffer
+ID3D11Buffer* gMeshletIndexBuffer = nullptr;
+uint32_t gMeshletIndexBufferCapacity = 0;
+
+// per instance vertex stream shared by every mesh, each mesh draws its own range of it
+ID3D11Buffer* gInstanceBuffer = nullptr;
+uint32_t gInstanceBufferCapacity = 0;
+
+// one vertex shader permutation and input layout per VertexFormat
+ID3D11VertexShader* gVertexShaders[2] = {};
+ID3D11InputLayout* gInputLayouts[2] = {};
+
+ID3D11PixelShader* gPixelShader = nullptr;
+
+// what LoadShaders loads at init: the vertex shaders by VertexFormat, then the pixel shader
+constexpr uint32_t PIXEL_SHADER = 2;
+constexpr uint32_t SHADER_COUNT = 3;
+
+ShaderLoadStats gShaderLoadStats;
+
+// the main light's cube shadow, pixel.hlsl t9. kept between frames, only the faces shadow_cache.h asks for are drawn
+constexpr uint32_t SHADOW_MAP_SIZE = 1024;
+
+ID3D11ShaderResourceView* gShadowCubeView = nullptr;
+ID3D11DepthStencilView* gShadowFaceViews[SHADOW_CUBE_FACES] = {};
+CachedConstantBuffer gShadowFaceBuffers[SHADOW_CUBE_FACES]; // vertex.hlsl b0 of every face
+ID3D11RasterizerState* gShadowRasterizerState = nullptr;
+
+// casters of the faces drawn this frame, like gInstanceBuffer
+ID3D11Buffer* gShadowInstanceBuffer = nullptr;
+uint32_t gShadowInstanceBufferCapacity = 0;
+
+ID3D11SamplerState* gSampler = nullptr;       // pixel.hlsl s0
+ID3D11SamplerState* gShadowSampler = nullptr; // pixel.hlsl s1
+
+// every pass's draws are recorded on the job system, sorted and replayed. big passes are replayed on deferred contexts
+// in parallel, a slice of the sorted commands each, and their command lists executed in order. small ones cost more
+// to record into command lists than they save and go straight to the immediate context
+constexpr uint32_t DEFERRED_CONTEXT_COUNT = 4;
+constexpr uint32_t DEFERRED_MIN_COMMANDS = 512;
+constexpr uint32_t RECORD_BATCH_SIZE = 16; // meshes per recording job
+
+RenderCommandQueue gCommands;
+ID3D11DeviceContext* gDeferredContexts[DEFERRED_CONTEXT_COUNT] = {};
+ID3D11DeviceContext1* gDeferredContexts1[DEFERRED_CONTEXT_COUNT] = {};
+ID3D11CommandList* gCommandLists[DEFERRED_CONTEXT_COUNT] = {};
+
+// gpu timestamps are read back a few frames later so GetData never stalls the cpu
+constexpr uint32_t GPU_PROFILER_LATENCY = PROFILER_GPU_LATENCY;
+constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 16;
+
+struct GpuProfilerFrame
+{
+    ID3D11Query* disjoint = nullptr;
+    ID3D11Query* frameBegin = nullptr;
+    ID3D11Query* frameEnd = nullptr;
+    ID3D11Query* scopeBegin[GPU_PROFILER_MAX_SCOPES] = {};
+    ID3D11Query* scopeEnd[GPU_PROFILER_MAX_SCOPES] = {};
+    const char* scopeNames[GPU_PROFILER_MAX_SCOPES] = {};
+    uint32_t scopeCount = 0;
+    uint64_t frameIndex = 0;
+    bool pending = false;
+};
+
+GpuProfilerFrame gGpuProfilerFrames[GPU_PROFILER_LATENCY];
+uint32_t gGpuProfilerCurrent = 0;
+bool gGpuProfilerMeasuring = false; // false when the current slot is still in flight
+
+bool gVsync = true;
+
+uint32_t gWidth = 0;
+uint32_t gHeight = 0;
+
+struct SubMeshData
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// this frame's instanced draw of one level of detail of a mesh
+struct MeshDraw
+{
+    ObjectConstants constants;
+    ObjectConstants uploadedConstants;          // what is at constantOffset, valid while the ring keeps constantGeneration
+    uint32_t constantOffset = 0;                // in bytes
+    uint32_t constantGeneration = UINT32_MAX;
+    InstanceRange instances = {};
+    uint32_t firstIndex = 0;                    // run of submeshes, first to last visible
+    uint32_t indexCount = 0;
+    bool compacted = false;                     // from gMeshletIndexBuffer instead of indexBuffer
+};
+
+struct GpuMesh
+{
+    std::vector<SubMeshData> submeshes;         // level after level, submeshCount each
+    uint32_t submeshCount;
+    uint32_t levelCount;
+    std::string debugName;
+    ID3D11Buffer* vertexBuffer;
+    ID3D11Buffer* indexBuffer;
+    VertexFormat vertexFormat;
+    ID3D11ShaderResourceView* textureArrays[MAX_TEXTURE_ARRAYS]; // the white array where unused
+    ID3D11ShaderResourceView* submeshTextures;                   // SubmeshTexture per submesh
+    uint64_t textureUsedTexels;                                  // this mesh's part of the texture stats, taken back
+    uint64_t textureAllocatedTexels;                             // out when streaming sets its textures again
+    uint32_t textureArrayCount;
+    uint32_t textureLayerCount;
+    MeshDraw draws[MAX_MESH_LODS];
+    ID3D11Buffer* shadowConstants;                               // ObjectConstants of the shadow pass, never changes
+    uint32_t shadowFirstIndex;                                   // every submesh at full detail
+    uint32_t shadowIndexCount;
+};
+
+std::vector<GpuMesh> gMeshes;
+
+ID3D11ShaderResourceView* gWhiteTexture = nullptr;
+
+// every mesh's texture arrays together, for the stats
+uint64_t gTextureUsedTexels = 0;
+uint64_t gTextureAllocatedTexels = 0;
+uint32_t gTextureArrayCount = 0;
+uint32_t gTextureLayerCount = 0;
+
+void BindMainTargets(ID3D11DeviceContext* context);
+
+// back buffer view, depth buffer and viewport for the current size
+void CreateRenderTargets()
+{
+    ID3D11Texture2D* backBuffer;
+    d3dcheck(gSwapChain->GetBuffer(0 /*first buffer (back buffer)*/, __uuidof(ID3D11Texture2D), (void**)&backBuffer));
+    d3dcheck(gDevice->CreateRenderTargetView(backBuffer, nullptr, &gBackBufferView));
+    backBuffer->Release();
+
+    D3D11_TEXTURE2D_DESC depthDesc = {};
+    depthDesc.Usage = D3D11_USAGE_DEFAULT;
+    depthDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    depthDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+    depthDesc.Width = gWidth;
+    depthDesc.Height = gHeight;
+    depthDesc.MipLevels = 1;
+    depthDesc.ArraySize = 1;
+    depthDesc.SampleDesc.Count = 1;
+
+    ID3D11Texture2D* depthBuffer;
+    d3dcheck(gDevice->CreateTexture2D(&depthDesc, nullptr, &depthBuffer));
+    d3dcheck(gDevice->CreateDepthStencilView(depthBuffer, nullptr, &gDepthBufferView));
+    depthBuffer->Release();
+
+    BindMainTargets(gContext);
+}
+
+void BindMainTargets(ID3D11DeviceContext* context)
+{
+    D3D11_VIEWPORT viewport = {};
+    viewport.Width = (float)gWidth;
+    viewport.Height = (float)gHeight;
+    viewport.MaxDepth = 1.0f;
+    viewport.MinDepth = 0.0f;
+
+    context->RSSetViewports(1, &viewport);
+    context->OMSetRenderTargets(1, &gBackBufferView, gDepthBufferView);
+}
+
+// one depth view per face to draw into and a cube view over all of them to sample
+void CreateShadowCube()
+{
+    D3D11_TEXTURE2D_DESC cubeDesc = {};
+    cubeDesc.Usage = D3D11_USAGE_DEFAULT;
+    cubeDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+    cubeDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+    cubeDesc.Width = SHADOW_MAP_SIZE;
+    cubeDesc.Height = SHADOW_MAP_SIZE;
+    cubeDesc.MipLevels = 1;
+    cubeDesc.ArraySize = SHADOW_CUBE_FACES;
+    cubeDesc.SampleDesc.Count = 1;
+    cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+    ID3D11Texture2D* cube;
+    d3dcheck(gDevice->CreateTexture2D(&cubeDesc, nullptr, &cube));
+
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+    {
+        D3D11_DEPTH_STENCIL_VIEW_DESC faceDesc = {};
+        faceDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        faceDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+        faceDesc.Texture2DArray.FirstArraySlice = face;
+        faceDesc.Texture2DArray.ArraySize = 1;
+
+        d3dcheck(gDevice->CreateDepthStencilView(cube, &faceDesc, &gShadowFaceViews[face]));
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format = DXGI_FORMAT_R32_FLOAT;
+    viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+    viewDesc.TextureCube.MipLevels = 1;
+
+    d3dcheck(gDevice->CreateShaderResourceView(cube, &viewDesc, &gShadowCubeView));
+    cube->Release();
+
+    // slope scaled bias on top of the world space one of the pixel shader for surfaces seen at grazing angles
+    D3D11_RASTERIZER_DESC rasterizerDesc = {};
+    rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+    rasterizerDesc.CullMode = D3D11_CULL_BACK;
+    rasterizerDesc.DepthBias = 0;
+    rasterizerDesc.SlopeScaledDepthBias = 1.5f;
+    rasterizerDesc.DepthClipEnable = true;
+
+    d3dcheck(gDevice->CreateRasterizerState(&rasterizerDesc, &gShadowRasterizerState));
+}
+
+void CreateTextureArray(const TextureArrayLayout& layout, const TextureData& data, ID3D11ShaderResourceView*& outResource)
+{
+    D3D11_TEXTURE2D_DESC texDesc = {};
+    texDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    texDesc.Format = (DXGI_FORMAT)GetDxgiFormat(layout.format);
+    texDesc.ArraySize = layout.layerCount;
+    texDesc.Width = layout.width;
+    texDesc.Height = layout.height;
+    texDesc.MipLevels = layout.levelCount;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texDesc.SampleDesc.Count = 1;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> texData(data.levels.size());
+    for (uint32_t i = 0; i < data.levels.size(); i++)
+    {
+        texData[i].pSysMem = data.data.data() + data.levels[i].offset;
+        texData[i].SysMemPitch = GetRowPitch(layout.format, data.levels[i].width);
+    }
+
+    // the view has to say array even for a single layer, the shader declares Texture2DArray
+    D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.Format = texDesc.Format;
+    viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    viewDesc.Texture2DArray.MipLevels = layout.levelCount;
+    viewDesc.Texture2DArray.ArraySize = layout.layerCount;
+
+    ID3D11Texture2D* texture;
+    d3dcheck(gDevice->CreateTexture2D(&texDesc, texData.data(), &texture));
+    d3dcheck(gDevice->CreateShaderResourceView(texture, &viewDesc, &outResource));
+    texture->Release();
+}
+
+void CreateSubmeshTextures(const std::vector<SubmeshTexture>& submeshTextures, ID3D11ShaderResourceView*& outResource)
+{
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = sizeof(SubmeshTexture) * (uint32_t)submeshTextures.size();
+    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+    bufferDesc.StructureByteStride = sizeof(SubmeshTexture);
+
+    D3D11_SUBRESOURCE_DATA bufferData = {};
+    bufferData.pSysMem = submeshTextures.data();
+
+    ID3D11Buffer* buffer;
+    d3dcheck(gDevice->CreateBuffer(&bufferDesc, &bufferData, &buffer));
+    d3dcheck(gDevice->CreateShaderResourceView(buffer, nullptr, &outResource));
+    buffer->Release();
+}
+
+uint32_t RendererCreateMesh(const MeshView& view, const std::string& debugName)
+{
+    std::vector<SubMeshData> submeshes;
+    for (uint32_t level = 0; level <= view.lodCount; level++)
+    {
+        for (uint32_t i = 0; i < view.submeshCount; i++)
+        {
+            SubMeshRange range = GetLodSubmesh(view, level, i);
+            submeshes.push_back({ range.indexOffset, range.indexCount });
+        }
+    }
+
+    std::vector<SubmeshTexture> submeshTextures;
+    for (uint32_t i = 0; i < view.submeshCount; i++)
+        submeshTextures.push_back({ -1, 0.0f, 0.0f, 0.0f, { 1.0f, 1.0f, 0.0f, 0.0f } });
+
+    ID3D11Buffer* vertexBuffer;
+    ID3D11Buffer* indexBuffer;
+
+    uint32_t vertexStride = GetVertexStride(view.vertexFormat);
+
+    D3D11_BUFFER_DESC vBufferDesc = {};
+    vBufferDesc.ByteWidth = vertexStride * view.vertexCount;
+    vBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    vBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    vBufferDesc.StructureByteStride = vertexStride;
+
+    D3D11_SUBRESOURCE_DATA vBufferDataPtr = {};
+    vBufferDataPtr.pSysMem = view.GetVertexData();
+
+    d3dcheck(gDevice->CreateBuffer(&vBufferDesc, &vBufferDataPtr, &vertexBuffer));
+
+    D3D11_BUFFER_DESC iBufferDesc = {};
+    iBufferDesc.ByteWidth = sizeof(uint32_t) * view.indexCount;
+    iBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+    iBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA iBufferDataPtr = {};
+    iBufferDataPtr.pSysMem = (const void*)view.indices;
+
+    d3dcheck(gDevice->CreateBuffer(&iBufferDesc, &iBufferDataPtr, &indexBuffer));
+
+    GpuMesh& outMesh = gMeshes.emplace_back();
+    outMesh.vertexBuffer = vertexBuffer;
+    outMesh.indexBuffer = indexBuffer;
+    outMesh.vertexFormat = view.vertexFormat;
+    for (MeshDraw& draw : outMesh.draws)
+    {
+        draw.constants.positionScale = { view.quantization.posScale.x, view.quantization.posScale.y, view.quantization.posScale.z, 1.0f };
+        draw.constants.positionOffset = { view.quantization.posOffset.x, view.quantization.posOffset.y, view.quantization.posOffset.z, 0.0f };
+        draw.constants.submeshCount = view.submeshCount;
+    }
+    outMesh.shadowFirstIndex = submeshes[0].firstIndex;
+    outMesh.shadowIndexCount = submeshes[view.submeshCount - 1].firstIndex + submeshes[view.submeshCount - 1].indexCount - outMesh.shadowFirstIndex;
+    outMesh.submeshes = std::move(submeshes);
+    outMesh.submeshCount = view.submeshCount;
+    outMesh.levelCount = 1 + view.lodCount;
+    outMesh.debugName = debugName;
+
+    ObjectConstants shadowConstants = outMesh.draws[0].constants;
+
+    D3D11_BUFFER_DESC shadowConstantsDesc = {};
+    shadowConstantsDesc.ByteWidth = sizeof(ObjectConstants);
+    shadowConstantsDesc.Usage = D3D11_USAGE_IMMUTABLE;
+    shadowConstantsDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+    D3D11_SUBRESOURCE_DATA shadowConstantsData = {};
+    shadowConstantsData.pSysMem = &shadowConstants;
+
+    d3dcheck(gDevice->CreateBuffer(&shadowConstantsDesc, &shadowConstantsData, &outMesh.shadowConstants));
+
+    for (ID3D11ShaderResourceView*& textureArray : outMesh.textureArrays)
+    {
+        textureArray = gWhiteTexture;
+        textureArray->AddRef();
+    }
+    CreateSubmeshTextures(submeshTextures, outMesh.submeshTextures);
+
+    return (uint32_t)gMeshes.size() - 1;
+}
+
+void RendererSetMeshTextures(uint32_t meshIndex, const TextureView* const* submeshTextures)
+{
+    GpuMesh& mesh = gMeshes[meshIndex];
+
+    PackedTextures packed;
+    PackTextures(submeshTextures, mesh.submeshCount, packed);
+
+    gTextureUsedTexels -= mesh.textureUsedTexels;
+    gTextureAllocatedTexels -= mesh.textureAllocatedTexels;
+    gTextureArrayCount -= mesh.textureArrayCount;
+    gTextureLayerCount -= mesh.textureLayerCount;
+    mesh.textureUsedTexels = mesh.textureAllocatedTexels = 0;
+    mesh.textureArrayCount = mesh.textureLayerCount = 0;
+
+    TextureData arrayData;
+    for (uint32_t i = 0; i < MAX_TEXTURE_ARRAYS; i++)
+    {
+        mesh.textureArrays[i]->Release();
+
+        // streaming can leave a mesh with fewer arrays than it had
+        if (i >= packed.arrays.size())
+        {
+            mesh.textureArrays[i] = gWhiteTexture;
+            mesh.textureArrays[i]->AddRef();
+            continue;
+        }
+
+        const TextureArrayLayout& layout = packed.arrays[i];
+        BuildTextureArray(packed, i, submeshTextures, arrayData);
+        CreateTextureArray(layout, arrayData, mesh.textureArrays[i]);
+
+        mesh.textureUsedTexels += layout.usedTexels;
+        mesh.textureAllocatedTexels += (uint64_t)layout.width * layout.height * layout.layerCount;
+        mesh.textureArrayCount++;
+        mesh.textureLayerCount += layout.layerCount;
+    }
+
+    gTextureUsedTexels += mesh.textureUsedTexels;
+    gTextureAllocatedTexels += mesh.textureAllocatedTexels;
+    gTextureArrayCount += mesh.textureArrayCount;
+    gTextureLayerCount += mesh.textureLayerCount;
+
+    std::vector<SubmeshTexture> table;
+    for (uint32_t i = 0; i < mesh.submeshCount; i++)
+    {
+        const TexturePlacement& placement = packed.placements[i];
+        SubmeshTexture& entry = table.emplace_back();
+        entry.array = placement.array;
+        entry.layer = (float)placement.layer;
+        entry.maxLod = placement.array < 0 ? 0.0f : (float)(placement.levelCount - 1);
+        entry.padding = 0.0f;
+        entry.uvRect = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+        if (placement.array >= 0 && !placement.wholeLayer)
+        {
+            const TextureArrayLayout& layout = packed.arrays[placement.array];
+            entry.uvRect = { (float)placement.width / layout.width, (float)placement.height / layout.height,
+                             (float)placement.x / layout.width, (float)placement.y / layout.height };
+        }
+    }
+
+    mesh.submeshTextures->Release();
+    CreateSubmeshTextures(table, mesh.submeshTextures);
+}
+
+void CreateConstantBuffer(uint32_t size, ID3D11Buffer*& outBuffer)
+{
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = size;
+    bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+    bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+    d3dcheck(gDevice->CreateBuffer(&bufferDesc, nullptr, &outBuffer));
+}
+
+void UploadConstantBuffer(CachedConstantBuffer& target, const void* data, uint32_t size)
+{
+    if (target.contents.size() == size && memcmp(target.contents.data(), data, size) == 0)
+    {
+        gStats.constantUploadsSkipped++;
+        return;
+    }
+
+    target.contents.assign((const uint8_t*)data, (const uint8_t*)data + size);
+
+    D3D11_MAPPED_SUBRESOURCE map;
+    d3dcheck(gContext->Map(target.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map));
+    memcpy(map.pData, data, size);
+    gContext->Unmap(target.buffer, 0);
+
+    gStats.constantUploads++;
+}
+
+// writes the object constants of every draw this frame that changed or lost its ring slot, all of them with a single map
+void UploadObjectConstants()
+{
+    PROFILE_SCOPE("UploadObjectConstants");
+
+    ConstantRing& ring = gObjectConstantRing;
+
+    static std::vector<MeshDraw*> sDirtyDraws;
+    auto findDirtyDraws = [&]()
+    {
+        sDirtyDraws.clear();
+        for (GpuMesh& mesh : gMeshes)
+        {
+            for (uint32_t level = 0; level < mesh.levelCount; level++)
+            {
+                MeshDraw& draw = mesh.draws[level];
+                if (draw.indexCount == 0)
+                    continue;
+
+                if (draw.constantGeneration != ring.generation || memcmp(&draw.constants, &draw.uploadedConstants, sizeof(ObjectConstants)) != 0)
+                    sDirtyDraws.push_back(&draw);
+                else
+                    gStats.objectUploadsSkipped++;
+            }
+        }
+    };
+
+    findDirtyDraws();
+    if (sDirtyDraws.empty())
+        return;
+
+    uint32_t size = (uint32_t)sDirtyDraws.size() * CONSTANT_BUFFER_ALIGNMENT;
+    check(size <= OBJECT_CONSTANT_RING_SIZE);
+
+    D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+    if (ring.cursor + size > OBJECT_CONSTANT_RING_SIZE)
+    {
+        // the gpu may still read the old contents, discarding renames the buffer and every draw moves
+        mapType = D3D11_MAP_WRITE_DISCARD;
+        ring.cursor = 0;
+        ring.generation++;
+
+        gStats.objectUploadsSkipped = 0;
+        findDirtyDraws();
+        size = (uint32_t)sDirtyDraws.size() * CONSTANT_BUFFER_ALIGNMENT;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE map;
+    d3dcheck(gContext->Map(ring.buffer, 0, mapType, 0, &map));
+
+    for (MeshDraw* draw : sDirtyDraws)
+    {
+        memcpy((uint8_t*)map.pData + ring.cursor, &draw->constants, sizeof(ObjectConstants));
+
+        draw->uploadedConstants = draw->constants;
+        draw->constantOffset = ring.cursor;
+        draw->constantGeneration = ring.generation;
+        ring.cursor += CONSTANT_BUFFER_ALIGNMENT;
+    }
+
+    gContext->Unmap(ring.buffer, 0);
+
+    gStats.objectUploads += (uint32_t)sDirtyDraws.size();
+}
+
+// one draw per mesh and level of detail from its first to its last visible submesh, the culled ones in between are
+// cheaper to let the rasterizer clip than to split the draw for. meshes meshlet culling compacted draw what it kept
+// at full detail instead
+void PrepareMeshDraws(const VisibleSet& visible, const MeshletVisibleSet* meshletVisible, const LodSelection* lods)
+{
+    gSubmeshTriangles.resize(visible.submeshVisible.size() * MAX_MESH_LODS);
+
+    for (uint32_t meshIndex = 0; meshIndex < gMeshes.size(); meshIndex++)
+    {
+        GpuMesh& mesh = gMeshes[meshIndex];
+        const uint8_t* submeshVisible = visible.submeshVisible.data() + visible.submeshOffsets[meshIndex];
+
+        for (uint32_t level = 0; level < mesh.levelCount; level++)
+        {
+            MeshDraw& draw = mesh.draws[level];
+            draw.indexCount = 0;
+            draw.compacted = level == 0 && meshletVisible && meshletVisible->draws[meshIndex].compacted;
+            draw.constants.submeshTriangleOffset = visible.submeshOffsets[meshIndex] * MAX_MESH_LODS + level * mesh.submeshCount;
+
+            if (lods)
+                draw.instances = lods->ranges[meshIndex * MAX_MESH_LODS + level];
+            else
+                draw.instances = level == 0 ? visible.ranges[meshIndex] : InstanceRange { 0, 0 };
+
+            uint32_t* submeshTriangles = gSubmeshTriangles.data() + draw.constants.submeshTriangleOffset;
+            if (draw.compacted)
+            {
+                const MeshletDraw& compacted = meshletVisible->draws[meshIndex];
+                memcpy(submeshTriangles, meshletVisible->submeshTriangles.data() + visible.submeshOffsets[meshIndex], sizeof(uint32_t) * mesh.submeshCount);
+
+                draw.firstIndex = compacted.firstIndex;
+                draw.indexCount = draw.instances.count ? compacted.indexCount : 0;
+                draw.constants.firstTriangle = 0;
+                continue;
+            }
+
+            const SubMeshData* submeshes = mesh.submeshes.data() + level * mesh.submeshCount;
+            for (uint32_t i = 0; i < mesh.submeshCount; i++)
+                submeshTriangles[i] = submeshes[i].firstIndex / 3;
+
+            if (draw.instances.count == 0)
+                continue;
+
+            uint32_t first = UINT32_MAX, last = 0;
+            for (uint32_t i = 0; i < mesh.submeshCount; i++)
+            {
+                if (submeshVisible[i])
+                {
+                    first = first == UINT32_MAX ? i : first;
+                    last = i;
+                }
+            }
+
+            if (first == UINT32_MAX)
+                continue;
+
+            draw.firstIndex = submeshes[first].firstIndex;
+            draw.indexCount = submeshes[last].firstIndex + submeshes[last].indexCount - draw.firstIndex;
+            draw.constants.firstTriangle = draw.firstIndex / 3;
+        }
+    }
+}
+
+void UploadStructuredBuffer(DynamicStructuredBuffer& target, const void* data, uint32_t count, uint32_t stride)
+{
+    // never empty, d3d does not allow zero sized buffers
+    uint32_t needed = count ? count : 1;
+
+    if (needed > target.capacity)
+    {
+        if (target.view)
+            target.view->Release();
+        if (target.buffer)
+            target.buffer->Release();
+
+        target.capacity = needed + needed / 2;
+
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.ByteWidth = stride * target.capacity;
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = stride;
+
+        d3dcheck(gDevice->CreateBuffer(&bufferDesc, nullptr, &target.buffer));
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+        viewDesc.Format = DXGI_FORMAT_UNKNOWN;
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+        viewDesc.Buffer.FirstElement = 0;
+        viewDesc.Buffer.NumElements = target.capacity;
+
+        d3dcheck(gDevice->CreateShaderResourceView(target.buffer, &viewDesc, &target.view));
+    }
+
+    if (count)
+    {
+        D3D11_MAPPED_SUBRESOURCE map;
+        d3dcheck(gContext->Map(target.buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map));
+        memcpy(map.pData, data, (size_t)stride * count);
+        gContext->Unmap(target.buffer, 0);
+    }
+}
+
+// vertex or index stream rewritten every frame, grows when the data does not fit anymore
+void UploadDynamicBuffer(ID3D11Buffer*& buffer, uint32_t& capacity, uint32_t bindFlags, const void* data, uint32_t count, uint32_t stride)
+{
+    if (count == 0)
+        return;
+
+    if (count > capacity)
+    {
+        if (buffer)
+            buffer->Release();
+
+        capacity = count + count / 2;
+
+        D3D11_BUFFER_DESC bufferDesc = {};
+        bufferDesc.ByteWidth = stride * capacity;
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = bindFlags;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        d3dcheck(gDevice->CreateBuffer(&bufferDesc, nullptr, &buffer));
+    }
+
+    D3D11_MAPPED_SUBRESOURCE map;
+    d3dcheck(gContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map));
+    memcpy(map.pData, data, (size_t)stride * count);
+    gContext->Unmap(buffer, 0);
+}
+
+void UploadInstances(const VisibleSet& visible)
+{
+    PROFILE_SCOPE("UploadInstances");
+
+    UploadDynamicBuffer(gInstanceBuffer, gInstanceBufferCapacity, D3D11_BIND_VERTEX_BUFFER, visible.instances.data(),
+        (uint32_t)visible.instances.size(), sizeof(InstanceData));
+}
+
+void UploadMeshletIndices(const MeshletVisibleSet* meshletVisible)
+{
+    PROFILE_SCOPE("UploadMeshletIndices");
+
+    if (meshletVisible)
+        UploadDynamicBuffer(gMeshletIndexBuffer, gMeshletIndexBufferCapacity, D3D11_BIND_INDEX_BUFFER, meshletVisible->indices.data(),
+            (uint32_t)meshletVisible->indices.size(), sizeof(uint32_t));
+}
+
+void CreateGpuProfiler()
+{
+    D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+    D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+    for (GpuProfilerFrame& frame : gGpuProfilerFrames)
+    {
+        d3dcheck(gDevice->CreateQuery(&disjointDesc, &frame.disjoint));
+        d3dcheck(gDevice->CreateQuery(&timestampDesc, &frame.frameBegin));
+        d3dcheck(gDevice->CreateQuery(&timestampDesc, &frame.frameEnd));
+        for (uint32_t i = 0; i < GPU_PROFILER_MAX_SCOPES; i++)
+        {
+            d3dcheck(gDevice->CreateQuery(&timestampDesc, &frame.scopeBegin[i]));
+            d3dcheck(gDevice->CreateQuery(&timestampDesc, &frame.scopeEnd[i]));
+        }
+    }
+}
+
+// hands every finished frame to the profiler, a frame whose queries are not done yet is retried next time
+void CollectGpuProfilerFrames()
+{
+    for (GpuProfilerFrame& frame : gGpuProfilerFrames)
+    {
+        if (!frame.pending)
+            continue;
+
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+        if (gContext->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            continue;
+
+        uint64_t frameBegin, frameEnd;
+        if (gContext->GetData(frame.frameBegin, &frameBegin, sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+            gContext->GetData(frame.frameEnd, &frameEnd, sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            continue;
+
+        ProfileGpuTiming timings[GPU_PROFILER_MAX_SCOPES];
+        bool ready = true;
+        for (uint32_t i = 0; i < frame.scopeCount && ready; i++)
+        {
+            uint64_t begin, end;
+            ready = gContext->GetData(frame.scopeBegin[i], &begin, sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK &&
+                    gContext->GetData(frame.scopeEnd[i], &end, sizeof(uint64_t), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK;
+            if (ready)
+            {
+                double toMs = 1000.0 / (double)disjoint.Frequency;
+                timings[i] = { frame.scopeNames[i], (float)((begin - frameBegin) * toMs), (float)((end - frameBegin) * toMs) };
+            }
+        }
+
+        if (!ready)
+            continue;
+
+        // the clock changed frequency or was interrupted, the timestamps mean nothing
+        if (!disjoint.Disjoint)
+            ProfilerAddGpuFrame(frame.frameIndex, timings, frame.scopeCount, (float)((frameEnd - frameBegin) * 1000.0 / (double)disjoint.Frequency));
+
+        frame.pending = false;
+    }
+}
+
+void GpuProfilerBeginFrame()
+{
+    CollectGpuProfilerFrames();
+
+    // every slot still in flight, the gpu is more than GPU_PROFILER_LATENCY frames behind and this frame is not measured
+    GpuProfilerFrame& frame = gGpuProfilerFrames[gGpuProfilerCurrent];
+    gGpuProfilerMeasuring = !frame.pending;
+    if (!gGpuProfilerMeasuring)
+        return;
+
+    frame.scopeCount = 0;
+    frame.frameIndex = GetProfilerStats().frameIndex;
+    gContext->Begin(frame.disjoint);
+    gContext->End(frame.frameBegin);
+}
+
+// returns the scope to pass to GpuEndScope, UINT32_MAX when the frame is not measured or out of scopes
+uint32_t GpuBeginScope(const char* name)
+{
+    GpuProfilerFrame& frame = gGpuProfilerFrames[gGpuProfilerCurrent];
+    if (!gGpuProfilerMeasuring || frame.scopeCount == GPU_PROFILER_MAX_SCOPES)
+        return UINT32_MAX;
+
+    uint32_t scope = frame.scopeCount++;
+    frame.scopeNames[scope] = name;
+    gContext->End(frame.scopeBegin[scope]);
+    return scope;
+}
+
+void GpuEndScope(uint32_t scope)
+{
+    if (scope != UINT32_MAX)
+        gContext->End(gGpuProfilerFrames[gGpuProfilerCurrent].scopeEnd[scope]);
+}
+
+void GpuProfilerEndFrame()
+{
+    GpuProfilerFrame& frame = gGpuProfilerFrames[gGpuProfilerCurrent];
+    if (gGpuProfilerMeasuring)
+    {
+        gContext->End(frame.frameEnd);
+        gContext->End(frame.disjoint);
+        frame.pending = true;
+    }
+
+    gGpuProfilerCurrent = (gGpuProfilerCurrent + 1) % GPU_PROFILER_LATENCY;
+}
+
+// the instances of the casters and the view of every face to draw again, the faces are cleared here so their passes
+// only have to draw
+void PrepareShadowFaces(const ShadowCasterSet& casters)
+{
+    PROFILE_SCOPE("PrepareShadowFaces");
+
+    UploadDynamicBuffer(gShadowInstanceBuffer, gShadowInstanceBufferCapacity, D3D11_BIND_VERTEX_BUFFER, casters.instances.data(),
+        (uint32_t)casters.instances.size(), sizeof(InstanceData));
+
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+    {
+        if (!(casters.faceMask & (1 << face)))
+            continue;
+
+        ViewConstants faceView = {};
+        faceView.viewProj = Mat4Transpose(casters.faceViewProj[face]);
+        UploadConstantBuffer(gShadowFaceBuffers[face], &faceView, sizeof(ViewConstants));
+
+        gContext->ClearDepthStencilView(gShadowFaceViews[face], D3D11_CLEAR_DEPTH, 1.0f, 0);
+        gStats.shadowFacesDrawn++;
+    }
+}
+
+// one command per mesh and level of detail for the main pass and one per mesh for every shadow face to draw again,
+// depth only with the main vertex shader looking out of the light and every mesh at full detail from its own indices
+void RecordDraws(JobSystem& jobs, const RenderFrame& frame)
+{
+    const VisibleSet& visible = *frame.visible;
+    const ShadowCasterSet* casters = frame.shadowCasters && frame.shadowCasters->faceMask ? frame.shadowCasters : nullptr;
+    uint32_t meshCount = (uint32_t)gMeshes.size();
+
+    ResetRenderCommands(gCommands);
+    RecordRenderCommands(jobs, gCommands, meshCount, RECORD_BATCH_SIZE, [&](uint32_t begin, uint32_t end, RenderCommandBuffer& buffer)
+    {
+        for (uint32_t meshIndex = begin; meshIndex < end; meshIndex++)
+        {
+            const GpuMesh& mesh = gMeshes[meshIndex];
+            uint32_t shader = (uint32_t)mesh.vertexFormat;
+
+            for (uint32_t level = 0; level < mesh.levelCount; level++)
+            {
+                const MeshDraw& draw = mesh.draws[level];
+                if (draw.indexCount == 0)
+                    continue;
+
+                RenderCommand command = {};
+                command.mesh = meshIndex;
+                command.indexBuffer = draw.compacted ? RENDER_MESHLET_INDEX_BUFFER : meshIndex;
+                command.constants = draw.constantOffset;
+                command.firstIndex = draw.firstIndex;
+                command.indexCount = draw.indexCount;
+                command.firstInstance = draw.instances.first;
+                command.instanceCount = draw.instances.count;
+
+                float depth = GetNearestInstanceDepth(visible.instances.data() + draw.instances.first, draw.instances.count, frame.view->viewDepth);
+                PushRenderCommand(buffer, MakeRenderKey(RENDER_PASS_MAIN, shader, meshIndex, depth, level), command);
+            }
+
+            for (uint32_t face = 0; casters && face < SHADOW_CUBE_FACES; face++)
+            {
+                const InstanceRange& range = casters->ranges[face * meshCount + meshIndex];
+                if (!(casters->faceMask & (1 << face)) || range.count == 0)
+                    continue;
+
+                RenderCommand command = {};
+                command.mesh = meshIndex;
+                command.indexBuffer = meshIndex;
+                command.constants = meshIndex;
+                command.firstIndex = mesh.shadowFirstIndex;
+                command.indexCount = mesh.shadowIndexCount;
+                command.firstInstance = range.first;
+                command.instanceCount = range.count;
+
+                PushRenderCommand(buffer, MakeRenderKey(face, shader, 0, 0.0f, meshIndex), command);
+            }
+        }
+    });
+}
+
+// everything a pass draws with apart from what its commands bind, a deferred context starts out with nothing bound
+void BindPass(ID3D11DeviceContext* context, uint32_t pass)
+{
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    if (pass < SHADOW_CUBE_FACES)
+    {
+        // the cube is still bound for sampling from the last frame
+        ID3D11ShaderResourceView* nullView = nullptr;
+        context->PSSetShaderResources(9, 1, &nullView);
+
+        D3D11_VIEWPORT viewport = {};
+        viewport.Width = (float)SHADOW_MAP_SIZE;
+        viewport.Height = (float)SHADOW_MAP_SIZE;
+        viewport.MaxDepth = 1.0f;
+        context->RSSetViewports(1, &viewport);
+        context->RSSetState(gShadowRasterizerState);
+        context->PSSetShader(nullptr, nullptr, 0);
+        context->VSSetConstantBuffers(0, 1, &gShadowFaceBuffers[pass].buffer);
+        context->OMSetRenderTargets(0, nullptr, gShadowFaceViews[pass]);
+        return;
+    }
+
+    BindMainTargets(context);
+    context->RSSetState(nullptr);
+    context->PSSetShader(gPixelShader, nullptr, 0);
+
+    context->VSSetConstantBuffers(0, 1, &gViewBuffer.buffer);
+    context->PSSetConstantBuffers(0, 1, &gLightBuffer.buffer);
+    context->PSSetConstantBuffers(1, 1, &gViewBuffer.buffer);
+
+    context->PSSetSamplers(0, 1, &gSampler);
+    context->PSSetSamplers(1, 1, &gShadowSampler);
+
+    ID3D11ShaderResourceView* lightViews[] = { gPointLightBuffer.view, gClusterBuffer.view, gClusterLightIndexBuffer.view };
+    context->PSSetShaderResources(1, 3, lightViews);
+    context->PSSetShaderResources(8, 1, &gSubmeshTriangleBuffer.view);
+    context->PSSetShaderResources(9, 1, &gShadowCubeView);
+}
+
+// binds what changed since the command before and draws, the pixel shader picks each submesh's texture out of the
+// mesh's arrays
+void DrawCommand(ID3D11DeviceContext* context, ID3D11DeviceContext1* context1, const RenderCommand& command, uint64_t key, uint32_t changes)
+{
+    const GpuMesh& mesh = gMeshes[command.mesh];
+    uint32_t pass = GetRenderKeyPass(key);
+    bool shadow = pass < SHADOW_CUBE_FACES;
+
+    if (changes & RENDER_STATE_PASS)
+        BindPass(context, pass);
+
+    if (changes & RENDER_STATE_SHADER)
+    {
+        context->VSSetShader(gVertexShaders[GetRenderKeyShader(key)], nullptr, 0);
+        context->IASetInputLayout(gInputLayouts[GetRenderKeyShader(key)]);
+    }
+
+    if ((changes & RENDER_STATE_MATERIAL) && !shadow)
+    {
+        context->PSSetShaderResources(0, 1, &mesh.textureArrays[0]);
+        context->PSSetShaderResources(4, MAX_TEXTURE_ARRAYS - 1, &mesh.textureArrays[1]);
+        context->PSSetShaderResources(7, 1, &mesh.submeshTextures);
+    }
+
+    if (changes & RENDER_STATE_VERTEX_BUFFER)
+    {
+        ID3D11Buffer* buffers[] = { mesh.vertexBuffer, shadow ? gShadowInstanceBuffer : gInstanceBuffer };
+        uint32_t strides[] = { GetVertexStride(mesh.vertexFormat), sizeof(InstanceData) };
+        uint32_t offsets[] = { 0, 0 };
+        context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+    }
+
+    if (changes & RENDER_STATE_INDEX_BUFFER)
+        context->IASetIndexBuffer(command.indexBuffer == RENDER_MESHLET_INDEX_BUFFER ? gMeshletIndexBuffer : mesh.indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+    if ((changes & RENDER_STATE_CONSTANTS) && shadow)
+        context->VSSetConstantBuffers(1, 1, &mesh.shadowConstants);
+    else if (changes & RENDER_STATE_CONSTANTS)
+    {
+        uint32_t firstConstant = command.constants / 16;
+        uint32_t constantCount = CONSTANT_BUFFER_ALIGNMENT / 16;
+        context1->VSSetConstantBuffers1(1, 1, &gObjectConstantRing.buffer, &firstConstant, &constantCount);
+        context1->PSSetConstantBuffers1(2, 1, &gObjectConstantRing.buffer, &firstConstant, &constantCount);
+    }
+
+    context->DrawIndexedInstanced(command.indexCount, command.instanceCount, command.firstIndex, 0, command.firstInstance);
+}
+
+// replays the sorted commands [begin, end), split across the deferred contexts when there are enough of them. returns
+// how many command lists were executed
+uint32_t SubmitCommands(JobSystem& jobs, uint32_t begin, uint32_t end)
+{
+    uint32_t count = end - begin;
+    if (count < DEFERRED_MIN_COMMANDS)
+    {
+        ReplayRenderCommands(gCommands, begin, end, [](const RenderCommand& command, uint64_t key, uint32_t changes)
+        {
+            DrawCommand(gContext, gContext1, command, key, changes);
+        });
+        return 0;
+    }
+
+    uint32_t sliceSize = (count + DEFERRED_CONTEXT_COUNT - 1) / DEFERRED_CONTEXT_COUNT;
+    uint32_t listCount = (count + sliceSize - 1) / sliceSize;
+
+    ParallelFor(jobs, listCount, 1, [&](uint32_t first, uint32_t last)
+    {
+        for (uint32_t list = first; list < last; list++)
+        {
+            ID3D11DeviceContext* context = gDeferredContexts[list];
+            ID3D11DeviceContext1* context1 = gDeferredContexts1[list];
+
+            uint32_t sliceBegin = begin + list * sliceSize;
+            uint32_t sliceEnd = sliceBegin + sliceSize < end ? sliceBegin + sliceSize : end;
+            ReplayRenderCommands(gCommands, sliceBegin, sliceEnd, [&](const RenderCommand& command, uint64_t key, uint32_t changes)
+            {
+                DrawCommand(context, context1, command, key, changes);
+            });
+
+            d3dcheck(context->FinishCommandList(FALSE, &gCommandLists[list]));
+        }
+    });
+
+    // in sorted order, every list leaves the immediate context with nothing bound
+    for (uint32_t list = 0; list < listCount; list++)
+    {
+        gContext->ExecuteCommandList(gCommandLists[list], FALSE);
+        gCommandLists[list]->Release();
+        gCommandLists[list] = nullptr;
+    }
+
+    return listCount;
+}
+
+// d3dcompiler behind LoadShaders, runs on the job system
+bool CompileShader(const ShaderPermutation& permutation, std::vector<uint8_t>& outBytecode, std::string& outErrors)
+{
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const ShaderDefine& define : permutation.defines)
+        macros.push_back({ define.name.c_str(), define.value.c_str() });
+    macros.push_back({ nullptr, nullptr });
+
+    std::wstring path(permutation.path.begin(), permutation.path.end());
+
+    ID3DBlob* blob = nullptr;
+    ID3DBlob* errorBlob = nullptr;
+    HRESULT result = D3DCompileFromFile(path.c_str(), macros.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, permutation.entry.c_str(),
+        permutation.profile.c_str(), 0, 0, &blob, &errorBlob);
+
+    if (errorBlob)
+    {
+        outErrors.assign((const char*)errorBlob->GetBufferPointer(), errorBlob->GetBufferSize());
+        errorBlob->Release();
+    }
+
+    if (result != S_OK)
+        return false;
+
+    const uint8_t* bytecode = (const uint8_t*)blob->GetBufferPointer();
+    outBytecode.assign(bytecode, bytecode + blob->GetBufferSize());
+    blob->Release();
+    return true;
+}
+
+bool RendererInit(void* windowHandle, uint32_t width, uint32_t height, JobSystem& jobs)
+{
+    gWidth = width;
+    gHeight = height;
+
+    // create swapchain
+    DXGI_SWAP_CHAIN_DESC swapchainDesc = {};
+    swapchainDesc.BufferCount = 1;
+    swapchainDesc.BufferDesc.Width = width;
+    swapchainDesc.BufferDesc.Height = height;
+    swapchainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    swapchainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+    swapchainDesc.BufferDesc.RefreshRate.Numerator = 0;
+    swapchainDesc.BufferDesc.RefreshRate.Denominator = 1;
+    swapchainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapchainDesc.OutputWindow = (HWND)windowHandle;
+    swapchainDesc.SampleDesc.Count = 1;
+    swapchainDesc.Windowed = true;
+    swapchainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;
+
+    HRESULT swapchainHR = D3D11CreateDeviceAndSwapChain(nullptr, D3D_DRIVER_TYPE_HARDWARE, 0, D3D11_CREATE_DEVICE_DEBUG, 0, 0,
+            D3D11_SDK_VERSION, &swapchainDesc, &gSwapChain, &gDevice, 0, &gContext);
+
+    if (swapchainHR != S_OK)
+        return false;
+
+    CreateRenderTargets();
+
+    CreateShadowCube();
+
+    // shaders, from the bytecode cache unless their sources changed, the others are compiled in parallel
+    LoadedShader shaders[SHADER_COUNT];
+    shaders[(uint32_t)VertexFormat::Full].permutation = { "shaders/vertex.hlsl", "main", "vs_5_0", {} };
+    shaders[(uint32_t)VertexFormat::Packed].permutation = { "shaders/vertex.hlsl", "main", "vs_5_0", { { "PACKED_VERTEX", "1" } } };
+    shaders[PIXEL_SHADER].permutation = { "shaders/pixel.hlsl", "main", "ps_5_0", {} };
+
+    gShaderLoadStats = LoadShaders(jobs, SHADER_CACHE_DIRECTORY, shaders, SHADER_COUNT, CompileShader);
+    for (const LoadedShader& shader : shaders)
+    {
+        if (!shader.errors.empty())
+            fprintf(stderr, "%s: %s", shader.permutation.path.c_str(), shader.errors.c_str());
+        check(shader.ok);
+    }
+
+    const std::vector<uint8_t>& psBytecode = shaders[PIXEL_SHADER].bytecode;
+    d3dcheck(gDevice->CreatePixelShader(psBytecode.data(), psBytecode.size(), nullptr, &gPixelShader));
+
+    // per instance stream in slot 1: model rows followed by the normal matrix rows
+    constexpr uint32_t VERTEX_INPUT_COUNT = 3;
+    constexpr uint32_t INSTANCE_INPUT_COUNT = 7;
+    constexpr uint32_t INPUT_COUNT = VERTEX_INPUT_COUNT + INSTANCE_INPUT_COUNT;
+
+    D3D11_INPUT_ELEMENT_DESC instanceInputs[INSTANCE_INPUT_COUNT] = {};
+    for (uint32_t i = 0; i < INSTANCE_INPUT_COUNT; i++)
+    {
+        instanceInputs[i].SemanticName = i < 4 ? "MODEL" : "NORMAL_MATRIX";
+        instanceInputs[i].SemanticIndex = i < 4 ? i : i - 4;
+        instanceInputs[i].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+        instanceInputs[i].InputSlot = 1;
+        instanceInputs[i].AlignedByteOffset = i * 16;
+        instanceInputs[i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+        instanceInputs[i].InstanceDataStepRate = 1;
+    }
+
+    // full vertex: float3 pos, float3 normal, float2 uv
+    D3D11_INPUT_ELEMENT_DESC fullInputs[INPUT_COUNT] = {};
+
+    fullInputs[0].SemanticName = "POS";
+    fullInputs[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+    fullInputs[0].AlignedByteOffset = 0;
+
+    fullInputs[1].SemanticName = "NORMAL";
+    fullInputs[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
+    fullInputs[1].AlignedByteOffset = 12;
+
+    fullInputs[2].SemanticName = "TEX_COORDS";
+    fullInputs[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+    fullInputs[2].AlignedByteOffset = 24;
+
+    // packed vertex: unorm16 pos relative to the bounds, snorm16 octahedral normal, half uv
+    D3D11_INPUT_ELEMENT_DESC packedInputs[INPUT_COUNT] = {};
+
+    packedInputs[0].SemanticName = "POS";
+    packedInputs[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+    packedInputs[0].AlignedByteOffset = 0;
+
+    packedInputs[1].SemanticName = "NORMAL";
+    packedInputs[1].Format = DXGI_FORMAT_R16G16_SNORM;
+    packedInputs[1].AlignedByteOffset = 8;
+
+    packedInputs[2].SemanticName = "TEX_COORDS";
+    packedInputs[2].Format = DXGI_FORMAT_R16G16_FLOAT;
+    packedInputs[2].AlignedByteOffset = 12;
+
+    for (uint32_t i = 0; i < INSTANCE_INPUT_COUNT; i++)
+    {
+        fullInputs[VERTEX_INPUT_COUNT + i] = instanceInputs[i];
+        packedInputs[VERTEX_INPUT_COUNT + i] = instanceInputs[i];
+    }
+
+    const D3D11_INPUT_ELEMENT_DESC* layouts[2] = { fullInputs, packedInputs };
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        const std::vector<uint8_t>& vsBytecode = shaders[i].bytecode;
+        d3dcheck(gDevice->CreateVertexShader(vsBytecode.data(), vsBytecode.size(), nullptr, &gVertexShaders[i]));
+        d3dcheck(gDevice->CreateInputLayout(layouts[i], INPUT_COUNT, vsBytecode.data(), vsBytecode.size(), &gInputLayouts[i]));
+    }
+
+    // sampler for textures
+    D3D11_SAMPLER_DESC samplerDesc = {};
+    samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+    samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+    samplerDesc.MinLOD = 0;
+    samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+    d3dcheck(gDevice->CreateSamplerState(&samplerDesc, &gSampler));
+
+    // pcf for the shadow cube, every tap blends the comparisons of 4 texels
+
+    D3D11_SAMPLER_DESC shadowSamplerDesc = {};
+    shadowSamplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+    shadowSamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    shadowSamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    shadowSamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    shadowSamplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+    shadowSamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+    d3dcheck(gDevice->CreateSamplerState(&shadowSamplerDesc, &gShadowSampler));
+
+    // constant buffers, object constants are bound per draw with an offset which needs the 11.1 runtime
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    d3dcheck(gDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)));
+    check(options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer);
+    d3dcheck(gContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&gContext1));
+
+    CreateConstantBuffer(sizeof(ViewConstants), gViewBuffer.buffer);
+    CreateConstantBuffer(sizeof(LightSettings), gLightBuffer.buffer);
+    CreateConstantBuffer(OBJECT_CONSTANT_RING_SIZE, gObjectConstantRing.buffer);
+    for (CachedConstantBuffer& faceBuffer : gShadowFaceBuffers)
+        CreateConstantBuffer(sizeof(ViewConstants), faceBuffer.buffer);
+
+    // deferred contexts replay big passes in parallel, they need the 11.1 runtime as well for the offsets
+    for (uint32_t i = 0; i < DEFERRED_CONTEXT_COUNT; i++)
+    {
+        d3dcheck(gDevice->CreateDeferredContext(0, &gDeferredContexts[i]));
+        d3dcheck(gDeferredContexts[i]->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&gDeferredContexts1[i]));
+    }
+
+    // bind everything the main pass needs, the draws bind the rest
+    BindPass(gContext, RENDER_PASS_MAIN);
+
+    // bound in every texture array slot a mesh does not use
+    TextureArrayLayout whiteLayout = { TextureFormat::RGBA8, 1, 1, 1, 1, 0, 1 };
+
+    TextureData whiteTexture;
+    whiteTexture.data.assign(4, 0xff);
+    whiteTexture.levels.push_back({ 1, 1, 0 });
+
+    CreateTextureArray(whiteLayout, whiteTexture, gWhiteTexture);
+
+    CreateGpuProfiler();
+
+    ImGui_ImplDX11_Init(gDevice, gContext);
+
+    return true;
+}
+
+const char* GetRendererName()
+{
+    return "D3D11";
+}
+
+void RendererSetVsync(bool enabled)
+{
+    gVsync = enabled;
+}
+
+void RendererBeginFrame(uint32_t width, uint32_t height)
+{
+    // a minimized window reports a zero size, keep the old buffers until it comes back
+    if ((width != gWidth || height != gHeight) && width && height)
+    {
+        gWidth = width;
+        gHeight = height;
+
+        gBackBufferView->Release();
+        gDepthBufferView->Release();
+
+        d3dcheck(gSwapChain->ResizeBuffers(1, gWidth, gHeight, DXGI_FORMAT_UNKNOWN, 0));
+        CreateRenderTargets();
+    }
+
+    GpuProfilerBeginFrame();
+
+    ImGui_ImplDX11_NewFrame();
+}
+
+void RendererDrawFrame(const RenderFrame& frame)
+{
+    PROFILE_SCOPE("RendererDrawFrame");
+
+    const VisibleSet& visible = *frame.visible;
+
+    gStats = {};
+    gStats.objectRingSize = OBJECT_CONSTANT_RING_SIZE;
+    gStats.shaders = gShaderLoadStats;
+    gStats.textureArrays = gTextureArrayCount;
+    gStats.textureLayers = gTextureLayerCount;
+    gStats.textureOccupancy = gTextureAllocatedTexels ? (float)((double)gTextureUsedTexels / (double)gTextureAllocatedTexels) : 1.0f;
+
+    PrepareMeshDraws(visible, frame.meshletVisible, frame.lods);
+    UploadInstances(visible);
+    UploadMeshletIndices(frame.meshletVisible);
+    UploadObjectConstants();
+
+    UploadStructuredBuffer(gPointLightBuffer, frame.pointLights, frame.pointLightCount, sizeof(PointLight));
+    UploadStructuredBuffer(gClusterBuffer, frame.clusters->clusters.data(), CLUSTER_COUNT, sizeof(uint32_t) * 2);
+    UploadStructuredBuffer(gClusterLightIndexBuffer, frame.clusters->lightIndices.data(), (uint32_t)frame.clusters->lightIndices.size(), sizeof(uint32_t));
+
+    UploadStructuredBuffer(gSubmeshTriangleBuffer, gSubmeshTriangles.data(), (uint32_t)gSubmeshTriangles.size(), sizeof(uint32_t));
+
+    // most frames only the cluster light count of animated lights or nothing at all changes
+    UploadConstantBuffer(gViewBuffer, frame.view, sizeof(ViewConstants));
+    UploadConstantBuffer(gLightBuffer, frame.light, sizeof(LightSettings));
+
+    if (frame.shadowCasters && frame.shadowCasters->faceMask)
+        PrepareShadowFaces(*frame.shadowCasters);
+
+    RecordDraws(*frame.jobs, frame);
+    SortRenderCommands(gCommands);
+
+    gContext->ClearRenderTargetView(gBackBufferView, frame.clearColor);
+    gContext->ClearDepthStencilView(gDepthBufferView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0.0f);
+
+    // the shadow faces sort before the main pass
+    uint32_t commandCount = (uint32_t)gCommands.keys.size();
+    uint32_t mainBegin = (uint32_t)(std::lower_bound(gCommands.keys.begin(), gCommands.keys.end(), MakeRenderKey(RENDER_PASS_MAIN, 0, 0, 0.0f, 0)) -
+        gCommands.keys.begin());
+
+    {
+        PROFILE_SCOPE("SubmitCommands");
+
+        uint32_t shadowScope = mainBegin ? GpuBeginScope("Shadows") : UINT32_MAX;
+        gStats.commandLists += SubmitCommands(*frame.jobs, 0, mainBegin);
+        GpuEndScope(shadowScope);
+
+        uint32_t sceneScope = GpuBeginScope("Scene");
+        uint32_t mainLists = SubmitCommands(*frame.jobs, mainBegin, commandCount);
+        gStats.commandLists += mainLists;
+        GpuEndScope(sceneScope);
+
+        // the ui draws into the main targets, gone after command lists or a frame without a main pass
+        if (mainLists || mainBegin == commandCount)
+            BindPass(gContext, RENDER_PASS_MAIN);
+    }
+
+    for (uint32_t i = 0; i < commandCount; i++)
+    {
+        const RenderCommand& command = gCommands.commands[gCommands.order[i]];
+        if (GetRenderKeyPass(gCommands.keys[i]) < SHADOW_CUBE_FACES)
+        {
+            gStats.shadowDrawCalls++;
+            gStats.shadowTrianglesDrawn += command.indexCount / 3 * command.instanceCount;
+            continue;
+        }
+
+        gStats.drawCalls++;
+        gStats.instancesDrawn += command.instanceCount;
+        gStats.trianglesDrawn += command.indexCount / 3 * command.instanceCount;
+    }
+
+    gStats.commands = gCommands.stats;
+    gStats.objectRingUsed = gObjectConstantRing.cursor;
+
+    uint32_t imguiScope = GpuBeginScope("ImGui");
+    ImGui::Render();
+    ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+    GpuEndScope(imguiScope);
+
+    GpuProfilerEndFrame();
+
+    // blocks on vsync and on the gpu catching up, not counted as cpu time
+    PROFILE_WAIT_SCOPE("Present");
+    gSwapChain->Present(gVsync ? 1 : 0, 0);
+}
+
+RendererStats GetRendererStats()
+{
+    return gStats;
+}
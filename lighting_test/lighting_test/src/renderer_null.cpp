@@ -0,0 +1,215 @@
+#include "renderer.h"
+#include "profiler.h"
+
+// no gpu at all: meshes only keep their submesh ranges and a frame records, sorts and replays the commands d3d11 would,
+// only counting them, enough to run and time everything the cpu does per frame on a machine without a display. textures are
+// packed like d3d11 does so the occupancy is the same
+
+struct NullMesh
+{
+    std::vector<SubMeshRange> submeshes; // level after level, submeshCount each
+    uint32_t submeshCount;
+    uint32_t levelCount;
+    VertexFormat vertexFormat;
+    uint64_t usedTexels;      // this mesh's part of the texture stats, taken back out when streaming sets its
+    uint64_t allocatedTexels; // textures again
+    uint32_t textureArrays;
+    uint32_t textureLayers;
+};
+
+std::vector<NullMesh> gNullMeshes;
+RendererStats gNullStats = {};
+RenderCommandQueue gNullCommands;
+
+uint64_t gNullUsedTexels = 0;
+uint64_t gNullAllocatedTexels = 0;
+uint32_t gNullTextureArrays = 0;
+uint32_t gNullTextureLayers = 0;
+
+bool RendererInit(void*, uint32_t, uint32_t, JobSystem&)
+{
+    return true;
+}
+
+const char* GetRendererName()
+{
+    return "Null";
+}
+
+// nothing is presented
+void RendererSetVsync(bool)
+{
+}
+
+uint32_t RendererCreateMesh(const MeshView& view, const std::string&)
+{
+    NullMesh& mesh = gNullMeshes.emplace_back();
+    mesh.submeshCount = view.submeshCount;
+    mesh.levelCount = 1 + view.lodCount;
+    mesh.vertexFormat = view.vertexFormat;
+    for (uint32_t level = 0; level < mesh.levelCount; level++)
+    {
+        for (uint32_t i = 0; i < view.submeshCount; i++)
+            mesh.submeshes.push_back(GetLodSubmesh(view, level, i));
+    }
+
+    return (uint32_t)gNullMeshes.size() - 1;
+}
+
+void RendererSetMeshTextures(uint32_t mesh, const TextureView* const* submeshTextures)
+{
+    NullMesh& nullMesh = gNullMeshes[mesh];
+
+    PackedTextures packed;
+    PackTextures(submeshTextures, nullMesh.submeshCount, packed);
+
+    gNullUsedTexels -= nullMesh.usedTexels;
+    gNullAllocatedTexels -= nullMesh.allocatedTexels;
+    gNullTextureArrays -= nullMesh.textureArrays;
+    gNullTextureLayers -= nullMesh.textureLayers;
+    nullMesh.usedTexels = nullMesh.allocatedTexels = 0;
+    nullMesh.textureArrays = nullMesh.textureLayers = 0;
+
+    for (const TextureArrayLayout& layout : packed.arrays)
+    {
+        nullMesh.usedTexels += layout.usedTexels;
+        nullMesh.allocatedTexels += (uint64_t)layout.width * layout.height * layout.layerCount;
+        nullMesh.textureArrays++;
+        nullMesh.textureLayers += layout.layerCount;
+    }
+
+    gNullUsedTexels += nullMesh.usedTexels;
+    gNullAllocatedTexels += nullMesh.allocatedTexels;
+    gNullTextureArrays += nullMesh.textureArrays;
+    gNullTextureLayers += nullMesh.textureLayers;
+}
+
+void RendererBeginFrame(uint32_t, uint32_t)
+{
+}
+
+void RendererDrawFrame(const RenderFrame& frame)
+{
+    PROFILE_SCOPE("RendererDrawFrame");
+
+    const VisibleSet& visible = *frame.visible;
+
+    gNullStats = {};
+    gNullStats.textureArrays = gNullTextureArrays;
+    gNullStats.textureLayers = gNullTextureLayers;
+    gNullStats.textureOccupancy = gNullAllocatedTexels ? (float)((double)gNullUsedTexels / (double)gNullAllocatedTexels) : 1.0f;
+
+    const ShadowCasterSet* casters = frame.shadowCasters && frame.shadowCasters->faceMask ? frame.shadowCasters : nullptr;
+    uint32_t meshCount = (uint32_t)gNullMeshes.size();
+
+    for (uint32_t face = 0; casters && face < SHADOW_CUBE_FACES; face++)
+        gNullStats.shadowFacesDrawn += (casters->faceMask >> face) & 1;
+
+    // one draw per mesh and level from its first to its last visible submesh, or of what meshlet culling kept, and one
+    // per mesh for every shadow face to draw again with every submesh at full detail
+    ResetRenderCommands(gNullCommands);
+    RecordRenderCommands(*frame.jobs, gNullCommands, meshCount, 16, [&](uint32_t begin, uint32_t end, RenderCommandBuffer& buffer)
+    {
+        for (uint32_t meshIndex = begin; meshIndex < end; meshIndex++)
+        {
+            const NullMesh& mesh = gNullMeshes[meshIndex];
+            const uint8_t* submeshVisible = visible.submeshVisible.data() + visible.submeshOffsets[meshIndex];
+            uint32_t shader = (uint32_t)mesh.vertexFormat;
+
+            for (uint32_t level = 0; level < mesh.levelCount; level++)
+            {
+                InstanceRange range = level == 0 ? visible.ranges[meshIndex] : InstanceRange { 0, 0 };
+                if (frame.lods)
+                    range = frame.lods->ranges[meshIndex * MAX_MESH_LODS + level];
+
+                if (range.count == 0)
+                    continue;
+
+                const SubMeshRange* submeshes = mesh.submeshes.data() + level * mesh.submeshCount;
+
+                RenderCommand command = {};
+                command.mesh = meshIndex;
+                command.indexBuffer = meshIndex;
+                command.firstInstance = range.first;
+                command.instanceCount = range.count;
+
+                if (level == 0 && frame.meshletVisible && frame.meshletVisible->draws[meshIndex].compacted)
+                {
+                    command.indexBuffer = RENDER_MESHLET_INDEX_BUFFER;
+                    command.firstIndex = frame.meshletVisible->draws[meshIndex].firstIndex;
+                    command.indexCount = frame.meshletVisible->draws[meshIndex].indexCount;
+                }
+                else
+                {
+                    uint32_t first = UINT32_MAX, last = 0;
+                    for (uint32_t i = 0; i < mesh.submeshCount; i++)
+                    {
+                        if (submeshVisible[i])
+                        {
+                            first = first == UINT32_MAX ? i : first;
+                            last = i;
+                        }
+                    }
+
+                    if (first != UINT32_MAX)
+                    {
+                        command.firstIndex = submeshes[first].indexOffset;
+                        command.indexCount = submeshes[last].indexOffset + submeshes[last].indexCount - command.firstIndex;
+                    }
+                }
+
+                if (command.indexCount == 0)
+                    continue;
+
+                // d3d11 has a ring offset per draw, any handle that differs between draws does here
+                command.constants = meshIndex * MAX_MESH_LODS + level;
+
+                float depth = GetNearestInstanceDepth(visible.instances.data() + range.first, range.count, frame.view->viewDepth);
+                PushRenderCommand(buffer, MakeRenderKey(RENDER_PASS_MAIN, shader, meshIndex, depth, level), command);
+            }
+
+            for (uint32_t face = 0; casters && face < SHADOW_CUBE_FACES; face++)
+            {
+                const InstanceRange& range = casters->ranges[face * meshCount + meshIndex];
+                if (!(casters->faceMask & (1 << face)) || range.count == 0)
+                    continue;
+
+                const SubMeshRange& last = mesh.submeshes[mesh.submeshCount - 1];
+
+                RenderCommand command = {};
+                command.mesh = meshIndex;
+                command.indexBuffer = meshIndex;
+                command.constants = meshIndex;
+                command.firstIndex = mesh.submeshes[0].indexOffset;
+                command.indexCount = last.indexOffset + last.indexCount - command.firstIndex;
+                command.firstInstance = range.first;
+                command.instanceCount = range.count;
+
+                PushRenderCommand(buffer, MakeRenderKey(face, shader, 0, 0.0f, meshIndex), command);
+            }
+        }
+    });
+
+    SortRenderCommands(gNullCommands);
+
+    ReplayRenderCommands(gNullCommands, 0, (uint32_t)gNullCommands.keys.size(), [](const RenderCommand& command, uint64_t key, uint32_t)
+    {
+        if (GetRenderKeyPass(key) < SHADOW_CUBE_FACES)
+        {
+            gNullStats.shadowDrawCalls++;
+            gNullStats.shadowTrianglesDrawn += command.indexCount / 3 * command.instanceCount;
+            return;
+        }
+
+        gNullStats.drawCalls++;
+        gNullStats.instancesDrawn += command.instanceCount;
+        gNullStats.trianglesDrawn += command.indexCount / 3 * command.instanceCount;
+    });
+
+    gNullStats.commands = gNullCommands.stats;
+}
+
+RendererStats GetRendererStats()
+{
+    return gNullStats;
+}
@@ -0,0 +1,153 @@
+#include "scene.h"
+#include "profiler.h"
+
+#include <chrono>
+#include <random>
+
+uint32_t AddInstance(Scene& scene, uint32_t meshIndex, const Transform& transform)
+{
+    scene.locationX.push_back(transform.location.x);
+    scene.locationY.push_back(transform.location.y);
+    scene.locationZ.push_back(transform.location.z);
+    scene.rotationX.push_back(transform.rotation.x);
+    scene.rotationY.push_back(transform.rotation.y);
+    scene.rotationZ.push_back(transform.rotation.z);
+    scene.scaleX.push_back(transform.scale.x);
+    scene.scaleY.push_back(transform.scale.y);
+    scene.scaleZ.push_back(transform.scale.z);
+    scene.meshIndices.push_back(meshIndex);
+
+    return (uint32_t)scene.meshIndices.size() - 1;
+}
+
+void ClearScene(Scene& scene)
+{
+    scene = Scene();
+}
+
+uint32_t GetInstanceCount(const Scene& scene)
+{
+    return (uint32_t)scene.meshIndices.size();
+}
+
+Transform GetInstanceTransform(const Scene& scene, uint32_t instance)
+{
+    Transform transform;
+    transform.location = { scene.locationX[instance], scene.locationY[instance], scene.locationZ[instance] };
+    transform.rotation = { scene.rotationX[instance], scene.rotationY[instance], scene.rotationZ[instance] };
+    transform.scale = { scene.scaleX[instance], scene.scaleY[instance], scene.scaleZ[instance] };
+    return transform;
+}
+
+void SetInstanceTransform(Scene& scene, uint32_t instance, const Transform& transform)
+{
+    scene.locationX[instance] = transform.location.x;
+    scene.locationY[instance] = transform.location.y;
+    scene.locationZ[instance] = transform.location.z;
+    scene.rotationX[instance] = transform.rotation.x;
+    scene.rotationY[instance] = transform.rotation.y;
+    scene.rotationZ[instance] = transform.rotation.z;
+    scene.scaleX[instance] = transform.scale.x;
+    scene.scaleY[instance] = transform.scale.y;
+    scene.scaleZ[instance] = transform.scale.z;
+}
+
+void SortInstancesByMesh(const Scene& scene, uint32_t meshCount, std::vector<uint32_t>& order, std::vector<InstanceRange>& ranges)
+{
+    uint32_t instanceCount = GetInstanceCount(scene);
+
+    ranges.assign(meshCount, { 0, 0 });
+    for (uint32_t mesh : scene.meshIndices)
+    {
+        check(mesh < meshCount);
+        ranges[mesh].count++;
+    }
+
+    uint32_t first = 0;
+    for (InstanceRange& range : ranges)
+    {
+        range.first = first;
+        first += range.count;
+    }
+
+    std::vector<uint32_t> cursor(meshCount);
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        cursor[mesh] = ranges[mesh].first;
+
+    order.resize(instanceCount);
+    for (uint32_t i = 0; i < instanceCount; i++)
+        order[cursor[scene.meshIndices[i]]++] = i;
+}
+
+void ComputeInstanceData(JobSystem& jobs, const Scene& scene, const uint32_t* order, uint32_t count, InstanceData* out)
+{
+    PROFILE_SCOPE("ComputeInstanceData");
+
+    // small enough for the gathered transforms and matrices to stay in L1
+    constexpr uint32_t BATCH_SIZE = 64;
+
+    ParallelFor(jobs, count, 1024, [&](uint32_t begin, uint32_t end)
+    {
+        Transform transforms[BATCH_SIZE];
+        Mat4 models[BATCH_SIZE];
+
+        for (uint32_t batchBegin = begin; batchBegin < end; batchBegin += BATCH_SIZE)
+        {
+            uint32_t batchCount = end - batchBegin < BATCH_SIZE ? end - batchBegin : BATCH_SIZE;
+
+            for (uint32_t i = 0; i < batchCount; i++)
+                transforms[i] = GetInstanceTransform(scene, order[batchBegin + i]);
+
+            Mat4FromTransformBatch(transforms, models, batchCount);
+
+            for (uint32_t i = 0; i < batchCount; i++)
+            {
+                InstanceData& instance = out[batchBegin + i];
+                instance.model = models[i];
+
+                Mat4 normalMatrix = Mat4Transpose(Mat4AffineInverse(models[i]));
+                for (uint32_t r = 0; r < 3; r++)
+                    instance.normalMatrix[r] = { normalMatrix.m[r][0], normalMatrix.m[r][1], normalMatrix.m[r][2], 0.0f };
+            }
+        }
+    });
+}
+
+void RunSceneBenchmark(JobSystem& jobs, uint32_t instanceCount, SceneBenchmarkResult& result)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> location(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> rotation(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    Scene scene;
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        Transform transform;
+        transform.location = { location(rng), location(rng), location(rng) };
+        transform.rotation = { rotation(rng), rotation(rng), rotation(rng) };
+        transform.scale = { scale(rng), scale(rng), scale(rng) };
+        AddInstance(scene, i % 4, transform);
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<InstanceRange> ranges;
+    SortInstancesByMesh(scene, 4, order, ranges);
+
+    std::vector<InstanceData> instances(instanceCount);
+
+    double best = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        ComputeInstanceData(jobs, scene, order.data(), instanceCount, instances.data());
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = ms < best ? ms : best;
+    }
+
+    result.instanceCount = instanceCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.ms = best;
+    result.instancesPerMs = best > 0.0 ? instanceCount / best : 0.0;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "simd_math.h"
+#include "jobs.h"
+
+#include <vector>
+
+// every instance of the scene, kept as structure of arrays so the batched world matrix pass
+// streams through tightly packed floats
+struct Scene
+{
+    std::vector<float> locationX, locationY, locationZ;
+    std::vector<float> rotationX, rotationY, rotationZ;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<uint32_t> meshIndices;
+};
+
+// what the vertex shader reads per instance, model is not transposed and normalMatrix holds the
+// rows of transpose(inverse(model))
+struct InstanceData
+{
+    Mat4 model;
+    Vec4 normalMatrix[3];
+};
+
+// contiguous run of the instance buffer drawn with a single mesh
+struct InstanceRange
+{
+    uint32_t first;
+    uint32_t count;
+};
+
+uint32_t AddInstance(Scene& scene, uint32_t meshIndex, const Transform& transform);
+void ClearScene(Scene& scene);
+
+uint32_t GetInstanceCount(const Scene& scene);
+Transform GetInstanceTransform(const Scene& scene, uint32_t instance);
+void SetInstanceTransform(Scene& scene, uint32_t instance, const Transform& transform);
+
+// counting sort of the instances by mesh, order[i] is the scene instance stored at slot i of the
+// instance buffer and ranges[mesh] is where that mesh's instances live
+void SortInstancesByMesh(const Scene& scene, uint32_t meshCount, std::vector<uint32_t>& order, std::vector<InstanceRange>& ranges);
+
+// world and normal matrices for order[0..count) written to out[0..count), batched and split across the job system
+void ComputeInstanceData(JobSystem& jobs, const Scene& scene, const uint32_t* order, uint32_t count, InstanceData* out);
+
+struct SceneBenchmarkResult
+{
+    uint32_t instanceCount;
+    uint32_t workerCount;
+    double ms;
+    double instancesPerMs;
+};
+
+// random scene of instanceCount instances pushed through ComputeInstanceData, best of a few runs
+void RunSceneBenchmark(JobSystem& jobs, uint32_t instanceCount, SceneBenchmarkResult& result);
@@ -0,0 +1,419 @@
+#include "shader_cache.h"
+#include "mapped_file.h"
+#include "profiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+using ShaderClock = std::chrono::high_resolution_clock;
+
+static float MillisecondsSince(ShaderClock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(ShaderClock::now() - start).count();
+}
+
+// fnv-1a, plenty for telling a handful of sources apart
+static void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+}
+
+// length first so "ab" + "c" and "a" + "bc" differ
+static void HashString(uint64_t& hash, const std::string& text)
+{
+    uint64_t size = text.size();
+    HashBytes(hash, &size, sizeof(size));
+    HashBytes(hash, text.data(), text.size());
+}
+
+static bool ReadTextFile(const std::string& path, std::string& outText)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    outText.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// the file and every file it includes, each once and in the order they appear. includes in comments or disabled
+// branches count as well, a key that changes when it would not have to only costs a compile
+static bool HashShaderFile(uint64_t& hash, const std::filesystem::path& path, std::unordered_set<std::string>& visited)
+{
+    std::string normalized = path.lexically_normal().generic_string();
+    if (!visited.insert(normalized).second)
+        return true;
+
+    std::string source;
+    if (!ReadTextFile(normalized, source))
+        return false;
+
+    HashString(hash, source);
+
+    size_t cursor = 0;
+    while ((cursor = source.find("#include", cursor)) != std::string::npos)
+    {
+        cursor += strlen("#include");
+
+        size_t open = source.find_first_not_of(" \t", cursor);
+        if (open == std::string::npos || source[open] != '"')
+            continue;
+
+        size_t close = source.find_first_of("\"\n", open + 1);
+        if (close == std::string::npos || source[close] != '"')
+            continue;
+
+        if (!HashShaderFile(hash, path.parent_path() / source.substr(open + 1, close - open - 1), visited))
+            return false;
+
+        cursor = close + 1;
+    }
+
+    return true;
+}
+
+bool GetShaderPermutationKey(const ShaderPermutation& permutation, uint64_t& outKey)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    uint32_t version = SHADER_CACHE_VERSION;
+    HashBytes(hash, &version, sizeof(version));
+    HashString(hash, permutation.entry);
+    HashString(hash, permutation.profile);
+
+    uint64_t defineCount = permutation.defines.size();
+    HashBytes(hash, &defineCount, sizeof(defineCount));
+    for (const ShaderDefine& define : permutation.defines)
+    {
+        HashString(hash, define.name);
+        HashString(hash, define.value);
+    }
+
+    std::unordered_set<std::string> visited;
+    if (!HashShaderFile(hash, permutation.path, visited))
+        return false;
+
+    outKey = hash;
+    return true;
+}
+
+uint64_t GetShaderPermutationId(const ShaderPermutation& permutation)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    HashString(hash, std::filesystem::path(permutation.path).lexically_normal().generic_string());
+    HashString(hash, permutation.entry);
+    HashString(hash, permutation.profile);
+
+    uint64_t defineCount = permutation.defines.size();
+    HashBytes(hash, &defineCount, sizeof(defineCount));
+    for (const ShaderDefine& define : permutation.defines)
+    {
+        HashString(hash, define.name);
+        HashString(hash, define.value);
+    }
+
+    return hash;
+}
+
+// "<shader>.<permutation>.", every entry of the permutation starts with it
+static std::string GetShaderCachePrefix(const ShaderPermutation& permutation)
+{
+    char id[32];
+    snprintf(id, sizeof(id), ".%016" PRIx64 ".", GetShaderPermutationId(permutation));
+    return std::filesystem::path(permutation.path).filename().generic_string() + id;
+}
+
+std::string GetShaderCachePath(const std::string& cacheDirectory, const ShaderPermutation& permutation, uint64_t key)
+{
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "%016" PRIx64 ".lshader", key);
+    return (std::filesystem::path(cacheDirectory) / (GetShaderCachePrefix(permutation) + suffix)).generic_string();
+}
+
+uint32_t RemoveStaleShaderCaches(const std::string& cacheDirectory, const ShaderPermutation& permutation, uint64_t key)
+{
+    std::string prefix = GetShaderCachePrefix(permutation);
+    std::string current = std::filesystem::path(GetShaderCachePath(cacheDirectory, permutation, key)).filename().generic_string();
+
+    // other permutations write and remove their own entries meanwhile, they never share the prefix. the iterator
+    // steps with an error code so a file vanishing under it ends the walk instead of throwing
+    uint32_t removed = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(cacheDirectory, error), end; !error && it != end; it.increment(error))
+    {
+        const std::filesystem::path& path = it->path();
+        std::string name = path.filename().generic_string();
+        if (name.compare(0, prefix.size(), prefix) || path.extension() != ".lshader" || name == current)
+            continue;
+
+        std::error_code removeError;
+        if (std::filesystem::remove(path, removeError))
+            removed++;
+    }
+
+    return removed;
+}
+
+bool ReadShaderCache(const std::string& cachePath, uint64_t key, std::vector<uint8_t>& outBytecode)
+{
+    MappedFile file;
+    if (!file.Map(cachePath))
+        return false;
+
+    const ShaderCacheHeader* header = (const ShaderCacheHeader*)file.data;
+
+    bool valid = file.size >= sizeof(ShaderCacheHeader)
+        && header->magic == SHADER_CACHE_MAGIC
+        && header->version == SHADER_CACHE_VERSION
+        && header->key == key
+        && header->bytecodeSize > 0
+        && file.size == sizeof(ShaderCacheHeader) + header->bytecodeSize;
+
+    if (!valid)
+        return false;
+
+    const uint8_t* bytecode = file.data + sizeof(ShaderCacheHeader);
+    outBytecode.assign(bytecode, bytecode + header->bytecodeSize);
+    return true;
+}
+
+bool WriteShaderCache(const std::string& cachePath, uint64_t key, const std::vector<uint8_t>& bytecode)
+{
+    ShaderCacheHeader header = {};
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.key = key;
+    header.bytecodeSize = bytecode.size();
+
+    // write to a temp file first so a crash never leaves a half written cache behind
+    std::string tempPath = cachePath + ".tmp";
+
+    bool ok;
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)bytecode.data(), bytecode.size());
+        file.flush();
+        ok = file.good();
+    }
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, cachePath, error);
+
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+// without a key the shader is still compiled, the compiler says what is missing, it just is not cached
+static void LoadShader(const std::string& cacheDirectory, LoadedShader& shader, const ShaderCompiler& compile)
+{
+    PROFILE_SCOPE("LoadShader");
+
+    auto start = ShaderClock::now();
+
+    bool hasKey = GetShaderPermutationKey(shader.permutation, shader.key);
+    std::string cachePath = hasKey ? GetShaderCachePath(cacheDirectory, shader.permutation, shader.key) : std::string();
+
+    shader.loadedFromCache = hasKey && ReadShaderCache(cachePath, shader.key, shader.bytecode);
+    shader.ok = shader.loadedFromCache;
+
+    if (!shader.loadedFromCache)
+    {
+        shader.bytecode.clear();
+        shader.ok = compile(shader.permutation, shader.bytecode, shader.errors) && !shader.bytecode.empty();
+
+        // a cache that cannot be written only means compiling again next launch, the stale ones stay until it can
+        if (shader.ok && hasKey && WriteShaderCache(cachePath, shader.key, shader.bytecode))
+            shader.staleRemoved = RemoveStaleShaderCaches(cacheDirectory, shader.permutation, shader.key);
+    }
+
+    shader.ms = MillisecondsSince(start);
+}
+
+ShaderLoadStats LoadShaders(JobSystem& jobs, const std::string& cacheDirectory, LoadedShader* shaders, uint32_t count,
+    const ShaderCompiler& compile)
+{
+    PROFILE_SCOPE("LoadShaders");
+
+    auto start = ShaderClock::now();
+
+    // a directory that cannot be made fails every write, the shaders still compile
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+
+    JobCounter counter;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        LoadedShader* shader = shaders + i;
+        jobs.Submit([shader, &cacheDirectory, &compile] { LoadShader(cacheDirectory, *shader, compile); }, counter);
+    }
+
+    jobs.Wait(counter);
+
+    ShaderLoadStats stats;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        stats.fromCache += shaders[i].loadedFromCache ? 1 : 0;
+        stats.compiled += shaders[i].loadedFromCache ? 0 : 1;
+        stats.failed += shaders[i].ok ? 0 : 1;
+        stats.staleRemoved += shaders[i].staleRemoved;
+    }
+
+    stats.wallTimeMs = MillisecondsSince(start);
+    return stats;
+}
+
+bool CompileShaderStub(const ShaderPermutation& permutation, std::vector<uint8_t>& outBytecode, std::string& outErrors)
+{
+    constexpr uint32_t COMPILE_ROUNDS = 200; // passes over the source, about a millisecond
+
+    std::string source;
+    if (!ReadTextFile(permutation.path, source))
+    {
+        outErrors = permutation.path + ": not found";
+        return false;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint32_t round = 0; round < COMPILE_ROUNDS; round++)
+        HashString(hash, source);
+    for (const ShaderDefine& define : permutation.defines)
+        HashString(hash, define.name);
+    HashString(hash, permutation.profile);
+
+    outBytecode.resize(64);
+    for (uint32_t i = 0; i < 64; i += 8)
+    {
+        HashBytes(hash, &i, sizeof(i));
+        memcpy(outBytecode.data() + i, &hash, sizeof(hash));
+    }
+
+    return true;
+}
+
+void RunShaderCacheBenchmark(JobSystem& jobs, ShaderCacheBenchmarkResult& result)
+{
+    constexpr uint32_t SOURCE_COUNT = 4;
+    constexpr uint32_t DEFINE_COUNT = 4; // every combination of them
+    constexpr uint32_t SOURCE_LINES = 200;
+    constexpr uint32_t RUNS = 3;
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "lighting_shader_bench";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+
+    auto writeFile = [](const std::filesystem::path& path, const std::string& text)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+    };
+
+    auto writeInclude = [&](uint32_t edit)
+    {
+        writeFile(directory / "common.hlsli", "// shared by every source, edit " + std::to_string(edit) + "\nfloat4 Shade(float4 color) { return color; }\n");
+    };
+
+    std::vector<ShaderPermutation> permutations;
+    for (uint32_t source = 0; source < SOURCE_COUNT; source++)
+    {
+        std::string text = "#include \"common.hlsli\"\n";
+        for (uint32_t line = 0; line < SOURCE_LINES; line++)
+            text += "static const float value" + std::to_string(line) + " = " + std::to_string(source * SOURCE_LINES + line) + ".0;\n";
+
+        std::string path = (directory / ("shader" + std::to_string(source) + ".hlsl")).generic_string();
+        writeFile(path, text);
+
+        for (uint32_t combination = 0; combination < (1 << DEFINE_COUNT); combination++)
+        {
+            ShaderPermutation& permutation = permutations.emplace_back();
+            permutation.path = path;
+            permutation.entry = "main";
+            permutation.profile = source % 2 ? "ps_5_0" : "vs_5_0";
+            for (uint32_t define = 0; define < DEFINE_COUNT; define++)
+            {
+                if (combination & (1 << define))
+                    permutation.defines.push_back({ "FEATURE_" + std::to_string(define), "1" });
+            }
+        }
+    }
+
+    std::string cacheDirectory = (directory / "cache").generic_string();
+
+    auto countCaches = [&]()
+    {
+        uint32_t cacheCount = 0;
+        for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error))
+            cacheCount += entry.path().extension() == ".lshader" ? 1 : 0;
+        return cacheCount;
+    };
+
+    uint32_t shaderCount = (uint32_t)permutations.size();
+    auto makeShaders = [&]()
+    {
+        std::vector<LoadedShader> shaders(shaderCount);
+        for (uint32_t i = 0; i < shaderCount; i++)
+            shaders[i].permutation = permutations[i];
+        return shaders;
+    };
+
+    result = {};
+    result.shaderCount = shaderCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.serialMs = result.coldMs = result.warmMs = result.includeMs = 1e30;
+
+    for (uint32_t run = 0; run < RUNS; run++)
+    {
+        writeInclude(run * 2);
+        std::filesystem::remove_all(cacheDirectory, error);
+
+        auto start = ShaderClock::now();
+        for (const ShaderPermutation& permutation : permutations)
+        {
+            std::vector<uint8_t> bytecode;
+            std::string errors;
+            CompileShaderStub(permutation, bytecode, errors);
+        }
+        result.serialMs = std::min(result.serialMs, (double)MillisecondsSince(start));
+
+        std::vector<LoadedShader> cold = makeShaders();
+        ShaderLoadStats coldStats = LoadShaders(jobs, cacheDirectory, cold.data(), shaderCount, CompileShaderStub);
+        result.coldMs = std::min(result.coldMs, (double)coldStats.wallTimeMs);
+
+        std::vector<LoadedShader> warm = makeShaders();
+        ShaderLoadStats warmStats = LoadShaders(jobs, cacheDirectory, warm.data(), shaderCount, CompileShaderStub);
+        result.warmMs = std::min(result.warmMs, (double)warmStats.wallTimeMs);
+        result.warmMisses = std::max(result.warmMisses, warmStats.compiled);
+
+        for (uint32_t i = 0; i < shaderCount; i++)
+            result.mismatches += cold[i].bytecode != warm[i].bytecode ? 1 : 0;
+
+        writeInclude(run * 2 + 1);
+
+        std::vector<LoadedShader> edited = makeShaders();
+        ShaderLoadStats editedStats = LoadShaders(jobs, cacheDirectory, edited.data(), shaderCount, CompileShaderStub);
+        result.includeMs = std::min(result.includeMs, (double)editedStats.wallTimeMs);
+        result.includeHits = std::max(result.includeHits, editedStats.fromCache);
+
+        // every permutation compiled again under its new key, the entries of the old ones must be gone
+        uint32_t cacheCount = countCaches();
+        result.staleLeft = std::max(result.staleLeft, cacheCount > shaderCount ? cacheCount - shaderCount : 0);
+    }
+
+    std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "jobs.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// compiled shaders are cached in a directory of their own, away from the sources, as
+// "<shader>.<permutation>.<key>.lshader". the permutation is a hash of what names the variant: the path, entry point,
+// profile and defines. the key is a hash of everything the bytecode depends on: the source and every file it includes
+// as well. editing any of them changes the key and simply misses, nothing is ever compared by timestamp, and writing
+// the new entry removes the ones the permutation left under older keys so edits do not pile up.
+// compiling goes through a callback so none of this needs d3d, renderer_d3d11.cpp hands in the real compiler
+//
+// layout: ShaderCacheHeader | bytecode
+
+constexpr uint32_t SHADER_CACHE_MAGIC = 0x4448534c; // "LSHD"
+constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+// relative to the working directory, like the shaders themselves
+constexpr const char* SHADER_CACHE_DIRECTORY = "shader_cache";
+
+struct ShaderCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t bytecodeSize;
+};
+
+struct ShaderDefine
+{
+    std::string name;
+    std::string value;
+};
+
+// one variant of a source file
+struct ShaderPermutation
+{
+    std::string path;
+    std::string entry;
+    std::string profile; // vs_5_0, ps_5_0, ...
+    std::vector<ShaderDefine> defines;
+};
+
+// hashes the permutation together with its source and, recursively, every file it includes with #include "file"
+// relative to the including one. false when one of the files is missing
+bool GetShaderPermutationKey(const ShaderPermutation& permutation, uint64_t& outKey);
+
+// the path, entry point, profile and defines, none of the file contents
+uint64_t GetShaderPermutationId(const ShaderPermutation& permutation);
+
+std::string GetShaderCachePath(const std::string& cacheDirectory, const ShaderPermutation& permutation, uint64_t key);
+
+// deletes the entries of the permutation written for any other key, returns how many
+uint32_t RemoveStaleShaderCaches(const std::string& cacheDirectory, const ShaderPermutation& permutation, uint64_t key);
+
+// fails if missing, corrupt, from another version or written for another key
+bool ReadShaderCache(const std::string& cachePath, uint64_t key, std::vector<uint8_t>& outBytecode);
+bool WriteShaderCache(const std::string& cachePath, uint64_t key, const std::vector<uint8_t>& bytecode);
+
+// compiles one permutation, called from worker threads so it must not touch anything shared. errors are kept for the log
+using ShaderCompiler = std::function<bool(const ShaderPermutation& permutation, std::vector<uint8_t>& outBytecode, std::string& outErrors)>;
+
+struct LoadedShader
+{
+    ShaderPermutation permutation;
+    uint64_t key = 0;
+    std::vector<uint8_t> bytecode;
+    std::string errors;
+    bool loadedFromCache = false;
+    bool ok = false;
+    uint32_t staleRemoved = 0; // older entries of the permutation deleted after compiling
+    float ms = 0.0f;
+};
+
+struct ShaderLoadStats
+{
+    uint32_t fromCache = 0;
+    uint32_t compiled = 0;
+    uint32_t failed = 0;
+    uint32_t staleRemoved = 0;
+    float wallTimeMs = 0.0f;
+};
+
+// one job per shader: reads the cache when it has the key, otherwise compiles and writes it for the next launch.
+// creates cacheDirectory when missing, blocks until every shader is done
+ShaderLoadStats LoadShaders(JobSystem& jobs, const std::string& cacheDirectory, LoadedShader* shaders, uint32_t count,
+    const ShaderCompiler& compile);
+
+// stands in for the real compiler where there is none: reads the source, burns some cpu time over it and returns a
+// hash of the source, defines and profile as the bytecode. fails when the source is missing
+bool CompileShaderStub(const ShaderPermutation& permutation, std::vector<uint8_t>& outBytecode, std::string& outErrors);
+
+struct ShaderCacheBenchmarkResult
+{
+    uint32_t shaderCount;
+    uint32_t workerCount;
+    double serialMs;     // every permutation compiled one after the other, no cache
+    double coldMs;       // LoadShaders with an empty cache
+    double warmMs;       // LoadShaders again, every shader from the cache
+    double includeMs;    // LoadShaders after editing the include every source shares
+    uint32_t warmMisses; // should be 0
+    uint32_t includeHits; // should be 0, the include is part of every key
+    uint32_t staleLeft;  // entries still in the cache for keys no longer used after the edit, should be 0
+    uint32_t mismatches; // shaders whose cached bytecode differs from the compiled one, should be 0
+};
+
+// a few generated sources sharing an include, every combination of a few defines, compiled by CompileShaderStub. the
+// sources and their cache go to a directory under the system temp path
+void RunShaderCacheBenchmark(JobSystem& jobs, ShaderCacheBenchmarkResult& result);
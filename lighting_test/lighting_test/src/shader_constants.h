@@ -0,0 +1,68 @@
+#pragma once
+
+#include "simd_math.h"
+#include "light_culling.h"
+
+// cpu side of the constant buffers in shaders/, layouts have to match the hlsl
+// split by how often they change so an unchanged buffer is never uploaded again
+
+// vertex.hlsl b0 and pixel.hlsl b1, changes with the camera and the window size
+struct ViewConstants
+{
+    Mat4 viewProj;  // view * proj, transposed for the column major hlsl side
+    Vec4 viewDepth; // third column of view, dot with the world position gives the view space depth
+    Vec4 camPos;
+
+    // how to find the pixel's cluster, the point lights themselves are in structured buffers
+    ClusterConstants clusters = {};
+};
+
+// vertex.hlsl b1 and pixel.hlsl b2, one per draw, suballocated from a ring of dynamic memory and bound with an offset
+struct ObjectConstants
+{
+    // dequantizes packed positions, identity for full vertices
+    Vec4 positionScale;
+    Vec4 positionOffset;
+
+    // a draw covers a run of submeshes, the pixel shader finds the triangle's submesh in the submesh triangle table
+    uint32_t firstTriangle;         // of the draw in its index buffer, SV_PrimitiveID counts from 0 in every draw
+    uint32_t submeshCount;
+    uint32_t submeshTriangleOffset; // where the drawn level's submeshes start in the table
+    uint32_t padding;
+};
+
+// pixel.hlsl t7, one per submesh of the mesh being drawn, where its texture is in the mesh's texture arrays
+struct SubmeshTexture
+{
+    int32_t array;  // albedo array, -1 for white
+    float layer;
+    float maxLod;   // last level an atlas rect has
+    float padding;
+    Vec4 uvRect;    // scale xy, offset zw. (1, 1, 0, 0) is a whole layer and wraps in the sampler
+};
+
+// pixel.hlsl t8 is a uint per submesh of every level of detail of every mesh, the first triangle of the submesh in
+// the index buffer the level draws from this frame. rewritten every frame since meshlet culling moves them, see meshlet.h
+
+// pixel.hlsl t9 is the main light's shadow cube, depth of every face as drawn with MakeShadowFaceViewProj
+
+// offsets passed to VSSetConstantBuffers1 are multiples of 16 constants
+constexpr uint32_t CONSTANT_BUFFER_ALIGNMENT = 256;
+
+// pixel.hlsl b0, only changes when edited in the ui
+struct LightSettings
+{
+    Vec4 pos = { 0.9f, 0.0f, 0.6f, 0.0f };
+    Vec4 ambientColor = { 0.1f, 0.1f, 0.1f, 1.0f };
+    Vec4 lightColor = { 1.0f, 1.0f, 1.0f, 0.0f };
+    float ambientStrength = 0.1f;
+    float specularStrength = 0.7f;
+    float specularPow = 256;
+    uint32_t shadowsEnabled = 1;
+
+    // the main light's cube shadow, see shadow_cache.h. near and range are the projection the faces were drawn with
+    float shadowNear = 0.05f;
+    float shadowRange = 25.0f;
+    float shadowBias = 0.03f;        // world units the compared distance is pulled towards the light
+    float shadowFilterRadius = 1.5f; // spread of the pcf taps in texels of a face
+};
@@ -0,0 +1,411 @@
+#include "shadow_cache.h"
+#include "profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+// look direction and up vector of every face, the up vectors are the ones d3d cube textures are addressed with
+static const Vec3 sFaceDirections[SHADOW_CUBE_FACES] =
+{
+    { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+    { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+};
+
+static const Vec3 sFaceUps[SHADOW_CUBE_FACES] =
+{
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+    { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 1.0f },
+    { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+};
+
+Mat4 MakeShadowFaceViewProj(const ShadowCubeProjection& projection, uint32_t face)
+{
+    Mat4 view = Mat4LookToLH(projection.light, sFaceDirections[face], sFaceUps[face]);
+    Mat4 proj = Mat4PerspectiveFovLH(90.0f * TO_RADIANS, 1.0f, projection.nearZ, projection.farZ);
+    return Mat4Multiply(view, proj);
+}
+
+uint32_t GetShadowFaceMask(const ShadowCubeProjection& projection, const Vec3& center, float radius)
+{
+    const float d[3] = { center.x - projection.light.x, center.y - projection.light.y, center.z - projection.light.z };
+
+    // the side planes of a face go through the light at 45 degrees, (forward -+ d[j]) / sqrt(2) is the distance to them
+    float sideRadius = radius * 1.41421356f;
+
+    uint32_t mask = 0;
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+    {
+        uint32_t axis = face / 2;
+        float forward = face & 1 ? -d[axis] : d[axis];
+
+        if (forward < projection.nearZ - radius || forward > projection.farZ + radius)
+            continue;
+
+        if (forward - fabsf(d[(axis + 1) % 3]) < -sideRadius || forward - fabsf(d[(axis + 2) % 3]) < -sideRadius)
+            continue;
+
+        mask |= 1 << face;
+    }
+
+    return mask;
+}
+
+// world space bounding sphere of an instance, the radius grows with the largest axis scale like CullScene does
+static uint32_t GetInstanceFaceMask(const ShadowCubeProjection& projection, const SubMeshBounds& bounds, const Mat4& model)
+{
+    const float (*m)[4] = model.m;
+    Vec3 c = bounds.center;
+    Vec3 center =
+    {
+        c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0],
+        c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1],
+        c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2],
+    };
+
+    float scaleSquared = 0.0f;
+    for (uint32_t row = 0; row < 3; row++)
+        scaleSquared = fmaxf(scaleSquared, m[row][0] * m[row][0] + m[row][1] * m[row][1] + m[row][2] * m[row][2]);
+
+    return GetShadowFaceMask(projection, center, bounds.radius * sqrtf(scaleSquared));
+}
+
+uint32_t UpdateShadowCube(JobSystem& jobs, const ShadowCubeProjection& projection, const MeshBounds* meshes, uint32_t meshCount,
+    const InstanceData* instances, const InstanceRange* ranges, ShadowCubeCache& cache)
+{
+    PROFILE_SCOPE("UpdateShadowCube");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    uint32_t instanceCount = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        instanceCount = ranges[mesh].first + ranges[mesh].count > instanceCount ? ranges[mesh].first + ranges[mesh].count : instanceCount;
+
+    // a moved light or a new range changes what every face sees, the masks are still needed for gathering
+    bool projectionChanged = !cache.valid || memcmp(&projection, &cache.projection, sizeof(ShadowCubeProjection)) != 0;
+
+    uint32_t dirty = projectionChanged ? SHADOW_ALL_FACES : 0;
+    uint32_t changed = 0;
+
+    // slots past the end were removed, their casters have to leave the faces they were in
+    uint32_t oldCount = (uint32_t)cache.faceMasks.size();
+    for (uint32_t i = instanceCount; i < oldCount; i++)
+    {
+        dirty |= cache.faceMasks[i];
+        changed++;
+    }
+
+    cache.models.resize(instanceCount);
+    cache.meshes.resize(instanceCount);
+    cache.faceMasks.resize(instanceCount);
+
+    std::atomic<uint32_t> sharedDirty = dirty;
+    std::atomic<uint32_t> sharedChanged = changed;
+
+    ParallelFor(jobs, instanceCount, 1024, [&](uint32_t begin, uint32_t end)
+    {
+        uint32_t localDirty = 0;
+        uint32_t localChanged = 0;
+
+        for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+        {
+            uint32_t meshBegin = ranges[mesh].first > begin ? ranges[mesh].first : begin;
+            uint32_t meshEnd = ranges[mesh].first + ranges[mesh].count < end ? ranges[mesh].first + ranges[mesh].count : end;
+
+            for (uint32_t i = meshBegin; i < meshEnd; i++)
+            {
+                const Mat4& model = instances[i].model;
+                uint32_t faceMask = GetInstanceFaceMask(projection, meshes[mesh].bounds, model);
+
+                // a slot that now holds another mesh or transform leaves the faces it was in and enters the new ones,
+                // rotating in place keeps the sphere but not what the faces see
+                bool slotChanged = i >= oldCount || cache.meshes[i] != mesh || memcmp(&cache.models[i], &model, sizeof(Mat4)) != 0;
+                if (slotChanged)
+                {
+                    localDirty |= faceMask | (i < oldCount ? cache.faceMasks[i] : 0);
+                    localChanged++;
+                }
+
+                cache.models[i] = model;
+                cache.meshes[i] = mesh;
+                cache.faceMasks[i] = (uint8_t)faceMask;
+            }
+        }
+
+        sharedDirty.fetch_or(localDirty);
+        sharedChanged.fetch_add(localChanged);
+    });
+
+    dirty = sharedDirty.load();
+
+    cache.projection = projection;
+    cache.valid = true;
+
+    uint32_t redrawn = 0;
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+        redrawn += (dirty >> face) & 1;
+
+    cache.stats.facesRedrawn = redrawn;
+    cache.stats.facesKept = SHADOW_CUBE_FACES - redrawn;
+    cache.stats.instancesChanged = sharedChanged.load();
+    cache.stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    return dirty;
+}
+
+void GatherShadowCasters(JobSystem& jobs, const ShadowCubeCache& cache, uint32_t faceMask, const InstanceData* instances,
+    const InstanceRange* ranges, uint32_t meshCount, ShadowCasterSet& out)
+{
+    PROFILE_SCOPE("GatherShadowCasters");
+
+    out.faceMask = faceMask;
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+        out.faceViewProj[face] = MakeShadowFaceViewProj(cache.projection, face);
+
+    // counted first so every face writes its own part of the instances
+    out.ranges.assign(SHADOW_CUBE_FACES * meshCount, { 0, 0 });
+
+    ParallelFor(jobs, SHADOW_CUBE_FACES, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t face = begin; face < end; face++)
+        {
+            if (!(faceMask & (1 << face)))
+                continue;
+
+            for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+            {
+                uint32_t count = 0;
+                for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+                    count += (cache.faceMasks[i] >> face) & 1;
+                out.ranges[face * meshCount + mesh].count = count;
+            }
+        }
+    });
+
+    uint32_t total = 0;
+    for (InstanceRange& range : out.ranges)
+    {
+        range.first = total;
+        total += range.count;
+    }
+
+    out.instances.resize(total);
+
+    ParallelFor(jobs, SHADOW_CUBE_FACES, 1, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t face = begin; face < end; face++)
+        {
+            if (!(faceMask & (1 << face)))
+                continue;
+
+            for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+            {
+                InstanceData* cursor = out.instances.data() + out.ranges[face * meshCount + mesh].first;
+                for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+                {
+                    if ((cache.faceMasks[i] >> face) & 1)
+                        *cursor++ = instances[i];
+                }
+            }
+        }
+    });
+}
+
+// what a face was drawn with, for the brute force check of the benchmark
+struct BenchmarkCaster
+{
+    uint32_t slot;
+    uint32_t mesh;
+    Mat4 model;
+};
+
+static bool IsSameCasters(const std::vector<BenchmarkCaster>& a, const std::vector<BenchmarkCaster>& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (uint32_t i = 0; i < a.size(); i++)
+    {
+        if (a[i].slot != b[i].slot || a[i].mesh != b[i].mesh || memcmp(&a[i].model, &b[i].model, sizeof(Mat4)) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+void RunShadowBenchmark(JobSystem& jobs, uint32_t instanceCount, ShadowBenchmarkResult& result)
+{
+    constexpr uint32_t MESH_COUNT = 4;
+    constexpr uint32_t FRAMES = 120;
+    constexpr uint32_t MOVERS = 4;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> location(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> rotation(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    // a sphere per mesh is all the cache looks at
+    MeshBounds meshes[MESH_COUNT];
+    for (uint32_t mesh = 0; mesh < MESH_COUNT; mesh++)
+    {
+        SubMeshBounds bounds;
+        bounds.center = { unit(rng) * 0.2f, unit(rng) * 0.2f, unit(rng) * 0.2f };
+        bounds.min = bounds.center - Vec3 { 0.5f, 0.5f, 0.5f };
+        bounds.max = bounds.center + Vec3 { 0.5f, 0.5f, 0.5f };
+        bounds.radius = 0.866f;
+        meshes[mesh].bounds = bounds;
+        meshes[mesh].submeshes.push_back(bounds);
+    }
+
+    std::vector<Transform> startTransforms(instanceCount);
+    for (Transform& transform : startTransforms)
+    {
+        transform.location = { location(rng), location(rng) * 0.25f, location(rng) };
+        transform.rotation = { rotation(rng), rotation(rng), rotation(rng) };
+        transform.scale = { scale(rng), scale(rng), scale(rng) };
+    }
+
+    std::vector<Vec3> drift(MOVERS);
+    for (Vec3& direction : drift)
+        direction = Normalize({ unit(rng), unit(rng) * 0.25f, unit(rng) }) * 0.05f;
+
+    enum class Motion { None, Orbit, Drift, Spin, Light };
+    struct SceneDesc
+    {
+        const char* name;
+        Motion motion;
+    };
+
+    const SceneDesc scenes[] =
+    {
+        { "static", Motion::None },
+        { "one orbiting object", Motion::Orbit },
+        { "4 drifting objects", Motion::Drift },
+        { "4 spinning in place", Motion::Spin },
+        { "moving light", Motion::Light },
+    };
+
+    result.instanceCount = instanceCount;
+    result.workerCount = jobs.GetWorkerCount();
+    result.scenes.clear();
+
+    // the face test against the faces' own matrices: a point of a sphere that projects inside a face has to be in its mask
+    result.faceTestMisses = 0;
+    {
+        ShadowCubeProjection projection = { { 1.0f, -2.0f, 0.5f }, 0.05f, 25.0f };
+        Mat4 faceViewProj[SHADOW_CUBE_FACES];
+        for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+            faceViewProj[face] = MakeShadowFaceViewProj(projection, face);
+
+        for (uint32_t sphere = 0; sphere < 4096; sphere++)
+        {
+            Vec3 center = { location(rng), location(rng), location(rng) };
+            float radius = scale(rng);
+            uint32_t mask = GetShadowFaceMask(projection, center, radius);
+
+            for (uint32_t sample = 0; sample < 16; sample++)
+            {
+                Vec3 p = center + Normalize({ unit(rng), unit(rng), unit(rng) }) * (radius * fabsf(unit(rng)));
+                for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+                {
+                    Vec4 clip = Vec4Transform({ p.x, p.y, p.z, 1.0f }, faceViewProj[face]);
+                    bool inside = clip.w > 0.0f && fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && clip.z >= 0.0f && clip.z <= clip.w;
+                    if (inside && !((mask >> face) & 1))
+                        result.faceTestMisses++;
+                }
+            }
+        }
+    }
+
+    for (const SceneDesc& desc : scenes)
+    {
+        Scene scene;
+        for (uint32_t i = 0; i < instanceCount; i++)
+            AddInstance(scene, i % MESH_COUNT, startTransforms[i]);
+
+        std::vector<uint32_t> order;
+        std::vector<InstanceRange> ranges;
+        SortInstancesByMesh(scene, MESH_COUNT, order, ranges);
+
+        std::vector<InstanceData> instances(instanceCount);
+
+        ShadowCubeCache cache;
+        ShadowCasterSet casters;
+        ShadowCubeProjection projection = { { 0.0f, 0.0f, 0.0f }, 0.05f, 25.0f };
+
+        // per face, what it was last drawn with and what the frame has
+        std::vector<BenchmarkCaster> drawn[SHADOW_CUBE_FACES];
+        std::vector<BenchmarkCaster> current;
+
+        ShadowBenchmarkScene& out = result.scenes.emplace_back();
+        out = { desc.name, FRAMES, 0, 0, 0, 0, 0.0 };
+
+        // frame 0 draws every face and is not counted
+        for (uint32_t frame = 0; frame <= FRAMES; frame++)
+        {
+            float t = (float)frame;
+            for (uint32_t m = 0; m < MOVERS && frame > 0; m++)
+            {
+                Transform transform = startTransforms[m];
+                if (desc.motion == Motion::Orbit && m == 0)
+                {
+                    float angle = t * 3.0f * TO_RADIANS;
+                    transform.location = { cosf(angle) * 5.0f, 0.5f, sinf(angle) * 5.0f };
+                }
+                else if (desc.motion == Motion::Drift)
+                    transform.location = transform.location + drift[m] * t;
+                else if (desc.motion == Motion::Spin)
+                    transform.rotation.y += t * 2.0f;
+                SetInstanceTransform(scene, m, transform);
+            }
+
+            if (desc.motion == Motion::Light && frame > 0)
+                projection.light = { sinf(t * 0.05f) * 2.0f, 0.0f, cosf(t * 0.05f) * 2.0f };
+
+            ComputeInstanceData(jobs, scene, order.data(), instanceCount, instances.data());
+
+            auto start = std::chrono::high_resolution_clock::now();
+            uint32_t faceMask = UpdateShadowCube(jobs, projection, meshes, MESH_COUNT, instances.data(), ranges.data(), cache);
+            GatherShadowCasters(jobs, cache, faceMask, instances.data(), ranges.data(), MESH_COUNT, casters);
+            auto end = std::chrono::high_resolution_clock::now();
+
+            // brute force: every sphere against every face, a face is needed when its casters differ from the drawn ones
+            for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+            {
+                current.clear();
+                for (uint32_t mesh = 0; mesh < MESH_COUNT; mesh++)
+                {
+                    for (uint32_t i = ranges[mesh].first; i < ranges[mesh].first + ranges[mesh].count; i++)
+                    {
+                        if ((GetInstanceFaceMask(projection, meshes[mesh].bounds, instances[i].model) >> face) & 1)
+                            current.push_back({ i, mesh, instances[i].model });
+                    }
+                }
+
+                bool needed = frame == 0 || desc.motion == Motion::Light || !IsSameCasters(current, drawn[face]);
+                bool redrawn = (faceMask >> face) & 1;
+                if (redrawn)
+                    drawn[face] = current;
+
+                if (frame == 0)
+                    continue;
+
+                out.facesRedrawn += redrawn;
+                out.facesNeeded += needed;
+                out.facesMissed += needed && !redrawn;
+            }
+
+            if (frame == 0)
+                continue;
+
+            out.castersDrawn += (uint32_t)casters.instances.size();
+            out.ms += std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        out.ms /= FRAMES;
+    }
+}
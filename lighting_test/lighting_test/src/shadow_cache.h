@@ -0,0 +1,88 @@
+#pragma once
+
+#include "culling.h"
+
+#include <vector>
+
+// the main light casts its shadows through a cube of depth maps around it, one 90 degree face per axis direction.
+// drawing all six every frame is wasted work when nothing moved, so the cube is kept between frames and a face is only
+// drawn again when the light moved or when an instance whose bounding sphere reaches into the face moved in or out
+// of it or inside it. everything here is cpu side, the renderer just draws the casters of the faces it is handed
+
+constexpr uint32_t SHADOW_CUBE_FACES = 6;
+constexpr uint32_t SHADOW_ALL_FACES = (1 << SHADOW_CUBE_FACES) - 1;
+
+// where the cube is and how far it reaches, a face's far plane is farZ along its axis
+struct ShadowCubeProjection
+{
+    Vec3 light;
+    float nearZ;
+    float farZ;
+};
+
+// faces in d3d cube texture order: +x, -x, +y, -y, +z, -z. view * proj of one face, not transposed
+Mat4 MakeShadowFaceViewProj(const ShadowCubeProjection& projection, uint32_t face);
+
+// bit i set for every face i whose frustum the sphere reaches into
+uint32_t GetShadowFaceMask(const ShadowCubeProjection& projection, const Vec3& center, float radius);
+
+struct ShadowCacheStats
+{
+    uint32_t facesRedrawn = 0;
+    uint32_t facesKept = 0;
+    uint32_t instancesChanged = 0; // moved, added or removed since the cube was last brought up to date
+    float ms = 0.0f;
+};
+
+// what the faces of the cube were last drawn with, per slot of the instance buffer
+struct ShadowCubeCache
+{
+    ShadowCubeProjection projection = {};
+    bool valid = false;            // nothing is drawn before the first update
+    std::vector<Mat4> models;
+    std::vector<uint32_t> meshes;
+    std::vector<uint8_t> faceMasks; // faces each slot's bounding sphere reaches into
+    ShadowCacheStats stats;
+};
+
+// compares this frame's instances to what the cache holds and returns the faces to redraw as a mask, every face when the
+// projection changed and otherwise the faces a changed slot touches before or after the change. the cache is then up to
+// date with the frame. instances and ranges are sorted by mesh like CullScene takes them, split across the job system
+uint32_t UpdateShadowCube(JobSystem& jobs, const ShadowCubeProjection& projection, const MeshBounds* meshes, uint32_t meshCount,
+    const InstanceData* instances, const InstanceRange* ranges, ShadowCubeCache& cache);
+
+// the casters of every face to redraw, what the renderer needs to bring the cube up to date
+struct ShadowCasterSet
+{
+    uint32_t faceMask = 0;
+    Mat4 faceViewProj[SHADOW_CUBE_FACES];
+    std::vector<InstanceData> instances; // face after face, still sorted by mesh
+    std::vector<InstanceRange> ranges;   // face * meshCount + mesh, into instances, empty for the faces kept
+};
+
+// after UpdateShadowCube with the same instances, one job per face
+void GatherShadowCasters(JobSystem& jobs, const ShadowCubeCache& cache, uint32_t faceMask, const InstanceData* instances,
+    const InstanceRange* ranges, uint32_t meshCount, ShadowCasterSet& out);
+
+struct ShadowBenchmarkScene
+{
+    const char* name;
+    uint32_t frames;
+    uint32_t facesRedrawn;   // summed over the frames
+    uint32_t facesNeeded;    // faces whose casters differ from the ones they were last drawn with, found by brute force
+    uint32_t facesMissed;    // needed but not redrawn, should be 0
+    uint32_t castersDrawn;
+    double ms;               // UpdateShadowCube and GatherShadowCasters per frame
+};
+
+struct ShadowBenchmarkResult
+{
+    uint32_t instanceCount;
+    uint32_t workerCount;
+    uint32_t faceTestMisses; // random points inside a face's clip volume whose sphere the face mask left out, should be 0
+    std::vector<ShadowBenchmarkScene> scenes;
+};
+
+// random instances around a light played through a few typical frames: nothing moving, one object orbiting the light,
+// a handful of objects drifting, objects spinning in place and the light itself moving
+void RunShadowBenchmark(JobSystem& jobs, uint32_t instanceCount, ShadowBenchmarkResult& result);
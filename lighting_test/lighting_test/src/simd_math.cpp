@@ -0,0 +1,363 @@
+#include "simd_math.h"
+
+#include <math.h>
+
+#if SIMD_MATH_AVX2
+    #include <immintrin.h>
+#endif
+
+#if SIMD_MATH_SSE
+    #include <xmmintrin.h>
+#elif SIMD_MATH_NEON
+    #include <arm_neon.h>
+#endif
+
+const char* GetSimdMathPath()
+{
+#if SIMD_MATH_AVX2
+    return "avx2";
+#elif SIMD_MATH_SSE
+    return "sse";
+#elif SIMD_MATH_NEON
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+float Dot(const Vec3& a, const Vec3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+Vec3 Cross(const Vec3& a, const Vec3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+float Length(const Vec3& v)
+{
+    return sqrtf(Dot(v, v));
+}
+
+Vec3 Normalize(const Vec3& v)
+{
+    float length = Length(v);
+    return length > 0.0f ? v * (1.0f / length) : v;
+}
+
+Mat4 Mat4Identity()
+{
+    Mat4 result = {};
+    result.m[0][0] = result.m[1][1] = result.m[2][2] = result.m[3][3] = 1.0f;
+    return result;
+}
+
+// single matrices stay scalar, the compiler makes the same shuffles of these loops the intrinsics spelled out and
+// they measured no faster. the batches below are where the simd paths pay off
+
+Mat4 Mat4Transpose(const Mat4& m)
+{
+    Mat4 result;
+    for (uint32_t r = 0; r < 4; r++)
+        for (uint32_t c = 0; c < 4; c++)
+            result.m[r][c] = m.m[c][r];
+    return result;
+}
+
+Mat4 Mat4Multiply(const Mat4& a, const Mat4& b)
+{
+    Mat4 result;
+    for (uint32_t r = 0; r < 4; r++)
+        for (uint32_t c = 0; c < 4; c++)
+            result.m[r][c] = a.m[r][0] * b.m[0][c] + a.m[r][1] * b.m[1][c] + a.m[r][2] * b.m[2][c] + a.m[r][3] * b.m[3][c];
+    return result;
+}
+
+Mat4 Mat4AffineInverse(const Mat4& m)
+{
+    // inverse of the upper 3x3 through its cofactors
+    float a00 = m.m[0][0], a01 = m.m[0][1], a02 = m.m[0][2];
+    float a10 = m.m[1][0], a11 = m.m[1][1], a12 = m.m[1][2];
+    float a20 = m.m[2][0], a21 = m.m[2][1], a22 = m.m[2][2];
+
+    float c00 = a11 * a22 - a12 * a21;
+    float c01 = a12 * a20 - a10 * a22;
+    float c02 = a10 * a21 - a11 * a20;
+
+    float determinant = a00 * c00 + a01 * c01 + a02 * c02;
+    float inverseDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+    Mat4 result;
+    result.m[0][0] = c00 * inverseDeterminant;
+    result.m[0][1] = (a02 * a21 - a01 * a22) * inverseDeterminant;
+    result.m[0][2] = (a01 * a12 - a02 * a11) * inverseDeterminant;
+    result.m[0][3] = 0.0f;
+
+    result.m[1][0] = c01 * inverseDeterminant;
+    result.m[1][1] = (a00 * a22 - a02 * a20) * inverseDeterminant;
+    result.m[1][2] = (a02 * a10 - a00 * a12) * inverseDeterminant;
+    result.m[1][3] = 0.0f;
+
+    result.m[2][0] = c02 * inverseDeterminant;
+    result.m[2][1] = (a01 * a20 - a00 * a21) * inverseDeterminant;
+    result.m[2][2] = (a00 * a11 - a01 * a10) * inverseDeterminant;
+    result.m[2][3] = 0.0f;
+
+    // translation becomes -t * A^-1
+    float tx = m.m[3][0], ty = m.m[3][1], tz = m.m[3][2];
+    for (uint32_t c = 0; c < 3; c++)
+        result.m[3][c] = -(tx * result.m[0][c] + ty * result.m[1][c] + tz * result.m[2][c]);
+    result.m[3][3] = 1.0f;
+
+    return result;
+}
+
+Mat4 Mat4Scaling(const Vec3& scale)
+{
+    Mat4 result = Mat4Identity();
+    result.m[0][0] = scale.x;
+    result.m[1][1] = scale.y;
+    result.m[2][2] = scale.z;
+    return result;
+}
+
+Mat4 Mat4Translation(const Vec3& translation)
+{
+    Mat4 result = Mat4Identity();
+    result.m[3][0] = translation.x;
+    result.m[3][1] = translation.y;
+    result.m[3][2] = translation.z;
+    return result;
+}
+
+Mat4 Mat4RotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+    float cp = cosf(pitch), sp = sinf(pitch);
+    float cy = cosf(yaw), sy = sinf(yaw);
+    float cr = cosf(roll), sr = sinf(roll);
+
+    Mat4 result;
+    result.m[0][0] = cr * cy + sr * sp * sy;
+    result.m[0][1] = sr * cp;
+    result.m[0][2] = sr * sp * cy - cr * sy;
+    result.m[0][3] = 0.0f;
+
+    result.m[1][0] = cr * sp * sy - sr * cy;
+    result.m[1][1] = cr * cp;
+    result.m[1][2] = sr * sy + cr * sp * cy;
+    result.m[1][3] = 0.0f;
+
+    result.m[2][0] = cp * sy;
+    result.m[2][1] = -sp;
+    result.m[2][2] = cp * cy;
+    result.m[2][3] = 0.0f;
+
+    result.m[3][0] = 0.0f;
+    result.m[3][1] = 0.0f;
+    result.m[3][2] = 0.0f;
+    result.m[3][3] = 1.0f;
+
+    return result;
+}
+
+Mat4 Mat4FromTransform(const Transform& transform)
+{
+    // scale * rotation only scales the rotation rows, no full multiply needed
+    Mat4 rotation = Mat4RotationRollPitchYaw(transform.rotation.x * TO_RADIANS, transform.rotation.y * TO_RADIANS, transform.rotation.z * TO_RADIANS);
+    float scale[3] = { transform.scale.x, transform.scale.y, transform.scale.z };
+
+    Mat4 result;
+    for (uint32_t r = 0; r < 3; r++)
+    {
+        for (uint32_t c = 0; c < 3; c++)
+            result.m[r][c] = rotation.m[r][c] * scale[r];
+        result.m[r][3] = 0.0f;
+    }
+
+    result.m[3][0] = transform.location.x;
+    result.m[3][1] = transform.location.y;
+    result.m[3][2] = transform.location.z;
+    result.m[3][3] = 1.0f;
+    return result;
+}
+
+Mat4 Mat4LookToLH(const Vec3& eye, const Vec3& direction, const Vec3& up)
+{
+    Vec3 zAxis = Normalize(direction);
+    Vec3 xAxis = Normalize(Cross(up, zAxis));
+    Vec3 yAxis = Cross(zAxis, xAxis);
+
+    Mat4 result;
+    result.m[0][0] = xAxis.x; result.m[0][1] = yAxis.x; result.m[0][2] = zAxis.x; result.m[0][3] = 0.0f;
+    result.m[1][0] = xAxis.y; result.m[1][1] = yAxis.y; result.m[1][2] = zAxis.y; result.m[1][3] = 0.0f;
+    result.m[2][0] = xAxis.z; result.m[2][1] = yAxis.z; result.m[2][2] = zAxis.z; result.m[2][3] = 0.0f;
+    result.m[3][0] = -Dot(xAxis, eye);
+    result.m[3][1] = -Dot(yAxis, eye);
+    result.m[3][2] = -Dot(zAxis, eye);
+    result.m[3][3] = 1.0f;
+    return result;
+}
+
+Mat4 Mat4PerspectiveFovLH(float fovRadians, float aspect, float nearZ, float farZ)
+{
+    float height = 1.0f / tanf(fovRadians * 0.5f);
+    float width = height / aspect;
+    float range = farZ / (farZ - nearZ);
+
+    Mat4 result = {};
+    result.m[0][0] = width;
+    result.m[1][1] = height;
+    result.m[2][2] = range;
+    result.m[2][3] = 1.0f;
+    result.m[3][2] = -range * nearZ;
+    return result;
+}
+
+Vec4 Vec4Transform(const Vec4& v, const Mat4& m)
+{
+    Vec4 result;
+    result.x = v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + v.w * m.m[3][0];
+    result.y = v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + v.w * m.m[3][1];
+    result.z = v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + v.w * m.m[3][2];
+    result.w = v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + v.w * m.m[3][3];
+    return result;
+}
+
+void Mat4MultiplyBatch(const Mat4* a, const Mat4& b, Mat4* out, uint32_t count)
+{
+    // every row of a result is a linear combination of the rows of b, which stay in registers for the whole batch.
+    // the cost is in broadcasting a's elements: avx2 splats two rows per permute and neon multiplies by a lane in
+    // place. sse needs a shuffle per element, the same the compiler makes of the scalar loop, so it runs that
+#if SIMD_MATH_AVX2
+    __m256 b0 = _mm256_broadcast_ps((const __m128*)b.m[0]);
+    __m256 b1 = _mm256_broadcast_ps((const __m128*)b.m[1]);
+    __m256 b2 = _mm256_broadcast_ps((const __m128*)b.m[2]);
+    __m256 b3 = _mm256_broadcast_ps((const __m128*)b.m[3]);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t r = 0; r < 4; r += 2)
+        {
+            __m256 rows = _mm256_loadu_ps(a[i].m[r]); // only 16 byte aligned
+            __m256 result = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b0);
+            result = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0x55), b1, result);
+            result = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0xaa), b2, result);
+            result = _mm256_fmadd_ps(_mm256_permute_ps(rows, 0xff), b3, result);
+            _mm256_storeu_ps(out[i].m[r], result);
+        }
+    }
+#elif SIMD_MATH_NEON
+    float32x4_t b0 = vld1q_f32(b.m[0]);
+    float32x4_t b1 = vld1q_f32(b.m[1]);
+    float32x4_t b2 = vld1q_f32(b.m[2]);
+    float32x4_t b3 = vld1q_f32(b.m[3]);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        for (uint32_t r = 0; r < 4; r++)
+        {
+            // the lane forms multiply by an element in place, no splat at all
+            float32x4_t row = vld1q_f32(a[i].m[r]);
+            float32x4_t result = vmulq_lane_f32(b0, vget_low_f32(row), 0);
+            result = vmlaq_lane_f32(result, b1, vget_low_f32(row), 1);
+            result = vmlaq_lane_f32(result, b2, vget_high_f32(row), 0);
+            result = vmlaq_lane_f32(result, b3, vget_high_f32(row), 1);
+            vst1q_f32(out[i].m[r], result);
+        }
+    }
+#else
+    // b copied so the compiler knows the stores cannot change it and keeps it in registers
+    Mat4 rows = b;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Mat4 result;
+        for (uint32_t r = 0; r < 4; r++)
+            for (uint32_t c = 0; c < 4; c++)
+                result.m[r][c] = a[i].m[r][0] * rows.m[0][c] + a[i].m[r][1] * rows.m[1][c] + a[i].m[r][2] * rows.m[2][c] + a[i].m[r][3] * rows.m[3][c];
+        out[i] = result;
+    }
+#endif
+}
+
+// sine and cosine of four angles in degrees. whole quarter turns come off exactly in degrees, what is left is within
+// 45 degrees where the cephes minimax polynomials are good to about an ulp
+static void SinCosDegrees(Float4 degrees, Float4& outSin, Float4& outCos)
+{
+    Float4 quadrant = RoundNearest(degrees * Splat(1.0f / 90.0f));
+    Float4 x = (degrees - quadrant * Splat(90.0f)) * Splat(TO_RADIANS);
+    Float4 x2 = x * x;
+
+    Float4 sinPoly = ((Splat(-1.9515295891e-4f) * x2 + Splat(8.3321608736e-3f)) * x2 + Splat(-1.6666654611e-1f)) * x2 * x + x;
+    Float4 cosPoly = ((Splat(2.443315711809948e-5f) * x2 + Splat(-1.388731625493765e-3f)) * x2 + Splat(4.166664568298827e-2f)) * x2 * x2
+        - Splat(0.5f) * x2 + Splat(1.0f);
+
+    // quadrant mod 4 as 0/1 flags: odd ones swap sine and cosine, the upper two negate both
+    Float4 mod4 = quadrant - RoundNearest(quadrant * Splat(0.25f) - Splat(0.375f)) * Splat(4.0f);
+    Float4 upper = RoundNearest(mod4 * Splat(0.5f) - Splat(0.25f));
+    Float4 odd = mod4 - upper * Splat(2.0f);
+    Float4 sign = Splat(1.0f) - upper * Splat(2.0f);
+
+    outSin = (sinPoly + odd * (cosPoly - sinPoly)) * sign;
+    outCos = (cosPoly - odd * (sinPoly + cosPoly)) * sign;
+}
+
+// four transforms at a time, one lane each, turned back into rows at the end
+static void ComposeFour(const Transform* transforms, Mat4* out)
+{
+    const Transform& t0 = transforms[0];
+    const Transform& t1 = transforms[1];
+    const Transform& t2 = transforms[2];
+    const Transform& t3 = transforms[3];
+
+    Float4 sp, cp, sy, cy, sr, cr;
+    SinCosDegrees(MakeFloat4(t0.rotation.x, t1.rotation.x, t2.rotation.x, t3.rotation.x), sp, cp);
+    SinCosDegrees(MakeFloat4(t0.rotation.y, t1.rotation.y, t2.rotation.y, t3.rotation.y), sy, cy);
+    SinCosDegrees(MakeFloat4(t0.rotation.z, t1.rotation.z, t2.rotation.z, t3.rotation.z), sr, cr);
+
+    Float4 scaleX = MakeFloat4(t0.scale.x, t1.scale.x, t2.scale.x, t3.scale.x);
+    Float4 scaleY = MakeFloat4(t0.scale.y, t1.scale.y, t2.scale.y, t3.scale.y);
+    Float4 scaleZ = MakeFloat4(t0.scale.z, t1.scale.z, t2.scale.z, t3.scale.z);
+    Float4 zero = Splat(0.0f);
+
+    // Mat4RotationRollPitchYaw with every row scaled
+    Float4 rows[4][4] =
+    {
+        { (cr * cy + sr * sp * sy) * scaleX, sr * cp * scaleX, (sr * sp * cy - cr * sy) * scaleX, zero },
+        { (cr * sp * sy - sr * cy) * scaleY, cr * cp * scaleY, (sr * sy + cr * sp * cy) * scaleY, zero },
+        { cp * sy * scaleZ, (zero - sp) * scaleZ, cp * cy * scaleZ, zero },
+        {
+            MakeFloat4(t0.location.x, t1.location.x, t2.location.x, t3.location.x),
+            MakeFloat4(t0.location.y, t1.location.y, t2.location.y, t3.location.y),
+            MakeFloat4(t0.location.z, t1.location.z, t2.location.z, t3.location.z),
+            Splat(1.0f),
+        },
+    };
+
+    for (uint32_t r = 0; r < 4; r++)
+    {
+        Transpose(rows[r][0], rows[r][1], rows[r][2], rows[r][3]);
+        for (uint32_t i = 0; i < 4; i++)
+            Store(rows[r][i], out[i].m[r]);
+    }
+}
+
+void Mat4FromTransformBatch(const Transform* transforms, Mat4* out, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        ComposeFour(transforms + i, out + i);
+
+    // the tail padded to four, a transform gives the same matrix wherever it is in the batch
+    if (i < count)
+    {
+        Transform tail[4];
+        Mat4 tailOut[4];
+        for (uint32_t j = 0; j < 4; j++)
+            tail[j] = transforms[i + (j < count - i ? j : 0)];
+
+        ComposeFour(tail, tailOut);
+        for (uint32_t j = 0; j < count - i; j++)
+            out[i + j] = tailOut[j];
+    }
+}
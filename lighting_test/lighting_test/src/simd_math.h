@@ -0,0 +1,142 @@
+#pragma once
+
+#include "core.h"
+
+// row major 4x4 matrices used with row vectors (v * M), same conventions as DirectXMath so the
+// shaders keep getting the same data. backed by sse/avx2/neon when the compiler targets them
+// and plain scalar code otherwise
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+    #define SIMD_MATH_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SIMD_MATH_SSE 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #define SIMD_MATH_NEON 1
+#endif
+
+#if SIMD_MATH_SSE
+    #include <emmintrin.h>
+#else
+    #include <math.h>
+    #include <string.h>
+#endif
+
+constexpr float PI = 3.14159265358979f;
+constexpr float TO_RADIANS = PI / 180.0f;
+
+struct alignas(16) Mat4
+{
+    float m[4][4];
+};
+
+// which code path the matrix functions were compiled with
+const char* GetSimdMathPath();
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+
+float Dot(const Vec3& a, const Vec3& b);
+Vec3 Cross(const Vec3& a, const Vec3& b);
+float Length(const Vec3& v);
+Vec3 Normalize(const Vec3& v);
+
+Mat4 Mat4Identity();
+Mat4 Mat4Transpose(const Mat4& m);
+Mat4 Mat4Multiply(const Mat4& a, const Mat4& b);
+
+// inverse of a matrix whose last column is (0, 0, 0, 1), rotation/scale/shear plus translation
+Mat4 Mat4AffineInverse(const Mat4& m);
+
+Mat4 Mat4Scaling(const Vec3& scale);
+Mat4 Mat4Translation(const Vec3& translation);
+
+// pitch (x), yaw (y), roll (z) in radians, applied roll then pitch then yaw like XMMatrixRotationRollPitchYaw
+Mat4 Mat4RotationRollPitchYaw(float pitch, float yaw, float roll);
+
+// scale * rotation * translation, rotation in degrees
+Mat4 Mat4FromTransform(const Transform& transform);
+
+Mat4 Mat4LookToLH(const Vec3& eye, const Vec3& direction, const Vec3& up);
+Mat4 Mat4PerspectiveFovLH(float fovRadians, float aspect, float nearZ, float farZ);
+
+Vec4 Vec4Transform(const Vec4& v, const Mat4& m);
+
+// out[i] = a[i] * b, b is loaded once for the whole batch
+void Mat4MultiplyBatch(const Mat4* a, const Mat4& b, Mat4* out, uint32_t count);
+
+// out[i] = Mat4FromTransform(transforms[i]), four at a time with polynomial sine and cosine, within a few ulp of it
+void Mat4FromTransformBatch(const Transform* transforms, Mat4* out, uint32_t count);
+
+// four independent floats for code that runs the same math on 4 things at once (pixels of a quad,
+// lights against a cluster), sse when available and plain arrays otherwise
+struct Float4
+{
+#if SIMD_MATH_SSE
+    __m128 v;
+#else
+    float v[4];
+#endif
+};
+
+#if SIMD_MATH_SSE
+
+inline Float4 Splat(float x) { return { _mm_set1_ps(x) }; }
+inline Float4 MakeFloat4(float a, float b, float c, float d) { return { _mm_setr_ps(a, b, c, d) }; }
+inline Float4 LoadFloat4(const float* p) { return { _mm_loadu_ps(p) }; }
+inline Float4 operator+(Float4 a, Float4 b) { return { _mm_add_ps(a.v, b.v) }; }
+inline Float4 operator-(Float4 a, Float4 b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline Float4 operator*(Float4 a, Float4 b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline Float4 operator/(Float4 a, Float4 b) { return { _mm_div_ps(a.v, b.v) }; }
+inline Float4 Min(Float4 a, Float4 b) { return { _mm_min_ps(a.v, b.v) }; }
+inline Float4 Max(Float4 a, Float4 b) { return { _mm_max_ps(a.v, b.v) }; }
+inline Float4 Sqrt(Float4 a) { return { _mm_sqrt_ps(a.v) }; }
+inline Float4 Abs(Float4 a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+inline Float4 RoundNearest(Float4 a) { return { _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)) }; } // |a| below 2^31
+inline int GreaterMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpgt_ps(a.v, b.v)); }
+inline int GreaterEqualMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)); }
+inline int LessMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmplt_ps(a.v, b.v)); }
+inline int LessEqualMask(Float4 a, Float4 b) { return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+inline void Store(Float4 a, float out[4]) { _mm_storeu_ps(out, a.v); }
+inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d) { _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v); }
+
+#else
+
+#define FLOAT4_OP(expr) Float4 r; for (int i = 0; i < 4; i++) r.v[i] = expr; return r;
+#define FLOAT4_MASK(expr) int m = 0; for (int i = 0; i < 4; i++) m |= (expr) ? 1 << i : 0; return m;
+
+inline Float4 Splat(float x) { return { { x, x, x, x } }; }
+inline Float4 MakeFloat4(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+inline Float4 LoadFloat4(const float* p) { return { { p[0], p[1], p[2], p[3] } }; }
+inline Float4 operator+(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] + b.v[i]) }
+inline Float4 operator-(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] - b.v[i]) }
+inline Float4 operator*(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] * b.v[i]) }
+inline Float4 operator/(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] / b.v[i]) }
+inline Float4 Min(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline Float4 Max(Float4 a, Float4 b) { FLOAT4_OP(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+inline Float4 Sqrt(Float4 a) { FLOAT4_OP(sqrtf(a.v[i])) }
+inline Float4 Abs(Float4 a) { FLOAT4_OP(fabsf(a.v[i])) }
+inline Float4 RoundNearest(Float4 a) { FLOAT4_OP(nearbyintf(a.v[i])) }
+inline int GreaterMask(Float4 a, Float4 b) { FLOAT4_MASK(a.v[i] > b.v[i]) }
+inline int GreaterEqualMask(Float4 a, Float4 b) { FLOAT4_MASK(a.v[i] >= b.v[i]) }
+inline int LessMask(Float4 a, Float4 b) { FLOAT4_MASK(a.v[i] < b.v[i]) }
+inline int LessEqualMask(Float4 a, Float4 b) { FLOAT4_MASK(a.v[i] <= b.v[i]) }
+inline void Store(Float4 a, float out[4]) { memcpy(out, a.v, sizeof(a.v)); }
+inline void Transpose(Float4& a, Float4& b, Float4& c, Float4& d)
+{
+    Float4 rows[4] = { a, b, c, d };
+    for (int i = 0; i < 4; i++)
+    {
+        a.v[i] = rows[i].v[0];
+        b.v[i] = rows[i].v[1];
+        c.v[i] = rows[i].v[2];
+        d.v[i] = rows[i].v[3];
+    }
+}
+
+#undef FLOAT4_OP
+#undef FLOAT4_MASK
+
+#endif
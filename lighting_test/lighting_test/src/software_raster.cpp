@@ -0,0 +1,791 @@
+#include "software_raster.h"
+#include "profiler.h"
+
+#include "../vendor/stb/stb_image.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+// what the vertex shader hands to the rasterizer
+struct RasterVertex
+{
+    float clip[4];
+    float attributes[8]; // world position, normal, texture coords
+};
+
+constexpr uint32_t ATTRIBUTE_COUNT = 8;
+
+struct TriangleSetup
+{
+    // edge i evaluates to the barycentric of vertex i, already divided by the area
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    uint32_t topLeftMask; // bit i set when edge i owns the pixels exactly on it
+
+    float z[3];
+    float invW[3];
+    float attributes[3][ATTRIBUTE_COUNT];
+
+    int32_t minX, minY, maxX, maxY;
+    const RasterTexture* texture;
+};
+
+// setup and bins of one run of consecutive triangles, tiles walk the chunks in order so the draw order is kept
+struct TriangleChunk
+{
+    std::vector<TriangleSetup> triangles;
+    std::vector<std::vector<uint32_t>> bins; // per tile, index into triangles
+    uint32_t culled;
+    uint32_t clipped;
+};
+
+constexpr uint32_t TRIANGLES_PER_CHUNK = 2048;
+
+// keeps the transformed vertices of an instance group around 16 MB
+constexpr uint32_t MAX_GROUP_VERTICES = 1 << 18;
+
+void MakeRasterTexture(const TextureView& view, RasterTexture& outTexture)
+{
+    outTexture.levelCount = view.levelCount;
+
+    size_t texelCount = 0;
+    for (uint32_t i = 0; i < view.levelCount; i++)
+    {
+        outTexture.widths[i] = view.levels[i].width;
+        outTexture.heights[i] = view.levels[i].height;
+        outTexture.offsets[i] = texelCount;
+        texelCount += (size_t)view.levels[i].width * view.levels[i].height;
+    }
+
+    outTexture.texels.resize(texelCount);
+
+    for (uint32_t i = 0; i < view.levelCount; i++)
+    {
+        const TextureLevelView& level = view.levels[i];
+        uint8_t* out = (uint8_t*)(outTexture.texels.data() + outTexture.offsets[i]);
+
+        if (IsBlockCompressed(view.format))
+        {
+            DecodeBcImage(view.format, level.data, level.width, level.height, out);
+        }
+        else
+        {
+            for (uint32_t y = 0; y < level.height; y++)
+                memcpy(out + (size_t)y * level.width * 4, level.data + (size_t)y * level.rowPitch, (size_t)level.width * 4);
+        }
+    }
+}
+
+void MakeRasterMesh(const MeshView& view, RasterMesh& outMesh)
+{
+    if (view.vertexFormat == VertexFormat::Packed)
+    {
+        outMesh.vertices.resize(view.vertexCount);
+        for (uint32_t i = 0; i < view.vertexCount; i++)
+            outMesh.vertices[i] = UnpackVertex(view.packedVertices[i], view.quantization);
+    }
+    else
+    {
+        outMesh.vertices.assign(view.vertices, view.vertices + view.vertexCount);
+    }
+
+    outMesh.indices.assign(view.indices, view.indices + view.indexCount);
+    outMesh.submeshes.assign(view.submeshes, view.submeshes + view.submeshCount);
+    outMesh.textures.assign(view.submeshCount, nullptr);
+}
+
+void ResizeRasterTarget(RasterTarget& target, uint32_t width, uint32_t height)
+{
+    target.width = width;
+    target.height = height;
+    target.color.resize((size_t)width * height);
+    target.depth.resize((size_t)width * height);
+}
+
+static uint8_t ToUnorm8(float x)
+{
+    x = x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x);
+    return (uint8_t)(x * 255.0f + 0.5f);
+}
+
+static uint32_t PackColor(float r, float g, float b, float a)
+{
+    return (uint32_t)ToUnorm8(r) | (uint32_t)ToUnorm8(g) << 8 | (uint32_t)ToUnorm8(b) << 16 | (uint32_t)ToUnorm8(a) << 24;
+}
+
+void ClearRasterTarget(RasterTarget& target, const float clearColor[4], float clearDepth)
+{
+    uint32_t color = PackColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    for (uint32_t& pixel : target.color)
+        pixel = color;
+    for (float& depth : target.depth)
+        depth = clearDepth;
+}
+
+// vertex.hlsl
+static void TransformVertices(JobSystem& jobs, const RasterMesh& mesh, const InstanceData* instances, uint32_t instanceCount,
+    const Mat4& viewProj, RasterVertex* out)
+{
+    uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+
+    ParallelFor(jobs, vertexCount * instanceCount, 4096, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            const InstanceData& instance = instances[i / vertexCount];
+            const MeshVertex& v = mesh.vertices[i % vertexCount];
+            RasterVertex& o = out[i];
+
+            Vec4 worldPos = Vec4Transform({ v.pos.x, v.pos.y, v.pos.z, 1.0f }, instance.model);
+            Vec4 clipPos = Vec4Transform(worldPos, viewProj);
+
+            o.clip[0] = clipPos.x;
+            o.clip[1] = clipPos.y;
+            o.clip[2] = clipPos.z;
+            o.clip[3] = clipPos.w;
+
+            const Vec4* n = instance.normalMatrix;
+            float nx = v.normal.x * n[0].x + v.normal.y * n[1].x + v.normal.z * n[2].x;
+            float ny = v.normal.x * n[0].y + v.normal.y * n[1].y + v.normal.z * n[2].y;
+            float nz = v.normal.x * n[0].z + v.normal.y * n[1].z + v.normal.z * n[2].z;
+            float invLength = 1.0f / sqrtf(nx * nx + ny * ny + nz * nz);
+
+            o.attributes[0] = worldPos.x;
+            o.attributes[1] = worldPos.y;
+            o.attributes[2] = worldPos.z;
+            o.attributes[3] = nx * invLength;
+            o.attributes[4] = ny * invLength;
+            o.attributes[5] = nz * invLength;
+            o.attributes[6] = v.textureCoords.x;
+            o.attributes[7] = v.textureCoords.y;
+        }
+    });
+}
+
+static RasterVertex LerpVertex(const RasterVertex& a, const RasterVertex& b, float t)
+{
+    RasterVertex result;
+    for (uint32_t i = 0; i < 4; i++)
+        result.clip[i] = a.clip[i] + (b.clip[i] - a.clip[i]) * t;
+    for (uint32_t i = 0; i < ATTRIBUTE_COUNT; i++)
+        result.attributes[i] = a.attributes[i] + (b.attributes[i] - a.attributes[i]) * t;
+    return result;
+}
+
+// clips against z >= 0, the d3d near plane, returns the vertex count of the polygon left (0, 3 or 4)
+static uint32_t ClipNear(const RasterVertex* in, RasterVertex* out)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const RasterVertex& a = in[i];
+        const RasterVertex& b = in[(i + 1) % 3];
+        bool aInside = a.clip[2] >= 0.0f;
+        bool bInside = b.clip[2] >= 0.0f;
+
+        if (aInside)
+            out[count++] = a;
+        if (aInside != bInside)
+            out[count++] = LerpVertex(a, b, a.clip[2] / (a.clip[2] - b.clip[2]));
+    }
+    return count;
+}
+
+static bool SetupTriangle(const RasterVertex& v0, const RasterVertex& v1, const RasterVertex& v2, uint32_t width, uint32_t height,
+    const RasterTexture* texture, TriangleSetup& out)
+{
+    const RasterVertex* v[3] = { &v0, &v1, &v2 };
+
+    float x[3], y[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        float invW = 1.0f / v[i]->clip[3];
+        x[i] = (v[i]->clip[0] * invW * 0.5f + 0.5f) * width;
+        y[i] = (0.5f - v[i]->clip[1] * invW * 0.5f) * height;
+
+        out.z[i] = v[i]->clip[2] * invW;
+        out.invW[i] = invW;
+        memcpy(out.attributes[i], v[i]->attributes, sizeof(out.attributes[i]));
+    }
+
+    // clockwise on screen (y down) is positive, counter clockwise is the back face
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(area > 0.0f))
+        return false;
+
+    // everything is fully behind the far plane
+    if (out.z[0] > 1.0f && out.z[1] > 1.0f && out.z[2] > 1.0f)
+        return false;
+
+    float minX = fminf(x[0], fminf(x[1], x[2]));
+    float maxX = fmaxf(x[0], fmaxf(x[1], x[2]));
+    float minY = fminf(y[0], fminf(y[1], y[2]));
+    float maxY = fmaxf(y[0], fmaxf(y[1], y[2]));
+
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+        return false;
+
+    out.minX = minX < 0.0f ? 0 : (int32_t)minX;
+    out.minY = minY < 0.0f ? 0 : (int32_t)minY;
+    out.maxX = maxX >= width ? (int32_t)width - 1 : (int32_t)maxX;
+    out.maxY = maxY >= height ? (int32_t)height - 1 : (int32_t)maxY;
+
+    float invArea = 1.0f / area;
+    out.topLeftMask = 0;
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        uint32_t j = (i + 1) % 3;
+        uint32_t k = (i + 2) % 3;
+        float dx = x[k] - x[j];
+        float dy = y[k] - y[j];
+
+        out.edgeA[i] = -dy * invArea;
+        out.edgeB[i] = dx * invArea;
+        out.edgeC[i] = (dy * x[j] - dx * y[j]) * invArea;
+
+        // left edges go up, top edges are flat and go right
+        if (dy < 0.0f || (dy == 0.0f && dx > 0.0f))
+            out.topLeftMask |= 1 << i;
+    }
+
+    out.texture = texture;
+    return true;
+}
+
+static void SetupAndBin(JobSystem& jobs, const RasterMesh& mesh, const RasterVertex* vertices, uint32_t instanceCount,
+    uint32_t width, uint32_t height, std::vector<TriangleChunk>& chunks)
+{
+    uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+    uint32_t trianglesPerInstance = (uint32_t)mesh.indices.size() / 3;
+    uint32_t triangleCount = trianglesPerInstance * instanceCount;
+
+    uint32_t tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    uint32_t tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+
+    // submesh of every triangle of an instance, to find the texture
+    std::vector<const RasterTexture*> triangleTextures(trianglesPerInstance);
+    for (uint32_t s = 0; s < mesh.submeshes.size(); s++)
+        for (uint32_t t = 0; t < mesh.submeshes[s].indexCount / 3; t++)
+            triangleTextures[mesh.submeshes[s].indexOffset / 3 + t] = mesh.textures[s];
+
+    chunks.resize((triangleCount + TRIANGLES_PER_CHUNK - 1) / TRIANGLES_PER_CHUNK);
+
+    ParallelFor(jobs, (uint32_t)chunks.size(), 1, [&](uint32_t chunkBegin, uint32_t chunkEnd)
+    {
+        for (uint32_t c = chunkBegin; c < chunkEnd; c++)
+        {
+            TriangleChunk& chunk = chunks[c];
+            chunk.triangles.clear();
+            chunk.bins.resize(tilesX * tilesY);
+            for (std::vector<uint32_t>& bin : chunk.bins)
+                bin.clear();
+            chunk.culled = 0;
+            chunk.clipped = 0;
+
+            uint32_t end = (c + 1) * TRIANGLES_PER_CHUNK < triangleCount ? (c + 1) * TRIANGLES_PER_CHUNK : triangleCount;
+            for (uint32_t t = c * TRIANGLES_PER_CHUNK; t < end; t++)
+            {
+                uint32_t instance = t / trianglesPerInstance;
+                uint32_t triangle = t % trianglesPerInstance;
+                const RasterVertex* base = vertices + (size_t)instance * vertexCount;
+
+                RasterVertex in[3] =
+                {
+                    base[mesh.indices[triangle * 3 + 0]],
+                    base[mesh.indices[triangle * 3 + 1]],
+                    base[mesh.indices[triangle * 3 + 2]],
+                };
+
+                RasterVertex polygon[4];
+                uint32_t polygonCount = 3;
+
+                bool crossesNear = in[0].clip[2] < 0.0f || in[1].clip[2] < 0.0f || in[2].clip[2] < 0.0f;
+                if (crossesNear)
+                {
+                    polygonCount = ClipNear(in, polygon);
+                    chunk.clipped++;
+                }
+                else
+                {
+                    polygon[0] = in[0];
+                    polygon[1] = in[1];
+                    polygon[2] = in[2];
+                }
+
+                bool visible = false;
+
+                // fan, the clipped polygon is convex
+                for (uint32_t p = 2; p < polygonCount; p++)
+                {
+                    TriangleSetup setup;
+                    if (!SetupTriangle(polygon[0], polygon[p - 1], polygon[p], width, height, triangleTextures[triangle], setup))
+                        continue;
+
+                    uint32_t index = (uint32_t)chunk.triangles.size();
+                    chunk.triangles.push_back(setup);
+                    visible = true;
+
+                    for (uint32_t ty = setup.minY / RASTER_TILE_SIZE; ty <= setup.maxY / RASTER_TILE_SIZE; ty++)
+                        for (uint32_t tx = setup.minX / RASTER_TILE_SIZE; tx <= setup.maxX / RASTER_TILE_SIZE; tx++)
+                            chunk.bins[ty * tilesX + tx].push_back(index);
+                }
+
+                if (!visible)
+                    chunk.culled++;
+            }
+        }
+    });
+}
+
+static void SampleBilinear(const RasterTexture& texture, uint32_t level, float u, float v, float out[3])
+{
+    uint32_t width = texture.widths[level];
+    uint32_t height = texture.heights[level];
+    const uint32_t* texels = texture.texels.data() + texture.offsets[level];
+
+    // wrap addressing, texel centers at half integers
+    float x = (u - floorf(u)) * width - 0.5f;
+    float y = (v - floorf(v)) * height - 0.5f;
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float tx = x - fx;
+    float ty = y - fy;
+
+    int32_t x0 = (int32_t)fx;
+    int32_t y0 = (int32_t)fy;
+    uint32_t x1 = (uint32_t)(x0 + 1) % width;
+    uint32_t y1 = (uint32_t)(y0 + 1) % height;
+    x0 = x0 < 0 ? (int32_t)width - 1 : x0;
+    y0 = y0 < 0 ? (int32_t)height - 1 : y0;
+
+    uint32_t t00 = texels[(size_t)y0 * width + x0];
+    uint32_t t10 = texels[(size_t)y0 * width + x1];
+    uint32_t t01 = texels[(size_t)y1 * width + x0];
+    uint32_t t11 = texels[(size_t)y1 * width + x1];
+
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        uint32_t shift = c * 8;
+        float c00 = (float)((t00 >> shift) & 0xff);
+        float c10 = (float)((t10 >> shift) & 0xff);
+        float c01 = (float)((t01 >> shift) & 0xff);
+        float c11 = (float)((t11 >> shift) & 0xff);
+
+        float top = c00 + (c10 - c00) * tx;
+        float bottom = c01 + (c11 - c01) * tx;
+        out[c] = (top + (bottom - top) * ty) * (1.0f / 255.0f);
+    }
+}
+
+// MIN_MAG_MIP_LINEAR, lod from the quad's coarse derivatives like the hardware does
+static void SampleTrilinear(const RasterTexture* texture, float u, float v, float lod, float out[3])
+{
+    if (!texture)
+    {
+        out[0] = out[1] = out[2] = 1.0f;
+        return;
+    }
+
+    float maxLod = (float)(texture->levelCount - 1);
+    lod = lod < 0.0f ? 0.0f : (lod > maxLod ? maxLod : lod);
+
+    uint32_t level = (uint32_t)lod;
+    float t = lod - level;
+
+    SampleBilinear(*texture, level, u, v, out);
+
+    if (t > 0.0f)
+    {
+        float next[3];
+        SampleBilinear(*texture, level + 1, u, v, next);
+        for (uint32_t c = 0; c < 3; c++)
+            out[c] += (next[c] - out[c]) * t;
+    }
+}
+
+static float ComputeLod(const RasterTexture* texture, const float u[4], const float v[4])
+{
+    if (!texture)
+        return 0.0f;
+
+    float width = (float)texture->widths[0];
+    float height = (float)texture->heights[0];
+
+    float dudx = (u[1] - u[0]) * width;
+    float dvdx = (v[1] - v[0]) * height;
+    float dudy = (u[2] - u[0]) * width;
+    float dvdy = (v[2] - v[0]) * height;
+
+    float lengthSquared = fmaxf(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+    return lengthSquared > 0.0f ? 0.5f * log2f(lengthSquared) : 0.0f;
+}
+
+struct ShadeConstants
+{
+    float camPos[3];
+    float lightPos[3];
+    float ambient[3]; // ambientColor * ambientStrength
+    float lightColor[3];
+    float specularStrength;
+    float specularPow;
+
+    const PointLight* pointLights; // null when there are none
+    const LightClusters* clusters;
+};
+
+// one pixel's share of the clustered point lights, the loop of pixel.hlsl
+static void AddPointLights(const ShadeConstants& constants, float pixelX, float pixelY, float viewDepth, const float world[3],
+    const float normal[3], const float viewDir[3], float diffuse[3], float specular[3])
+{
+    const LightClusters& clusters = *constants.clusters;
+    uint32_t cluster = GetClusterIndex(clusters.constants, pixelX, pixelY, viewDepth);
+    uint32_t offset = clusters.clusters[cluster * 2 + 0];
+    uint32_t count = clusters.clusters[cluster * 2 + 1];
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const PointLight& light = constants.pointLights[clusters.lightIndices[offset + i]];
+
+        float toSurface[3] = { world[0] - light.position.x, world[1] - light.position.y, world[2] - light.position.z };
+        float distance = sqrtf(toSurface[0] * toSurface[0] + toSurface[1] * toSurface[1] + toSurface[2] * toSurface[2]);
+        float attenuation = GetLightAttenuation(distance, light.radius) * light.intensity;
+        if (attenuation <= 0.0f)
+            continue;
+
+        float direction[3] = { toSurface[0] / distance, toSurface[1] / distance, toSurface[2] / distance };
+        float lightDotNormal = direction[0] * normal[0] + direction[1] * normal[1] + direction[2] * normal[2];
+        float lambert = fmaxf(-lightDotNormal, 0.0f);
+
+        float viewDotReflect = 0.0f;
+        for (uint32_t c = 0; c < 3; c++)
+            viewDotReflect += viewDir[c] * (direction[c] - 2.0f * lightDotNormal * normal[c]);
+        float spec = constants.specularStrength * powf(fmaxf(-viewDotReflect, 0.0f), constants.specularPow);
+
+        const float color[3] = { light.color.x, light.color.y, light.color.z };
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            diffuse[c] += lambert * color[c] * attenuation;
+            specular[c] += spec * color[c] * attenuation;
+        }
+    }
+}
+
+static void RasterTile(const std::vector<TriangleChunk>& chunks, uint32_t tile, uint32_t tilesX, RasterTarget& target,
+    const ShadeConstants& constants, uint64_t& outPixelsShaded)
+{
+    int32_t tileX0 = (int32_t)((tile % tilesX) * RASTER_TILE_SIZE);
+    int32_t tileY0 = (int32_t)((tile / tilesX) * RASTER_TILE_SIZE);
+    int32_t tileX1 = tileX0 + (int32_t)RASTER_TILE_SIZE - 1;
+    int32_t tileY1 = tileY0 + (int32_t)RASTER_TILE_SIZE - 1;
+
+    int32_t width = (int32_t)target.width;
+    int32_t height = (int32_t)target.height;
+
+    uint64_t pixelsShaded = 0;
+
+    // one lane per pixel of a 2x2 quad: (x, y) (x + 1, y) (x, y + 1) (x + 1, y + 1), sampled at the centers
+    const Float4 quadOffsetX = MakeFloat4(0.5f, 1.5f, 0.5f, 1.5f);
+    const Float4 quadOffsetY = MakeFloat4(0.5f, 0.5f, 1.5f, 1.5f);
+
+    for (const TriangleChunk& chunk : chunks)
+    {
+        for (uint32_t index : chunk.bins[tile])
+        {
+            const TriangleSetup& tri = chunk.triangles[index];
+
+            // quads stay aligned to even pixels so neighbouring triangles agree on derivatives
+            int32_t minX = (tri.minX > tileX0 ? tri.minX : tileX0) & ~1;
+            int32_t minY = (tri.minY > tileY0 ? tri.minY : tileY0) & ~1;
+            int32_t maxX = tri.maxX < tileX1 ? tri.maxX : tileX1;
+            int32_t maxY = tri.maxY < tileY1 ? tri.maxY : tileY1;
+
+            Float4 edgeA[3], edgeB[3], edgeC[3];
+            for (uint32_t e = 0; e < 3; e++)
+            {
+                edgeA[e] = Splat(tri.edgeA[e]);
+                edgeB[e] = Splat(tri.edgeB[e]);
+                edgeC[e] = Splat(tri.edgeC[e]);
+            }
+
+            for (int32_t qy = minY; qy <= maxY; qy += 2)
+            {
+                Float4 py = Splat((float)qy) + quadOffsetY;
+
+                for (int32_t qx = minX; qx <= maxX; qx += 2)
+                {
+                    Float4 px = Splat((float)qx) + quadOffsetX;
+
+                    Float4 b[3];
+                    int coverage = 0xf;
+                    for (uint32_t e = 0; e < 3; e++)
+                    {
+                        b[e] = edgeA[e] * px + edgeB[e] * py + edgeC[e];
+                        coverage &= tri.topLeftMask & (1 << e) ? GreaterEqualMask(b[e], Splat(0.0f)) : GreaterMask(b[e], Splat(0.0f));
+                    }
+
+                    // lanes past the right or bottom border of the target
+                    if (qx + 1 >= width)
+                        coverage &= 0x5;
+                    if (qy + 1 >= height)
+                        coverage &= 0x3;
+
+                    if (!coverage)
+                        continue;
+
+                    size_t pixelIndex[4] =
+                    {
+                        (size_t)qy * width + qx,
+                        (size_t)qy * width + qx + 1,
+                        (size_t)(qy + 1) * width + qx,
+                        (size_t)(qy + 1) * width + qx + 1,
+                    };
+
+                    // z / w is linear in screen space
+                    Float4 z = b[0] * Splat(tri.z[0]) + b[1] * Splat(tri.z[1]) + b[2] * Splat(tri.z[2]);
+
+                    float zLanes[4];
+                    float depthLanes[4];
+                    Store(z, zLanes);
+                    for (uint32_t lane = 0; lane < 4; lane++)
+                        depthLanes[lane] = coverage & (1 << lane) ? target.depth[pixelIndex[lane]] : 0.0f;
+
+                    // depth test less, and the clip test against the far plane
+                    Float4 depth = MakeFloat4(depthLanes[0], depthLanes[1], depthLanes[2], depthLanes[3]);
+                    coverage &= LessMask(z, depth) & ~GreaterMask(z, Splat(1.0f));
+
+                    if (!coverage)
+                        continue;
+
+                    // perspective correct barycentrics, computed for the whole quad so helper lanes give derivatives
+                    Float4 w0 = b[0] * Splat(tri.invW[0]);
+                    Float4 w1 = b[1] * Splat(tri.invW[1]);
+                    Float4 w2 = b[2] * Splat(tri.invW[2]);
+                    Float4 invSum = Splat(1.0f) / (w0 + w1 + w2);
+                    w0 = w0 * invSum;
+                    w1 = w1 * invSum;
+                    w2 = w2 * invSum;
+
+                    Float4 attributes[ATTRIBUTE_COUNT];
+                    for (uint32_t a = 0; a < ATTRIBUTE_COUNT; a++)
+                        attributes[a] = w0 * Splat(tri.attributes[0][a]) + w1 * Splat(tri.attributes[1][a]) + w2 * Splat(tri.attributes[2][a]);
+
+                    // pixel.hlsl, the interpolated normal is not renormalized there either
+                    Float4 worldX = attributes[0], worldY = attributes[1], worldZ = attributes[2];
+                    Float4 normalX = attributes[3], normalY = attributes[4], normalZ = attributes[5];
+
+                    Float4 lightX = worldX - Splat(constants.lightPos[0]);
+                    Float4 lightY = worldY - Splat(constants.lightPos[1]);
+                    Float4 lightZ = worldZ - Splat(constants.lightPos[2]);
+                    Float4 lightInvLength = Splat(1.0f) / Sqrt(lightX * lightX + lightY * lightY + lightZ * lightZ);
+                    lightX = lightX * lightInvLength;
+                    lightY = lightY * lightInvLength;
+                    lightZ = lightZ * lightInvLength;
+
+                    Float4 lightDotNormal = lightX * normalX + lightY * normalY + lightZ * normalZ;
+                    Float4 diffuse = Max(Splat(0.0f) - lightDotNormal, Splat(0.0f));
+
+                    Float4 viewX = worldX - Splat(constants.camPos[0]);
+                    Float4 viewY = worldY - Splat(constants.camPos[1]);
+                    Float4 viewZ = worldZ - Splat(constants.camPos[2]);
+                    Float4 viewInvLength = Splat(1.0f) / Sqrt(viewX * viewX + viewY * viewY + viewZ * viewZ);
+                    viewX = viewX * viewInvLength;
+                    viewY = viewY * viewInvLength;
+                    viewZ = viewZ * viewInvLength;
+
+                    // reflect(l, n) = l - 2 * dot(n, l) * n
+                    Float4 twoDot = lightDotNormal + lightDotNormal;
+                    Float4 reflectX = lightX - twoDot * normalX;
+                    Float4 reflectY = lightY - twoDot * normalY;
+                    Float4 reflectZ = lightZ - twoDot * normalZ;
+                    Float4 viewDotReflect = viewX * reflectX + viewY * reflectY + viewZ * reflectZ;
+                    Float4 specularBase = Max(Splat(0.0f) - viewDotReflect, Splat(0.0f));
+
+                    float diffuseLanes[4], specularLanes[4], u[4], v[4];
+                    Store(diffuse, diffuseLanes);
+                    Store(specularBase, specularLanes);
+                    Store(attributes[6], u);
+                    Store(attributes[7], v);
+
+                    float lod = ComputeLod(tri.texture, u, v);
+
+                    // lanes for the point light loop, 1 / sum of the perspective weights is the view depth
+                    float pointLanes[10][4];
+                    if (constants.pointLights)
+                    {
+                        Float4 lanes[10] = { worldX, worldY, worldZ, normalX, normalY, normalZ, viewX, viewY, viewZ, invSum };
+                        for (uint32_t i = 0; i < 10; i++)
+                            Store(lanes[i], pointLanes[i]);
+                    }
+
+                    for (uint32_t lane = 0; lane < 4; lane++)
+                    {
+                        if (!(coverage & (1 << lane)))
+                            continue;
+
+                        float albedo[3];
+                        SampleTrilinear(tri.texture, u[lane], v[lane], lod, albedo);
+
+                        float spec = constants.specularStrength * powf(specularLanes[lane], constants.specularPow);
+
+                        float diffuse[3], specular[3];
+                        for (uint32_t c = 0; c < 3; c++)
+                        {
+                            diffuse[c] = diffuseLanes[lane] * constants.lightColor[c];
+                            specular[c] = spec * constants.lightColor[c];
+                        }
+
+                        if (constants.pointLights)
+                        {
+                            float world[3] = { pointLanes[0][lane], pointLanes[1][lane], pointLanes[2][lane] };
+                            float normal[3] = { pointLanes[3][lane], pointLanes[4][lane], pointLanes[5][lane] };
+                            float viewDir[3] = { pointLanes[6][lane], pointLanes[7][lane], pointLanes[8][lane] };
+                            float pixelX = qx + (lane & 1) + 0.5f;
+                            float pixelY = qy + (lane >> 1) + 0.5f;
+                            AddPointLights(constants, pixelX, pixelY, pointLanes[9][lane], world, normal, viewDir, diffuse, specular);
+                        }
+
+                        float color[3];
+                        for (uint32_t c = 0; c < 3; c++)
+                            color[c] = albedo[c] * (diffuse[c] + constants.ambient[c] + specular[c]);
+
+                        target.color[pixelIndex[lane]] = PackColor(color[0], color[1], color[2], 1.0f);
+                        target.depth[pixelIndex[lane]] = zLanes[lane];
+                        pixelsShaded++;
+                    }
+                }
+            }
+        }
+    }
+
+    outPixelsShaded = pixelsShaded;
+}
+
+void RasterDraw(JobSystem& jobs, RasterTarget& target, const RasterMesh& mesh, const InstanceData* instances, uint32_t instanceCount,
+    const ViewConstants& view, const LightSettings& light, const PointLight* pointLights, const LightClusters* clusters, RasterStats& stats)
+{
+    PROFILE_SCOPE("RasterDraw");
+
+    uint32_t vertexCount = (uint32_t)mesh.vertices.size();
+    if (vertexCount == 0 || instanceCount == 0 || target.width == 0 || target.height == 0)
+        return;
+
+    // the cbuffer holds it transposed for the column major hlsl side
+    Mat4 viewProj = Mat4Transpose(view.viewProj);
+
+    ShadeConstants constants;
+    constants.camPos[0] = view.camPos.x;
+    constants.camPos[1] = view.camPos.y;
+    constants.camPos[2] = view.camPos.z;
+    constants.lightPos[0] = light.pos.x;
+    constants.lightPos[1] = light.pos.y;
+    constants.lightPos[2] = light.pos.z;
+    constants.ambient[0] = light.ambientColor.x * light.ambientStrength;
+    constants.ambient[1] = light.ambientColor.y * light.ambientStrength;
+    constants.ambient[2] = light.ambientColor.z * light.ambientStrength;
+    constants.lightColor[0] = light.lightColor.x;
+    constants.lightColor[1] = light.lightColor.y;
+    constants.lightColor[2] = light.lightColor.z;
+    constants.specularStrength = light.specularStrength;
+    constants.specularPow = light.specularPow;
+    constants.pointLights = clusters && clusters->constants.pointLightCount ? pointLights : nullptr;
+    constants.clusters = clusters;
+
+    uint32_t tilesX = (target.width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    uint32_t tilesY = (target.height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+    uint32_t tileCount = tilesX * tilesY;
+
+    uint32_t groupSize = MAX_GROUP_VERTICES / vertexCount;
+    groupSize = groupSize ? groupSize : 1;
+
+    std::vector<RasterVertex> vertices;
+    std::vector<TriangleChunk> chunks;
+    std::vector<uint64_t> tilePixels(tileCount);
+
+    for (uint32_t first = 0; first < instanceCount; first += groupSize)
+    {
+        uint32_t count = instanceCount - first < groupSize ? instanceCount - first : groupSize;
+
+        auto vertexStart = std::chrono::high_resolution_clock::now();
+        vertices.resize((size_t)vertexCount * count);
+        TransformVertices(jobs, mesh, instances + first, count, viewProj, vertices.data());
+
+        auto binStart = std::chrono::high_resolution_clock::now();
+        SetupAndBin(jobs, mesh, vertices.data(), count, target.width, target.height, chunks);
+
+        auto rasterStart = std::chrono::high_resolution_clock::now();
+        ParallelFor(jobs, tileCount, 1, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t tile = begin; tile < end; tile++)
+                RasterTile(chunks, tile, tilesX, target, constants, tilePixels[tile]);
+        });
+
+        auto rasterEnd = std::chrono::high_resolution_clock::now();
+
+        stats.trianglesIn += (uint32_t)(mesh.indices.size() / 3) * count;
+        for (const TriangleChunk& chunk : chunks)
+        {
+            stats.trianglesCulled += chunk.culled;
+            stats.trianglesClipped += chunk.clipped;
+        }
+        for (uint64_t pixels : tilePixels)
+            stats.pixelsShaded += pixels;
+
+        stats.vertexMs += std::chrono::duration<float, std::milli>(binStart - vertexStart).count();
+        stats.binMs += std::chrono::duration<float, std::milli>(rasterStart - binStart).count();
+        stats.rasterMs += std::chrono::duration<float, std::milli>(rasterEnd - rasterStart).count();
+    }
+}
+
+RasterCompareResult CompareRasterTarget(const RasterTarget& target, const std::string& goldenPath, uint32_t channelTolerance,
+    float maxPixelsOver)
+{
+    RasterCompareResult result;
+
+    int width, height, channels;
+    uint8_t* golden = stbi_load(goldenPath.c_str(), &width, &height, &channels, 4);
+    if (!golden)
+        return result;
+
+    if ((uint32_t)width == target.width && (uint32_t)height == target.height)
+    {
+        result.loaded = true;
+
+        auto difference = [&](const uint8_t* color, int x, int y)
+        {
+            const uint8_t* expected = golden + ((size_t)y * width + x) * 4;
+            uint32_t largest = 0;
+            for (uint32_t c = 0; c < 4; c++)
+                largest = std::max(largest, (uint32_t)abs(color[c] - expected[c]));
+            return largest;
+        };
+
+        // an edge a rounding away from where it was moves by a pixel, a pixel only counts when no golden pixel
+        // next to it is within the tolerance either
+        const uint8_t* color = (const uint8_t*)target.color.data();
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                const uint8_t* pixel = color + ((size_t)y * width + x) * 4;
+                uint32_t closest = difference(pixel, x, y);
+                result.maxDifference = std::max(result.maxDifference, closest);
+
+                for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1) && closest > channelTolerance; ny++)
+                    for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); nx++)
+                        closest = std::min(closest, difference(pixel, nx, ny));
+
+                result.pixelsOver += closest > channelTolerance;
+            }
+        }
+
+        result.passed = result.pixelsOver <= maxPixelsOver * width * height;
+    }
+
+    stbi_image_free(golden);
+    return result;
+}
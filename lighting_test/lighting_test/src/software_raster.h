@@ -0,0 +1,86 @@
+#pragma once
+
+#include "mesh_cache.h"
+#include "texture_cache.h"
+#include "scene.h"
+#include "shader_constants.h"
+
+#include <vector>
+
+// cpu reference of the d3d11 path: takes the same vertices, instance data and cbuffers, runs the math of
+// shaders/vertex.hlsl and shaders/pixel.hlsl and follows the default d3d11 state Init() relies on
+// (back face culling with clockwise front faces, depth test less, trilinear wrap sampling, unorm target)
+// the main light's cube shadow is left out, the reference shows it unshadowed and is compared against frames drawn with
+// shadows turned off
+//
+// screen is split in TILE_SIZE tiles, triangles are set up and binned in parallel chunks and then every
+// tile is rasterized by one job in 2x2 pixel quads, one quad per simd register
+
+constexpr uint32_t RASTER_TILE_SIZE = 64;
+
+// what a reference may drift from its golden image. the simd paths, fma contraction and the block compressors round a
+// little differently between compilers and cpus, which moves edges by a pixel and flips the odd pixel of a thin triangle
+constexpr uint32_t RASTER_GOLDEN_CHANNEL_TOLERANCE = 8;
+constexpr float RASTER_GOLDEN_MAX_PIXELS_OVER = 0.01f; // of all pixels
+
+// rgba8 texture with its mip chain, block compressed levels are decoded once up front
+struct RasterTexture
+{
+    uint32_t levelCount = 0;
+    uint32_t widths[MAX_TEXTURE_LEVELS];
+    uint32_t heights[MAX_TEXTURE_LEVELS];
+    size_t offsets[MAX_TEXTURE_LEVELS];
+    std::vector<uint32_t> texels;
+};
+
+// full precision vertices, packed meshes are unpacked
+struct RasterMesh
+{
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<SubMeshRange> submeshes;
+    std::vector<const RasterTexture*> textures; // one per submesh, null samples white like the cube's texture
+};
+
+struct RasterTarget
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint32_t> color; // rgba8, red in the low byte
+    std::vector<float> depth;
+};
+
+struct RasterStats
+{
+    uint32_t trianglesIn = 0;
+    uint32_t trianglesCulled = 0;  // back facing, degenerate or off screen
+    uint32_t trianglesClipped = 0; // crossing the near plane
+    uint64_t pixelsShaded = 0;
+    float vertexMs = 0.0f;
+    float binMs = 0.0f;
+    float rasterMs = 0.0f;
+};
+
+struct RasterCompareResult
+{
+    bool loaded = false;        // the golden image was read and has the target's size
+    uint32_t pixelsOver = 0;    // with a channel further off than the tolerance from the golden pixel and its neighbours
+    uint32_t maxDifference = 0; // of any channel against the golden pixel itself
+    bool passed = false;
+};
+
+void MakeRasterTexture(const TextureView& view, RasterTexture& outTexture);
+void MakeRasterMesh(const MeshView& view, RasterMesh& outMesh);
+
+void ResizeRasterTarget(RasterTarget& target, uint32_t width, uint32_t height);
+void ClearRasterTarget(RasterTarget& target, const float clearColor[4], float clearDepth);
+
+// draws instanceCount instances of mesh with the constants exactly as uploaded to the gpu,
+// point lights are looked up through clusters like the pixel shader does (both may be null), stats are accumulated
+void RasterDraw(JobSystem& jobs, RasterTarget& target, const RasterMesh& mesh, const InstanceData* instances, uint32_t instanceCount,
+    const ViewConstants& view, const LightSettings& light, const PointLight* pointLights, const LightClusters* clusters, RasterStats& stats);
+
+// target's color against a png, passed while at most maxPixelsOver of the pixels have a channel off by more than
+// channelTolerance from the golden pixel at the same place and from the ones around it
+RasterCompareResult CompareRasterTarget(const RasterTarget& target, const std::string& goldenPath, uint32_t channelTolerance,
+    float maxPixelsOver);
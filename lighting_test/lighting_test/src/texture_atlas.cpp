@@ -0,0 +1,297 @@
+#include "texture_atlas.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string.h>
+
+// imgui_draw.cpp keeps its copy static as well
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#include "../vendor/imgui/imstb_rectpack.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+static uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void PackTextures(const TextureView* const* textures, uint32_t count, PackedTextures& outPacked)
+{
+    PROFILE_SCOPE("PackTextures");
+
+    outPacked.arrays.clear();
+    TexturePlacement none = {};
+    none.array = -1;
+    outPacked.placements.assign(count, none);
+
+    for (uint32_t formatIndex = 0; formatIndex < MAX_TEXTURE_ARRAYS; formatIndex++)
+    {
+        TextureFormat format = (TextureFormat)formatIndex;
+
+        uint32_t width = 0, height = 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (textures[i] && textures[i]->format == format)
+            {
+                width = std::max(width, textures[i]->levels[0].width);
+                height = std::max(height, textures[i]->levels[0].height);
+            }
+        }
+
+        if (!width)
+            continue;
+
+        // the biggest textures get a layer each, the others go into atlas pages
+        std::vector<uint32_t> wholeLayers, packed;
+        uint32_t wholeLevels = UINT32_MAX, packedLevels = UINT32_MAX;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!textures[i] || textures[i]->format != format)
+                continue;
+
+            const TextureView& texture = *textures[i];
+            if (texture.levels[0].width == width && texture.levels[0].height == height)
+            {
+                wholeLayers.push_back(i);
+                wholeLevels = std::min(wholeLevels, texture.levelCount);
+            }
+            else
+            {
+                packed.push_back(i);
+                packedLevels = std::min(packedLevels, texture.levelCount);
+            }
+        }
+
+        // at the last level an atlas rect keeps, its gutter is still one block wide
+        uint32_t atlasLevels = packed.empty() ? 1 : std::min(MAX_ATLAS_LEVELS, packedLevels);
+        if (!wholeLayers.empty())
+            atlasLevels = std::min(atlasLevels, wholeLevels);
+        uint32_t gutter = 4u << (atlasLevels - 1);
+
+        // pages of only atlas rects are sized to fit the biggest one with its gutter
+        if (wholeLayers.empty())
+        {
+            width = AlignUp(width + 2 * gutter, gutter);
+            height = AlignUp(height + 2 * gutter, gutter);
+        }
+
+        TextureArrayLayout& layout = outPacked.arrays.emplace_back();
+        layout.format = format;
+        layout.width = width;
+        layout.height = height;
+        layout.levelCount = wholeLayers.empty() ? atlasLevels : wholeLevels;
+        layout.layerCount = 0;
+        layout.gutter = packed.empty() ? 0 : gutter;
+        layout.usedTexels = 0;
+
+        int32_t arrayIndex = (int32_t)outPacked.arrays.size() - 1;
+
+        for (uint32_t i : wholeLayers)
+        {
+            outPacked.placements[i] = { arrayIndex, layout.layerCount++, 0, 0, width, height, layout.levelCount, true };
+            layout.usedTexels += (uint64_t)width * height;
+        }
+
+        // packed in gutter sized cells so every rect stays block aligned down to its last level,
+        // one more page every time the rects left over do not fit
+        uint32_t cellsX = width / gutter;
+        uint32_t cellsY = height / gutter;
+
+        std::vector<stbrp_rect> rects;
+        for (uint32_t i : packed)
+        {
+            stbrp_rect& rect = rects.emplace_back();
+            rect.id = (int)i;
+            rect.w = (stbrp_coord)((textures[i]->levels[0].width + gutter - 1) / gutter + 2);
+            rect.h = (stbrp_coord)((textures[i]->levels[0].height + gutter - 1) / gutter + 2);
+        }
+
+        std::vector<stbrp_node> nodes(cellsX);
+        while (!rects.empty())
+        {
+            stbrp_context context;
+            stbrp_init_target(&context, (int)cellsX, (int)cellsY, nodes.data(), (int)cellsX);
+            stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+            uint32_t layer = layout.layerCount++;
+
+            std::vector<stbrp_rect> left;
+            for (const stbrp_rect& rect : rects)
+            {
+                if (!rect.was_packed)
+                {
+                    left.push_back(rect);
+                    continue;
+                }
+
+                const TextureLevelView& top = textures[rect.id]->levels[0];
+                outPacked.placements[rect.id] = { arrayIndex, layer, (uint32_t)(rect.x + 1) * gutter, (uint32_t)(rect.y + 1) * gutter, top.width, top.height, atlasLevels, false };
+                layout.usedTexels += (uint64_t)top.width * top.height;
+            }
+
+            // too big for an empty page with its gutter, it gets the page to itself and loses the top left gutter
+            if (left.size() == rects.size())
+            {
+                const TextureLevelView& top = textures[left.back().id]->levels[0];
+                outPacked.placements[left.back().id] = { arrayIndex, layer, 0, 0, top.width, top.height, atlasLevels, false };
+                layout.usedTexels += (uint64_t)top.width * top.height;
+                left.pop_back();
+            }
+
+            rects = std::move(left);
+        }
+    }
+}
+
+float GetTextureOccupancy(const PackedTextures& packed)
+{
+    uint64_t used = 0, allocated = 0;
+    for (const TextureArrayLayout& layout : packed.arrays)
+    {
+        used += layout.usedTexels;
+        allocated += (uint64_t)layout.width * layout.height * layout.layerCount;
+    }
+
+    return allocated ? (float)((double)used / (double)allocated) : 1.0f;
+}
+
+void BuildTextureArray(const PackedTextures& packed, uint32_t arrayIndex, const TextureView* const* textures, TextureData& outData)
+{
+    PROFILE_SCOPE("BuildTextureArray");
+
+    const TextureArrayLayout& layout = packed.arrays[arrayIndex];
+
+    outData.format = layout.format;
+    outData.levels.clear();
+
+    size_t size = 0;
+    for (uint32_t layer = 0; layer < layout.layerCount; layer++)
+    {
+        for (uint32_t level = 0; level < layout.levelCount; level++)
+        {
+            uint32_t levelWidth = std::max(layout.width >> level, 1u);
+            uint32_t levelHeight = std::max(layout.height >> level, 1u);
+            outData.levels.push_back({ levelWidth, levelHeight, size });
+            size += GetLevelSize(layout.format, levelWidth, levelHeight);
+        }
+    }
+
+    // whatever no texture covers stays black, it is never sampled
+    outData.data.assign(size, 0);
+
+    // copied in blocks, texels for RGBA8, the gutter repeats the closest edge block
+    uint32_t blockSize = IsBlockCompressed(layout.format) ? 4 : 1;
+    uint32_t blockBytes = GetBlockBytes(layout.format);
+
+    for (uint32_t i = 0; i < packed.placements.size(); i++)
+    {
+        const TexturePlacement& placement = packed.placements[i];
+        if (placement.array != (int32_t)arrayIndex)
+            continue;
+
+        for (uint32_t level = 0; level < placement.levelCount; level++)
+        {
+            const MipLevel& target = outData.levels[placement.layer * layout.levelCount + level];
+            uint8_t* targetData = outData.data.data() + target.offset;
+            uint32_t targetPitch = GetRowPitch(layout.format, target.width);
+            int32_t targetBlocksX = (int32_t)((target.width + blockSize - 1) / blockSize);
+            int32_t targetBlocksY = (int32_t)((target.height + blockSize - 1) / blockSize);
+
+            const TextureLevelView& source = textures[i]->levels[level];
+            int32_t sourceBlocksX = (int32_t)((source.width + blockSize - 1) / blockSize);
+            int32_t sourceBlocksY = (int32_t)((source.height + blockSize - 1) / blockSize);
+
+            int32_t originX = (int32_t)((placement.x >> level) / blockSize);
+            int32_t originY = (int32_t)((placement.y >> level) / blockSize);
+            int32_t gutter = placement.wholeLayer ? 0 : (int32_t)((layout.gutter >> level) / blockSize);
+
+            for (int32_t y = -gutter; y < sourceBlocksY + gutter; y++)
+            {
+                int32_t targetY = originY + y;
+                if (targetY < 0 || targetY >= targetBlocksY)
+                    continue;
+
+                const uint8_t* sourceRow = source.data + (size_t)std::clamp(y, 0, sourceBlocksY - 1) * source.rowPitch;
+                uint8_t* targetRow = targetData + (size_t)targetY * targetPitch;
+
+                for (int32_t x = -gutter; x < sourceBlocksX + gutter; x++)
+                {
+                    int32_t targetX = originX + x;
+                    if (targetX < 0 || targetX >= targetBlocksX)
+                        continue;
+
+                    memcpy(targetRow + (size_t)targetX * blockBytes, sourceRow + (size_t)std::clamp(x, 0, sourceBlocksX - 1) * blockBytes, blockBytes);
+                }
+            }
+        }
+    }
+}
+
+void RunAtlasBenchmark(uint32_t textureCount, AtlasBenchmarkResult& result)
+{
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> sizeShift(4, 10);
+    std::uniform_int_distribution<uint32_t> oddSize(8, 700);
+    std::uniform_int_distribution<uint32_t> formatIndex(0, MAX_TEXTURE_ARRAYS - 1);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+    // sizes and formats only, packing never looks at the texels
+    std::vector<TextureView> views(textureCount);
+    std::vector<const TextureView*> textures(textureCount);
+    for (uint32_t i = 0; i < textureCount; i++)
+    {
+        uint32_t chance = percent(rng);
+        uint32_t width, height;
+        if (chance < 20)
+            width = height = 1024;
+        else if (chance < 80)
+            width = height = 1u << sizeShift(rng);
+        else
+        {
+            width = oddSize(rng);
+            height = oddSize(rng);
+        }
+
+        TextureView& view = views[i];
+        view = {};
+        view.format = (TextureFormat)formatIndex(rng);
+        while (view.levelCount < MAX_TEXTURE_LEVELS && (width >> view.levelCount || height >> view.levelCount))
+        {
+            view.levels[view.levelCount] = { std::max(width >> view.levelCount, 1u), std::max(height >> view.levelCount, 1u), 0, nullptr };
+            view.levelCount++;
+        }
+
+        textures[i] = &view;
+    }
+
+    PackedTextures packed;
+
+    double best = 1e30;
+    for (uint32_t run = 0; run < 5; run++)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        PackTextures(textures.data(), textureCount, packed);
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = ms < best ? ms : best;
+    }
+
+    result.textureCount = textureCount;
+    result.arrayCount = (uint32_t)packed.arrays.size();
+    result.layerCount = 0;
+    for (const TextureArrayLayout& layout : packed.arrays)
+        result.layerCount += layout.layerCount;
+    result.wholeLayers = 0;
+    for (const TexturePlacement& placement : packed.placements)
+        result.wholeLayers += placement.wholeLayer ? 1 : 0;
+    result.occupancy = GetTextureOccupancy(packed);
+    result.ms = best;
+}
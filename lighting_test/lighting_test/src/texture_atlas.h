@@ -0,0 +1,62 @@
+#pragma once
+
+#include "texture_cache.h"
+
+// packs the textures of one mesh into a few Texture2DArrays so every submesh samples from the same
+// bindings and the whole mesh draws in one call. textures of the biggest size fill whole layers and keep
+// their full mip chain and hardware wrapping, smaller ones are packed into atlas pages of that size with
+// stb_rect_pack, surrounded by a gutter of replicated edge blocks. one array per texture format
+
+constexpr uint32_t MAX_TEXTURE_ARRAYS = 4; // one per TextureFormat
+
+// levels an atlas rect keeps, each one more doubles the gutter
+constexpr uint32_t MAX_ATLAS_LEVELS = 4;
+
+struct TexturePlacement
+{
+    int32_t array;         // into PackedTextures::arrays, -1 when there is no texture
+    uint32_t layer;
+    uint32_t x, y;         // top level texels
+    uint32_t width, height;
+    uint32_t levelCount;   // levels that can be sampled
+    bool wholeLayer;
+};
+
+struct TextureArrayLayout
+{
+    TextureFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t layerCount;
+    uint32_t gutter;       // top level texels around every atlas rect
+    uint64_t usedTexels;   // top level texels covered by textures, without gutters
+};
+
+struct PackedTextures
+{
+    std::vector<TextureArrayLayout> arrays;
+    std::vector<TexturePlacement> placements; // one per input texture
+};
+
+// textures may contain nulls, only the sizes, level counts and formats are looked at
+void PackTextures(const TextureView* const* textures, uint32_t count, PackedTextures& outPacked);
+
+// used texels over allocated top level texels of every array, 1 when nothing was packed
+float GetTextureOccupancy(const PackedTextures& packed);
+
+// contents of every layer of one array, levels are ordered like d3d subresources: layer * levelCount + level
+void BuildTextureArray(const PackedTextures& packed, uint32_t arrayIndex, const TextureView* const* textures, TextureData& outData);
+
+struct AtlasBenchmarkResult
+{
+    uint32_t textureCount;
+    uint32_t arrayCount;
+    uint32_t layerCount;
+    uint32_t wholeLayers;
+    float occupancy;
+    double ms;
+};
+
+// random power of two and odd sized textures of a few formats, only packed, best of a few runs
+void RunAtlasBenchmark(uint32_t textureCount, AtlasBenchmarkResult& result);
@@ -0,0 +1,251 @@
+#include "texture_cache.h"
+
+#include <fstream>
+#include <filesystem>
+#include <string.h>
+
+constexpr uint32_t TEXTURE_CACHE_MAGIC = 0x5845544c; // "LTEX", in the dds reserved words
+constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+constexpr uint32_t DDS_FOURCC_DX10 = 0x30315844; // "DX10"
+
+constexpr uint32_t DDSD_CAPS = 0x1;
+constexpr uint32_t DDSD_HEIGHT = 0x2;
+constexpr uint32_t DDSD_WIDTH = 0x4;
+constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+constexpr uint32_t DXGI_FORMAT_R8G8B8A8_UNORM_VALUE = 28;
+constexpr uint32_t DXGI_FORMAT_BC1_UNORM_VALUE = 71;
+constexpr uint32_t DXGI_FORMAT_BC3_UNORM_VALUE = 77;
+constexpr uint32_t DXGI_FORMAT_BC7_UNORM_VALUE = 98;
+
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask;
+    uint32_t gBitMask;
+    uint32_t bBitMask;
+    uint32_t aBitMask;
+};
+
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+// what we put in DdsHeader::reserved1
+struct CacheStamp
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTimestamp;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "dds header must be 124 bytes");
+static_assert(sizeof(CacheStamp) <= sizeof(DdsHeader::reserved1), "cache stamp does not fit the reserved words");
+
+uint32_t GetDxgiFormat(TextureFormat format)
+{
+    switch (format)
+    {
+        case TextureFormat::BC1: return DXGI_FORMAT_BC1_UNORM_VALUE;
+        case TextureFormat::BC3: return DXGI_FORMAT_BC3_UNORM_VALUE;
+        case TextureFormat::BC7: return DXGI_FORMAT_BC7_UNORM_VALUE;
+        default: return DXGI_FORMAT_R8G8B8A8_UNORM_VALUE;
+    }
+}
+
+static bool GetTextureFormat(uint32_t dxgiFormat, TextureFormat& outFormat)
+{
+    switch (dxgiFormat)
+    {
+        case DXGI_FORMAT_R8G8B8A8_UNORM_VALUE: outFormat = TextureFormat::RGBA8; return true;
+        case DXGI_FORMAT_BC1_UNORM_VALUE: outFormat = TextureFormat::BC1; return true;
+        case DXGI_FORMAT_BC3_UNORM_VALUE: outFormat = TextureFormat::BC3; return true;
+        case DXGI_FORMAT_BC7_UNORM_VALUE: outFormat = TextureFormat::BC7; return true;
+        default: return false;
+    }
+}
+
+std::string GetTextureCachePath(const std::string& texturePath)
+{
+    return texturePath + ".dds";
+}
+
+TextureView MakeTextureView(const TextureData& texture)
+{
+    check(texture.levels.size() <= MAX_TEXTURE_LEVELS);
+
+    TextureView view;
+    view.format = texture.format;
+    view.levelCount = (uint32_t)texture.levels.size();
+
+    for (uint32_t i = 0; i < view.levelCount; i++)
+    {
+        const MipLevel& level = texture.levels[i];
+        view.levels[i].width = level.width;
+        view.levels[i].height = level.height;
+        view.levels[i].rowPitch = GetRowPitch(texture.format, level.width);
+        view.levels[i].data = texture.data.data() + level.offset;
+    }
+
+    return view;
+}
+
+bool WriteTextureCache(const std::string& texturePath, const TextureData& texture)
+{
+    CacheStamp stamp = {};
+    stamp.magic = TEXTURE_CACHE_MAGIC;
+    stamp.version = TEXTURE_CACHE_VERSION;
+
+    if (!GetFileStamp(texturePath, stamp.sourceSize, stamp.sourceTimestamp))
+        return false;
+
+    const MipLevel& top = texture.levels[0];
+
+    DdsHeader header = {};
+    header.size = sizeof(DdsHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = top.height;
+    header.width = top.width;
+    header.pitchOrLinearSize = (uint32_t)GetLevelSize(texture.format, top.width, top.height);
+    header.mipMapCount = (uint32_t)texture.levels.size();
+    memcpy(header.reserved1, &stamp, sizeof(stamp));
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+    header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+    DdsHeaderDx10 headerDx10 = {};
+    headerDx10.dxgiFormat = GetDxgiFormat(texture.format);
+    headerDx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    headerDx10.arraySize = 1;
+
+    // same temp file dance as the mesh cache
+    std::string cachePath = GetTextureCachePath(texturePath);
+    std::string tempPath = cachePath + ".tmp";
+
+    bool ok;
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)&headerDx10, sizeof(headerDx10));
+        file.write((const char*)texture.data.data(), texture.data.size());
+        file.flush();
+        ok = file.good();
+    }
+
+    std::error_code error;
+    if (ok)
+        std::filesystem::rename(tempPath, cachePath, error);
+
+    if (!ok || error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool MapTextureCache(const std::string& texturePath, MappedFile& outFile, TextureView& outView)
+{
+    uint64_t sourceSize;
+    int64_t sourceTimestamp;
+    if (!GetFileStamp(texturePath, sourceSize, sourceTimestamp))
+        return false;
+
+    if (!outFile.Map(GetTextureCachePath(texturePath)))
+        return false;
+
+    constexpr size_t headersSize = sizeof(uint32_t) + sizeof(DdsHeader) + sizeof(DdsHeaderDx10);
+
+    const DdsHeader* header = (const DdsHeader*)(outFile.data + sizeof(uint32_t));
+    const DdsHeaderDx10* headerDx10 = (const DdsHeaderDx10*)(outFile.data + sizeof(uint32_t) + sizeof(DdsHeader));
+
+    CacheStamp stamp = {};
+    TextureFormat format = TextureFormat::RGBA8;
+
+    bool valid = outFile.size >= headersSize && *(const uint32_t*)outFile.data == DDS_MAGIC;
+    if (valid)
+    {
+        memcpy(&stamp, header->reserved1, sizeof(stamp));
+
+        valid = stamp.magic == TEXTURE_CACHE_MAGIC
+            && stamp.version == TEXTURE_CACHE_VERSION
+            && stamp.sourceSize == sourceSize
+            && stamp.sourceTimestamp == sourceTimestamp
+            && header->pixelFormat.fourCC == DDS_FOURCC_DX10
+            && header->mipMapCount >= 1 && header->mipMapCount <= MAX_TEXTURE_LEVELS
+            && GetTextureFormat(headerDx10->dxgiFormat, format);
+    }
+
+    uint64_t offset = headersSize;
+    if (valid)
+    {
+        outView.format = format;
+        outView.levelCount = header->mipMapCount;
+
+        uint32_t width = header->width;
+        uint32_t height = header->height;
+
+        for (uint32_t i = 0; i < outView.levelCount; i++)
+        {
+            TextureLevelView& level = outView.levels[i];
+            level.width = width;
+            level.height = height;
+            level.rowPitch = GetRowPitch(format, width);
+            level.data = outFile.data + offset;
+
+            offset += GetLevelSize(format, width, height);
+
+            width = width > 1 ? width / 2 : 1;
+            height = height > 1 ? height / 2 : 1;
+        }
+
+        valid = offset == outFile.size;
+    }
+
+    if (!valid)
+    {
+        outFile.Unmap();
+        return false;
+    }
+
+    return true;
+}
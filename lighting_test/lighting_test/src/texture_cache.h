@@ -0,0 +1,49 @@
+#pragma once
+
+#include "bc.h"
+#include "mips.h"
+#include "mapped_file.h"
+
+#include <string>
+#include <vector>
+
+// cooked textures are plain dds files (dx10 header) written next to the source as "<texture>.dds",
+// the source size and timestamp are stamped in the reserved header words to detect stale caches
+
+constexpr uint32_t MAX_TEXTURE_LEVELS = 16;
+
+// cpu side texture with its whole mip chain, levels index into data
+struct TextureData
+{
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<uint8_t> data;
+    std::vector<MipLevel> levels;
+};
+
+struct TextureLevelView
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t rowPitch;
+    const uint8_t* data;
+};
+
+// non owning view, either over a TextureData or a mapped dds
+struct TextureView
+{
+    TextureFormat format;
+    uint32_t levelCount;
+    TextureLevelView levels[MAX_TEXTURE_LEVELS];
+};
+
+// dxgi format enum value, kept here so cooking does not need the d3d headers
+uint32_t GetDxgiFormat(TextureFormat format);
+
+std::string GetTextureCachePath(const std::string& texturePath);
+
+TextureView MakeTextureView(const TextureData& texture);
+
+bool WriteTextureCache(const std::string& texturePath, const TextureData& texture);
+
+// maps the dds for texturePath, fails if missing, not written by us, from another version or older than the source
+bool MapTextureCache(const std::string& texturePath, MappedFile& outFile, TextureView& outView);
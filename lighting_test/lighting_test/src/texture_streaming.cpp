@@ -0,0 +1,425 @@
+#include "texture_streaming.h"
+#include "profiler.h"
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+// levels a texture can leave out before its top level is at most STREAMING_TAIL_SIZE
+static uint32_t GetMaxDrop(const TextureView& view)
+{
+    uint32_t drop = 0;
+    while (drop + 1 < view.levelCount && std::max(view.levels[drop].width, view.levels[drop].height) > STREAMING_TAIL_SIZE)
+        drop++;
+    return drop;
+}
+
+void InitStreamingMesh(const TextureView* const* textures, uint32_t count, StreamingMesh& out)
+{
+    out = {};
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!textures[i])
+            continue;
+
+        const TextureView& view = *textures[i];
+        out.topSize = std::max(out.topSize, std::max(view.levels[0].width, view.levels[0].height));
+        out.maxDrop = std::max(out.maxDrop, GetMaxDrop(view));
+
+        for (uint32_t drop = 0; drop < MAX_TEXTURE_LEVELS; drop++)
+        {
+            for (uint32_t level = std::min(drop, GetMaxDrop(view)); level < view.levelCount; level++)
+                out.bytes[drop] += GetLevelSize(view.format, view.levels[level].width, view.levels[level].height);
+        }
+    }
+
+    out.residentDrop = out.maxDrop;
+    out.requestedDrop = out.maxDrop;
+    out.wantedDrop = out.maxDrop;
+}
+
+TextureView TrimTextureView(const TextureView& view, uint32_t drop)
+{
+    drop = std::min(drop, GetMaxDrop(view));
+
+    TextureView trimmed = {};
+    trimmed.format = view.format;
+    trimmed.levelCount = view.levelCount - drop;
+    for (uint32_t level = 0; level < trimmed.levelCount; level++)
+        trimmed.levels[level] = view.levels[drop + level];
+
+    return trimmed;
+}
+
+float GetStreamingScreenSize(const Vec3& camera, float pixelsPerUnit, const SubMeshBounds& bounds, const InstanceData* instances, uint32_t count)
+{
+    const Vec3& c = bounds.center;
+    float size = 0.0f;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const float (*m)[4] = instances[i].model.m;
+
+        Vec3 center =
+        {
+            c.x * m[0][0] + c.y * m[1][0] + c.z * m[2][0] + m[3][0],
+            c.x * m[0][1] + c.y * m[1][1] + c.z * m[2][1] + m[3][1],
+            c.x * m[0][2] + c.y * m[1][2] + c.z * m[2][2] + m[3][2],
+        };
+
+        float scale = 0.0f;
+        for (uint32_t row = 0; row < 3; row++)
+            scale = fmaxf(scale, m[row][0] * m[row][0] + m[row][1] * m[row][1] + m[row][2] * m[row][2]);
+        scale = sqrtf(scale);
+
+        // from inside the sphere it covers the screen, as big as it gets
+        float radius = bounds.radius * scale;
+        float distance = Length(center - camera) - radius;
+        if (distance <= 0.0f)
+            return FLT_MAX;
+
+        size = fmaxf(size, 2.0f * radius * pixelsPerUnit / distance);
+    }
+
+    return size;
+}
+
+void UpdateTextureStreaming(TextureStreamer& streamer, const float* screenSizes, Arena& scratch, std::vector<StreamingRequest>& outRequests,
+    std::vector<uint32_t>& outEvicted)
+{
+    PROFILE_SCOPE("UpdateTextureStreaming");
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    outRequests.clear();
+    outEvicted.clear();
+
+    std::vector<StreamingMesh>& meshes = streamer.meshes;
+    uint32_t meshCount = (uint32_t)meshes.size();
+    uint64_t budget = streamer.settings.budgetBytes;
+
+    streamer.frameIndex++;
+    streamer.stats = {};
+    TextureStreamingStats& stats = streamer.stats;
+
+    // a texel per pixel of the top level is enough, every halving of the screen size takes off a level
+    uint64_t reserved = 0;
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        StreamingMesh& mesh = meshes[i];
+        mesh.wantedDrop = mesh.maxDrop;
+        if (screenSizes[i] > 0.0f)
+        {
+            float drop = floorf(log2f((float)mesh.topSize / screenSizes[i]) + streamer.settings.mipBias);
+            mesh.wantedDrop = drop <= 0.0f ? 0 : std::min((uint32_t)drop, mesh.maxDrop);
+            mesh.lastUsedFrame = streamer.frameIndex;
+        }
+
+        reserved += mesh.bytes[std::min(mesh.residentDrop, mesh.requestedDrop)];
+    }
+
+    auto evict = [&](uint32_t meshIndex, uint32_t drop)
+    {
+        StreamingMesh& mesh = meshes[meshIndex];
+        reserved -= mesh.bytes[mesh.residentDrop] - mesh.bytes[drop];
+        mesh.residentDrop = drop;
+        mesh.requestedDrop = drop;
+        outEvicted.push_back(meshIndex);
+    };
+
+    auto holdsUnwanted = [&](uint32_t meshIndex)
+    {
+        return meshes[meshIndex].residentDrop < meshes[meshIndex].wantedDrop;
+    };
+
+    // meshes that can give back levels, least recently used first. ties stay in mesh order, std::sort with the index
+    // as the tie break does what std::stable_sort would without its heap buffer
+    ArenaVector<uint32_t> lru(scratch);
+    lru.reserve(meshCount);
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        if (meshes[i].requestedDrop == meshes[i].residentDrop && meshes[i].residentDrop < meshes[i].maxDrop)
+            lru.push_back(i);
+    }
+
+    std::sort(lru.begin(), lru.end(), [&](uint32_t a, uint32_t b)
+    {
+        return meshes[a].lastUsedFrame != meshes[b].lastUsedFrame ? meshes[a].lastUsedFrame < meshes[b].lastUsedFrame : a < b;
+    });
+
+    // over budget, e.g. after it was lowered: the levels nobody wants first, then a level at a time of what is wanted
+    for (uint32_t i = 0; i < lru.size() && reserved > budget; i++)
+    {
+        if (holdsUnwanted(lru[i]))
+            evict(lru[i], meshes[lru[i]].wantedDrop);
+    }
+
+    bool progress = true;
+    while (reserved > budget && progress)
+    {
+        progress = false;
+        for (uint32_t i = 0; i < lru.size() && reserved > budget; i++)
+        {
+            if (meshes[lru[i]].residentDrop < meshes[lru[i]].maxDrop)
+            {
+                evict(lru[i], meshes[lru[i]].residentDrop + 1);
+                progress = true;
+            }
+        }
+    }
+
+    // what the visible meshes miss, biggest shortfall first. ties go to the mesh filling more of the screen
+    ArenaVector<uint32_t> missing(scratch);
+    missing.reserve(meshCount);
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        if (meshes[i].requestedDrop == meshes[i].residentDrop && meshes[i].wantedDrop < meshes[i].residentDrop)
+            missing.push_back(i);
+    }
+
+    std::sort(missing.begin(), missing.end(), [&](uint32_t a, uint32_t b)
+    {
+        uint32_t shortfallA = meshes[a].residentDrop - meshes[a].wantedDrop;
+        uint32_t shortfallB = meshes[b].residentDrop - meshes[b].wantedDrop;
+        if (shortfallA != shortfallB)
+            return shortfallA > shortfallB;
+        return screenSizes[a] != screenSizes[b] ? screenSizes[a] > screenSizes[b] : a < b;
+    });
+
+    uint32_t lruCursor = 0; // evicting only ever moves forward, what was skipped holds nothing unwanted
+    for (uint32_t meshIndex : missing)
+    {
+        StreamingMesh& mesh = meshes[meshIndex];
+
+        // all the levels it wants when they fit, else as many as do
+        for (uint32_t drop = mesh.wantedDrop; drop < mesh.residentDrop; drop++)
+        {
+            uint64_t cost = mesh.bytes[drop] - mesh.bytes[mesh.residentDrop];
+
+            for (; lruCursor < lru.size() && reserved + cost > budget; lruCursor++)
+            {
+                if (lru[lruCursor] != meshIndex && holdsUnwanted(lru[lruCursor]))
+                    evict(lru[lruCursor], meshes[lru[lruCursor]].wantedDrop);
+            }
+
+            if (reserved + cost > budget)
+                continue;
+
+            outRequests.push_back({ meshIndex, drop, mesh.residentDrop });
+            mesh.requestedDrop = drop;
+            reserved += cost;
+            break;
+        }
+    }
+
+    std::sort(outEvicted.begin(), outEvicted.end());
+    outEvicted.erase(std::unique(outEvicted.begin(), outEvicted.end()), outEvicted.end());
+
+    for (uint32_t i = 0; i < meshCount; i++)
+    {
+        const StreamingMesh& mesh = meshes[i];
+        stats.residentBytes += mesh.bytes[mesh.residentDrop];
+        stats.wantedBytes += mesh.bytes[mesh.wantedDrop];
+        stats.inFlight += mesh.requestedDrop < mesh.residentDrop ? 1 : 0;
+        stats.blurryMeshes += screenSizes[i] > 0.0f && mesh.residentDrop > mesh.wantedDrop ? 1 : 0;
+    }
+
+    stats.reservedBytes = reserved;
+    stats.requests = (uint32_t)outRequests.size();
+    stats.evictions = (uint32_t)outEvicted.size();
+    stats.ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void CompleteStreamingRequest(TextureStreamer& streamer, const StreamingRequest& request)
+{
+    StreamingMesh& mesh = streamer.meshes[request.mesh];
+    check(mesh.requestedDrop == request.drop);
+    mesh.residentDrop = request.drop;
+}
+
+uint64_t PrefetchTextureLevels(const TextureView& view, uint32_t firstLevel, uint32_t endLevel)
+{
+    constexpr size_t PAGE_SIZE = 4096;
+
+    uint64_t sum = 0;
+    for (uint32_t level = firstLevel; level < endLevel && level < view.levelCount; level++)
+    {
+        const TextureLevelView& levelView = view.levels[level];
+        size_t size = GetLevelSize(view.format, levelView.width, levelView.height);
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+            sum += levelView.data[offset];
+    }
+
+    return sum;
+}
+
+void StartStreamingIo(StreamingIo& io, const std::function<void(const StreamingRequest&)>& read)
+{
+    io.quit = false;
+    io.thread = std::thread([&io, read]
+    {
+        ProfilerSetThreadName("streaming");
+
+        std::unique_lock<std::mutex> lock(io.mutex);
+        for (;;)
+        {
+            io.wake.wait(lock, [&io] { return io.quit || !io.pending.empty(); });
+            if (io.quit)
+                return;
+
+            StreamingRequest request = io.pending.front();
+            io.pending.pop_front();
+
+            lock.unlock();
+            read(request);
+            lock.lock();
+
+            io.done.push_back(request);
+        }
+    });
+}
+
+void StopStreamingIo(StreamingIo& io)
+{
+    {
+        std::lock_guard<std::mutex> lock(io.mutex);
+        io.quit = true;
+    }
+
+    io.wake.notify_one();
+    if (io.thread.joinable())
+        io.thread.join();
+}
+
+void SubmitStreamingRequests(StreamingIo& io, const std::vector<StreamingRequest>& requests)
+{
+    if (requests.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(io.mutex);
+        io.pending.insert(io.pending.end(), requests.begin(), requests.end());
+    }
+
+    io.wake.notify_one();
+}
+
+void CollectStreamingRequests(StreamingIo& io, std::vector<StreamingRequest>& outDone)
+{
+    std::lock_guard<std::mutex> lock(io.mutex);
+    outDone.swap(io.done);
+    io.done.clear();
+}
+
+void RunTextureStreamingBenchmark(TextureStreamingBenchmarkResult& result)
+{
+    constexpr uint32_t MESH_COUNT = 512;
+    constexpr uint32_t FRAMES = 600;
+    constexpr uint32_t READ_FRAMES = 3;   // from request to resident
+    constexpr float FIELD_SIZE = 200.0f;
+    constexpr float VIEW_DISTANCE = 150.0f;
+    constexpr float FOV_Y = 1.0472f;      // 60 degrees
+    constexpr uint32_t VIEW_HEIGHT = 1080;
+    constexpr float BUDGETS[] = { 0.0f, 1.0f, 0.5f, 0.25f }; // of the most the path ever wants at once, 0 is no budget
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-FIELD_SIZE * 0.5f, FIELD_SIZE * 0.5f);
+    std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+    std::uniform_int_distribution<uint32_t> textureCount(1, 4);
+    std::uniform_int_distribution<uint32_t> sizeLog2(8, 12);
+    std::uniform_int_distribution<uint32_t> format(0, 1);
+
+    // only sizes and formats matter to the policy, the views have no data
+    std::vector<StreamingMesh> meshes(MESH_COUNT);
+    std::vector<InstanceData> instances(MESH_COUNT);
+    std::vector<SubMeshBounds> bounds(MESH_COUNT);
+
+    result = {};
+    result.meshCount = MESH_COUNT;
+    result.frames = FRAMES;
+
+    for (uint32_t i = 0; i < MESH_COUNT; i++)
+    {
+        TextureView views[4] = {};
+        const TextureView* pointers[4] = {};
+        uint32_t count = textureCount(rng);
+        for (uint32_t t = 0; t < count; t++)
+        {
+            uint32_t size = 1 << sizeLog2(rng);
+            views[t].format = format(rng) ? TextureFormat::BC7 : TextureFormat::BC1;
+            while (views[t].levelCount == 0 || views[t].levels[views[t].levelCount - 1].width > 1)
+            {
+                uint32_t levelSize = std::max(size >> views[t].levelCount, 1u);
+                views[t].levels[views[t].levelCount++] = { levelSize, levelSize, GetRowPitch(views[t].format, levelSize), nullptr };
+            }
+            pointers[t] = &views[t];
+        }
+
+        InitStreamingMesh(pointers, count, meshes[i]);
+        result.fullMb += meshes[i].bytes[0] / (1024.0 * 1024.0);
+        result.tailMb += meshes[i].bytes[meshes[i].maxDrop] / (1024.0 * 1024.0);
+
+        instances[i] = {};
+        instances[i].model = Mat4Translation({ position(rng), 0.0f, position(rng) });
+        bounds[i] = { {}, {}, { 0.0f, 0.0f, 0.0f }, radius(rng) };
+    }
+
+    float pixelsPerUnit = VIEW_HEIGHT / (2.0f * tanf(FOV_Y * 0.5f));
+    std::vector<float> screenSizes(MESH_COUNT);
+
+    for (float budgetFraction : BUDGETS)
+    {
+        TextureStreamer streamer;
+        streamer.meshes = meshes;
+        streamer.settings.budgetBytes = budgetFraction ? (uint64_t)(result.peakWantedMb * budgetFraction * 1024.0 * 1024.0) : UINT64_MAX;
+
+        TextureStreamingBenchmarkRun& run = result.runs.emplace_back();
+        run = {};
+        run.budgetFraction = budgetFraction;
+
+        std::deque<std::pair<uint32_t, StreamingRequest>> reads; // finishing frame and request
+        std::vector<StreamingRequest> requests;
+        std::vector<uint32_t> evicted;
+        Arena scratch;
+
+        for (uint32_t frame = 0; frame < FRAMES; frame++)
+        {
+            // circling the field looking along the path, everything in a cone ahead within view distance is visible
+            float angle = frame * 6.2831853f / FRAMES;
+            Vec3 camera = { cosf(angle) * FIELD_SIZE * 0.35f, 2.0f, sinf(angle) * FIELD_SIZE * 0.35f };
+            Vec3 forward = { -sinf(angle), 0.0f, cosf(angle) };
+
+            for (uint32_t i = 0; i < MESH_COUNT; i++)
+            {
+                Vec3 toMesh = Vec3 { instances[i].model.m[3][0], 0.0f, instances[i].model.m[3][2] } - camera;
+                float distance = Length(toMesh);
+                bool visible = distance < VIEW_DISTANCE && Dot(toMesh, forward) > distance * 0.5f - bounds[i].radius;
+                screenSizes[i] = visible ? GetStreamingScreenSize(camera, pixelsPerUnit, bounds[i], &instances[i], 1) : 0.0f;
+            }
+
+            while (!reads.empty() && reads.front().first <= frame)
+            {
+                CompleteStreamingRequest(streamer, reads.front().second);
+                reads.pop_front();
+            }
+
+            scratch.Reset();
+            UpdateTextureStreaming(streamer, screenSizes.data(), scratch, requests, evicted);
+            for (const StreamingRequest& request : requests)
+                reads.push_back({ frame + READ_FRAMES, request });
+
+            const TextureStreamingStats& stats = streamer.stats;
+            result.peakWantedMb = std::max(result.peakWantedMb, stats.wantedBytes / (1024.0 * 1024.0));
+            run.avgResidentMb += stats.residentBytes / (1024.0 * 1024.0) / FRAMES;
+            run.peakReservedMb = std::max(run.peakReservedMb, stats.reservedBytes / (1024.0 * 1024.0));
+            run.budgetOverruns += stats.reservedBytes > streamer.settings.budgetBytes ? 1 : 0;
+            run.blurryFrames += stats.blurryMeshes;
+            run.requests += stats.requests;
+            run.evictions += stats.evictions;
+            run.ms += stats.ms / FRAMES;
+        }
+    }
+}
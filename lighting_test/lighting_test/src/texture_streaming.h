@@ -0,0 +1,133 @@
+#pragma once
+
+#include "arena.h"
+#include "mesh.h"
+#include "scene.h"
+#include "texture_cache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// textures stream per mesh: every texture of a mesh leaves out the same number of top levels so its texture arrays
+// pack the same way at every residency (see texture_atlas.h). levels of STREAMING_TAIL_SIZE texels or less are always
+// resident, the ones above are requested once the mesh covers enough of the screen to show them and read on a thread
+// of their own. resident levels are kept under a byte budget, when a request does not fit the meshes that were not
+// looked at for the longest give back the levels they do not need first. the policy is plain cpu code the app drives,
+// the renderer only gets the trimmed views
+
+constexpr uint32_t STREAMING_TAIL_SIZE = 64;
+
+struct StreamingMesh
+{
+    uint32_t topSize = 0;    // width or height of the biggest level of the biggest texture
+    uint32_t maxDrop = 0;    // top levels the biggest texture can leave out, smaller ones leave out fewer
+    uint64_t bytes[MAX_TEXTURE_LEVELS] = {}; // of every texture with d top levels left out
+
+    uint32_t residentDrop = 0;   // what the renderer has, starts with the tail only
+    uint32_t requestedDrop = 0;  // in flight when below residentDrop
+    uint32_t wantedDrop = 0;     // for this frame's screen size
+    uint64_t lastUsedFrame = 0;  // last frame an instance was visible
+};
+
+// sizes and formats of the mesh's textures, null ones are left out
+void InitStreamingMesh(const TextureView* const* textures, uint32_t count, StreamingMesh& out);
+
+// view of the levels a texture has with drop top levels left out, never past its tail
+TextureView TrimTextureView(const TextureView& view, uint32_t drop);
+
+// pixels across the nearest of the instances' bounding spheres, 0 when there are none. pixelsPerUnit is
+// viewHeight / (2 tan(fovY / 2))
+float GetStreamingScreenSize(const Vec3& camera, float pixelsPerUnit, const SubMeshBounds& bounds, const InstanceData* instances, uint32_t count);
+
+struct TextureStreamingSettings
+{
+    uint64_t budgetBytes = 128ull << 20;
+    float mipBias = 0.0f; // added to the wanted level, positive streams less
+};
+
+// read drop's levels of a mesh, the ones in [drop, fromDrop)
+struct StreamingRequest
+{
+    uint32_t mesh;
+    uint32_t drop;
+    uint32_t fromDrop;
+};
+
+struct TextureStreamingStats
+{
+    uint64_t residentBytes = 0;  // what the renderer has
+    uint64_t reservedBytes = 0;  // resident and in flight, what the budget is checked against
+    uint64_t wantedBytes = 0;    // if every mesh had what it wants
+    uint32_t requests = 0;       // this frame
+    uint32_t evictions = 0;      // meshes that gave back levels this frame
+    uint32_t inFlight = 0;
+    uint32_t blurryMeshes = 0;   // visible with fewer levels than they want
+    float ms = 0.0f;
+};
+
+struct TextureStreamer
+{
+    TextureStreamingSettings settings;
+    std::vector<StreamingMesh> meshes;
+    uint64_t frameIndex = 0;
+    TextureStreamingStats stats;
+};
+
+// one frame of the policy. screenSizes has a size per mesh, 0 when not visible. gives back the levels over budget,
+// least recently used first, then asks for what the visible meshes miss, biggest shortfall first, evicting what others
+// hold and do not need to make room. meshes that gave back levels go to outEvicted and must be trimmed right away,
+// requests in flight are never evicted. the sorted lists are built in scratch
+void UpdateTextureStreaming(TextureStreamer& streamer, const float* screenSizes, Arena& scratch, std::vector<StreamingRequest>& outRequests,
+    std::vector<uint32_t>& outEvicted);
+
+// the request's levels were read, the mesh has them from now on
+void CompleteStreamingRequest(TextureStreamer& streamer, const StreamingRequest& request);
+
+// touches every page of the levels [firstLevel, endLevel) so a mapped dds is in memory before the renderer uploads it
+uint64_t PrefetchTextureLevels(const TextureView& view, uint32_t firstLevel, uint32_t endLevel);
+
+// a thread that reads requests one after the other, the frame only hands them over and collects what is done
+struct StreamingIo
+{
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<StreamingRequest> pending;
+    std::vector<StreamingRequest> done;
+    bool quit = false;
+};
+
+void StartStreamingIo(StreamingIo& io, const std::function<void(const StreamingRequest&)>& read);
+void StopStreamingIo(StreamingIo& io);
+void SubmitStreamingRequests(StreamingIo& io, const std::vector<StreamingRequest>& requests);
+void CollectStreamingRequests(StreamingIo& io, std::vector<StreamingRequest>& outDone);
+
+struct TextureStreamingBenchmarkRun
+{
+    float budgetFraction;     // of peakWantedMb, 0 for no budget
+    double avgResidentMb;
+    double peakReservedMb;
+    uint32_t budgetOverruns;  // frames reserved went over the budget, should be 0
+    uint32_t blurryFrames;    // visible meshes missing levels, summed over the frames
+    uint32_t requests;
+    uint32_t evictions;
+    double ms;                // UpdateTextureStreaming per frame
+};
+
+struct TextureStreamingBenchmarkResult
+{
+    uint32_t meshCount;
+    uint32_t frames;
+    double fullMb;            // every texture at full detail, what loading everything keeps
+    double tailMb;            // only the levels always resident
+    double peakWantedMb;      // the most the camera path needs at once, found by the run without a budget
+    std::vector<TextureStreamingBenchmarkRun> runs;
+};
+
+// random meshes with a few textures each along a camera path, reads finish a few frames after the request. run at
+// a few budgets
+void RunTextureStreamingBenchmark(TextureStreamingBenchmarkResult& result);
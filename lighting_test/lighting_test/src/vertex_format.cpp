@@ -0,0 +1,273 @@
+#include "vertex_format.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+uint32_t GetVertexStride(VertexFormat format)
+{
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(MeshVertex);
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // nan and inf
+    if (((bits >> 23) & 0xff) == 0xff)
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+    // overflow to inf
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00);
+
+    // denormals, round to nearest
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return (uint16_t)sign;
+
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    // normals, round to nearest even, a mantissa carry correctly bumps the exponent
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        half++;
+
+    return (uint16_t)half;
+}
+
+float HalfToFloat(uint16_t value)
+{
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // renormalize the denormal
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else if (exponent == 31)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+static float SignNotZero(float x)
+{
+    return x >= 0.0f ? 1.0f : -1.0f;
+}
+
+void EncodeOctahedral(const Vec3& normal, uint32_t bits, int32_t outEncoded[2])
+{
+    float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+    if (l1 <= 0.0f)
+    {
+        outEncoded[0] = outEncoded[1] = 0;
+        return;
+    }
+
+    float x = normal.x / l1;
+    float y = normal.y / l1;
+
+    // fold the lower hemisphere over the diagonals
+    if (normal.z < 0.0f)
+    {
+        float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+        float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    float maxValue = (float)((1 << (bits - 1)) - 1);
+    outEncoded[0] = (int32_t)lroundf(x * maxValue);
+    outEncoded[1] = (int32_t)lroundf(y * maxValue);
+}
+
+Vec3 DecodeOctahedral(const int32_t encoded[2], uint32_t bits)
+{
+    // same math as the vertex shader, snorm decode clamps -max-1 to -1
+    float maxValue = (float)((1 << (bits - 1)) - 1);
+    float x = fmaxf(encoded[0] / maxValue, -1.0f);
+    float y = fmaxf(encoded[1] / maxValue, -1.0f);
+    float z = 1.0f - fabsf(x) - fabsf(y);
+
+    float t = fmaxf(-z, 0.0f);
+    x += x >= 0.0f ? -t : t;
+    y += y >= 0.0f ? -t : t;
+
+    float length = sqrtf(x * x + y * y + z * z);
+    if (length <= 0.0f)
+        return { 0.0f, 0.0f, 1.0f };
+
+    return { x / length, y / length, z / length };
+}
+
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, uint32_t vertexCount)
+{
+    Vec3 minPos = { 1e30f, 1e30f, 1e30f };
+    Vec3 maxPos = { -1e30f, -1e30f, -1e30f };
+
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        const Vec3& p = vertices[i].pos;
+        minPos = { fminf(minPos.x, p.x), fminf(minPos.y, p.y), fminf(minPos.z, p.z) };
+        maxPos = { fmaxf(maxPos.x, p.x), fmaxf(maxPos.y, p.y), fmaxf(maxPos.z, p.z) };
+    }
+
+    if (vertexCount == 0)
+        minPos = maxPos = { 0.0f, 0.0f, 0.0f };
+
+    // flat axes still need a non zero scale to stay invertible
+    VertexQuantization quantization;
+    quantization.posOffset = minPos;
+    quantization.posScale.x = maxPos.x > minPos.x ? maxPos.x - minPos.x : 1.0f;
+    quantization.posScale.y = maxPos.y > minPos.y ? maxPos.y - minPos.y : 1.0f;
+    quantization.posScale.z = maxPos.z > minPos.z ? maxPos.z - minPos.z : 1.0f;
+    return quantization;
+}
+
+static uint16_t QuantizeUnorm16(float value, float offset, float scale)
+{
+    float normalized = (value - offset) / scale;
+    normalized = normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+    return (uint16_t)lroundf(normalized * 65535.0f);
+}
+
+PackedVertex PackVertex(const MeshVertex& vertex, const VertexQuantization& quantization)
+{
+    PackedVertex packed;
+    packed.pos[0] = QuantizeUnorm16(vertex.pos.x, quantization.posOffset.x, quantization.posScale.x);
+    packed.pos[1] = QuantizeUnorm16(vertex.pos.y, quantization.posOffset.y, quantization.posScale.y);
+    packed.pos[2] = QuantizeUnorm16(vertex.pos.z, quantization.posOffset.z, quantization.posScale.z);
+    packed.pos[3] = 0;
+
+    int32_t normal[2];
+    EncodeOctahedral(vertex.normal, 16, normal);
+    packed.normal[0] = (int16_t)normal[0];
+    packed.normal[1] = (int16_t)normal[1];
+
+    packed.textureCoords[0] = FloatToHalf(vertex.textureCoords.x);
+    packed.textureCoords[1] = FloatToHalf(vertex.textureCoords.y);
+
+    return packed;
+}
+
+MeshVertex UnpackVertex(const PackedVertex& vertex, const VertexQuantization& quantization)
+{
+    MeshVertex unpacked;
+    unpacked.pos.x = vertex.pos[0] / 65535.0f * quantization.posScale.x + quantization.posOffset.x;
+    unpacked.pos.y = vertex.pos[1] / 65535.0f * quantization.posScale.y + quantization.posOffset.y;
+    unpacked.pos.z = vertex.pos[2] / 65535.0f * quantization.posScale.z + quantization.posOffset.z;
+
+    int32_t normal[2] = { vertex.normal[0], vertex.normal[1] };
+    unpacked.normal = DecodeOctahedral(normal, 16);
+
+    unpacked.textureCoords.x = HalfToFloat(vertex.textureCoords[0]);
+    unpacked.textureCoords.y = HalfToFloat(vertex.textureCoords[1]);
+
+    return unpacked;
+}
+
+bool CanPackVertices(const MeshVertex* vertices, uint32_t vertexCount)
+{
+    for (uint32_t i = 0; i < vertexCount; i++)
+        if (fabsf(vertices[i].textureCoords.x) > MAX_PACKED_UV || fabsf(vertices[i].textureCoords.y) > MAX_PACKED_UV)
+            return false;
+
+    return true;
+}
+
+VertexPackingError MeasurePackingError(const MeshVertex* vertices, uint32_t vertexCount, const VertexQuantization& quantization)
+{
+    constexpr float TO_DEGREES = 180.0f / 3.14159265358979f;
+
+    VertexPackingError error = {};
+
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        const MeshVertex& original = vertices[i];
+        MeshVertex roundTrip = UnpackVertex(PackVertex(original, quantization), quantization);
+
+        error.position = fmaxf(error.position, fabsf(roundTrip.pos.x - original.pos.x));
+        error.position = fmaxf(error.position, fabsf(roundTrip.pos.y - original.pos.y));
+        error.position = fmaxf(error.position, fabsf(roundTrip.pos.z - original.pos.z));
+
+        // obj files without normals leave them zeroed, nothing to compare against
+        const Vec3& n = original.normal;
+        float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (length > 0.0f)
+        {
+            // atan2 of sine and cosine, acosf alone loses a few hundredths of a degree near 1
+            const Vec3& m = roundTrip.normal;
+            float sine = sqrtf((n.y * m.z - n.z * m.y) * (n.y * m.z - n.z * m.y) + (n.z * m.x - n.x * m.z) * (n.z * m.x - n.x * m.z) +
+                (n.x * m.y - n.y * m.x) * (n.x * m.y - n.y * m.x));
+            float cosine = n.x * m.x + n.y * m.y + n.z * m.z;
+            error.normalDegrees = fmaxf(error.normalDegrees, atan2f(sine, cosine) * TO_DEGREES);
+        }
+
+        error.textureCoords = fmaxf(error.textureCoords, fabsf(roundTrip.textureCoords.x - original.textureCoords.x));
+        error.textureCoords = fmaxf(error.textureCoords, fabsf(roundTrip.textureCoords.y - original.textureCoords.y));
+    }
+
+    return error;
+}
+
+float GetMaxPackedPositionError(const VertexQuantization& quantization)
+{
+    const float offsets[3] = { quantization.posOffset.x, quantization.posOffset.y, quantization.posOffset.z };
+    const float scales[3] = { quantization.posScale.x, quantization.posScale.y, quantization.posScale.z };
+
+    float bound = 0.0f;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        float offset = offsets[axis];
+        float scale = scales[axis];
+        float magnitude = fmaxf(fabsf(offset), fabsf(offset + scale)) + scale;
+        bound = fmaxf(bound, scale * 0.5f / 65535.0f + 4.0f * FLT_EPSILON * magnitude);
+    }
+    return bound;
+}
+
+bool IsPackingErrorWithinBounds(const VertexPackingError& error, const VertexQuantization& quantization)
+{
+    return error.position <= GetMaxPackedPositionError(quantization) && error.normalDegrees <= MAX_PACKED_NORMAL_DEGREES &&
+        error.textureCoords <= MAX_PACKED_UV_ERROR;
+}
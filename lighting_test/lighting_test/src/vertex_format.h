@@ -0,0 +1,74 @@
+#pragma once
+
+#include "core.h"
+
+struct MeshVertex
+{
+    Vec3 pos; // xyz
+    Vec3 normal;
+    Vec2 textureCoords; // uv
+};
+
+enum class VertexFormat : uint32_t
+{
+    Full,   // MeshVertex, 32 bytes
+    Packed, // PackedVertex, 16 bytes
+};
+
+// R16G16B16A16_UNORM position relative to the mesh bounds (w unused),
+// R16G16_SNORM octahedral normal, R16G16_FLOAT uv
+struct PackedVertex
+{
+    uint16_t pos[4];
+    int16_t normal[2];
+    uint16_t textureCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// pos = unorm * scale + offset
+struct VertexQuantization
+{
+    Vec3 posOffset;
+    Vec3 posScale;
+};
+
+// largest round trip error seen over a mesh
+struct VertexPackingError
+{
+    float position;      // world units
+    float normalDegrees;
+    float textureCoords; // uv units
+};
+
+// half floats lose sub-texel precision beyond this uv magnitude (2^-11 relative, ~0.0039 at 8)
+constexpr float MAX_PACKED_UV = 8.0f;
+
+uint32_t GetVertexStride(VertexFormat format);
+
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// octahedral normal encoding into two signed normalized integers of `bits` bits (8 or 16)
+void EncodeOctahedral(const Vec3& normal, uint32_t bits, int32_t outEncoded[2]);
+Vec3 DecodeOctahedral(const int32_t encoded[2], uint32_t bits);
+
+VertexQuantization ComputeVertexQuantization(const MeshVertex* vertices, uint32_t vertexCount);
+
+PackedVertex PackVertex(const MeshVertex& vertex, const VertexQuantization& quantization);
+MeshVertex UnpackVertex(const PackedVertex& vertex, const VertexQuantization& quantization);
+
+// the packed layout is only picked when the uvs fit half floats
+bool CanPackVertices(const MeshVertex* vertices, uint32_t vertexCount);
+
+VertexPackingError MeasurePackingError(const MeshVertex* vertices, uint32_t vertexCount, const VertexQuantization& quantization);
+
+// what a round trip may lose, the packing tests fail past these. half a snorm16 step of the octahedron turns a normal
+// by about 0.004 degrees at worst
+constexpr float MAX_PACKED_NORMAL_DEGREES = 0.01f;
+constexpr float MAX_PACKED_UV_ERROR = MAX_PACKED_UV / 2048.0f; // half of a half float step at MAX_PACKED_UV
+
+// half a unorm16 step of the widest axis plus the float rounding of the decode
+float GetMaxPackedPositionError(const VertexQuantization& quantization);
+
+bool IsPackingErrorWithinBounds(const VertexPackingError& error, const VertexQuantization& quantization);
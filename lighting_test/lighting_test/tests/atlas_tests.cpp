@@ -0,0 +1,180 @@
+#include "test.h"
+#include "texture_atlas.h"
+
+#include <algorithm>
+#include <random>
+
+// sizes and formats only, packing never looks at the texels
+static TextureView MakeView(TextureFormat format, uint32_t width, uint32_t height)
+{
+    TextureView view = {};
+    view.format = format;
+    while (view.levelCount < MAX_TEXTURE_LEVELS && (width >> view.levelCount || height >> view.levelCount))
+    {
+        view.levels[view.levelCount] = { std::max(width >> view.levelCount, 1u), std::max(height >> view.levelCount, 1u), 0, nullptr };
+        view.levelCount++;
+    }
+    return view;
+}
+
+static std::vector<const TextureView*> Pointers(const std::vector<TextureView>& views)
+{
+    std::vector<const TextureView*> textures;
+    for (const TextureView& view : views)
+        textures.push_back(&view);
+    return textures;
+}
+
+// every texture placed inside its page, atlas rects apart by their gutters, used texels what the placements cover
+static void ExpectValidPacking(const std::vector<const TextureView*>& textures, const PackedTextures& packed)
+{
+    EXPECT(packed.placements.size() == textures.size());
+
+    std::vector<uint64_t> used(packed.arrays.size(), 0);
+    for (size_t i = 0; i < packed.placements.size(); i++)
+    {
+        const TexturePlacement& placement = packed.placements[i];
+        if (!textures[i])
+        {
+            EXPECTF(placement.array == -1, "texture %zu", i);
+            continue;
+        }
+
+        if (placement.array < 0 || placement.array >= (int32_t)packed.arrays.size())
+        {
+            EXPECTF(false, "texture %zu in array %d", i, placement.array);
+            continue;
+        }
+
+        const TextureArrayLayout& layout = packed.arrays[placement.array];
+        EXPECTF(layout.format == textures[i]->format, "texture %zu", i);
+        EXPECTF(placement.width == textures[i]->levels[0].width && placement.height == textures[i]->levels[0].height, "texture %zu", i);
+        EXPECTF(placement.layer < layout.layerCount, "texture %zu", i);
+        EXPECTF(placement.x + placement.width <= layout.width && placement.y + placement.height <= layout.height, "texture %zu", i);
+        EXPECTF(placement.levelCount <= textures[i]->levelCount && placement.levelCount <= layout.levelCount, "texture %zu", i);
+        used[placement.array] += (uint64_t)placement.width * placement.height;
+
+        for (size_t j = 0; j < i; j++)
+        {
+            const TexturePlacement& other = packed.placements[j];
+            if (other.array != placement.array || other.layer != placement.layer)
+                continue;
+
+            // a whole layer has its layer to itself, atlas rects keep a gutter on every side
+            uint32_t gutter = placement.wholeLayer || other.wholeLayer ? 0 : layout.gutter;
+            bool apart = placement.x >= other.x + other.width + gutter || other.x >= placement.x + placement.width + gutter ||
+                placement.y >= other.y + other.height + gutter || other.y >= placement.y + placement.height + gutter;
+            EXPECTF(apart && !placement.wholeLayer && !other.wholeLayer, "textures %zu and %zu overlap", j, i);
+        }
+    }
+
+    for (size_t i = 0; i < packed.arrays.size(); i++)
+        EXPECTF(packed.arrays[i].usedTexels == used[i], "array %zu", i);
+}
+
+static void TestSameSize()
+{
+    std::vector<TextureView> views(3, MakeView(TextureFormat::BC7, 512, 512));
+    std::vector<const TextureView*> textures = Pointers(views);
+
+    PackedTextures packed;
+    PackTextures(textures.data(), (uint32_t)textures.size(), packed);
+    ExpectValidPacking(textures, packed);
+
+    EXPECT(packed.arrays.size() == 1);
+    EXPECT(packed.arrays[0].layerCount == 3);
+    EXPECT(packed.arrays[0].levelCount == 10);
+    EXPECT(packed.arrays[0].gutter == 0);
+    for (const TexturePlacement& placement : packed.placements)
+        EXPECT(placement.wholeLayer && placement.levelCount == 10);
+    EXPECT(GetTextureOccupancy(packed) == 1.0f);
+}
+
+static void TestPages()
+{
+    // four whole layers, sixteen 256 rects with a 32 texel gutter go nine to a page: six layers, five of them covered
+    std::vector<TextureView> views;
+    for (uint32_t i = 0; i < 4; i++)
+        views.push_back(MakeView(TextureFormat::BC1, 1024, 1024));
+    for (uint32_t i = 0; i < 16; i++)
+        views.push_back(MakeView(TextureFormat::BC1, 256, 256));
+    std::vector<const TextureView*> textures = Pointers(views);
+
+    PackedTextures packed;
+    PackTextures(textures.data(), (uint32_t)textures.size(), packed);
+    ExpectValidPacking(textures, packed);
+
+    EXPECT(packed.arrays.size() == 1);
+    EXPECT(packed.arrays[0].layerCount == 6);
+    EXPECT(packed.arrays[0].gutter == 32);
+    EXPECT(packed.arrays[0].levelCount == 11);
+    for (uint32_t i = 4; i < 20; i++)
+        EXPECT(!packed.placements[i].wholeLayer && packed.placements[i].levelCount == MAX_ATLAS_LEVELS);
+
+    float occupancy = GetTextureOccupancy(packed);
+    EXPECTF(occupancy > 0.833f && occupancy < 0.834f, "occupancy %.4f", occupancy);
+}
+
+static void TestFormatsAndNulls()
+{
+    std::vector<TextureView> views = { MakeView(TextureFormat::RGBA8, 66, 6), MakeView(TextureFormat::BC3, 128, 64), MakeView(TextureFormat::RGBA8, 32, 32) };
+    std::vector<const TextureView*> textures = Pointers(views);
+    textures.insert(textures.begin() + 1, nullptr);
+
+    PackedTextures packed;
+    PackTextures(textures.data(), (uint32_t)textures.size(), packed);
+    ExpectValidPacking(textures, packed);
+
+    // one array per format, atlas only pages are sized to the biggest rect and its gutter
+    EXPECT(packed.arrays.size() == 2);
+    EXPECT(packed.placements[0].array == packed.placements[3].array);
+    EXPECT(packed.placements[0].array != packed.placements[2].array);
+    EXPECT(packed.placements[2].wholeLayer);
+}
+
+static void TestRandom()
+{
+    // what the atlas benchmark packs
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<uint32_t> sizeShift(4, 10);
+    std::uniform_int_distribution<uint32_t> oddSize(8, 700);
+    std::uniform_int_distribution<uint32_t> formatIndex(0, MAX_TEXTURE_ARRAYS - 1);
+    std::uniform_int_distribution<uint32_t> percent(0, 99);
+
+    std::vector<TextureView> views;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t chance = percent(rng);
+        uint32_t width, height;
+        if (chance < 20)
+            width = height = 1024;
+        else if (chance < 80)
+            width = height = 1u << sizeShift(rng);
+        else
+        {
+            width = oddSize(rng);
+            height = oddSize(rng);
+        }
+
+        views.push_back(MakeView((TextureFormat)formatIndex(rng), width, height));
+    }
+    std::vector<const TextureView*> textures = Pointers(views);
+
+    PackedTextures packed;
+    PackTextures(textures.data(), (uint32_t)textures.size(), packed);
+    ExpectValidPacking(textures, packed);
+
+    EXPECT(packed.arrays.size() == MAX_TEXTURE_ARRAYS);
+
+    // 82% when this was written, a packing change that loses more than a few points should be looked at
+    float occupancy = GetTextureOccupancy(packed);
+    EXPECTF(occupancy >= 0.80f, "occupancy %.4f", occupancy);
+}
+
+void TestAtlas()
+{
+    TestSameSize();
+    TestPages();
+    TestFormatsAndNulls();
+    TestRandom();
+}
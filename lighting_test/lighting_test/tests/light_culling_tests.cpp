@@ -0,0 +1,103 @@
+#include "test.h"
+#include "light_culling.h"
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+
+static std::vector<PointLight> MakeLights(uint32_t count, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+    std::uniform_real_distribution<float> radius(0.05f, 8.0f);
+
+    std::vector<PointLight> lights(count);
+    for (PointLight& light : lights)
+        light = { { spread(rng), spread(rng) * 0.5f, spread(rng) }, radius(rng), { 1.0f, 1.0f, 1.0f }, 1.0f };
+    return lights;
+}
+
+static void TestAgainstBruteForce()
+{
+    JobSystem jobs;
+    Arena scratch;
+    LightClusters clusters;
+
+    ClusterProjection projection = { 60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f, 1600, 900 };
+
+    struct Case
+    {
+        uint32_t lightCount;
+        Vec3 eye;
+        Vec3 direction;
+    };
+
+    const Case cases[] =
+    {
+        { 0, { 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 1.0f } },
+        { 1, { 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 1.0f } },
+        { 7, { 3.0f, 1.0f, 2.0f }, { -1.0f, -0.2f, 0.5f } },
+        { 1024, { 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 1.0f } },
+        { 1024, { 10.0f, 4.0f, 10.0f }, { -1.0f, -0.3f, -1.0f } },
+    };
+
+    for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        std::vector<PointLight> lights = MakeLights(cases[c].lightCount, 1000 + c);
+        Mat4 view = Mat4LookToLH(cases[c].eye, Normalize(cases[c].direction), { 0.0f, 1.0f, 0.0f });
+
+        scratch.Reset();
+        BuildLightClusters(jobs, lights.data(), (uint32_t)lights.size(), view, projection, scratch, clusters);
+
+        EXPECT(clusters.clusters.size() == CLUSTER_COUNT * 2);
+        uint32_t mismatches = CheckLightClusters(lights.data(), (uint32_t)lights.size(), view, projection, clusters);
+        EXPECTF(mismatches == 0, "%u lights, case %u: %u mismatches", cases[c].lightCount, c, mismatches);
+
+        uint32_t most = 0;
+        for (uint32_t i = 0; i < CLUSTER_COUNT; i++)
+            most = std::max(most, clusters.clusters[i * 2 + 1]);
+        EXPECT(most == clusters.maxLightsPerCluster);
+    }
+}
+
+static void TestPixelsFindTheirLights()
+{
+    // what the pixel shader does: the cluster of the pixel a light's center lands on has that light
+    JobSystem jobs;
+    Arena scratch;
+    LightClusters clusters;
+
+    ClusterProjection projection = { 60.0f * TO_RADIANS, 16.0f / 9.0f, 0.01f, 1000.0f, 1600, 900 };
+    Mat4 view = Mat4LookToLH({ 0.0f, 0.0f, -5.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f });
+
+    std::vector<PointLight> lights = MakeLights(256, 7);
+    BuildLightClusters(jobs, lights.data(), (uint32_t)lights.size(), view, projection, scratch, clusters);
+
+    float tanHalfFov = tanf(projection.fovRadians * 0.5f);
+    uint32_t checked = 0;
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        Vec4 center = Vec4Transform({ lights[i].position.x, lights[i].position.y, lights[i].position.z, 1.0f }, view);
+        if (center.z < projection.nearZ)
+            continue;
+
+        float x = (center.x / (center.z * tanHalfFov * projection.aspect) * 0.5f + 0.5f) * projection.width;
+        float y = (0.5f - center.y / (center.z * tanHalfFov) * 0.5f) * projection.height;
+        if (x < 0.0f || y < 0.0f || x >= projection.width || y >= projection.height)
+            continue;
+
+        uint32_t cluster = GetClusterIndex(clusters.constants, x, y, center.z);
+        const uint32_t* first = clusters.lightIndices.data() + clusters.clusters[cluster * 2 + 0];
+        const uint32_t* last = first + clusters.clusters[cluster * 2 + 1];
+        EXPECTF(std::find(first, last, i) != last, "light %u not in cluster %u", i, cluster);
+        checked++;
+    }
+
+    EXPECT(checked > 0);
+}
+
+void TestLightCulling()
+{
+    TestAgainstBruteForce();
+    TestPixelsFindTheirLights();
+}
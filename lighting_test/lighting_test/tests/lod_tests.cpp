@@ -0,0 +1,120 @@
+#include "test.h"
+#include "mesh_lod.h"
+
+#include <math.h>
+#include <algorithm>
+#include <filesystem>
+
+static float GetArea(const MeshVertex* vertices, const uint32_t* indices, uint32_t indexCount)
+{
+    float area = 0.0f;
+    for (uint32_t i = 0; i < indexCount; i += 3)
+    {
+        const Vec3& a = vertices[indices[i + 0]].pos;
+        const Vec3& b = vertices[indices[i + 1]].pos;
+        const Vec3& c = vertices[indices[i + 2]].pos;
+        area += 0.5f * Length(Cross(b - a, c - a));
+    }
+    return area;
+}
+
+static void TestFlatGrid()
+{
+    // a plane loses nothing to simplification down to a quarter of its faces: no error, the same area, no face turned
+    // over. further down the collapses left may cut the corners, the error has to say so
+    constexpr uint32_t SIZE = 16;
+
+    std::vector<MeshVertex> vertices;
+    for (uint32_t y = 0; y <= SIZE; y++)
+    {
+        for (uint32_t x = 0; x <= SIZE; x++)
+            vertices.push_back({ { (float)x, (float)y, 0.0f }, { 0.0f, 0.0f, 1.0f }, { (float)x / SIZE, (float)y / SIZE } });
+    }
+
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y < SIZE; y++)
+    {
+        for (uint32_t x = 0; x < SIZE; x++)
+        {
+            uint32_t i = y * (SIZE + 1) + x;
+            indices.insert(indices.end(), { i, i + 1, i + SIZE + 2, i, i + SIZE + 2, i + SIZE + 1 });
+        }
+    }
+
+    for (uint32_t target : { (uint32_t)indices.size() / 2, (uint32_t)indices.size() / 4, (uint32_t)indices.size() / 8, (uint32_t)indices.size() / 16 })
+    {
+        std::vector<uint32_t> simplified(indices.size());
+        float error = -1.0f;
+        uint32_t count = SimplifyIndices(vertices.data(), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size(), target,
+            simplified.data(), error);
+
+        EXPECTF(count <= target && count > 0 && count % 3 == 0, "%u indices for a target of %u", count, target);
+
+        float area = GetArea(vertices.data(), simplified.data(), count);
+        bool lossless = fabsf(area - SIZE * SIZE) < 1e-3f;
+        if (target >= indices.size() / 4)
+            EXPECTF(lossless, "area %f, %u indices", area, count);
+
+        if (lossless)
+            EXPECTF(error >= 0.0f && error < 1e-5f, "error %g, %u indices", error, count);
+        else
+            EXPECTF(error >= 0.1f, "area %f but error %g, %u indices", area, error, count);
+
+        for (uint32_t i = 0; i < count; i += 3)
+        {
+            const Vec3& a = vertices[simplified[i + 0]].pos;
+            const Vec3& b = vertices[simplified[i + 1]].pos;
+            const Vec3& c = vertices[simplified[i + 2]].pos;
+            EXPECTF(Cross(b - a, c - a).z > 0.0f, "triangle %u turned over", i / 3);
+        }
+    }
+}
+
+static void TestMeshes()
+{
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("meshes", error))
+    {
+        if (entry.path().extension() == ".obj")
+            paths.push_back(entry.path().generic_string());
+    }
+    std::sort(paths.begin(), paths.end());
+    EXPECTF(!paths.empty(), "meshes in %s", std::filesystem::current_path().generic_string().c_str());
+
+    JobSystem jobs;
+    std::vector<LodBenchmarkCase> cases;
+    RunLodBenchmark(jobs, paths, cases);
+    EXPECT(cases.size() == paths.size());
+
+    for (const LodBenchmarkCase& bench : cases)
+    {
+        const char* path = bench.path.c_str();
+        EXPECTF(bench.levels.size() > 1 && bench.levels.size() <= MAX_MESH_LODS, "%s: %zu levels", path, bench.levels.size());
+        if (bench.levels.empty())
+            continue;
+
+        EXPECTF(bench.levels[0].error == 0.0f && bench.levels[0].measuredError == 0.0f, "%s", path);
+
+        for (size_t level = 1; level < bench.levels.size(); level++)
+        {
+            const LodBenchmarkLevel& coarse = bench.levels[level];
+            const LodBenchmarkLevel& fine = bench.levels[level - 1];
+
+            // every level aims for half the triangles of the one before and is allowed at least its error
+            EXPECTF(coarse.triangles * 2 <= fine.triangles + 2, "%s level %zu: %u triangles after %u", path, level, coarse.triangles, fine.triangles);
+            EXPECTF(coarse.error >= fine.error, "%s level %zu: error %f after %f", path, level, coarse.error, fine.error);
+
+            // the reported error is the farthest any source vertex is from the level, the samples are some of them.
+            // lod selection trusts this bound, only float rounding may differ
+            float bound = coarse.error + 1e-5f * bench.radius;
+            EXPECTF(coarse.measuredError <= bound, "%s level %zu: measured %f, reported %f", path, level, coarse.measuredError, coarse.error);
+        }
+    }
+}
+
+void TestLods()
+{
+    TestFlatGrid();
+    TestMeshes();
+}
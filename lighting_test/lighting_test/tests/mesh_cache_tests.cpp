@@ -0,0 +1,104 @@
+#include "test.h"
+#include "jobs.h"
+#include "mesh_cache.h"
+
+#include <string.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+static std::vector<uint8_t> ReadBytes(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteBytes(const std::string& path, const std::vector<uint8_t>& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)bytes.data(), bytes.size());
+}
+
+static void TestCorruptCache()
+{
+    // a copy of the cube so the cache written next to it is the test's own
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "lighting_mesh_cache_tests";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+
+    std::string meshPath = (directory / "cube.obj").generic_string();
+    std::filesystem::copy_file("meshes/cube.obj", meshPath, error);
+    EXPECTF(!error, "copying meshes/cube.obj: %s", error.message().c_str());
+
+    JobSystem jobs;
+    EXPECT(CookMesh(jobs, meshPath));
+
+    MeshCacheHeader header = {};
+    {
+        MappedFile file;
+        MeshView view;
+        EXPECT(MapMeshCache(meshPath, file, view));
+        if (!file.data)
+            return;
+
+        header = *(const MeshCacheHeader*)file.data;
+    }
+
+    EXPECTF(header.lodCount > 0 && header.meshletCount > 0, "%u levels, %u meshlets", header.lodCount, header.meshletCount);
+
+    std::string cachePath = GetMeshCachePath(meshPath);
+    const std::vector<uint8_t> original = ReadBytes(cachePath);
+
+    size_t submeshes = sizeof(MeshCacheHeader);
+    size_t lodErrors = submeshes + header.submeshCount * (sizeof(SubMeshRange) + sizeof(SubMeshBounds));
+    size_t lodSubmeshes = lodErrors + header.lodCount * sizeof(float);
+    size_t meshlets = lodSubmeshes + header.lodCount * header.submeshCount * sizeof(SubMeshRange);
+    size_t meshletTable = meshlets + header.meshletCount * sizeof(Meshlet);
+    size_t indices = original.size() - header.indexCount * sizeof(uint32_t);
+
+    auto poke = [](std::vector<uint8_t>& bytes, size_t offset, uint32_t value) { memcpy(bytes.data() + offset, &value, sizeof(value)); };
+
+    // every edit keeps the header and the size right, only what the tables say is off
+    struct Corruption
+    {
+        const char* name;
+        std::function<void(std::vector<uint8_t>&)> apply;
+    };
+
+    const Corruption corruptions[] =
+    {
+        { "submesh past the indices", [&](std::vector<uint8_t>& bytes) { poke(bytes, submeshes + 4, header.indexCount + 3); } },
+        { "submesh offset past the indices", [&](std::vector<uint8_t>& bytes) { poke(bytes, submeshes, header.indexCount); } },
+        { "level past the indices", [&](std::vector<uint8_t>& bytes) { poke(bytes, lodSubmeshes, header.indexCount - 2); } },
+        { "level error not a number", [&](std::vector<uint8_t>& bytes) { poke(bytes, lodErrors, 0x7fc00000); } },
+        { "meshlet past the indices", [&](std::vector<uint8_t>& bytes) { poke(bytes, meshlets + 4, header.indexCount); } },
+        { "meshlet of another submesh", [&](std::vector<uint8_t>& bytes) { poke(bytes, meshlets + 12, header.submeshCount); } },
+        { "meshlet table past the meshlets", [&](std::vector<uint8_t>& bytes) { poke(bytes, meshletTable + 4 * header.submeshCount, header.meshletCount + 1); } },
+        { "index past the vertices", [&](std::vector<uint8_t>& bytes) { poke(bytes, indices + 4, header.vertexCount); } },
+    };
+
+    for (const Corruption& corruption : corruptions)
+    {
+        std::vector<uint8_t> bytes = original;
+        corruption.apply(bytes);
+        WriteBytes(cachePath, bytes);
+
+        MappedFile file;
+        MeshView view;
+        EXPECTF(!MapMeshCache(meshPath, file, view), "%s still maps", corruption.name);
+    }
+
+    WriteBytes(cachePath, original);
+    MappedFile file;
+    MeshView view;
+    EXPECT(MapMeshCache(meshPath, file, view));
+    file.Unmap();
+
+    std::filesystem::remove_all(directory, error);
+}
+
+void TestMeshCache()
+{
+    TestCorruptCache();
+}
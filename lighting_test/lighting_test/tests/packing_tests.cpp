@@ -0,0 +1,104 @@
+#include "test.h"
+#include "jobs.h"
+#include "mesh_cache.h"
+#include "simd_math.h"
+
+#include <math.h>
+#include <algorithm>
+#include <filesystem>
+#include <random>
+
+static void TestNormals()
+{
+    // the axes, the octahedron's edges and corners where the lower hemisphere folds, then random directions
+    std::vector<Vec3> normals =
+    {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+        { 1, 1, 0 }, { -1, 1, 0 }, { 1, -1, 0 }, { -1, -1, 0 }, { 1, 0, -1 }, { 0, -1, -1 },
+        { 1, 1, 1 }, { -1, -1, -1 }, { 1, -1, -1 }, { 0.001f, 0.001f, -1.0f }, { -0.001f, 0.0f, -1.0f },
+    };
+
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> gaussian;
+    for (uint32_t i = 0; i < 100000; i++)
+        normals.push_back({ gaussian(rng), gaussian(rng), gaussian(rng) });
+
+    std::vector<MeshVertex> vertices;
+    for (const Vec3& normal : normals)
+        vertices.push_back({ { 0.0f, 0.0f, 0.0f }, Normalize(normal), { 0.0f, 0.0f } });
+
+    VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), (uint32_t)vertices.size());
+    VertexPackingError error = MeasurePackingError(vertices.data(), (uint32_t)vertices.size(), quantization);
+    EXPECTF(error.normalDegrees <= MAX_PACKED_NORMAL_DEGREES, "normal %f degrees", error.normalDegrees);
+
+    // an axis lands on the grid, nothing is lost
+    MeshVertex axis = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } };
+    VertexPackingError exact = MeasurePackingError(&axis, 1, quantization);
+    EXPECT(exact.normalDegrees == 0.0f);
+}
+
+static void TestPositionsAndUvs()
+{
+    // bounds far from the origin and of very different sizes per axis
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<float> uv(-MAX_PACKED_UV, MAX_PACKED_UV);
+
+    const Vec3 offsets[] = { { 0.0f, 0.0f, 0.0f }, { -1000.0f, 250.0f, 3.0f }, { 0.5f, -0.25f, 8000.0f } };
+    const Vec3 sizes[] = { { 1.0f, 1.0f, 1.0f }, { 0.01f, 40.0f, 2.0f }, { 300.0f, 0.5f, 0.001f } };
+
+    for (uint32_t c = 0; c < 3; c++)
+    {
+        std::vector<MeshVertex> vertices;
+        for (uint32_t i = 0; i < 20000; i++)
+        {
+            Vec3 p = { offsets[c].x + sizes[c].x * unit(rng), offsets[c].y + sizes[c].y * unit(rng), offsets[c].z + sizes[c].z * unit(rng) };
+            vertices.push_back({ p, { 0.0f, 1.0f, 0.0f }, { uv(rng), uv(rng) } });
+        }
+
+        VertexQuantization quantization = ComputeVertexQuantization(vertices.data(), (uint32_t)vertices.size());
+        VertexPackingError error = MeasurePackingError(vertices.data(), (uint32_t)vertices.size(), quantization);
+        EXPECTF(IsPackingErrorWithinBounds(error, quantization), "case %u: pos %g of %g, uv %g", c, error.position,
+            GetMaxPackedPositionError(quantization), error.textureCoords);
+
+        // a bound loose enough to pass anything would not catch a broken quantization
+        EXPECTF(error.position > 0.25f * GetMaxPackedPositionError(quantization), "case %u: pos %g", c, error.position);
+    }
+}
+
+static void TestMeshes()
+{
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("meshes", error))
+    {
+        if (entry.path().extension() == ".obj")
+            paths.push_back(entry.path().generic_string());
+    }
+    std::sort(paths.begin(), paths.end());
+    EXPECT(!paths.empty());
+
+    JobSystem jobs;
+    Arena scratch(MESH_LOAD_ARENA_BLOCK_SIZE);
+    for (const std::string& path : paths)
+    {
+        scratch.Reset();
+        MeshData data;
+        EXPECTF(LoadMeshData(jobs, path, scratch, data), "%s", path.c_str());
+
+        PackMeshVertices(data);
+        if (data.vertexFormat != VertexFormat::Packed)
+            continue;
+
+        const VertexPackingError& packing = data.stats.packingError;
+        EXPECTF(IsPackingErrorWithinBounds(packing, data.quantization), "%s: pos %g of %g, normal %g degrees, uv %g", path.c_str(),
+            packing.position, GetMaxPackedPositionError(data.quantization), packing.normalDegrees, packing.textureCoords);
+    }
+}
+
+void TestPacking()
+{
+    TestNormals();
+    TestPositionsAndUvs();
+    TestMeshes();
+}
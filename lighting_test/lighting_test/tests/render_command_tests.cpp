@@ -0,0 +1,116 @@
+#include "test.h"
+#include "render_commands.h"
+
+static void TestKeys()
+{
+    uint64_t key = MakeRenderKey(9, 5, 40000, 12.5f, 7);
+    EXPECT(GetRenderKeyPass(key) == 9 && GetRenderKeyShader(key) == 5 && GetRenderKeyMaterial(key) == 40000);
+
+    // pass before shader before material before depth, near to far, and behind the eye counts as nearest
+    EXPECT(MakeRenderKey(0, 15, 65535, 900.0f, 0) < MakeRenderKey(1, 0, 0, 0.1f, 0));
+    EXPECT(MakeRenderKey(2, 0, 65535, 900.0f, 0) < MakeRenderKey(2, 1, 0, 0.1f, 0));
+    EXPECT(MakeRenderKey(2, 1, 3, 900.0f, 0) < MakeRenderKey(2, 1, 4, 0.1f, 0));
+    EXPECT(MakeRenderKey(2, 1, 3, 0.5f, 9) < MakeRenderKey(2, 1, 3, 2.0f, 0));
+    EXPECT(MakeRenderKey(2, 1, 3, -4.0f, 0) == MakeRenderKey(2, 1, 3, 0.0f, 0));
+}
+
+static void TestQueue()
+{
+    // recorded in this order, firstInstance tells them apart after sorting
+    struct Draw
+    {
+        uint32_t pass, shader, material;
+        float depth;
+        uint32_t mesh, indexBuffer, constants;
+    };
+
+    const Draw draws[] =
+    {
+        { 1, 0, 5, 2.0f, 3, 3, 0 },
+        { 0, 1, 2, 5.0f, 1, 1, 1 },
+        { 0, 1, 2, 1.0f, 1, 1, 1 }, // nearer than the one before, binds nothing after it
+        { 0, 0, 2, 9.0f, 2, 9, 2 },
+        { 1, 0, 5, 2.0f, 4, 3, 0 }, // the same key as the first, stays after it
+        { 0, 1, 7, 3.0f, 1, 1, 1 },
+    };
+    constexpr uint32_t DRAW_COUNT = sizeof(draws) / sizeof(draws[0]);
+
+    auto record = [&](uint32_t first)
+    {
+        return [&draws, first](uint32_t begin, uint32_t end, RenderCommandBuffer& buffer)
+        {
+            for (uint32_t i = first + begin; i < first + end; i++)
+            {
+                const Draw& draw = draws[i];
+                RenderCommand command = { draw.mesh, draw.indexBuffer, draw.constants, 0, 36, i, 1, 0 };
+                PushRenderCommand(buffer, MakeRenderKey(draw.pass, draw.shader, draw.material, draw.depth, 0), command);
+            }
+        };
+    };
+
+    // two calls, the second adds its buffers after the first's
+    JobSystem jobs;
+    RenderCommandQueue queue;
+    ResetRenderCommands(queue);
+    RecordRenderCommands(jobs, queue, 4, 2, record(0));
+    RecordRenderCommands(jobs, queue, DRAW_COUNT - 4, 2, record(4));
+    EXPECTF(queue.bufferCount == 3, "%u buffers", queue.bufferCount);
+
+    SortRenderCommands(queue);
+
+    const uint32_t expectedOrder[DRAW_COUNT] = { 3, 2, 1, 5, 0, 4 };
+    const uint32_t expectedChanges[DRAW_COUNT] =
+    {
+        RENDER_STATE_ALL,
+        RENDER_STATE_SHADER | RENDER_STATE_VERTEX_BUFFER | RENDER_STATE_INDEX_BUFFER | RENDER_STATE_CONSTANTS,
+        0,
+        RENDER_STATE_MATERIAL,
+        RENDER_STATE_ALL, // a new pass binds everything again
+        RENDER_STATE_VERTEX_BUFFER,
+    };
+
+    EXPECTF(queue.stats.commands == DRAW_COUNT, "%u commands", queue.stats.commands);
+    for (uint32_t i = 0; i < DRAW_COUNT && i < queue.stats.commands; i++)
+    {
+        uint32_t draw = queue.commands[queue.order[i]].firstInstance;
+        EXPECTF(draw == expectedOrder[i], "sorted %u: draw %u, expected %u", i, draw, expectedOrder[i]);
+        EXPECTF(queue.changes[i] == expectedChanges[i], "sorted %u: changes %x, expected %x", i, queue.changes[i], expectedChanges[i]);
+    }
+
+    EXPECTF(queue.stats.stateChanges == 18 && queue.stats.stateChangesSkipped == 18, "%u bound, %u skipped", queue.stats.stateChanges,
+        queue.stats.stateChangesSkipped);
+
+    // a range binds everything at its first command and then only what changes
+    uint32_t replayed = 0;
+    ReplayRenderCommands(queue, 1, 4, [&](const RenderCommand& command, uint64_t, uint32_t changes)
+    {
+        uint32_t i = 1 + replayed++;
+        EXPECTF(command.firstInstance == expectedOrder[i], "replayed %u: draw %u", i, command.firstInstance);
+        uint32_t expected = i == 1 ? RENDER_STATE_ALL : expectedChanges[i];
+        EXPECTF(changes == expected, "replayed %u: changes %x, expected %x", i, changes, expected);
+    });
+    EXPECT(replayed == 3);
+
+    // the next frame starts empty
+    ResetRenderCommands(queue);
+    SortRenderCommands(queue);
+    EXPECT(queue.stats.commands == 0);
+}
+
+static void TestBenchmark()
+{
+    JobSystem jobs;
+    RenderCommandBenchmarkResult result;
+    RunRenderCommandBenchmark(jobs, 16384, result);
+
+    EXPECTF(result.mismatches == 0, "%u commands sorted differently than std::stable_sort", result.mismatches);
+    EXPECTF(result.sortedStateChanges < result.unsortedStateChanges, "%u state changes sorted, %u in recording order",
+        result.sortedStateChanges, result.unsortedStateChanges);
+}
+
+void TestRenderCommands()
+{
+    TestKeys();
+    TestQueue();
+    TestBenchmark();
+}
@@ -0,0 +1,164 @@
+#include "test.h"
+#include "shader_cache.h"
+
+#include <filesystem>
+#include <fstream>
+
+static void WriteTextFile(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+static uint32_t CountCacheFiles(const std::string& cacheDirectory)
+{
+    uint32_t count = 0;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDirectory, error))
+        count += entry.path().extension() == ".lshader" ? 1 : 0;
+    return count;
+}
+
+static void TestKeys()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "lighting_shader_tests_keys";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory / "include", error);
+
+    WriteTextFile(directory / "shader.hlsl", "#include \"include/outer.hlsli\"\nfloat4 main() : SV_Target { return Outer(); }\n");
+    WriteTextFile(directory / "include" / "outer.hlsli", "#include \"inner.hlsli\"\nfloat4 Outer() { return Inner(); }\n");
+    WriteTextFile(directory / "include" / "inner.hlsli", "float4 Inner() { return 1; }\n");
+
+    ShaderPermutation permutation = { (directory / "shader.hlsl").generic_string(), "main", "ps_5_0", {} };
+
+    uint64_t key = 0, again = 0;
+    EXPECT(GetShaderPermutationKey(permutation, key));
+    EXPECT(GetShaderPermutationKey(permutation, again) && again == key);
+
+    // every part of the permutation is in the key, the id only names the variant and ignores the files
+    ShaderPermutation defined = permutation;
+    defined.defines.push_back({ "FEATURE", "1" });
+    ShaderPermutation otherValue = defined;
+    otherValue.defines[0].value = "2";
+    ShaderPermutation otherProfile = permutation;
+    otherProfile.profile = "ps_5_1";
+    ShaderPermutation otherEntry = permutation;
+    otherEntry.entry = "other";
+
+    for (const ShaderPermutation* variant : { &defined, &otherValue, &otherProfile, &otherEntry })
+    {
+        uint64_t variantKey = 0;
+        EXPECT(GetShaderPermutationKey(*variant, variantKey) && variantKey != key);
+        EXPECT(GetShaderPermutationId(*variant) != GetShaderPermutationId(permutation));
+    }
+    EXPECT(GetShaderPermutationId(defined) != GetShaderPermutationId(otherValue));
+
+    // an include two levels down changes the key but not the id
+    uint64_t id = GetShaderPermutationId(permutation);
+    WriteTextFile(directory / "include" / "inner.hlsli", "float4 Inner() { return 2; }\n");
+    uint64_t edited = 0;
+    EXPECT(GetShaderPermutationKey(permutation, edited) && edited != key);
+    EXPECT(GetShaderPermutationId(permutation) == id);
+
+    // a missing include has no key
+    std::filesystem::remove(directory / "include" / "inner.hlsli", error);
+    EXPECT(!GetShaderPermutationKey(permutation, edited));
+
+    std::filesystem::remove_all(directory, error);
+}
+
+static void TestLoads()
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "lighting_shader_tests_loads";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+
+    WriteTextFile(directory / "a.hlsl", "float4 main() : SV_Target { return 1; }\n");
+    WriteTextFile(directory / "b.hlsl", "float4 main() : SV_Target { return 2; }\n");
+
+    std::string cacheDirectory = (directory / "cache").generic_string();
+    std::string a = (directory / "a.hlsl").generic_string();
+    std::string b = (directory / "b.hlsl").generic_string();
+
+    // two variants of a, one of b
+    const ShaderPermutation permutations[] =
+    {
+        { a, "main", "ps_5_0", {} },
+        { a, "main", "ps_5_0", { { "FEATURE", "1" } } },
+        { b, "main", "ps_5_0", {} },
+    };
+    constexpr uint32_t COUNT = 3;
+
+    JobSystem jobs;
+    auto load = [&](LoadedShader (&shaders)[COUNT])
+    {
+        for (uint32_t i = 0; i < COUNT; i++)
+            shaders[i].permutation = permutations[i];
+        return LoadShaders(jobs, cacheDirectory, shaders, COUNT, CompileShaderStub);
+    };
+
+    LoadedShader cold[COUNT];
+    ShaderLoadStats stats = load(cold);
+    EXPECTF(stats.compiled == COUNT && stats.fromCache == 0 && stats.failed == 0, "cold: %u compiled, %u from cache", stats.compiled,
+        stats.fromCache);
+    EXPECT(CountCacheFiles(cacheDirectory) == COUNT);
+    EXPECT(!std::filesystem::exists(directory / "a.hlsl.lshader"));
+
+    LoadedShader warm[COUNT];
+    stats = load(warm);
+    EXPECTF(stats.fromCache == COUNT && stats.compiled == 0, "warm: %u compiled", stats.compiled);
+    for (uint32_t i = 0; i < COUNT; i++)
+        EXPECTF(warm[i].ok && warm[i].bytecode == cold[i].bytecode, "shader %u", i);
+
+    // editing a compiles both of its variants again, each removes its own old entry and leaves the others alone
+    WriteTextFile(directory / "a.hlsl", "float4 main() : SV_Target { return 3; }\n");
+    LoadedShader edited[COUNT];
+    stats = load(edited);
+    EXPECTF(stats.compiled == 2 && stats.fromCache == 1 && stats.staleRemoved == 2, "edited: %u compiled, %u stale removed",
+        stats.compiled, stats.staleRemoved);
+    EXPECT(edited[0].staleRemoved == 1 && edited[1].staleRemoved == 1 && edited[2].loadedFromCache);
+    EXPECT(CountCacheFiles(cacheDirectory) == COUNT);
+
+    // an entry left by any older key goes the next time its permutation is written, however many there are
+    uint64_t key = edited[2].key;
+    WriteShaderCache(GetShaderCachePath(cacheDirectory, permutations[2], key + 1), key + 1, edited[2].bytecode);
+    WriteShaderCache(GetShaderCachePath(cacheDirectory, permutations[2], key + 2), key + 2, edited[2].bytecode);
+    EXPECT(RemoveStaleShaderCaches(cacheDirectory, permutations[2], key) == 2);
+    EXPECT(CountCacheFiles(cacheDirectory) == COUNT);
+
+    // an entry that does not read back is compiled again and replaced
+    std::string path = GetShaderCachePath(cacheDirectory, permutations[2], key);
+    WriteTextFile(path, "not a shader");
+    std::vector<uint8_t> bytecode;
+    EXPECT(!ReadShaderCache(path, key, bytecode));
+
+    LoadedShader repaired[COUNT];
+    stats = load(repaired);
+    EXPECTF(stats.compiled == 1 && !repaired[2].loadedFromCache && repaired[2].bytecode == edited[2].bytecode, "repaired: %u compiled",
+        stats.compiled);
+    EXPECT(ReadShaderCache(path, key, bytecode) && bytecode == edited[2].bytecode);
+
+    std::filesystem::remove_all(directory, error);
+}
+
+static void TestBenchmark()
+{
+    JobSystem jobs;
+    ShaderCacheBenchmarkResult result;
+    RunShaderCacheBenchmark(jobs, result);
+
+    EXPECT(result.shaderCount > 0);
+    EXPECTF(result.warmMisses == 0, "%u misses with a warm cache", result.warmMisses);
+    EXPECTF(result.includeHits == 0, "%u hits after editing the include", result.includeHits);
+    EXPECTF(result.staleLeft == 0, "%u stale entries left", result.staleLeft);
+    EXPECTF(result.mismatches == 0, "%u cached shaders differ from the compiled ones", result.mismatches);
+}
+
+void TestShaderCache()
+{
+    TestKeys();
+    TestLoads();
+    TestBenchmark();
+}
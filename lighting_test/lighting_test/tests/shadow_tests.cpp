@@ -0,0 +1,104 @@
+#include "test.h"
+#include "shadow_cache.h"
+
+static void TestFaceMask()
+{
+    ShadowCubeProjection projection = { { 1.0f, 2.0f, 3.0f }, 0.05f, 25.0f };
+
+    // on an axis a small sphere is in that face only, around the light it is in every face, past the far plane in none
+    const Vec3 axes[SHADOW_CUBE_FACES] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (uint32_t face = 0; face < SHADOW_CUBE_FACES; face++)
+    {
+        uint32_t mask = GetShadowFaceMask(projection, projection.light + axes[face] * 10.0f, 0.5f);
+        EXPECTF(mask == 1u << face, "face %u: mask %x", face, mask);
+    }
+
+    EXPECT(GetShadowFaceMask(projection, projection.light, 0.5f) == SHADOW_ALL_FACES);
+    EXPECT(GetShadowFaceMask(projection, projection.light + Vec3 { 0.0f, 0.0f, 40.0f }, 1.0f) == 0);
+}
+
+static void TestUpdates()
+{
+    // one mesh, a row of instances along +x, one along -z
+    MeshBounds mesh;
+    mesh.bounds = { { -0.5f, -0.5f, -0.5f }, { 0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 0.0f }, 0.866f };
+    mesh.submeshes.push_back(mesh.bounds);
+
+    Scene scene;
+    for (uint32_t i = 0; i < 4; i++)
+        AddInstance(scene, 0, { { 4.0f + 3.0f * i, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    AddInstance(scene, 0, { { 0.0f, 0.0f, -6.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+
+    std::vector<uint32_t> order;
+    std::vector<InstanceRange> ranges;
+    SortInstancesByMesh(scene, 1, order, ranges);
+
+    JobSystem jobs;
+    std::vector<InstanceData> instances(order.size());
+    ShadowCubeCache cache;
+    ShadowCubeProjection projection = { { 0.0f, 0.0f, 0.0f }, 0.05f, 25.0f };
+
+    auto update = [&]()
+    {
+        ComputeInstanceData(jobs, scene, order.data(), (uint32_t)order.size(), instances.data());
+        return UpdateShadowCube(jobs, projection, &mesh, 1, instances.data(), ranges.data(), cache);
+    };
+
+    EXPECT(update() == SHADOW_ALL_FACES);
+    EXPECT(update() == 0);
+
+    // spinning in place inside +x
+    SetInstanceTransform(scene, 1, { { 7.0f, 0.0f, 0.0f }, { 0.0f, 30.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    uint32_t mask = update();
+    EXPECTF(mask == 1u << 0, "mask %x", mask);
+    EXPECT(cache.stats.instancesChanged == 1);
+
+    // from -z over to +y, both faces
+    SetInstanceTransform(scene, 4, { { 0.0f, 6.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    mask = update();
+    EXPECTF(mask == ((1u << 5) | (1u << 2)), "mask %x", mask);
+
+    // what moves past the far plane still takes its casters out of the face it left
+    SetInstanceTransform(scene, 3, { { 40.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } });
+    mask = update();
+    EXPECTF(mask == 1u << 0, "mask %x", mask);
+
+    ShadowCasterSet casters;
+    GatherShadowCasters(jobs, cache, mask, instances.data(), ranges.data(), 1, casters);
+    EXPECT(casters.faceMask == mask);
+    EXPECTF(casters.instances.size() == 3, "%zu casters", casters.instances.size());
+
+    EXPECT(update() == 0);
+
+    projection.light = { 0.0f, 0.1f, 0.0f };
+    EXPECT(update() == SHADOW_ALL_FACES);
+}
+
+static void TestScenes()
+{
+    // the benchmark's brute force comparison: a face whose casters differ from the ones it was drawn with is redrawn
+    JobSystem jobs;
+    ShadowBenchmarkResult result;
+    RunShadowBenchmark(jobs, 1024, result);
+
+    EXPECTF(result.faceTestMisses == 0, "%u face test misses", result.faceTestMisses);
+    EXPECT(!result.scenes.empty());
+
+    for (const ShadowBenchmarkScene& scene : result.scenes)
+    {
+        EXPECTF(scene.facesMissed == 0, "%s: %u faces missed", scene.name, scene.facesMissed);
+        EXPECTF(scene.facesRedrawn >= scene.facesNeeded, "%s", scene.name);
+        EXPECTF(scene.facesRedrawn <= scene.frames * SHADOW_CUBE_FACES, "%s", scene.name);
+    }
+
+    // nothing moving redraws nothing, the light moving redraws everything
+    EXPECTF(result.scenes.front().facesRedrawn == 0, "%s: %u redrawn", result.scenes.front().name, result.scenes.front().facesRedrawn);
+    EXPECTF(result.scenes.back().facesRedrawn == result.scenes.back().frames * SHADOW_CUBE_FACES, "%s", result.scenes.back().name);
+}
+
+void TestShadows()
+{
+    TestFaceMask();
+    TestUpdates();
+    TestScenes();
+}
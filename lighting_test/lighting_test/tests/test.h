@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+
+// the checks of lighting_tests. a failed expectation prints where and what and the suite goes on, the suite fails
+// when any did. core.h's check() stops the program instead, which is not what a test wants
+
+extern int gTestFailures;
+
+#define EXPECT(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s(%d): expected %s\n", __FILE__, __LINE__, #condition); \
+            gTestFailures++; \
+        } \
+    } while (false)
+
+// printf style context after the condition
+#define EXPECTF(condition, ...) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s(%d): expected %s, ", __FILE__, __LINE__, #condition); \
+            fprintf(stderr, __VA_ARGS__); \
+            fprintf(stderr, "\n"); \
+            gTestFailures++; \
+        } \
+    } while (false)
@@ -0,0 +1,92 @@
+#include "test.h"
+
+#include <string.h>
+#include <vector>
+
+// the checks the benchmarks print as numbers, asserted. every suite is a ctest of its own, see CMakeLists.txt,
+// run from the project directory like lighting_bench so the suites that load assets find them
+
+int gTestFailures = 0;
+
+void TestAtlas();
+void TestRenderCommands();
+void TestLightCulling();
+void TestLods();
+void TestMeshCache();
+void TestPacking();
+void TestShaderCache();
+void TestShadows();
+
+struct TestSuite
+{
+    const char* name;
+    void (*run)();
+};
+
+static const TestSuite sTestSuites[] =
+{
+    { "atlas", TestAtlas },
+    { "commands", TestRenderCommands },
+    { "lights", TestLightCulling },
+    { "lods", TestLods },
+    { "meshcache", TestMeshCache },
+    { "packing", TestPacking },
+    { "shaders", TestShaderCache },
+    { "shadows", TestShadows },
+};
+
+static void PrintUsage()
+{
+    printf("usage: lighting_tests [suite...]\n"
+           "runs every suite when none is named, one of:");
+    for (const TestSuite& suite : sTestSuites)
+        printf(" %s", suite.name);
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<const TestSuite*> selected;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+        {
+            PrintUsage();
+            return 0;
+        }
+
+        const TestSuite* found = nullptr;
+        for (const TestSuite& suite : sTestSuites)
+        {
+            if (!strcmp(arg, suite.name))
+                found = &suite;
+        }
+
+        if (!found)
+        {
+            fprintf(stderr, "unknown suite %s\n", arg);
+            PrintUsage();
+            return 1;
+        }
+
+        selected.push_back(found);
+    }
+
+    if (selected.empty())
+    {
+        for (const TestSuite& suite : sTestSuites)
+            selected.push_back(&suite);
+    }
+
+    for (const TestSuite* suite : selected)
+    {
+        int failuresBefore = gTestFailures;
+        suite->run();
+        printf("%s: %s\n", suite->name, gTestFailures == failuresBefore ? "passed" : "FAILED");
+    }
+
+    return gTestFailures ? 1 : 0;
+}